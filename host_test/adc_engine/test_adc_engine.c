@@ -0,0 +1,393 @@
+/**
+ * @file test_adc_engine.c
+ * @brief   Benchmark del motor de adquisición del ADC1 con una señal sintética: los canales de pH y TDS se muestrean
+ *          en modo continuo (DMA simulado, a ADC_ENGINE_SAMPLE_FREQ_HZ repartida entre ambos canales) con un valor
+ *          constante por canal, al que se suma ruido gaussiano, zumbido de 50 Hz de la red e impulsos aislados.
+ *
+ *          -Ruido: se compara el valor filtrado que reciben las funciones callback de los sensores (cada 3 s) con el
+ *           valor de la señal, y con el de la adquisición original de las tareas de pH y TDS (10 conversiones
+ *           separadas 10 ms, ordenadas por el método de la burbuja, tomando la sexta) sobre la misma señal.
+ *          -Rendimiento: se mide el tiempo de procesamiento de la tarea del motor por muestra (sin contar la
+ *           generación de la señal), y la fracción de CPU que representa a la frecuencia de muestreo del motor.
+ *
+ *          Además, se verifica que el motor procesa todas las muestras generadas, que cada canal recibe solo sus
+ *          muestras, y que las funciones callback se ejecutan con el período de cada canal. El tiempo se mide en el
+ *          host: sirve para comparar, pero no es el costo en el ESP32.
+ */
+
+#include <math.h>
+#include <time.h>
+#include <setjmp.h>
+
+#include "ADC_ENGINE.c"
+
+/* Canales y período de las funciones callback de los sensores de pH y TDS (AUXILIARES_ALGORITMO_CONTROL_*). */
+#define TEST_CANAL_PH ADC1_CHANNEL_0
+#define TEST_CANAL_TDS ADC1_CHANNEL_3
+#define TEST_PERIODO_MS 3000
+
+/* Tiempo simulado, y tiempo inicial descartado (hasta que se llena la ventana de la mediana), en s. */
+#define TEST_DURACION_S 600
+#define TEST_ARRANQUE_S 3
+
+/* Señal sintética, en cuentas del ADC: valor de cada canal, ruido gaussiano, zumbido e impulsos. */
+#define TEST_VALOR_PH 1850
+#define TEST_VALOR_TDS 640
+#define TEST_RUIDO_SIGMA 20.0
+#define TEST_ZUMBIDO_AMPLITUD 30.0
+#define TEST_ZUMBIDO_HZ 50.0
+#define TEST_IMPULSO_PROB 200           /* Uno cada TEST_IMPULSO_PROB muestras, en promedio. */
+#define TEST_IMPULSO_MAX 1500
+
+/* Errores máximos admitidos del valor filtrado frente al valor de la señal, en cuentas del ADC. */
+#define TEST_ERROR_MAX 2
+#define TEST_ERROR_RMS_MAX 1.0
+
+#define TEST_CANALES 2
+
+static const adc1_channel_t test_canales[TEST_CANALES] = { TEST_CANAL_PH, TEST_CANAL_TDS };
+static const char *test_nombres[TEST_CANALES] = { "pH", "TDS" };
+static const int test_valores[TEST_CANALES] = { TEST_VALOR_PH, TEST_VALOR_TDS };
+
+static uint32_t test_semilla = 1;
+
+/* Patrón de muestreo configurado en el controlador digital del ADC. */
+static adc_digi_pattern_config_t test_patron[SOC_ADC_PATT_LEN_MAX];
+static uint32_t test_patron_len;
+static bool test_dma_activo;
+
+/* Muestras generadas, lecturas del DMA y tiempo de generación de la señal. */
+static uint64_t test_muestras;
+static uint64_t test_muestras_max;
+static uint32_t test_lecturas;
+static uint64_t test_generacion_ns;
+static jmp_buf test_fin;
+
+/* Errores del valor filtrado recibido por las funciones callback. */
+typedef struct {
+    uint32_t callbacks;
+    uint32_t medidos;
+    int64_t ultimo_us;
+    uint32_t periodo_min_ms;
+    uint32_t periodo_max_ms;
+    double suma;
+    double suma_cuad;
+    int error_max;
+} test_errores_t;
+
+static test_errores_t test_motor[TEST_CANALES];
+
+/*==================[AUXILIARES]=============================================*/
+
+static uint32_t test_rand(void)
+{
+    test_semilla ^= test_semilla << 13;
+    test_semilla ^= test_semilla >> 17;
+    test_semilla ^= test_semilla << 5;
+    return test_semilla;
+}
+
+static uint64_t test_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static int64_t test_ahora_us(void)
+{
+    return (int64_t) (test_muestras * 1000000 / ADC_ENGINE_SAMPLE_FREQ_HZ);
+}
+
+/* Ruido gaussiano de varianza unitaria (Box-Muller). */
+static double test_gauss(void)
+{
+    double u1 = (test_rand() + 1.0) / 4294967297.0;
+    double u2 = test_rand() / 4294967296.0;
+
+    return sqrt(-2.0 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+/* Conversión del ADC del canal "c" en el instante "t_us". */
+static uint16_t test_senal(int c, int64_t t_us)
+{
+    double v = test_valores[c] + TEST_RUIDO_SIGMA * test_gauss()
+               + TEST_ZUMBIDO_AMPLITUD * sin(2 * M_PI * TEST_ZUMBIDO_HZ * t_us / 1e6);
+
+    if(test_rand() % TEST_IMPULSO_PROB == 0)
+    {
+        v += (int) (test_rand() % (2 * TEST_IMPULSO_MAX + 1)) - TEST_IMPULSO_MAX;
+    }
+
+    long raw = lround(v);
+
+    return raw < 0 ? 0 : raw > 4095 ? 4095 : raw;
+}
+
+static int test_indice(adc1_channel_t canal)
+{
+    for(int c = 0; c < TEST_CANALES; c++)
+    {
+        if(test_canales[c] == canal)
+        {
+            return c;
+        }
+    }
+
+    return -1;
+}
+
+static void test_acumular(test_errores_t *e, int error)
+{
+    e->medidos++;
+    e->suma += error;
+    e->suma_cuad += (double) error * error;
+    e->error_max = abs(error) > e->error_max ? abs(error) : e->error_max;
+}
+
+static void test_callback(int c, uint16_t raw)
+{
+    test_errores_t *e = &test_motor[c];
+    int64_t ahora_us = test_ahora_us();
+
+    if(e->callbacks++ > 0)
+    {
+        uint32_t periodo_ms = (ahora_us - e->ultimo_us) / 1000;
+
+        e->periodo_min_ms = periodo_ms < e->periodo_min_ms ? periodo_ms : e->periodo_min_ms;
+        e->periodo_max_ms = periodo_ms > e->periodo_max_ms ? periodo_ms : e->periodo_max_ms;
+    }
+
+    e->ultimo_us = ahora_us;
+
+    if(ahora_us >= TEST_ARRANQUE_S * 1000000LL)
+    {
+        test_acumular(e, (int) raw - test_valores[c]);
+    }
+}
+
+static void test_callback_ph(uint16_t raw)
+{
+    test_callback(0, raw);
+}
+
+static void test_callback_tds(uint16_t raw)
+{
+    test_callback(1, raw);
+}
+
+/* Adquisición original de las tareas de pH y TDS, a partir del instante "t_us". */
+static uint16_t test_adquisicion_original(int c, int64_t t_us)
+{
+    int buffer[10];
+    int aux = 0;
+
+    for(int i = 0; i < 10; i++)
+    {
+        buffer[i] = test_senal(c, t_us + i * 10000);
+    }
+
+    for(int i = 1; i < 10; i++)
+    {
+        for(int j = 0; j < 10 - i; j++)
+        {
+            if(buffer[j] > buffer[j + 1])
+            {
+                aux = buffer[j];
+                buffer[j] = buffer[j + 1];
+                buffer[j + 1] = aux;
+            }
+        }
+    }
+
+    return buffer[5];
+}
+
+/*==================[MOCKS]==================================================*/
+
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t *config)
+{
+    memcpy(test_patron, config->adc_pattern, config->pattern_num * sizeof(adc_digi_pattern_config_t));
+    test_patron_len = config->pattern_num;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_start(void)
+{
+    test_dma_activo = 1;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_stop(void)
+{
+    test_dma_activo = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_digi_deinitialize(void)
+{
+    return ESP_OK;
+}
+
+/**
+ *  Lectura del buffer DMA: se generan las conversiones siguientes del patrón de muestreo en formato TYPE1. Al llegar
+ *  a la cantidad de muestras del test, se vuelve al test.
+ */
+esp_err_t adc_digi_read_bytes(uint8_t *buffer, uint32_t largo, uint32_t *leidos, uint32_t espera_ms)
+{
+    if(!test_dma_activo || test_patron_len == 0 || test_muestras >= test_muestras_max)
+    {
+        longjmp(test_fin, 1);
+    }
+
+    uint64_t t0 = test_ns();
+    uint32_t n = 0;
+
+    for(; n + SOC_ADC_DIGI_RESULT_BYTES <= largo && test_muestras < test_muestras_max; n += SOC_ADC_DIGI_RESULT_BYTES)
+    {
+        adc_digi_output_data_t dato = {0};
+        uint8_t canal = test_patron[test_muestras % test_patron_len].channel;
+
+        dato.type1.channel = canal;
+        dato.type1.data = test_senal(test_indice(canal), test_ahora_us());
+        memcpy(&buffer[n], &dato, sizeof(dato));
+
+        test_muestras++;
+    }
+
+    *leidos = n;
+    test_lecturas++;
+    test_generacion_ns += test_ns() - t0;
+
+    return ESP_OK;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle)
+{
+    *handle = (TaskHandle_t) tarea;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t tarea)
+{
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t espera)
+{
+    longjmp(test_fin, 1);
+}
+
+/* Una única tarea se ejecuta a la vez: el mutex siempre está disponible. */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return (SemaphoreHandle_t) 1;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t espera)
+{
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    return pdTRUE;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return test_ahora_us();
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    int fallas = 0;
+
+    for(int c = 0; c < TEST_CANALES; c++)
+    {
+        test_motor[c].periodo_min_ms = UINT32_MAX;
+    }
+
+    if(adc_engine_add_channel(TEST_CANAL_PH, TEST_PERIODO_MS, test_callback_ph) != ESP_OK ||
+       adc_engine_add_channel(TEST_CANAL_TDS, TEST_PERIODO_MS, test_callback_tds) != ESP_OK)
+    {
+        printf("FAIL: no se pudieron agregar los canales\n");
+        return 1;
+    }
+
+    /**
+     *  Se ejecuta la tarea del motor sobre toda la señal. El tiempo de la tarea es el tiempo total menos el de la
+     *  generación de la señal dentro de las lecturas del DMA.
+     */
+    test_muestras_max = (uint64_t) TEST_DURACION_S * ADC_ENGINE_SAMPLE_FREQ_HZ;
+
+    uint64_t t0 = test_ns();
+
+    if(!setjmp(test_fin))
+    {
+        vTaskAdcEngine(NULL);
+    }
+
+    uint64_t total_ns = test_ns() - t0;
+
+    adc_engine_stats_t stats;
+    adc_engine_get_stats(&stats);
+
+    bool muestras_ok = test_patron_len == TEST_CANALES && stats.samples == test_muestras_max
+                       && stats.frames == test_lecturas && stats.overflows == 0;
+
+    printf("%s: %u s a %d Hz, patrón de %u canales, %u lecturas del DMA, %u muestras procesadas de %llu generadas\n",
+           muestras_ok ? "ok" : "FAIL", TEST_DURACION_S, ADC_ENGINE_SAMPLE_FREQ_HZ, test_patron_len, stats.frames,
+           stats.samples, (unsigned long long) test_muestras_max);
+
+    fallas += !muestras_ok;
+
+    /**
+     *  Adquisición original sobre la misma señal: 10 conversiones cada TEST_PERIODO_MS.
+     */
+    test_errores_t original[TEST_CANALES] = {0};
+
+    for(int c = 0; c < TEST_CANALES; c++)
+    {
+        for(int64_t t_us = TEST_ARRANQUE_S * 1000000LL; t_us < TEST_DURACION_S * 1000000LL; t_us += TEST_PERIODO_MS * 1000)
+        {
+            test_acumular(&original[c], (int) test_adquisicion_original(c, t_us) - test_valores[c]);
+        }
+    }
+
+    for(int c = 0; c < TEST_CANALES; c++)
+    {
+        test_errores_t *m = &test_motor[c], *o = &original[c];
+        double rms_motor = sqrt(m->suma_cuad / m->medidos), rms_original = sqrt(o->suma_cuad / o->medidos);
+        uint32_t callbacks_esperados = TEST_DURACION_S * 1000 / TEST_PERIODO_MS;
+
+        /* Las funciones callback se ejecutan al leer el DMA: el período se cumple con la resolución de una lectura. */
+        bool ok = m->callbacks >= callbacks_esperados - 1 && m->callbacks <= callbacks_esperados
+                  && m->periodo_min_ms >= TEST_PERIODO_MS && m->periodo_max_ms <= TEST_PERIODO_MS + 20
+                  && m->error_max <= TEST_ERROR_MAX && rms_motor <= TEST_ERROR_RMS_MAX && rms_motor < rms_original;
+
+        printf("%s: canal %s (valor %d): %u callbacks (período %u a %u ms), error del motor: medio %+.2f, rms %.2f, "
+               "máximo %d cuentas | adquisición original: medio %+.2f, rms %.2f, máximo %d cuentas\n",
+               ok ? "ok" : "FAIL", test_nombres[c], test_valores[c], m->callbacks, m->periodo_min_ms, m->periodo_max_ms,
+               m->suma / m->medidos, rms_motor, m->error_max, o->suma / o->medidos, rms_original, o->error_max);
+
+        fallas += !ok;
+    }
+
+    double ns_muestra = (double) (total_ns - test_generacion_ns) / stats.samples;
+
+    printf("benchmark (host), tarea del motor: %.1f ns por muestra (%.1f millones de muestras por segundo), "
+           "%.3f %% de CPU a %d Hz\n",
+           ns_muestra, 1e3 / ns_muestra, ns_muestra * ADC_ENGINE_SAMPLE_FREQ_HZ / 1e7, ADC_ENGINE_SAMPLE_FREQ_HZ);
+
+    printf("%s: %d fallas\n", fallas ? "FAIL" : "PASS", fallas);
+
+    return fallas ? 1 : 0;
+}
@@ -0,0 +1,475 @@
+/**
+ * @file test_co2_pwm.c
+ * @brief   Test de la medición de CO2 por PWM a partir de flancos marcados temporalmente en la rutina de interrupción:
+ *          la tarea "vTaskGetCO2ByPWM()" procesa secuencias sintéticas de flancos del PWM del MH-Z19C (período nominal
+ *          de 1004 ms, th = 2 ms + (período - 4 ms) * ppm / 5000), entregadas por la rutina de interrupción en tiempo
+ *          simulado, y se verifican las mediciones que recibe la función callback:
+ *
+ *          -Ciclo normal: una medición exacta por ciclo, a partir del primer ciclo completo.
+ *          -Inicio en medio de un pulso en alto: el pulso incompleto no genera una medición.
+ *          -Flanco faltante: sin un flanco descendente se pierde el ciclo sin error; sin un flanco ascendente, el ciclo
+ *           resultante tiene un período fuera de rango y se informa un error. En ambos casos, el ciclo siguiente se
+ *           mide correctamente.
+ *          -Período y tiempo en alto fuera de rango: se informa un error, y el ciclo siguiente se mide correctamente.
+ *          -Sin flancos: se informa un error por cada tiempo de espera cumplido, y la medición se reanuda con el primer
+ *           ciclo completo.
+ *
+ *          Además, se verifica "co2_sensor_decode_edge()" por separado sobre un ciclo.
+ */
+
+#include <math.h>
+#include <setjmp.h>
+
+#include "CO2_SENSOR.c"
+
+/* Pin del sensor, y período nominal del PWM, en us. */
+#define TEST_PIN 33
+#define TEST_PERIODO_US 1004000
+
+/* Inicio del tiempo simulado, luego del tiempo de calentamiento del sensor, en us. */
+#define TEST_INICIO_US 100000000
+
+/* Flancos y mediciones máximos por escenario. */
+#define TEST_FLANCOS_MAX 64
+#define TEST_MEDICIONES_MAX 32
+
+/* Diferencia máxima admitida frente al valor esperado, en ppm. */
+#define TEST_ERROR_MAX_PPM 0.01
+
+#define TEST_ERROR CO2_SENSOR_MEASURE_ERROR
+
+/* Secuencia de flancos del escenario, y flanco siguiente a entregar. */
+static co2_sensor_edge_t test_flancos[TEST_FLANCOS_MAX];
+static int test_flancos_num;
+static int test_flanco_sig;
+
+/* Tiempo simulado, nivel del pin, y contexto para volver al test al terminar la secuencia. */
+static int64_t test_ahora_us;
+static int test_nivel;
+static jmp_buf test_fin;
+
+/* Mediciones recibidas por la función callback. */
+static CO2_sensor_ppm_t test_mediciones[TEST_MEDICIONES_MAX];
+static int test_mediciones_num;
+
+/*==================[MOCKS]==================================================*/
+
+int64_t esp_timer_get_time(void)
+{
+    return test_ahora_us;
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+    return test_nivel;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin)
+{
+    return ESP_OK;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t) 1;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t tarea, BaseType_t *despertada)
+{
+    *despertada = pdTRUE;
+}
+
+/**
+ *  La tarea queda bloqueada hasta el próximo flanco, que se entrega a través de la rutina de interrupción, o hasta que
+ *  se cumple el tiempo de espera. Al terminar la secuencia, se vuelve al test.
+ */
+uint32_t ulTaskNotifyTake(BaseType_t limpiar, TickType_t espera)
+{
+    if(test_flanco_sig >= test_flancos_num)
+    {
+        longjmp(test_fin, 1);
+    }
+
+    int64_t limite_us = test_ahora_us + (int64_t) espera * portTICK_PERIOD_MS * 1000;
+    const co2_sensor_edge_t *flanco = &test_flancos[test_flanco_sig];
+
+    if(flanco->time_us > limite_us)
+    {
+        test_ahora_us = limite_us;
+        return 0;
+    }
+
+    test_flanco_sig++;
+    test_ahora_us = flanco->time_us;
+    test_nivel = flanco->level;
+    co2_sensor_isr_handler(NULL);
+
+    return 1;
+}
+
+/* Inicialización y lectura por UART: no se utilizan en el test. */
+uint8_t mhz19b_calc_crc(uint8_t *data)
+{
+    return 0;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t isr, void *arg)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx, int tx, int cola, QueueHandle_t *handle, int flags)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t uart_driver_delete(uart_port_t port)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t uart_flush_input(uart_port_t port)
+{
+    return ESP_FAIL;
+}
+
+int uart_write_bytes(uart_port_t port, const void *data, size_t len)
+{
+    return -1;
+}
+
+int uart_read_bytes(uart_port_t port, void *data, uint32_t len, TickType_t espera)
+{
+    return -1;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t cola, void *item, TickType_t espera)
+{
+    return pdFALSE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t cola)
+{
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return NULL;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t espera)
+{
+    return pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    return pdFALSE;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle)
+{
+    return pdFAIL;
+}
+
+void vTaskDelayUntil(TickType_t *ultimo, TickType_t periodo)
+{
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return 0;
+}
+
+/*==================[AUXILIARES]=============================================*/
+
+static void test_callback(void *pvParameters)
+{
+    if(test_mediciones_num < TEST_MEDICIONES_MAX)
+    {
+        test_mediciones[test_mediciones_num++] = CO2_ppm_pwm;
+    }
+}
+
+static void test_flanco(int64_t t_us, bool nivel)
+{
+    test_flancos[test_flancos_num++] = (co2_sensor_edge_t) { .time_us = t_us, .level = nivel };
+}
+
+/* Tiempo en alto del ciclo de un período dado para una concentración de CO2, según la ecuación del fabricante. */
+static int64_t test_th_us(int64_t periodo_us, int ppm)
+{
+    return 2000 + (periodo_us - 4000) * ppm / 5000;
+}
+
+/**
+ *  Agrega un ciclo del PWM (flanco ascendente y descendente) que comienza en "t_us", omitiendo los flancos indicados,
+ *  y devuelve el instante del ciclo siguiente.
+ */
+static int64_t test_ciclo(int64_t t_us, int64_t periodo_us, int64_t th_us, bool sin_subida, bool sin_bajada)
+{
+    if(!sin_subida)
+    {
+        test_flanco(t_us, 1);
+    }
+
+    if(!sin_bajada)
+    {
+        test_flanco(t_us + th_us, 0);
+    }
+
+    return t_us + periodo_us;
+}
+
+static int64_t test_ciclo_ppm(int64_t t_us, int ppm)
+{
+    return test_ciclo(t_us, TEST_PERIODO_US, test_th_us(TEST_PERIODO_US, ppm), 0, 0);
+}
+
+static void test_nuevo_escenario(void)
+{
+    test_flancos_num = 0;
+    test_flanco_sig = 0;
+    test_mediciones_num = 0;
+    test_ahora_us = TEST_INICIO_US;
+    test_nivel = 0;
+}
+
+/* Ejecuta la tarea sobre la secuencia de flancos, y compara las mediciones recibidas con las esperadas. */
+static bool test_correr(const char *nombre, const CO2_sensor_ppm_t *esperadas, int esperadas_num)
+{
+    CO2_edge_head = 0;
+    CO2_edge_tail = 0;
+    CO2_edge_overflow = 0;
+    CO2_ppm_history_idx = 0;
+    CO2_ppm_history_count = 0;
+    CO2_ppm_pwm = CO2_SENSOR_MEASURE_ERROR;
+
+    if(!setjmp(test_fin))
+    {
+        vTaskGetCO2ByPWM(NULL);
+    }
+
+    bool ok = test_mediciones_num == esperadas_num;
+
+    for(int i = 0; ok && i < esperadas_num; i++)
+    {
+        ok = fabs(test_mediciones[i] - esperadas[i]) <= TEST_ERROR_MAX_PPM;
+    }
+
+    printf("%s: %s, %d flancos: mediciones", ok ? "ok" : "FAIL", nombre, test_flancos_num);
+
+    for(int i = 0; i < test_mediciones_num; i++)
+    {
+        test_mediciones[i] == TEST_ERROR ? printf(" error") : printf(" %.1f", test_mediciones[i]);
+    }
+
+    if(!ok)
+    {
+        printf(" | esperadas");
+
+        for(int i = 0; i < esperadas_num; i++)
+        {
+            esperadas[i] == TEST_ERROR ? printf(" error") : printf(" %.1f", esperadas[i]);
+        }
+    }
+
+    printf("\n");
+
+    return ok;
+}
+
+/*==================[ESCENARIOS]=============================================*/
+
+static bool test_decodificador(void)
+{
+    co2_sensor_decoder_t decoder = {0};
+    int64_t th_us = 0, periodo_us = 0;
+    int64_t t_us = TEST_INICIO_US, th_esperado = test_th_us(TEST_PERIODO_US, 1000);
+
+    bool ok = !co2_sensor_decode_edge(&decoder, &(co2_sensor_edge_t) { t_us, 1 }, &th_us, &periodo_us);
+    ok &= !co2_sensor_decode_edge(&decoder, &(co2_sensor_edge_t) { t_us + th_esperado, 0 }, &th_us, &periodo_us);
+    ok &= co2_sensor_decode_edge(&decoder, &(co2_sensor_edge_t) { t_us + TEST_PERIODO_US, 1 }, &th_us, &periodo_us);
+    ok &= th_us == th_esperado && periodo_us == TEST_PERIODO_US;
+
+    /* El ciclo siguiente se mide desde el último flanco ascendente. */
+    ok &= decoder.rise_us == t_us + TEST_PERIODO_US && decoder.fall_us == 0;
+
+    printf("%s: co2_sensor_decode_edge, ciclo de 1000 ppm: th %lld us, período %lld us\n", ok ? "ok" : "FAIL",
+           (long long) th_us, (long long) periodo_us);
+
+    return ok;
+}
+
+static bool test_ciclo_normal(void)
+{
+    static const int ppm[] = { 400, 650, 1000, 2000, 4500 };
+    CO2_sensor_ppm_t esperadas[5];
+
+    test_nuevo_escenario();
+
+    int64_t t_us = TEST_INICIO_US + 300000;
+
+    for(int i = 0; i < 5; i++)
+    {
+        t_us = test_ciclo_ppm(t_us, ppm[i]);
+        esperadas[i] = ppm[i];
+    }
+
+    /* Flanco ascendente que cierra el último ciclo. */
+    test_flanco(t_us, 1);
+
+    return test_correr("ciclo normal", esperadas, 5);
+}
+
+static bool test_inicio_en_alto(void)
+{
+    static const CO2_sensor_ppm_t esperadas[] = { 800, 1200 };
+
+    test_nuevo_escenario();
+
+    /* El pin está en alto al habilitarse la interrupción: el primer flanco es descendente. */
+    test_nivel = 1;
+    test_flanco(TEST_INICIO_US + 150000, 0);
+
+    int64_t t_us = TEST_INICIO_US + 500000;
+
+    t_us = test_ciclo_ppm(t_us, 800);
+    t_us = test_ciclo_ppm(t_us, 1200);
+    test_flanco(t_us, 1);
+
+    return test_correr("inicio en medio de un pulso en alto", esperadas, 2);
+}
+
+static bool test_flanco_faltante(void)
+{
+    bool ok = 1;
+
+    /* Sin el flanco descendente del tercer ciclo: ese ciclo se pierde. */
+    {
+        static const CO2_sensor_ppm_t esperadas[] = { 500, 600, 800, 900 };
+
+        test_nuevo_escenario();
+
+        int64_t t_us = TEST_INICIO_US + 100000;
+
+        t_us = test_ciclo_ppm(t_us, 500);
+        t_us = test_ciclo_ppm(t_us, 600);
+        t_us = test_ciclo(t_us, TEST_PERIODO_US, test_th_us(TEST_PERIODO_US, 700), 0, 1);
+        t_us = test_ciclo_ppm(t_us, 800);
+        t_us = test_ciclo_ppm(t_us, 900);
+        test_flanco(t_us, 1);
+
+        ok &= test_correr("sin flanco descendente", esperadas, 4);
+    }
+
+    /* Sin el flanco ascendente del tercer ciclo: el segundo y el tercero se unen en un ciclo inválido. */
+    {
+        static const CO2_sensor_ppm_t esperadas[] = { 500, TEST_ERROR, 800, 900 };
+
+        test_nuevo_escenario();
+
+        int64_t t_us = TEST_INICIO_US + 100000;
+
+        t_us = test_ciclo_ppm(t_us, 500);
+        t_us = test_ciclo_ppm(t_us, 600);
+        t_us = test_ciclo(t_us, TEST_PERIODO_US, test_th_us(TEST_PERIODO_US, 700), 1, 0);
+        t_us = test_ciclo_ppm(t_us, 800);
+        t_us = test_ciclo_ppm(t_us, 900);
+        test_flanco(t_us, 1);
+
+        ok &= test_correr("sin flanco ascendente", esperadas, 4);
+    }
+
+    return ok;
+}
+
+static bool test_fuera_de_rango(void)
+{
+    static const CO2_sensor_ppm_t esperadas[] = { 1000, TEST_ERROR, TEST_ERROR, TEST_ERROR, 1000 };
+
+    test_nuevo_escenario();
+
+    int64_t t_us = TEST_INICIO_US + 100000;
+
+    t_us = test_ciclo_ppm(t_us, 1000);
+
+    /* Períodos por encima y por debajo del rango (1004 ms +-5 %), y tiempo en alto menor a 2 ms. */
+    t_us = test_ciclo(t_us, CO2_SENSOR_PERIOD_MAX_US + 1000, test_th_us(CO2_SENSOR_PERIOD_MAX_US + 1000, 1000), 0, 0);
+    t_us = test_ciclo(t_us, CO2_SENSOR_PERIOD_MIN_US - 1000, test_th_us(CO2_SENSOR_PERIOD_MIN_US - 1000, 1000), 0, 0);
+    t_us = test_ciclo(t_us, TEST_PERIODO_US, 1500, 0, 0);
+
+    t_us = test_ciclo_ppm(t_us, 1000);
+    test_flanco(t_us, 1);
+
+    return test_correr("período y tiempo en alto fuera de rango", esperadas, 5);
+}
+
+static bool test_sin_flancos(void)
+{
+    /* 3 s sin flancos: dos tiempos de espera de CO2_SENSOR_EDGE_TIMEOUT_MS cumplidos. */
+    static const CO2_sensor_ppm_t esperadas[] = { 1500, TEST_ERROR, TEST_ERROR, 1600, 1700 };
+
+    test_nuevo_escenario();
+
+    int64_t t_us = TEST_INICIO_US + 100000;
+
+    t_us = test_ciclo_ppm(t_us, 1500);
+    test_flanco(t_us, 1);
+
+    t_us += 3000000;
+
+    t_us = test_ciclo_ppm(t_us, 1600);
+    t_us = test_ciclo_ppm(t_us, 1700);
+    test_flanco(t_us, 1);
+
+    return test_correr("sin flancos durante 3 s", esperadas, 5);
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    int fallas = 0;
+
+    CO2_SENSOR_PWM_PIN = TEST_PIN;
+    CO2_warm_up_time_start = 0;
+    CO2_sensor_callback_function_on_new_measurment(test_callback);
+
+    fallas += !test_decodificador();
+    fallas += !test_ciclo_normal();
+    fallas += !test_inicio_en_alto();
+    fallas += !test_flanco_faltante();
+    fallas += !test_fuera_de_rango();
+    fallas += !test_sin_flancos();
+
+    printf("%s: %d fallas\n", fallas ? "FAIL" : "PASS", fallas);
+
+    return fallas ? 1 : 0;
+}
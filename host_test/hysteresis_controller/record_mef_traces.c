@@ -0,0 +1,134 @@
+/**
+ * @file record_mef_traces.c
+ * @brief   Grabador de las trazas de referencia del replay de los lazos de control de pH, TDS y temperatura.
+ *
+ *          Compila las MEFs originales de los tres lazos, tal como estaban antes del motor de control por ventana
+ *          de histéresis (el Makefile las extrae del historial de git), y graba la traza de cada semilla. El único
+ *          cambio a las fuentes originales es que el "while(1)" de cada tarea se reemplaza por una única pasada,
+ *          para poder evaluarlas desde el replay.
+ *
+ *          Las MEFs originales se evaluaban cada 100 ms, y algunas transiciones necesitaban más de una evaluación
+ *          para completarse (por ejemplo, al entrar al estado BAJO, la válvula se abría en la evaluación siguiente).
+ *          El motor, en cambio, evalúa cada lazo al recibir un evento y completa la transición en esa evaluación.
+ *          Para comparar las transiciones y no la latencia del polling, en cada paso se evalúan las MEFs originales
+ *          REPLAY_PASADAS veces, hasta que se completan todas las transiciones de los valores de ese paso.
+ *
+ *          Uso: record_mef_traces <semilla> [pasos]
+ */
+
+#include "replay_common.h"
+
+#include "MEF_ALGORITMO_CONTROL_pH_SOLUCION.c"
+#include "MEF_ALGORITMO_CONTROL_TDS_SOLUCION.c"
+#include "MEF_ALGORITMO_CONTROL_TEMP_SOLUCION.c"
+
+/* Cantidad de evaluaciones de las MEFs originales por paso del replay. */
+#define REPLAY_PASADAS 4
+
+/* Timers de FreeRTOS de los pulsos de las válvulas de pH (1) y TDS (2). */
+static struct {
+    bool activo;
+    TickType_t inicio;
+    TickType_t periodo;
+} replay_timers[3];
+
+TimerHandle_t aux_control_ph_get_timer_handle(void)
+{
+    return (TimerHandle_t) 1;
+}
+
+TimerHandle_t aux_control_tds_get_timer_handle(void)
+{
+    return (TimerHandle_t) 2;
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t periodo, TickType_t espera)
+{
+    int i = (intptr_t) timer;
+    replay_timers[i].periodo = periodo;
+    replay_timers[i].activo = 1;
+    replay_timers[i].inicio = replay_ahora;
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t espera)
+{
+    int i = (intptr_t) timer;
+    replay_timers[i].activo = 1;
+    replay_timers[i].inicio = replay_ahora;
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t espera)
+{
+    replay_timers[(intptr_t) timer].activo = 0;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle)
+{
+    *handle = (TaskHandle_t) 1;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t espera)
+{
+    return 0;
+}
+
+static void replay_estado_manual(int lazo)
+{
+    /**
+     *  Las MEFs originales leen los tópicos del modo MANUAL en cada evaluación.
+     */
+}
+
+static void replay_evaluar(void)
+{
+    for(int i = 1; i <= 2; i++)
+    {
+        if(replay_timers[i].activo && replay_ahora - replay_timers[i].inicio >= replay_timers[i].periodo)
+        {
+            replay_timers[i].activo = 0;
+
+            if(i == 1)
+            {
+                mef_ph_set_timer_flag_value(1);
+            }
+
+            else
+            {
+                mef_tds_set_timer_flag_value(1);
+            }
+        }
+    }
+
+    for(int i = 0; i < REPLAY_PASADAS; i++)
+    {
+        vTaskSolutionPhControl(NULL);
+        vTaskSolutionTdsControl(NULL);
+        vTaskSolutionTempControl(NULL);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "uso: %s <semilla> [pasos]\n", argv[0]);
+        return 2;
+    }
+
+    static const replay_ops_t ops = {
+        .estado_manual = replay_estado_manual,
+        .evaluar = replay_evaluar,
+    };
+
+    mef_ph_init((esp_mqtt_client_handle_t) 1);
+    mef_tds_init((esp_mqtt_client_handle_t) 1);
+    mef_temp_soluc_init((esp_mqtt_client_handle_t) 1);
+
+    replay_run(&ops, strtoul(argv[1], NULL, 0), argc > 2 ? atoi(argv[2]) : REPLAY_PASOS, stdout);
+
+    return 0;
+}
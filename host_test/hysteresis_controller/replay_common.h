@@ -0,0 +1,417 @@
+/*
+
+    Replay de los lazos de control de pH, TDS y temperatura de la solución
+
+    Parte común al grabador de trazas (MEFs originales) y al test del motor de control por ventana de
+    histéresis: simulación de los relés, los tanques, la conexión MQTT y los tópicos del modo MANUAL,
+    generación de las entradas a partir de una semilla, y formato de las trazas.
+
+    Ambos programas se compilan con todas las fuentes en una única unidad de traducción, por lo que este
+    archivo define funciones y datos estáticos.
+
+*/
+
+#ifndef REPLAY_COMMON_H_   /* Include guard */
+#define REPLAY_COMMON_H_
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "MQTT_PUBL_SUSCR.h"
+#include "MCP23008.h"
+#include "ACTUATOR_SERVICE.h"
+#include "APP_LEVEL_SENSOR.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_pH_SOLUCION.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_TDS_SOLUCION.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_TEMP_SOLUCION.h"
+#include "MEF_ALGORITMO_CONTROL_pH_SOLUCION.h"
+#include "MEF_ALGORITMO_CONTROL_TDS_SOLUCION.h"
+#include "MEF_ALGORITMO_CONTROL_TEMP_SOLUCION.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/* Período de cada paso del replay: el período de evaluación de las MEFs originales. */
+#define REPLAY_PASO_MS 100
+
+/* Cantidad de pasos y semillas de las trazas grabadas. */
+#define REPLAY_PASOS 20000
+#define REPLAY_SEMILLAS 10
+
+/* Cantidad de relés del MCP23008 y de tópicos del modo MANUAL simulados. */
+#define REPLAY_RELES 8
+#define REPLAY_TOPICOS 6
+
+/* Cantidad máxima de escrituras efectivas por paso. */
+#define REPLAY_MAX_ESCRITURAS 64
+
+/* Relé de la bomba de solución, que no pertenece a ningún lazo. */
+#define REPLAY_RELE_BOMBA RELE_5
+
+/*==================[INTERNAL DATA DEFINITION]===============================*/
+
+/* Estado de la simulación. */
+static TickType_t replay_ahora;
+static bool replay_reles[REPLAY_RELES];
+static bool replay_tanque_bajo[TANQUE_SUSTRATO + 1];
+static bool replay_conexion = 1;
+static bool replay_topico_valor[REPLAY_TOPICOS];
+static uint32_t replay_semilla;
+
+/* Tópicos del modo MANUAL: dos por lazo (pH, TDS, temperatura), en el orden aumento-disminución. */
+static const char *replay_topicos[REPLAY_TOPICOS] = {
+    MANUAL_MODE_VALVULA_AUM_PH_STATE_MQTT_TOPIC,
+    MANUAL_MODE_VALVULA_DISM_PH_STATE_MQTT_TOPIC,
+    MANUAL_MODE_VALVULA_AUM_TDS_STATE_MQTT_TOPIC,
+    MANUAL_MODE_VALVULA_DISM_TDS_STATE_MQTT_TOPIC,
+    MANUAL_MODE_CALEFACTOR_STATE_MQTT_TOPIC,
+    MANUAL_MODE_REFRIGERADOR_STATE_MQTT_TOPIC,
+};
+
+/**
+ *  Escrituras efectivas del paso en curso (las que cambian el estado de un relé, que son las únicas que llegan
+ *  al MCP23008 a través del servicio de actuadores), y cantidad de escrituras redundantes.
+ */
+static struct {
+    uint8_t rele;
+    bool estado;
+} replay_escrituras[REPLAY_MAX_ESCRITURAS];
+static int replay_cant_escrituras;
+static uint32_t replay_redundantes;
+
+/* Funciones callback registradas por los módulos bajo prueba. */
+static ActuatorServiceChangeCallbackFunction replay_actuator_cbs[ACTUATOR_SERVICE_MAX_CHANGE_CALLBACKS];
+static int replay_cant_actuator_cbs;
+static AppLevelSensorChangeCallbackFunction replay_level_cbs[APP_LEVEL_SENSOR_MAX_CHANGE_CALLBACKS];
+static int replay_cant_level_cbs;
+static esp_event_handler_t replay_mqtt_handler;
+
+/*==================[SIMULACION]=============================================*/
+
+/* Generador pseudoaleatorio xorshift32, para que las trazas no dependan de la libc del host. */
+static uint32_t replay_rand(void)
+{
+    replay_semilla ^= replay_semilla << 13;
+    replay_semilla ^= replay_semilla >> 17;
+    replay_semilla ^= replay_semilla << 5;
+    return replay_semilla;
+}
+
+static inline int replay_rand_n(int n)
+{
+    return replay_rand() % n;
+}
+
+static inline void replay_escribir(int8_t rele, bool estado)
+{
+    if(replay_reles[rele] == estado)
+    {
+        replay_redundantes++;
+        return;
+    }
+
+    if(replay_cant_escrituras >= REPLAY_MAX_ESCRITURAS)
+    {
+        fprintf(stderr, "demasiadas escrituras en un paso\n");
+        exit(1);
+    }
+
+    replay_escrituras[replay_cant_escrituras].rele = rele;
+    replay_escrituras[replay_cant_escrituras].estado = estado;
+    replay_cant_escrituras++;
+
+    replay_reles[rele] = estado;
+
+    /**
+     *  Como el servicio de actuadores, se avisa del cambio a las funciones callback registradas.
+     */
+    uint8_t state = 0;
+
+    for(int i = 0; i < REPLAY_RELES; i++)
+    {
+        state |= replay_reles[i] << i;
+    }
+
+    for(int i = 0; i < replay_cant_actuator_cbs; i++)
+    {
+        replay_actuator_cbs[i](BIT(rele), state);
+    }
+}
+
+/*==================[MOCKS]==================================================*/
+
+TickType_t xTaskGetTickCount(void)
+{
+    return replay_ahora;
+}
+
+esp_err_t actuator_service_set_relay(int8_t relay_num, bool state)
+{
+    replay_escribir(relay_num, state);
+    return ESP_OK;
+}
+
+esp_err_t actuator_service_set_relay_mask(uint8_t mask, uint8_t state)
+{
+    for(int i = 0; i < REPLAY_RELES; i++)
+    {
+        if(mask & BIT(i))
+        {
+            replay_escribir(i, (state >> i) & 1);
+        }
+    }
+
+    return ESP_OK;
+}
+
+bool actuator_service_get_relay(int8_t relay_num)
+{
+    return replay_reles[relay_num];
+}
+
+esp_err_t actuator_service_set_state_topic(int8_t relay_num, const char *topic)
+{
+    return ESP_OK;
+}
+
+esp_err_t actuator_service_add_change_callback(ActuatorServiceChangeCallbackFunction callback)
+{
+    replay_actuator_cbs[replay_cant_actuator_cbs++] = callback;
+    return ESP_OK;
+}
+
+bool app_level_sensor_level_below_limit(tanques_unidad_sec_t tanque)
+{
+    return replay_tanque_bajo[tanque];
+}
+
+esp_err_t app_level_sensor_add_change_callback(AppLevelSensorChangeCallbackFunction callback)
+{
+    replay_level_cbs[replay_cant_level_cbs++] = callback;
+    return ESP_OK;
+}
+
+bool mqtt_check_connection(void)
+{
+    return replay_conexion;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, int event, esp_event_handler_t event_handler, void *event_handler_arg)
+{
+    replay_mqtt_handler = event_handler;
+    return ESP_OK;
+}
+
+mqtt_topic_handle_t mqtt_get_topic_handle(const char *topic)
+{
+    for(int i = 0; i < REPLAY_TOPICOS; i++)
+    {
+        if(!strcmp(topic, replay_topicos[i]))
+        {
+            return (mqtt_topic_handle_t) (intptr_t) (i + 1);
+        }
+    }
+
+    return NULL;
+}
+
+esp_err_t mqtt_get_topic_on_off(mqtt_topic_handle_t handle, bool *value)
+{
+    int i = (int) (intptr_t) handle - 1;
+
+    if(i < 0 || i >= REPLAY_TOPICOS)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    *value = replay_topico_valor[i];
+    return ESP_OK;
+}
+
+/*==================[REPLAY]=================================================*/
+
+/* Funciones de cada programa: avisar un nuevo estado de un tópico del modo MANUAL y evaluar las MEFs en un paso. */
+typedef struct {
+    void (*estado_manual)(int lazo);
+    void (*evaluar)(void);
+} replay_ops_t;
+
+static inline void replay_imprimir_paso(FILE *out, const char *paso)
+{
+    if(replay_cant_escrituras == 0)
+    {
+        return;
+    }
+
+    /**
+     *  Las escrituras se ordenan por relé, para que la traza no dependa del orden en que se evalúan los lazos.
+     *  El orden de las escrituras de un mismo relé se conserva.
+     */
+    for(int i = 1; i < replay_cant_escrituras; i++)
+    {
+        for(int j = i; j > 0 && replay_escrituras[j - 1].rele > replay_escrituras[j].rele; j--)
+        {
+            __typeof__(replay_escrituras[0]) aux = replay_escrituras[j];
+            replay_escrituras[j] = replay_escrituras[j - 1];
+            replay_escrituras[j - 1] = aux;
+        }
+    }
+
+    fprintf(out, "%s W", paso);
+
+    for(int i = 0; i < replay_cant_escrituras; i++)
+    {
+        fprintf(out, " %d=%d", replay_escrituras[i].rele, replay_escrituras[i].estado);
+    }
+
+    fprintf(out, " R ");
+
+    for(int i = 0; i < REPLAY_RELES; i++)
+    {
+        fprintf(out, "%d", replay_reles[i]);
+    }
+
+    fprintf(out, "\n");
+
+    replay_cant_escrituras = 0;
+}
+
+/**
+ *  Genera las entradas de cada paso a partir de la semilla, evalúa las MEFs, e imprime en la traza las escrituras
+ *  efectivas de los pasos que tuvieron alguna, junto con el estado de todos los relés al final del paso. Las
+ *  escrituras de la inicialización (antes de llamar a esta función) se imprimen como paso "I".
+ */
+static inline void replay_run(const replay_ops_t *ops, uint32_t semilla, int pasos, FILE *out)
+{
+    float ph = 6, tds = 900, temp = 25;
+    bool manual[3] = {0};
+
+    replay_semilla = semilla;
+
+    fprintf(out, "# semilla %u, %d pasos de %d ms\n", semilla, pasos, REPLAY_PASO_MS);
+    replay_imprimir_paso(out, "I");
+
+    for(int k = 0; k < pasos; k++)
+    {
+        replay_ahora = pdMS_TO_TICKS(k * REPLAY_PASO_MS);
+
+        /**
+         *  Caminatas aleatorias de las variables, que cruzan las ventanas de histéresis de los tres lazos.
+         */
+        ph += (replay_rand_n(200) - 100) / 1000.0;
+        ph = ph < 4 ? 4 : (ph > 8 ? 8 : ph);
+        tds += (replay_rand_n(200) - 100) / 5.0;
+        tds = tds < 600 ? 600 : (tds > 1200 ? 1200 : tds);
+        temp += (replay_rand_n(200) - 100) / 200.0;
+        temp = temp < 18 ? 18 : (temp > 32 ? 32 : temp);
+
+        mef_ph_set_ph_value(ph);
+        mef_tds_set_tds_value(tds);
+        mef_temp_soluc_set_temp_soluc_value(temp);
+
+        /**
+         *  Bomba de solución (enclavamiento común de los lazos de pH y TDS).
+         */
+        if(replay_rand_n(50) == 0)
+        {
+            replay_escribir(REPLAY_RELE_BOMBA, !replay_reles[REPLAY_RELE_BOMBA]);
+        }
+
+        /**
+         *  Nivel de los tanques (enclavamientos de cada válvula).
+         */
+        if(replay_rand_n(80) == 0)
+        {
+            tanques_unidad_sec_t tanque = replay_rand_n(TANQUE_SUSTRATO + 1);
+            replay_tanque_bajo[tanque] = !replay_tanque_bajo[tanque];
+
+            for(int i = 0; i < replay_cant_level_cbs; i++)
+            {
+                replay_level_cbs[i](tanque);
+            }
+        }
+
+        /**
+         *  Conexión con el broker MQTT. La desconexión se avisa con el handler de eventos del cliente.
+         */
+        if(replay_rand_n(200) == 0)
+        {
+            replay_conexion = !replay_conexion;
+
+            if(!replay_conexion && replay_mqtt_handler != NULL)
+            {
+                replay_mqtt_handler(NULL, "MQTT_EVENTS", MQTT_EVENT_DISCONNECTED, NULL);
+            }
+        }
+
+        /**
+         *  Modo MANUAL de cada lazo.
+         */
+        if(replay_rand_n(100) == 0)
+        {
+            int lazo = replay_rand_n(3);
+            manual[lazo] = !manual[lazo];
+
+            switch(lazo)
+            {
+                case 0: mef_ph_set_manual_mode_flag_value(manual[0]); break;
+                case 1: mef_tds_set_manual_mode_flag_value(manual[1]); break;
+                case 2: mef_temp_soluc_set_manual_mode_flag_value(manual[2]); break;
+            }
+        }
+
+        /**
+         *  Error de sensado de cada lazo.
+         */
+        if(replay_rand_n(60) == 0)
+        {
+            bool error = replay_rand_n(2);
+
+            switch(replay_rand_n(3))
+            {
+                case 0: mef_ph_set_sensor_error_flag_value(error); break;
+                case 1: mef_tds_set_sensor_error_flag_value(error); break;
+                case 2: mef_temp_soluc_set_sensor_error_flag_value(error); break;
+            }
+        }
+
+        /**
+         *  Nuevos límites de cada lazo.
+         */
+        if(replay_rand_n(500) == 0)
+        {
+            float sp_ph = 5 + replay_rand_n(20) / 10.0;
+            float sp_tds = 800 + replay_rand_n(200);
+            float sp_temp = 22 + replay_rand_n(60) / 10.0;
+
+            switch(replay_rand_n(3))
+            {
+                case 0: mef_ph_set_ph_control_limits(sp_ph - 0.5, sp_ph + 0.5); break;
+                case 1: mef_tds_set_tds_control_limits(sp_tds - 100, sp_tds + 100); break;
+                case 2: mef_temp_soluc_set_temp_control_limits(sp_temp - 2, sp_temp + 2); break;
+            }
+        }
+
+        /**
+         *  Nuevo estado pedido de un actuador en modo MANUAL.
+         */
+        if(replay_rand_n(30) == 0)
+        {
+            int topico = replay_rand_n(REPLAY_TOPICOS);
+            replay_topico_valor[topico] = !replay_topico_valor[topico];
+            ops->estado_manual(topico / 2);
+        }
+
+        ops->evaluar();
+
+        char paso[16];
+        snprintf(paso, sizeof(paso), "%d", k);
+        replay_imprimir_paso(out, paso);
+    }
+}
+
+#endif // REPLAY_COMMON_H_
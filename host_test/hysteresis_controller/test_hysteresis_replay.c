@@ -0,0 +1,269 @@
+/**
+ * @file test_hysteresis_replay.c
+ * @brief   Test de equivalencia del motor de control por ventana de histéresis con las MEFs originales de los
+ *          lazos de control de pH, TDS y temperatura de la solución.
+ *
+ *          Se compilan el motor y los descriptores de los tres lazos, se les aplican las mismas entradas que
+ *          generó el grabador para cada semilla (valores sensados, límites, modo MANUAL, errores de sensado, bomba,
+ *          nivel de los tanques, conexión MQTT y tópicos del modo MANUAL), y se compara la traza resultante con la
+ *          traza grabada de las MEFs originales, en "traces/". El test falla ante cualquier diferencia en el conjunto
+ *          de escrituras efectivas de un paso o en el estado de los relés al final del paso.
+ *
+ *          La tarea del motor se ejecuta hasta que se bloquea esperando eventos: "ulTaskNotifyTake()" vuelve a este
+ *          programa con un longjmp cuando no hay notificaciones pendientes ni plazos de pulso vencidos.
+ *
+ *          Los pulsos de dosificación de pH y TDS se comparan con los tiempos fijos de las MEFs originales, por lo
+ *          que se anulan las ganancias del control PI de sus descriptores. El tiempo de apertura con control PI se
+ *          verifica en "test_pulse_sizing.c".
+ *
+ *          Uso: test_hysteresis_replay <directorio de trazas>
+ */
+
+#include <setjmp.h>
+
+#include "replay_common.h"
+
+#include "HYSTERESIS_CONTROLLER.c"
+#include "MEF_ALGORITMO_CONTROL_pH_SOLUCION.c"
+#include "MEF_ALGORITMO_CONTROL_TDS_SOLUCION.c"
+#include "MEF_ALGORITMO_CONTROL_TEMP_SOLUCION.c"
+
+/* Cantidad máxima de despertares de la tarea del motor por paso, antes de considerar que no se bloquea. */
+#define REPLAY_MAX_DESPERTARES 64
+
+/* Cola de eventos del motor. */
+static struct {
+    uint8_t items[HYST_CTRL_EVENT_QUEUE_LEN][sizeof(hyst_ctrl_evento_t)];
+    UBaseType_t largo;
+    int primero;
+    int cantidad;
+} replay_cola;
+
+/* Notificaciones pendientes de la tarea del motor, y contexto para volver al replay cuando se bloquea. */
+static uint32_t replay_notificaciones;
+static jmp_buf replay_bloqueada;
+static int replay_despertares;
+
+/* Descriptores de los lazos de pH y TDS sin control PI. */
+static hyst_ctrl_loop_desc_t replay_desc_ph;
+static hyst_ctrl_loop_desc_t replay_desc_tds;
+
+BaseType_t xTaskCreate(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle)
+{
+    *handle = (TaskHandle_t) 1;
+    return pdPASS;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t largo, UBaseType_t tamanio)
+{
+    if(largo > HYST_CTRL_EVENT_QUEUE_LEN || tamanio != sizeof(hyst_ctrl_evento_t))
+    {
+        return NULL;
+    }
+
+    replay_cola.largo = largo;
+    return (QueueHandle_t) &replay_cola;
+}
+
+BaseType_t xQueueSend(QueueHandle_t cola, const void *item, TickType_t espera)
+{
+    if(replay_cola.cantidad == replay_cola.largo)
+    {
+        return errQUEUE_FULL;
+    }
+
+    memcpy(replay_cola.items[(replay_cola.primero + replay_cola.cantidad) % replay_cola.largo], item, sizeof(hyst_ctrl_evento_t));
+    replay_cola.cantidad++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t cola, void *item, TickType_t espera)
+{
+    if(replay_cola.cantidad == 0)
+    {
+        return pdFALSE;
+    }
+
+    memcpy(item, replay_cola.items[replay_cola.primero], sizeof(hyst_ctrl_evento_t));
+    replay_cola.primero = (replay_cola.primero + 1) % replay_cola.largo;
+    replay_cola.cantidad--;
+    return pdTRUE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t tarea)
+{
+    replay_notificaciones++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t espera)
+{
+    if(replay_notificaciones == 0 && espera != 0)
+    {
+        longjmp(replay_bloqueada, 1);
+    }
+
+    if(++replay_despertares > REPLAY_MAX_DESPERTARES)
+    {
+        fprintf(stderr, "FAIL: la tarea del motor no se bloquea en el instante %u\n", replay_ahora);
+        exit(1);
+    }
+
+    uint32_t notificaciones = replay_notificaciones;
+    replay_notificaciones = 0;
+    return notificaciones;
+}
+
+static void replay_estado_manual(int lazo)
+{
+    switch(lazo)
+    {
+        case 0: mef_ph_notify_manual_mode_actuator_state(); break;
+        case 1: mef_tds_notify_manual_mode_actuator_state(); break;
+        case 2: mef_temp_soluc_notify_manual_mode_actuator_state(); break;
+    }
+}
+
+static void replay_evaluar(void)
+{
+    replay_despertares = 0;
+
+    if(!setjmp(replay_bloqueada))
+    {
+        vTaskHystCtrl(NULL);
+    }
+}
+
+static void replay_init(void)
+{
+    memset(&replay_cola, 0, sizeof(replay_cola));
+    memset(hyst_ctrl_loops, 0, sizeof(hyst_ctrl_loops));
+    memset(hyst_ctrl_pendientes, 0, sizeof(hyst_ctrl_pendientes));
+    memset(replay_reles, 0, sizeof(replay_reles));
+    memset(replay_tanque_bajo, 0, sizeof(replay_tanque_bajo));
+    memset(replay_topico_valor, 0, sizeof(replay_topico_valor));
+
+    hyst_ctrl_loop_count = 0;
+    hyst_ctrl_reles_lazos = 0;
+    hyst_ctrl_mqtt_handler_registered = 0;
+    xHystCtrlEventQueue = NULL;
+    xHystCtrlTaskHandle = NULL;
+    mef_ph_loop = NULL;
+    mef_tds_loop = NULL;
+    mef_temp_soluc_loop = NULL;
+
+    replay_ahora = 0;
+    replay_conexion = 1;
+    replay_notificaciones = 0;
+    replay_cant_escrituras = 0;
+    replay_cant_actuator_cbs = 0;
+    replay_cant_level_cbs = 0;
+    replay_mqtt_handler = NULL;
+
+    mef_ph_init((esp_mqtt_client_handle_t) 1);
+    mef_tds_init((esp_mqtt_client_handle_t) 1);
+    mef_temp_soluc_init((esp_mqtt_client_handle_t) 1);
+
+    replay_desc_ph = *mef_ph_loop->desc;
+    replay_desc_ph.ganancia_kp = 0;
+    replay_desc_ph.ganancia_ki = 0;
+    mef_ph_loop->desc = &replay_desc_ph;
+
+    replay_desc_tds = *mef_tds_loop->desc;
+    replay_desc_tds.ganancia_kp = 0;
+    replay_desc_tds.ganancia_ki = 0;
+    mef_tds_loop->desc = &replay_desc_tds;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "uso: %s <directorio de trazas>\n", argv[0]);
+        return 2;
+    }
+
+    static const replay_ops_t ops = {
+        .estado_manual = replay_estado_manual,
+        .evaluar = replay_evaluar,
+    };
+
+    int fallas = 0;
+    uint32_t lineas_total = 0;
+
+    for(uint32_t semilla = 1; semilla <= REPLAY_SEMILLAS; semilla++)
+    {
+        char ruta[512];
+        snprintf(ruta, sizeof(ruta), "%s/seed_%u.trace", argv[1], semilla);
+
+        FILE *grabada = fopen(ruta, "r");
+
+        if(grabada == NULL)
+        {
+            fprintf(stderr, "FAIL: no se pudo abrir %s\n", ruta);
+            return 1;
+        }
+
+        char *traza = NULL;
+        size_t largo = 0;
+        FILE *actual = open_memstream(&traza, &largo);
+
+        replay_init();
+        replay_run(&ops, semilla, REPLAY_PASOS, actual);
+        fclose(actual);
+
+        /**
+         *  Se comparan las trazas línea por línea. Cada línea es un paso con escrituras efectivas, por lo que
+         *  cualquier diferencia de escrituras o de estado de los relés aparece en la primera línea distinta.
+         */
+        char linea[256];
+        char *resto = traza;
+        uint32_t numero = 0;
+        bool igual = 1;
+
+        while(fgets(linea, sizeof(linea), grabada) != NULL)
+        {
+            numero++;
+
+            char *fin = strchr(resto, '\n');
+            size_t n = fin != NULL ? (size_t) (fin - resto + 1) : strlen(resto);
+
+            if(n != strlen(linea) || strncmp(resto, linea, n))
+            {
+                printf("FAIL: semilla %u, línea %u\n  grabada: %s  motor:   %.*s\n", semilla, numero, linea, (int) n, resto);
+                igual = 0;
+                break;
+            }
+
+            resto += n;
+        }
+
+        if(igual && *resto != '\0')
+        {
+            printf("FAIL: semilla %u, el motor escribió pasos que no están en la traza grabada: %.60s\n", semilla, resto);
+            igual = 0;
+        }
+
+        if(igual)
+        {
+            printf("ok: semilla %u, %u pasos con escrituras idénticos\n", semilla, numero - 1);
+            lineas_total += numero - 1;
+        }
+
+        else
+        {
+            fallas++;
+        }
+
+        fclose(grabada);
+        free(traza);
+    }
+
+    hyst_ctrl_stats_t stats;
+    hyst_ctrl_get_stats(&stats);
+
+    printf("%s: %d de %d semillas, %u pasos con escrituras, %u escrituras redundantes, %u eventos descartados\n",
+           fallas ? "FAIL" : "PASS", REPLAY_SEMILLAS - fallas, REPLAY_SEMILLAS, lineas_total, replay_redundantes, stats.descartados);
+
+    return fallas ? 1 : 0;
+}
@@ -0,0 +1,414 @@
+/**
+ * @file test_pulse_sizing.c
+ * @brief   Simulación de lazo cerrado de los pulsos de dosificación del lazo de control de pH: compara los pulsos
+ *          fijos de las MEFs originales (1 s abierta, 2 s cerrada) con los pulsos calculados por control P y PI,
+ *          y verifica el anti-windup del término integral.
+ *
+ *          Se compila el motor con el descriptor real del lazo de pH, y la tarea del motor se ejecuta contra una
+ *          planta simulada con paso de 1 ms: con la válvula abierta el pH del tanque cambia a razón constante, y
+ *          el sensor, a la salida del canal de cultivo, ve el pH del tanque con un retardo de transporte y un
+ *          retardo de mezcla de primer orden. El sensor se muestrea cada 1 s, con ruido. Los parámetros de la
+ *          planta son supuestos, no mediciones.
+ *
+ *          La simulación avanza cuando la tarea del motor se bloquea en "ulTaskNotifyTake()", hasta la siguiente
+ *          muestra o hasta que vence el plazo del pulso en curso.
+ */
+
+#include <math.h>
+#include <setjmp.h>
+
+#include "replay_common.h"
+
+#include "HYSTERESIS_CONTROLLER.c"
+#include "MEF_ALGORITMO_CONTROL_pH_SOLUCION.c"
+
+/* Planta: paso de simulación, período de muestreo, y duración de cada corrida. */
+#define SIM_PASO_MS 1
+#define SIM_MUESTREO_MS 1000
+#define SIM_DURACION_MS (60 * 60 * 1000)
+
+/* Planta: variación de pH con la válvula abierta (pH/s), retardo de transporte y constante de mezcla (s). */
+#define SIM_TASA_PH 0.05
+#define SIM_RETARDO_S 30
+#define SIM_TAU_S 10
+
+/* Amplitud pico a pico del ruido del sensor (pH). */
+#define SIM_RUIDO 0.04
+
+#define SIM_RETARDO_MUESTRAS (SIM_RETARDO_S * 1000 / SIM_PASO_MS)
+
+/* Cantidad máxima de pulsos registrados por corrida. */
+#define SIM_MAX_PULSOS 1024
+
+/* Resultado de una corrida. */
+typedef struct {
+    double dosificado_ms;           /* Tiempo total con alguna válvula abierta. */
+    double asentamiento_ms;         /* Último instante con el pH sensado fuera del rango correcto. */
+    double final;                   /* pH sensado al final de la corrida. */
+    double minimo;                  /* pH sensado mínimo con el reactivo con efecto. */
+    float integral_recuperacion;    /* Término integral en el instante de recuperación de la planta. */
+    int pulsos;
+    double apertura_ms[SIM_MAX_PULSOS];     /* Duración de cada pulso. */
+    float integral[SIM_MAX_PULSOS];         /* Término integral al terminar de abrir cada pulso. */
+} sim_resultado_t;
+
+/* Estado de la planta. */
+static double sim_tasa;
+static double sim_tanque;
+static double sim_sensado;
+static double sim_historia[SIM_RETARDO_MUESTRAS];
+static uint32_t sim_indice;
+static TickType_t sim_proxima_muestra;
+static TickType_t sim_fin;
+static TickType_t sim_apertura;
+static bool sim_abierta;
+static sim_resultado_t *sim_res;
+static jmp_buf sim_terminada;
+
+/* Cola de eventos del motor y notificaciones pendientes de su tarea. */
+static struct {
+    uint8_t items[HYST_CTRL_EVENT_QUEUE_LEN][sizeof(hyst_ctrl_evento_t)];
+    int primero;
+    int cantidad;
+} sim_cola;
+static uint32_t sim_notificaciones;
+
+/* Límites del rango correcto del lazo de pH. */
+static const double sim_limite_inferior = 5.5;
+static const double sim_limite_superior = 6.5;
+
+static hyst_ctrl_loop_desc_t sim_desc;
+
+/*==================[PLANTA]=================================================*/
+
+static double sim_ruido(void)
+{
+    return ((replay_rand() % 1000) / 1000.0 - 0.5) * SIM_RUIDO;
+}
+
+static void sim_paso(void)
+{
+    bool aumento = replay_reles[VALVULA_AUMENTO_PH];
+    bool disminucion = replay_reles[VALVULA_DISMINUCION_PH];
+    bool abierta = aumento || disminucion;
+
+    sim_tanque += (aumento - disminucion) * SIM_TASA_PH * sim_tasa * SIM_PASO_MS / 1000.0;
+
+    /**
+     *  El sensor ve el pH del tanque con el retardo de transporte, filtrado por el retardo de mezcla.
+     */
+    double retardado = sim_historia[sim_indice % SIM_RETARDO_MUESTRAS];
+    sim_historia[sim_indice % SIM_RETARDO_MUESTRAS] = sim_tanque;
+    sim_indice++;
+
+    sim_sensado += (retardado - sim_sensado) * (SIM_PASO_MS / 1000.0) / SIM_TAU_S;
+
+    if(abierta)
+    {
+        sim_res->dosificado_ms += SIM_PASO_MS;
+    }
+
+    if(sim_tasa > 0 && sim_sensado < sim_res->minimo)
+    {
+        sim_res->minimo = sim_sensado;
+    }
+
+    if(sim_sensado < sim_limite_inferior || sim_sensado > sim_limite_superior)
+    {
+        sim_res->asentamiento_ms = replay_ahora;
+    }
+
+    /**
+     *  Se registra la duración de cada pulso, y el término integral con el que se calculó.
+     */
+    if(abierta && !sim_abierta)
+    {
+        sim_apertura = replay_ahora;
+
+        if(sim_res->pulsos < SIM_MAX_PULSOS)
+        {
+            sim_res->integral[sim_res->pulsos] = mef_ph_loop->integral;
+        }
+    }
+
+    if(!abierta && sim_abierta && sim_res->pulsos < SIM_MAX_PULSOS)
+    {
+        sim_res->apertura_ms[sim_res->pulsos++] = replay_ahora - sim_apertura;
+    }
+
+    sim_abierta = abierta;
+    replay_ahora += pdMS_TO_TICKS(SIM_PASO_MS);
+
+    /**
+     *  Las escrituras del servicio de actuadores no se imprimen en esta simulación.
+     */
+    replay_cant_escrituras = 0;
+}
+
+/*==================[MOCKS]==================================================*/
+
+BaseType_t xTaskCreate(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle)
+{
+    *handle = (TaskHandle_t) 1;
+    return pdPASS;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t largo, UBaseType_t tamanio)
+{
+    return (QueueHandle_t) &sim_cola;
+}
+
+BaseType_t xQueueSend(QueueHandle_t cola, const void *item, TickType_t espera)
+{
+    if(sim_cola.cantidad == HYST_CTRL_EVENT_QUEUE_LEN)
+    {
+        return errQUEUE_FULL;
+    }
+
+    memcpy(sim_cola.items[(sim_cola.primero + sim_cola.cantidad) % HYST_CTRL_EVENT_QUEUE_LEN], item, sizeof(hyst_ctrl_evento_t));
+    sim_cola.cantidad++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t cola, void *item, TickType_t espera)
+{
+    if(sim_cola.cantidad == 0)
+    {
+        return pdFALSE;
+    }
+
+    memcpy(item, sim_cola.items[sim_cola.primero], sizeof(hyst_ctrl_evento_t));
+    sim_cola.primero = (sim_cola.primero + 1) % HYST_CTRL_EVENT_QUEUE_LEN;
+    sim_cola.cantidad--;
+    return pdTRUE;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t tarea)
+{
+    sim_notificaciones++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t espera)
+{
+    if(sim_notificaciones == 0)
+    {
+        /**
+         *  La tarea del motor se bloquea: avanza la planta hasta la próxima muestra, o hasta que vence el plazo.
+         */
+        TickType_t limite = sim_proxima_muestra;
+
+        if(espera != portMAX_DELAY && replay_ahora + espera < limite)
+        {
+            limite = replay_ahora + espera;
+        }
+
+        while(replay_ahora < limite)
+        {
+            sim_paso();
+        }
+
+        if(replay_ahora >= sim_fin)
+        {
+            longjmp(sim_terminada, 1);
+        }
+
+        if(replay_ahora >= sim_proxima_muestra)
+        {
+            sim_proxima_muestra += pdMS_TO_TICKS(SIM_MUESTREO_MS);
+            mef_ph_set_ph_value(sim_sensado + sim_ruido());
+        }
+    }
+
+    uint32_t notificaciones = sim_notificaciones;
+    sim_notificaciones = 0;
+    return notificaciones;
+}
+
+/*==================[SIMULACION]=============================================*/
+
+/**
+ *  Simula el lazo de pH, con el descriptor dado, desde el pH inicial dado. La tasa relativa escala el efecto del
+ *  reactivo en la planta, y pasa a 1 a partir del instante de recuperación (0 para no cambiarla).
+ */
+static void sim_correr(const hyst_ctrl_loop_desc_t *desc, double inicial, double tasa, TickType_t recuperacion, TickType_t duracion, sim_resultado_t *res)
+{
+    memset(&sim_cola, 0, sizeof(sim_cola));
+    memset(hyst_ctrl_loops, 0, sizeof(hyst_ctrl_loops));
+    memset(hyst_ctrl_pendientes, 0, sizeof(hyst_ctrl_pendientes));
+    memset(replay_reles, 0, sizeof(replay_reles));
+    memset(res, 0, sizeof(*res));
+
+    hyst_ctrl_loop_count = 0;
+    hyst_ctrl_reles_lazos = 0;
+    hyst_ctrl_mqtt_handler_registered = 0;
+    xHystCtrlEventQueue = NULL;
+    xHystCtrlTaskHandle = NULL;
+    mef_ph_loop = NULL;
+
+    replay_ahora = 0;
+    replay_semilla = 1;
+    replay_cant_actuator_cbs = 0;
+    replay_cant_level_cbs = 0;
+    sim_notificaciones = 0;
+
+    /**
+     *  La bomba de solución está encendida, y ningún tanque tiene nivel bajo.
+     */
+    replay_reles[PH_BOMBA] = 1;
+
+    mef_ph_init((esp_mqtt_client_handle_t) 1);
+
+    sim_desc = *desc;
+    mef_ph_loop->desc = &sim_desc;
+
+    sim_res = res;
+    res->minimo = inicial;
+    sim_tasa = tasa;
+    sim_tanque = inicial;
+    sim_sensado = inicial;
+    sim_indice = 0;
+    sim_abierta = 0;
+
+    for(int i = 0; i < SIM_RETARDO_MUESTRAS; i++)
+    {
+        sim_historia[i] = inicial;
+    }
+
+    sim_proxima_muestra = pdMS_TO_TICKS(SIM_MUESTREO_MS);
+    sim_fin = recuperacion ? recuperacion : duracion;
+
+    if(!setjmp(sim_terminada))
+    {
+        vTaskHystCtrl(NULL);
+    }
+
+    if(recuperacion)
+    {
+        res->integral_recuperacion = mef_ph_loop->integral;
+        sim_tasa = 1;
+        sim_fin = duracion;
+
+        if(!setjmp(sim_terminada))
+        {
+            vTaskHystCtrl(NULL);
+        }
+    }
+
+    res->final = sim_sensado;
+}
+
+static int fallas = 0;
+
+static void sim_verificar(bool condicion, const char *mensaje, double inicial)
+{
+    if(!condicion)
+    {
+        printf("FAIL: pH inicial %.1f: %s\n", inicial, mensaje);
+        fallas++;
+    }
+}
+
+/**
+ *  Compara pulsos fijos, P y PI desde distintos pH iniciales, con la misma planta.
+ */
+static void test_comparacion(void)
+{
+    static const double iniciales[] = {4.0, 5.0, 5.3, 7.0, 8.0};
+    static sim_resultado_t fijo, p, pi;
+
+    hyst_ctrl_loop_desc_t desc_fijo = mef_ph_desc;
+    desc_fijo.ganancia_kp = 0;
+    desc_fijo.ganancia_ki = 0;
+
+    hyst_ctrl_loop_desc_t desc_p = mef_ph_desc;
+    desc_p.ganancia_ki = 0;
+
+    printf("pH inicial | fijo 1000/2000: asentamiento, dosificado, final | P | PI\n");
+
+    for(size_t i = 0; i < sizeof(iniciales) / sizeof(iniciales[0]); i++)
+    {
+        double inicial = iniciales[i];
+
+        sim_correr(&desc_fijo, inicial, 1, 0, SIM_DURACION_MS, &fijo);
+        sim_correr(&desc_p, inicial, 1, 0, SIM_DURACION_MS, &p);
+        sim_correr(&mef_ph_desc, inicial, 1, 0, SIM_DURACION_MS, &pi);
+
+        printf("%10.1f | %5.0f s %5.1f s %.2f | %5.0f s %5.1f s %.2f | %5.0f s %5.1f s %.2f\n", inicial,
+               fijo.asentamiento_ms / 1000, fijo.dosificado_ms / 1000, fijo.final,
+               p.asentamiento_ms / 1000, p.dosificado_ms / 1000, p.final,
+               pi.asentamiento_ms / 1000, pi.dosificado_ms / 1000, pi.final);
+
+        sim_verificar(fijo.final > sim_limite_inferior && fijo.final < sim_limite_superior, "pulsos fijos no llegan al rango correcto", inicial);
+        sim_verificar(p.final > sim_limite_inferior && p.final < sim_limite_superior, "P no llega al rango correcto", inicial);
+
+        /**
+         *  Con PI se debe usar menos reactivo que con los pulsos fijos, terminar cerca del centro del rango (los
+         *  pulsos fijos terminan en el borde opuesto de la ventana), y asentarse en un tiempo similar.
+         */
+        sim_verificar(pi.dosificado_ms < fijo.dosificado_ms, "PI usa más reactivo que los pulsos fijos", inicial);
+        sim_verificar(fabs(pi.final - 6.0) < 0.25, "PI no termina cerca del centro del rango", inicial);
+        sim_verificar(pi.asentamiento_ms <= 1.25 * fijo.asentamiento_ms, "PI tarda más de 1,25 veces en asentarse", inicial);
+
+        for(int k = 0; k < pi.pulsos; k++)
+        {
+            sim_verificar(pi.apertura_ms[k] >= mef_ph_desc.tiempo_apertura_min_ms - SIM_PASO_MS
+                          && pi.apertura_ms[k] <= mef_ph_desc.tiempo_apertura_max_ms + SIM_PASO_MS, "pulso PI fuera de [min, max]", inicial);
+        }
+    }
+}
+
+/**
+ *  Anti-windup: el reactivo no tiene efecto durante los primeros 20 minutos (por ejemplo, un tanque vacío con el
+ *  sensor de nivel fallando), por lo que el error no baja y el tiempo de apertura satura en el máximo. El término
+ *  integral debe dejar de crecer al saturar, y al recuperarse la planta el lazo debe volver al rango sin
+ *  sobrepasar el rango correcto por el lado opuesto.
+ */
+static void test_anti_windup(void)
+{
+    static sim_resultado_t res;
+    const double inicial = 7.5;
+    const double max = mef_ph_desc.tiempo_apertura_max_ms;
+
+    sim_correr(&mef_ph_desc, inicial, 0, pdMS_TO_TICKS(20 * 60 * 1000), SIM_DURACION_MS, &res);
+
+    int saturados = 0;
+    int crecimientos = 0;
+
+    /**
+     *  En cada pulso saturado en el máximo, el término integral debe quedar igual al del pulso anterior.
+     */
+    for(int k = 1; k < res.pulsos; k++)
+    {
+        if(res.apertura_ms[k] >= max - SIM_PASO_MS)
+        {
+            saturados++;
+            crecimientos += res.integral[k] != res.integral[k - 1];
+        }
+    }
+
+    printf("anti-windup: %d pulsos, %d saturados en %.0f ms, integral al recuperarse %.2f pH, mínimo %.2f, final %.2f\n",
+           res.pulsos, saturados, max, res.integral_recuperacion, res.minimo, res.final);
+
+    sim_verificar(saturados >= 10, "el tiempo de apertura no satura con la planta sin efecto", inicial);
+    sim_verificar(crecimientos == 0, "el término integral crece con la salida saturada", inicial);
+
+    /**
+     *  Sin anti-windup, el término integral acumularía el error de todos los pulsos (más de 1 pH por pulso).
+     *  Con anti-windup, queda acotado por el valor que satura el tiempo de apertura por sí solo.
+     */
+    sim_verificar(res.integral_recuperacion * mef_ph_desc.ganancia_ki <= max, "el término integral no queda acotado con la salida saturada", inicial);
+
+    sim_verificar(res.final > sim_limite_inferior && res.final < sim_limite_superior, "no vuelve al rango correcto al recuperarse la planta", inicial);
+    sim_verificar(res.minimo > sim_limite_inferior, "sobrepasa el rango correcto al recuperarse la planta", inicial);
+}
+
+int main(void)
+{
+    test_comparacion();
+    test_anti_windup();
+
+    printf("%s\n", fallas ? "FAIL" : "PASS");
+
+    return fallas ? 1 : 0;
+}
@@ -0,0 +1,308 @@
+/*
+
+    Modelo del MCP23008 para los tests de host del driver
+
+    Simula los registros del expansor detrás de las funciones de I2C de ESP-IDF, con el comportamiento de la
+    hoja de datos que usa el driver: lectura secuencial con incremento de dirección, escritura del GPIO sobre
+    el OLAT, e interrupción por cambio en el GP7 (INTCON = 0, respecto del valor anterior) con captura en
+    INTF/INTCAP, salida INT activa en bajo, y liberación al leer INTCAP o GPIO. Mientras la interrupción está
+    pendiente, el chip no vuelve a capturar el puerto.
+
+    Cuenta las transacciones de I2C, permite hacer fallar las próximas transacciones, y llama a una función
+    de enganche antes y después de cada transacción, para que el test cambie el pin en cualquier punto de la
+    secuencia del driver. Una transacción es atómica para el modelo.
+
+    Los tests se compilan con el driver en una única unidad de traducción, por lo que este archivo define
+    funciones y datos estáticos.
+
+*/
+
+#ifndef MCP23008_MODELO_H_   /* Include guard */
+#define MCP23008_MODELO_H_
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+#include "MCP23008.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/* Cantidad de registros del MCP23008 (IODIR a OLAT). */
+#define MODELO_REGISTROS 11
+
+/* Bit del Trigger pH en el puerto. */
+#define MODELO_GP7 0x80
+
+/* Puntos de la transacción en los que se llama a la función de enganche. */
+typedef enum {
+    MODELO_ANTES,
+    MODELO_DESPUES,
+} modelo_fase_t;
+
+/*==================[INTERNAL DATA DEFINITION]===============================*/
+
+static struct {
+    uint8_t regs[MODELO_REGISTROS];
+    bool pin;                   /* Nivel del GP7 (Trigger pH). */
+    bool pendiente;             /* Interrupción pendiente (salida INT en bajo). */
+    uint32_t lecturas;          /* Transacciones de lectura. */
+    uint32_t escrituras;        /* Transacciones de escritura. */
+    uint32_t bytes;             /* Bytes transferidos, sin contar la dirección del esclavo. */
+    int fallas;                 /* Cantidad de próximas transacciones que fallan. */
+    uint32_t fallidas;          /* Transacciones fallidas. */
+} modelo;
+
+/* Función de enganche, y ISR registrada en el GPIO de la salida INT. */
+static void (*modelo_enganche)(modelo_fase_t fase, uint8_t reg, size_t len);
+static gpio_isr_t modelo_isr;
+static void *modelo_isr_arg;
+
+/* Tiempo simulado, en us. */
+static int64_t modelo_ahora_us;
+
+/*==================[SIMULACION]=============================================*/
+
+static inline void modelo_reset(void)
+{
+    memset(&modelo, 0, sizeof(modelo));
+
+    /* Valores de reset de la hoja de datos: todos los pines como entrada. */
+    modelo.regs[MCP23008_IO_CONFIG_REG_ADDR] = 0xFF;
+
+    modelo_enganche = NULL;
+    modelo_ahora_us = 0;
+}
+
+static uint8_t modelo_puerto(void)
+{
+    uint8_t iodir = modelo.regs[MCP23008_IO_CONFIG_REG_ADDR];
+
+    return (modelo.regs[MCP23008_OLAT_REG_ADDR] & ~iodir) | ((modelo.pin ? MODELO_GP7 : 0) & iodir);
+}
+
+static inline void modelo_liberar(void)
+{
+    modelo.pendiente = 0;
+    modelo.regs[MCP23008_INTF_REG_ADDR] = 0;
+}
+
+/**
+ *  Cambio del nivel del GP7. Si la interrupción está habilitada y no hay otra pendiente, se captura el puerto,
+ *  baja la salida INT, y se llama a la ISR (flanco descendente).
+ */
+static inline void modelo_set_pin(bool nivel)
+{
+    if(modelo.pin == nivel)
+    {
+        return;
+    }
+
+    modelo.pin = nivel;
+
+    if(!(modelo.regs[MCP23008_GPINTEN_REG_ADDR] & MODELO_GP7) || modelo.pendiente)
+    {
+        return;
+    }
+
+    modelo.pendiente = 1;
+    modelo.regs[MCP23008_INTF_REG_ADDR] = MODELO_GP7;
+    modelo.regs[MCP23008_INTCAP_REG_ADDR] = modelo_puerto();
+
+    if(modelo_isr != NULL)
+    {
+        modelo_isr(modelo_isr_arg);
+    }
+}
+
+static inline bool modelo_fallar(void)
+{
+    if(modelo.fallas > 0)
+    {
+        modelo.fallas--;
+        modelo.fallidas++;
+        return 1;
+    }
+
+    return 0;
+}
+
+/*==================[MOCKS]==================================================*/
+
+esp_err_t i2c_master_write_read_device(i2c_port_t port, uint8_t addr, const uint8_t *wbuf, size_t wlen, uint8_t *rbuf, size_t rlen, TickType_t ticks)
+{
+    if(modelo_enganche != NULL)
+    {
+        modelo_enganche(MODELO_ANTES, wbuf[0], rlen);
+    }
+
+    if(addr != MCP23008_ADDR || wlen != 1 || modelo_fallar())
+    {
+        return ESP_FAIL;
+    }
+
+    modelo.lecturas++;
+    modelo.bytes += wlen + rlen;
+
+    for(size_t i = 0; i < rlen; i++)
+    {
+        uint8_t reg = (wbuf[0] + i) % MODELO_REGISTROS;
+
+        if(reg == MCP23008_GPIO_PORT_REG_ADDR)
+        {
+            rbuf[i] = modelo_puerto();
+        }
+
+        else
+        {
+            rbuf[i] = modelo.regs[reg];
+        }
+
+        if(reg == MCP23008_INTCAP_REG_ADDR || reg == MCP23008_GPIO_PORT_REG_ADDR)
+        {
+            modelo_liberar();
+        }
+    }
+
+    if(modelo_enganche != NULL)
+    {
+        modelo_enganche(MODELO_DESPUES, wbuf[0], rlen);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_write_to_device(i2c_port_t port, uint8_t addr, const uint8_t *buf, size_t len, TickType_t ticks)
+{
+    if(modelo_enganche != NULL)
+    {
+        modelo_enganche(MODELO_ANTES, buf[0], 0);
+    }
+
+    if(addr != MCP23008_ADDR || len < 1 || modelo_fallar())
+    {
+        return ESP_FAIL;
+    }
+
+    modelo.escrituras++;
+    modelo.bytes += len;
+
+    for(size_t i = 1; i < len; i++)
+    {
+        uint8_t reg = (buf[0] + i - 1) % MODELO_REGISTROS;
+
+        /* La escritura del GPIO se aplica sobre el OLAT. INTF e INTCAP son de solo lectura. */
+        if(reg == MCP23008_GPIO_PORT_REG_ADDR)
+        {
+            reg = MCP23008_OLAT_REG_ADDR;
+        }
+
+        if(reg != MCP23008_INTF_REG_ADDR && reg != MCP23008_INTCAP_REG_ADDR)
+        {
+            modelo.regs[reg] = buf[i];
+        }
+    }
+
+    if(modelo_enganche != NULL)
+    {
+        modelo_enganche(MODELO_DESPUES, buf[0], 0);
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *conf)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t rx, size_t tx, int flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, gpio_mode_t mode)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t nivel)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t isr, void *arg)
+{
+    if(gpio == MCP23008_INT_GPIO_PIN)
+    {
+        modelo_isr = isr;
+        modelo_isr_arg = arg;
+    }
+
+    return ESP_OK;
+}
+
+/* La salida INT del MCP23008 es activa en bajo. */
+int gpio_get_level(gpio_num_t gpio)
+{
+    return gpio == MCP23008_INT_GPIO_PIN ? !modelo.pendiente : 0;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return modelo_ahora_us;
+}
+
+/* Una única tarea accede al driver: el mutex siempre está disponible y lo tiene la tarea que lo toma. */
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return (SemaphoreHandle_t) 1;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t espera)
+{
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex)
+{
+    return pdTRUE;
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t mutex)
+{
+    return (TaskHandle_t) 1;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t) 1;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle)
+{
+    *handle = (TaskHandle_t) tarea;
+    return pdPASS;
+}
+
+#endif /* MCP23008_MODELO_H_ */
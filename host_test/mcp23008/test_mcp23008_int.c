@@ -0,0 +1,339 @@
+/**
+ * @file test_mcp23008_int.c
+ * @brief   Test de la atención de la interrupción del Trigger pH (GP7) del MCP23008: la ISR
+ *          "MCP23008_int_isr_handler()" y la tarea "vTaskMCP23008Int()", contra el modelo del chip de
+ *          "mcp23008_modelo.h".
+ *
+ *          Primero se ejecutan escenarios puntuales (flanco aislado, pulso con la interrupción pendiente, pulso
+ *          después de la lectura de los registros, lecturas fallidas y su reintento, y tres flancos con la
+ *          interrupción pendiente), y luego se cambia el pin al azar antes de atender la interrupción y en cualquier
+ *          punto de la secuencia de lecturas del driver, con fallas de I2C inyectadas.
+ *
+ *          El chip solo captura el primer cambio de cada interrupción (INTCAP) y el nivel al momento de la lectura
+ *          (GPIO), por lo que de una ventana con k flancos (desde la captura hasta la liberación) se pueden entregar
+ *          a lo sumo 2 (k par) o 1 (k impar) cambios. El test verifica que el driver entrega todos los cambios que el
+ *          chip permite reconstruir, es decir, que las ventanas de hasta dos flancos no pierden ninguno, y que al
+ *          quedar la tarea bloqueada el nivel entregado coincide con el del pin.
+ *
+ *          La tarea se ejecuta hasta que se bloquea esperando la notificación de la ISR: "ulTaskNotifyTake()"
+ *          vuelve al test con un longjmp cuando no hay notificaciones pendientes.
+ */
+
+#include <setjmp.h>
+
+#include "mcp23008_modelo.h"
+
+#include "MCP23008.c"
+
+/* Iteraciones del test aleatorio, y despertares máximos de la tarea por iteración antes de considerar que no se bloquea. */
+#define TEST_ITERACIONES 200000
+#define TEST_MAX_DESPERTARES 64
+
+/* Notificaciones pendientes de la tarea, y contexto para volver al test cuando se bloquea. */
+static uint32_t test_notificaciones;
+static jmp_buf test_bloqueada;
+static int test_despertares;
+static uint32_t test_demoras;
+
+/* Generador pseudoaleatorio xorshift32 y probabilidad de cambiar el pin en cada punto de la secuencia del driver. */
+static uint32_t test_semilla = 1;
+static int test_prob_enganche;
+
+/* Guion de un escenario puntual: cambios del pin después de cada transacción, por número de transacción. */
+static const uint8_t *test_guion;
+static int test_guion_largo;
+static int test_transaccion;
+
+/* Contabilidad de flancos, de ventanas de interrupción y de eventos entregados. */
+static struct {
+    uint32_t flancos;
+    uint32_t entregados;
+    uint32_t perdidos_chip;
+    uint32_t ventanas[4];
+    uint32_t errores;
+} test_cuenta;
+
+static uint32_t test_flancos_ventana;
+static bool test_ultimo_entregado;
+
+/*==================[MOCKS]==================================================*/
+
+void vTaskNotifyGiveFromISR(TaskHandle_t tarea, BaseType_t *woken)
+{
+    test_notificaciones++;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t tarea)
+{
+    test_notificaciones++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t espera)
+{
+    if(test_notificaciones == 0)
+    {
+        longjmp(test_bloqueada, 1);
+    }
+
+    if(++test_despertares > TEST_MAX_DESPERTARES)
+    {
+        fprintf(stderr, "FAIL: la tarea de la interrupción no se bloquea\n");
+        exit(1);
+    }
+
+    uint32_t notificaciones = test_notificaciones;
+    test_notificaciones = 0;
+    modelo_ahora_us += 20;
+    return notificaciones;
+}
+
+static void test_enganche(modelo_fase_t fase, uint8_t reg, size_t len);
+
+void vTaskDelay(TickType_t ticks)
+{
+    test_demoras++;
+    modelo_ahora_us += ticks * 1000;
+
+    /* Durante la demora el pin también puede cambiar. */
+    test_enganche(MODELO_DESPUES, 0, 0);
+}
+
+/*==================[SIMULACION]=============================================*/
+
+static uint32_t test_rand(void)
+{
+    test_semilla ^= test_semilla << 13;
+    test_semilla ^= test_semilla >> 17;
+    test_semilla ^= test_semilla << 5;
+    return test_semilla;
+}
+
+static void test_flanco(void)
+{
+    bool pendiente = modelo.pendiente;
+
+    modelo_ahora_us += 1 + test_rand() % 50;
+    modelo_set_pin(!modelo.pin);
+    test_cuenta.flancos++;
+
+    /* Un flanco sin interrupción pendiente abre una ventana; con la interrupción pendiente se suma a la ventana. */
+    if(!pendiente)
+    {
+        test_flancos_ventana = 1;
+    }
+
+    else
+    {
+        test_flancos_ventana++;
+    }
+}
+
+/* Al liberarse la interrupción se cierra la ventana: el chip solo permite reconstruir 1 (k impar) o 2 (k par) flancos. */
+static void test_cerrar_ventana(void)
+{
+    if(test_flancos_ventana == 0 || modelo.pendiente)
+    {
+        return;
+    }
+
+    uint32_t k = test_flancos_ventana;
+
+    test_cuenta.perdidos_chip += k - ((k & 1) ? 1 : 2);
+    test_cuenta.ventanas[k < 4 ? k : 3]++;
+    test_flancos_ventana = 0;
+}
+
+static void test_enganche(modelo_fase_t fase, uint8_t reg, size_t len)
+{
+    if(fase != MODELO_DESPUES)
+    {
+        return;
+    }
+
+    test_cerrar_ventana();
+
+    if(test_guion != NULL)
+    {
+        for(int i = 0; test_transaccion < test_guion_largo && i < test_guion[test_transaccion]; i++)
+        {
+            test_flanco();
+        }
+
+        test_transaccion++;
+    }
+
+    else if(test_prob_enganche > 0 && test_rand() % 100 < test_prob_enganche)
+    {
+        for(int i = 1 + test_rand() % 2; i > 0; i--)
+        {
+            test_flanco();
+        }
+    }
+}
+
+static void test_callback(const MCP23008_pH_trigger_event_t *event)
+{
+    test_cuenta.entregados++;
+
+    if(event->level == test_ultimo_entregado || event->latency_us < 0 || event->edge_time_us > modelo_ahora_us)
+    {
+        test_cuenta.errores++;
+    }
+
+    test_ultimo_entregado = event->level;
+}
+
+static void test_atender(void)
+{
+    test_despertares = 0;
+
+    if(!setjmp(test_bloqueada))
+    {
+        vTaskMCP23008Int(NULL);
+    }
+}
+
+static void test_init(void)
+{
+    modelo_reset();
+    memset(&test_cuenta, 0, sizeof(test_cuenta));
+
+    test_notificaciones = 0;
+    test_demoras = 0;
+    test_flancos_ventana = 0;
+    test_ultimo_entregado = 0;
+    test_guion = NULL;
+    test_prob_enganche = 0;
+
+    MCP23008_init();
+    MCP23008_pH_trigger_callback_function_on_event(test_callback);
+
+    modelo_enganche = test_enganche;
+}
+
+/* Al bloquearse la tarea, la interrupción está liberada y el nivel entregado es el del pin. */
+static bool test_en_reposo(void)
+{
+    return test_notificaciones == 0 && !modelo.pendiente && read_pH_trigger() == modelo.pin;
+}
+
+/*==================[ESCENARIOS]=============================================*/
+
+typedef struct {
+    const char *nombre;
+    uint8_t flancos;            /* Flancos antes de atender la interrupción. */
+    uint8_t guion[4];           /* Flancos después de cada transacción. */
+    int fallas;                 /* Transacciones que fallan. */
+    uint32_t eventos;           /* Eventos que se deben entregar. */
+} test_escenario_t;
+
+static const test_escenario_t test_escenarios[] = {
+    { "flanco aislado",                             1, {0},         0, 1 },
+    { "pulso con la interrupción pendiente",        2, {0},         0, 2 },
+    { "pulso después de la primera transacción",    1, {2},         0, 3 },
+    { "flanco después de la primera transacción",   1, {1},         0, 2 },
+    { "lectura fallida",                            1, {0},         1, 1 },
+    { "pulso en la demora de reintento (límite)",   1, {2},         1, 1 },
+    { "pulso después del reintento",                1, {0, 2},      1, 3 },
+    { "pulso y dos lecturas fallidas",              2, {0},         2, 2 },
+    { "tres flancos pendientes (límite del chip)",  3, {0},         0, 1 },
+};
+
+static bool test_escenario(const test_escenario_t *esc)
+{
+    test_init();
+
+    test_guion = esc->guion;
+    test_guion_largo = sizeof(esc->guion);
+    test_transaccion = 0;
+    modelo.fallas = esc->fallas;
+
+    for(int i = 0; i < esc->flancos; i++)
+    {
+        test_flanco();
+    }
+
+    test_atender();
+
+    bool ok = test_en_reposo() && test_cuenta.entregados == esc->eventos && test_cuenta.errores == 0
+              && (esc->fallas == 0 || test_demoras > 0);
+
+    printf("%s: %s, %u flancos, %u eventos entregados (esperados %u), %u lecturas, %u fallidas\n",
+           ok ? "ok" : "FAIL", esc->nombre, test_cuenta.flancos, test_cuenta.entregados, esc->eventos,
+           modelo.lecturas, modelo.fallidas);
+
+    return ok;
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    int fallas = 0;
+
+    for(size_t i = 0; i < sizeof(test_escenarios) / sizeof(test_escenarios[0]); i++)
+    {
+        fallas += !test_escenario(&test_escenarios[i]);
+    }
+
+    /**
+     *  Test aleatorio: antes de cada atención cambia el pin entre 0 y 3 veces, y después de cada transacción (y
+     *  durante la demora de reintento) cambia 1 o 2 veces con probabilidad del 25 %. Una de cada 16 atenciones
+     *  tiene 1 o 2 transacciones fallidas.
+     */
+    test_init();
+    test_prob_enganche = 25;
+
+    MCP23008_stats_t stats_inicio = {0};
+    MCP23008_get_stats(&stats_inicio);
+
+    uint32_t sin_reposo = 0;
+    uint32_t lecturas_inicio = modelo.lecturas;
+
+    for(uint32_t i = 0; i < TEST_ITERACIONES; i++)
+    {
+        for(int n = test_rand() % 4; n > 0; n--)
+        {
+            test_flanco();
+        }
+
+        if(test_rand() % 16 == 0)
+        {
+            modelo.fallas = 1 + test_rand() % 2;
+        }
+
+        test_atender();
+
+        if(!test_en_reposo())
+        {
+            sin_reposo++;
+        }
+    }
+
+    uint32_t perdidos = test_cuenta.flancos - test_cuenta.entregados;
+    MCP23008_stats_t stats = {0};
+    MCP23008_get_stats(&stats);
+
+    printf("aleatorio: %u flancos, %u eventos entregados, %u lecturas (%.2f por evento), %u fallidas\n",
+           test_cuenta.flancos, test_cuenta.entregados, modelo.lecturas - lecturas_inicio,
+           (double) (modelo.lecturas - lecturas_inicio) / test_cuenta.entregados, modelo.fallidas);
+    printf("aleatorio: ventanas de 1, 2 y 3 o más flancos: %u, %u, %u; flancos perdidos %u, irrecuperables por el chip %u\n",
+           test_cuenta.ventanas[1], test_cuenta.ventanas[2], test_cuenta.ventanas[3], perdidos, test_cuenta.perdidos_chip);
+    printf("aleatorio: %u eventos contados por el driver, latencia máxima %lld us\n",
+           stats.trigger_events - stats_inicio.trigger_events, (long long) stats.trigger_max_latency_us);
+
+    bool ok = perdidos == test_cuenta.perdidos_chip && sin_reposo == 0 && test_cuenta.errores == 0
+              && stats.trigger_events - stats_inicio.trigger_events == test_cuenta.entregados;
+
+    if(!ok)
+    {
+        printf("FAIL: %u flancos perdidos por el driver, %u atenciones sin reposo, %u eventos inválidos\n",
+               perdidos - test_cuenta.perdidos_chip, sin_reposo, test_cuenta.errores);
+        fallas++;
+    }
+
+    printf("%s: %d fallas\n", fallas ? "FAIL" : "PASS", fallas);
+
+    return fallas ? 1 : 0;
+}
@@ -0,0 +1,259 @@
+/**
+ * @file test_relay_bus.c
+ * @brief   Test del tráfico I2C del manejo de los relés del MCP23008: compara el driver original, en el que
+ *          "get_relay_state()" lee el GPIO y "set_relay_state()" lee y escribe el GPIO en cada llamada, con el
+ *          driver con copia en RAM del registro OLAT, en el que la lectura no accede al bus y la escritura solo se
+ *          realiza si el estado cambia (más la verificación periódica del OLAT).
+ *
+ *          Ambos drivers se ejecutan contra el modelo del chip de "mcp23008_modelo.h", que cuenta las
+ *          transacciones, con las mismas llamadas por paso de 100 ms que realizaban las MEFs de control previas a
+ *          la copia del OLAT, durante un minuto, en tres escenarios:
+ *
+ *          -AUTO dosificando: los lazos de pH y TDS fuera de la ventana con la bomba encendida. Cada paso evalúa la
+ *           guarda "!get_relay_state(bomba)" de cada lazo, y las válvulas se abren 1 s y se cierran 2 s.
+ *          -AUTO en la ventana: las guardas se cortocircuitan con el valor sensado, por lo que no hay llamadas, y el
+ *           único tráfico es el de la verificación del OLAT.
+ *          -MANUAL: con los tópicos del modo MANUAL recibidos, cada paso vuelve a escribir las dos válvulas de pH
+ *           y las dos de TDS, y el usuario cambia una válvula cada 5 s.
+ *
+ *          El driver original se extrae del historial de git (ver el Makefile). El test verifica que ambos drivers
+ *          dejan los relés en el estado esperado, y que el driver con copia del OLAT realiza exactamente una
+ *          escritura por cambio efectivo más dos lecturas por verificación.
+ */
+
+#include <setjmp.h>
+
+#include "mcp23008_modelo.h"
+
+#include "MEF_ALGORITMO_CONTROL_pH_SOLUCION.h"
+#include "MEF_ALGORITMO_CONTROL_TDS_SOLUCION.h"
+
+#include "MCP23008.c"
+
+/* Driver original, con sus funciones renombradas para compilarlo en la misma unidad de traducción. */
+#define TAG old_TAG
+#define MCP23008_register_read old_MCP23008_register_read
+#define MCP23008_register_write_byte old_MCP23008_register_write_byte
+#define MCP23008_init old_MCP23008_init
+#define read_pH_trigger old_read_pH_trigger
+#define set_relay_state old_set_relay_state
+#define get_relay_state old_get_relay_state
+
+/* El driver original se compila sin cambios, incluidas sus variables sin uso. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#include "old_mcp23008/MCP23008.c"
+#pragma GCC diagnostic pop
+
+#undef TAG
+#undef MCP23008_register_read
+#undef MCP23008_register_write_byte
+#undef MCP23008_init
+#undef read_pH_trigger
+#undef set_relay_state
+#undef get_relay_state
+
+/* Período de evaluación de las MEFs de control, y duración de cada escenario. */
+#define TEST_PASO_MS 100
+#define TEST_DURACION_MS 60000
+
+/* Tiempos de apertura y cierre de las válvulas de pH y TDS, y período de los cambios del usuario en modo MANUAL. */
+#define TEST_APERTURA_MS 1000
+#define TEST_CIERRE_MS 2000
+#define TEST_CAMBIO_MANUAL_MS 5000
+
+typedef enum {
+    TEST_AUTO_DOSIFICANDO,
+    TEST_AUTO_VENTANA,
+    TEST_MANUAL,
+    TEST_ESCENARIOS,
+} test_escenario_t;
+
+static const char *test_nombres[TEST_ESCENARIOS] = {
+    "AUTO dosificando",
+    "AUTO en la ventana",
+    "MANUAL",
+};
+
+/* Funciones de acceso a los relés del driver bajo test. */
+typedef struct {
+    esp_err_t (*set)(int8_t relay_num, bool relay_state);
+    bool (*get)(int8_t relay_num);
+} test_driver_t;
+
+/* Contexto para salir de la tarea de verificación del OLAT luego de una pasada. */
+static jmp_buf test_resync_fin;
+static int test_resync_demoras;
+
+/*==================[MOCKS]==================================================*/
+
+void vTaskDelay(TickType_t ticks)
+{
+    if(++test_resync_demoras > 1)
+    {
+        longjmp(test_resync_fin, 1);
+    }
+}
+
+/* El Trigger pH no cambia en este test, por lo que la tarea de atención de la interrupción no se ejecuta. */
+void vTaskNotifyGiveFromISR(TaskHandle_t tarea, BaseType_t *woken)
+{
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t tarea)
+{
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t espera)
+{
+    return 0;
+}
+
+/*==================[SIMULACION]=============================================*/
+
+/* Una pasada de la tarea de verificación del OLAT del driver con copia en RAM. */
+static void test_resync(void)
+{
+    test_resync_demoras = 0;
+
+    if(!setjmp(test_resync_fin))
+    {
+        vTaskMCP23008Resync(NULL);
+    }
+}
+
+typedef struct {
+    uint32_t llamadas;
+    uint32_t lecturas;
+    uint32_t escrituras;
+    uint32_t cambios;
+    uint32_t resyncs;
+    bool estado_ok;
+} test_resultado_t;
+
+/* Estado esperado de los relés, que se actualiza con cada escritura. */
+static uint8_t test_estado;
+
+static bool test_get(const test_driver_t *drv, test_resultado_t *res, int8_t rele)
+{
+    res->llamadas++;
+    return drv->get(rele);
+}
+
+static void test_set(const test_driver_t *drv, test_resultado_t *res, int8_t rele, bool valor)
+{
+    res->llamadas++;
+    res->cambios += ((test_estado >> rele) & 1) != valor;
+
+    BIT_WRITE(test_estado, rele, valor);
+    drv->set(rele, valor);
+}
+
+/* Un paso de 100 ms de las MEFs de control. */
+static void test_paso(const test_driver_t *drv, test_resultado_t *res, test_escenario_t esc, uint32_t t_ms)
+{
+    if(esc == TEST_AUTO_DOSIFICANDO)
+    {
+        /* Guardas de los estados BAJO de pH y TDS: "... || !get_relay_state(bomba) || ...". */
+        if(!test_get(drv, res, PH_BOMBA) || !test_get(drv, res, TDS_BOMBA))
+        {
+            return;
+        }
+
+        /* Sub-MEF de las válvulas: apertura y cierre por tramos (la válvula de TDS tiene lógica negada). */
+        uint32_t fase = t_ms % (TEST_APERTURA_MS + TEST_CIERRE_MS);
+
+        if(fase == 0 || fase == TEST_APERTURA_MS)
+        {
+            bool abierta = fase == 0;
+
+            test_set(drv, res, VALVULA_AUMENTO_PH, abierta);
+            test_set(drv, res, VALVULA_AUMENTO_TDS, !abierta);
+        }
+    }
+
+    else if(esc == TEST_MANUAL)
+    {
+        bool cambio = t_ms % TEST_CAMBIO_MANUAL_MS == 0;
+
+        /* Cada paso se vuelven a escribir las válvulas con el valor de los tópicos del modo MANUAL. */
+        static const int8_t valvulas[] = { VALVULA_AUMENTO_PH, VALVULA_DISMINUCION_PH, VALVULA_AUMENTO_TDS, VALVULA_DISMINUCION_TDS };
+
+        for(size_t i = 0; i < sizeof(valvulas) / sizeof(valvulas[0]); i++)
+        {
+            bool valor = (test_estado >> valvulas[i]) & 1;
+
+            test_set(drv, res, valvulas[i], valvulas[i] == VALVULA_DISMINUCION_PH && cambio ? !valor : valor);
+        }
+    }
+}
+
+static test_resultado_t test_correr(const test_driver_t *drv, esp_err_t (*init)(void), bool resync, test_escenario_t esc)
+{
+    test_resultado_t res = {0};
+
+    modelo_reset();
+    init();
+
+    /* Se parte con la bomba encendida y las válvulas cerradas. */
+    drv->set(PH_BOMBA, 1);
+
+    test_estado = modelo.regs[MCP23008_OLAT_REG_ADDR];
+    uint32_t lecturas = modelo.lecturas, escrituras = modelo.escrituras;
+
+    for(uint32_t t_ms = 0; t_ms < TEST_DURACION_MS; t_ms += TEST_PASO_MS)
+    {
+        test_paso(drv, &res, esc, t_ms);
+
+        if(resync && t_ms % MCP23008_RESYNC_PERIOD_MS == 0)
+        {
+            test_resync();
+            res.resyncs++;
+        }
+    }
+
+    res.lecturas = modelo.lecturas - lecturas;
+    res.escrituras = modelo.escrituras - escrituras;
+    res.estado_ok = modelo.regs[MCP23008_OLAT_REG_ADDR] == test_estado;
+
+    return res;
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    static const test_driver_t original = { old_set_relay_state, old_get_relay_state };
+    static const test_driver_t olat = { set_relay_state, get_relay_state };
+
+    int fallas = 0;
+
+    for(test_escenario_t esc = 0; esc < TEST_ESCENARIOS; esc++)
+    {
+        test_resultado_t a = test_correr(&original, old_MCP23008_init, 0, esc);
+        test_resultado_t b = test_correr(&olat, MCP23008_init, 1, esc);
+
+        uint32_t total_a = a.lecturas + a.escrituras;
+        uint32_t total_b = b.lecturas + b.escrituras;
+
+        /**
+         *  Con la copia del OLAT, cada cambio efectivo de un relé es una única escritura, y las únicas lecturas son las
+         *  de la verificación periódica. Sin llamadas al driver, la verificación es el único tráfico.
+         */
+        bool ok = a.estado_ok && b.estado_ok && a.llamadas == b.llamadas
+                  && b.escrituras == b.cambios && b.lecturas == 2 * b.resyncs
+                  && (a.llamadas == 0 || total_b < total_a);
+
+        printf("%s: %s, %u llamadas al driver por minuto\n", ok ? "ok" : "FAIL", test_nombres[esc], a.llamadas);
+        printf("    original: %5u transacciones por minuto (%u lecturas, %u escrituras)\n", total_a, a.lecturas, a.escrituras);
+        printf("    OLAT:     %5u transacciones por minuto (%u lecturas de %u verificaciones, %u escrituras)\n",
+               total_b, b.lecturas, b.resyncs, b.escrituras);
+
+        fallas += !ok;
+    }
+
+    printf("%s: %d fallas\n", fallas ? "FAIL" : "PASS", fallas);
+
+    return fallas ? 1 : 0;
+}
@@ -0,0 +1,326 @@
+/*
+
+    Mocks del cliente MQTT de ESP-IDF y de FreeRTOS para los tests de host de la librería MQTT
+
+    Reemplaza al cliente MQTT (suscripción y publicación, contando las llamadas y los bytes que cada
+    publicación ocuparía en el cable), a la cola de ingreso (una cola FIFO real, con la capacidad y el
+    tamaño de elemento con los que se la crea) y a las tareas, mutex y NVS que usa la librería. NVS no
+    está disponible, por lo que el buffer de publicaciones pendientes funciona solo en RAM.
+
+    Las tareas de la librería son bucles infinitos: "mocks_correr_tarea()" ejecuta una tarea hasta que
+    se bloquearía (cola de ingreso vacía, o demora de la tarea luego de la cantidad de pasadas indicada)
+    y vuelve al test con un longjmp.
+
+    Los tests se compilan con la librería en una única unidad de traducción, por lo que este archivo
+    define funciones y datos estáticos.
+
+*/
+
+#ifndef MQTT_MOCKS_H_   /* Include guard */
+#define MQTT_MOCKS_H_
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <setjmp.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "nvs_flash.h"
+#include "mqtt_client.h"
+#include "esp_timer.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/* Capacidad y tamaño de elemento máximos de la cola modelada. */
+#define MOCKS_COLA_MAX_LEN 256
+#define MOCKS_COLA_MAX_ITEM 16
+
+/*==================[INTERNAL DATA DEFINITION]===============================*/
+
+static struct {
+    uint8_t items[MOCKS_COLA_MAX_LEN][MOCKS_COLA_MAX_ITEM];
+    UBaseType_t capacidad;
+    UBaseType_t tamanio;
+    UBaseType_t cabeza;
+    UBaseType_t cantidad;
+} mocks_cola;
+
+/* Publicaciones y suscripciones realizadas a través del cliente MQTT. */
+static struct {
+    uint32_t publicaciones;
+    uint64_t bytes_cable;       /* Bytes de los paquetes PUBLISH, con encabezados. */
+    uint64_t bytes_dato;        /* Bytes del dato publicado. */
+    uint32_t suscripciones;
+    bool falla_publicacion;     /* Si es 1, las publicaciones fallan (sin conexión). */
+} mocks_mqtt;
+
+/* Función que recibe cada publicación realizada, para que el test verifique su contenido. */
+static void (*mocks_publicacion)(const char *topic, const char *data, int len);
+
+/* Handler de eventos registrado por la librería. */
+static esp_event_handler_t mocks_handler;
+
+/* Tiempo simulado, en us. */
+static int64_t mocks_ahora_us;
+
+/* Contexto para volver al test cuando una tarea se bloquea, y pasadas de la tarea que faltan hasta bloquearse. */
+static jmp_buf mocks_bloqueada;
+static bool mocks_en_tarea;
+static int mocks_pasadas;
+
+/*==================[SIMULACION]=============================================*/
+
+static inline void mocks_reset(void)
+{
+    memset(&mocks_cola, 0, sizeof(mocks_cola));
+    memset(&mocks_mqtt, 0, sizeof(mocks_mqtt));
+    mocks_publicacion = NULL;
+    mocks_ahora_us = 0;
+}
+
+/**
+ *  Bytes que ocupa en el cable un paquete PUBLISH con QoS 0 (MQTT 3.1.1): encabezado fijo (1 byte de tipo
+ *  y de 1 a 4 bytes de largo restante), largo del tópico (2 bytes), tópico y dato, sin identificador de paquete.
+ */
+static uint32_t mocks_bytes_publish(size_t topic_len, size_t data_len)
+{
+    uint32_t restante = 2 + topic_len + data_len;
+    uint32_t largo = 1;
+
+    for(uint32_t r = restante; r >= 128; r >>= 7)
+    {
+        largo++;
+    }
+
+    return 1 + largo + restante;
+}
+
+/* Ejecuta una tarea de la librería hasta que se bloquea, permitiendo "pasadas" demoras antes de volver. */
+static inline void mocks_correr_tarea(TaskFunction_t tarea, int pasadas)
+{
+    mocks_pasadas = pasadas;
+    mocks_en_tarea = 1;
+
+    if(!setjmp(mocks_bloqueada))
+    {
+        tarea(NULL);
+    }
+
+    mocks_en_tarea = 0;
+}
+
+static inline void mocks_bloquear(void)
+{
+    if(mocks_en_tarea)
+    {
+        longjmp(mocks_bloqueada, 1);
+    }
+}
+
+/* Las demoras de una tarea avanzan el tiempo simulado, y bloquean la tarea cuando se acaban sus pasadas. */
+static inline void mocks_demora(TickType_t ticks)
+{
+    if(mocks_pasadas-- <= 0)
+    {
+        mocks_bloquear();
+    }
+
+    mocks_ahora_us += (int64_t) ticks * portTICK_RATE_MS * 1000;
+}
+
+/*==================[MOCKS]==================================================*/
+
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t *config)
+{
+    return (esp_mqtt_client_handle_t) 1;
+}
+
+esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t client, int event, esp_event_handler_t handler, void *arg)
+{
+    mocks_handler = handler;
+    return ESP_OK;
+}
+
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t client)
+{
+    return ESP_OK;
+}
+
+int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t client, const char *topic, int qos)
+{
+    return ++mocks_mqtt.suscripciones;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic, const char *data, int len, int qos, int retain)
+{
+    if(mocks_mqtt.falla_publicacion)
+    {
+        return -1;
+    }
+
+    if(len <= 0)
+    {
+        len = strlen(data);
+    }
+
+    mocks_mqtt.publicaciones++;
+    mocks_mqtt.bytes_cable += mocks_bytes_publish(strlen(topic), len);
+    mocks_mqtt.bytes_dato += len;
+
+    if(mocks_publicacion != NULL)
+    {
+        mocks_publicacion(topic, data, len);
+    }
+
+    return mocks_mqtt.publicaciones;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t largo, UBaseType_t tamanio)
+{
+    if(largo > MOCKS_COLA_MAX_LEN || tamanio > MOCKS_COLA_MAX_ITEM)
+    {
+        return NULL;
+    }
+
+    memset(&mocks_cola, 0, sizeof(mocks_cola));
+    mocks_cola.capacidad = largo;
+    mocks_cola.tamanio = tamanio;
+
+    return (QueueHandle_t) &mocks_cola;
+}
+
+BaseType_t xQueueSend(QueueHandle_t cola, const void *item, TickType_t espera)
+{
+    if(mocks_cola.cantidad == mocks_cola.capacidad)
+    {
+        return pdFALSE;
+    }
+
+    memcpy(mocks_cola.items[(mocks_cola.cabeza + mocks_cola.cantidad) % mocks_cola.capacidad], item, mocks_cola.tamanio);
+    mocks_cola.cantidad++;
+
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t cola, void *item, TickType_t espera)
+{
+    if(mocks_cola.cantidad == 0)
+    {
+        if(espera > 0)
+        {
+            mocks_bloquear();
+        }
+
+        return pdFALSE;
+    }
+
+    memcpy(item, mocks_cola.items[mocks_cola.cabeza], mocks_cola.tamanio);
+    mocks_cola.cabeza = (mocks_cola.cabeza + 1) % mocks_cola.capacidad;
+    mocks_cola.cantidad--;
+
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t cola)
+{
+    return mocks_cola.cantidad;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle)
+{
+    *handle = (TaskHandle_t) tarea;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t tarea, const char *nombre, uint32_t stack, void *param, UBaseType_t prioridad, TaskHandle_t *handle, BaseType_t core)
+{
+    *handle = (TaskHandle_t) tarea;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t tarea)
+{
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t espera)
+{
+    mocks_bloquear();
+    return 0;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    mocks_demora(ticks);
+}
+
+void vTaskDelayUntil(TickType_t *ultimo, TickType_t periodo)
+{
+    mocks_demora(periodo);
+    *ultimo += periodo;
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t) (mocks_ahora_us / 1000 / portTICK_RATE_MS);
+}
+
+/* Una única tarea se ejecuta a la vez: el mutex siempre está disponible. */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return (SemaphoreHandle_t) 1;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t espera)
+{
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex)
+{
+    return pdTRUE;
+}
+
+esp_err_t nvs_open(const char *nombre, nvs_open_mode_t modo, nvs_handle_t *handle)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *clave, uint32_t *valor)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *clave, uint32_t valor)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *clave, void *valor, size_t *largo)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *clave, const void *valor, size_t largo)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return ESP_FAIL;
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return mocks_ahora_us;
+}
+
+#endif /* MQTT_MOCKS_H_ */
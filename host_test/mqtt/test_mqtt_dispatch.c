@@ -0,0 +1,457 @@
+/**
+ * @file test_mqtt_dispatch.c
+ * @brief   Benchmark del despacho de los mensajes MQTT recibidos: compara el handler de eventos actual, que busca el
+ *          tópico en la tabla de hash FNV-1a, interpreta el dato y encola el callback, con el despacho original, que
+ *          copiaba el nombre del tópico a un buffer auxiliar y lo comparaba con "strcmp()" contra todos los tópicos
+ *          registrados.
+ *
+ *          Se registran los 26 tópicos que suscribe la compilación de depuración (lazos de control, bombeo, luces
+ *          y tópicos de ensayo), y se reproduce una secuencia de 10000 mensajes al azar (con un 5 % de mensajes en
+ *          tópicos no registrados), armados como en el buffer de recepción del cliente: ni el tópico ni el dato
+ *          están terminados en nulo.
+ *
+ *          El test verifica que ambos despachos encuentran el mismo tópico para cada mensaje, que guardan el mismo
+ *          dato y ejecutan los mismos callbacks, y que la tabla de hash compara a lo sumo un nombre completo por
+ *          mensaje. El costo en ns y ciclos se mide en el host: sirve para comparar ambas versiones, pero no es el
+ *          costo en el ESP32.
+ */
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "mqtt_mocks.h"
+
+#include "MQTT_PUBL_SUSCR.c"
+
+#include "APP_LEVEL_SENSOR.h"
+#include "APP_LIGHT_SENSOR.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_BOMBEO_SOLUCION.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_TDS_SOLUCION.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_TEMP_SOLUCION.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_pH_SOLUCION.h"
+
+/* Cantidad de mensajes de la secuencia, porcentaje de mensajes en tópicos no registrados, y repeticiones del benchmark. */
+#define TEST_MENSAJES 10000
+#define TEST_DESCONOCIDOS_PCT 5
+#define TEST_REPETICIONES 50
+
+/* Tamaño del buffer en el que se arman los mensajes. */
+#define TEST_BUFFER_LEN (TEST_MENSAJES * 96)
+
+/*==================[TOPICOS]================================================*/
+
+/* Tópicos suscritos en la compilación de depuración, con el tipo de dato con el que los registra cada módulo. */
+static const struct {
+    const char *topic;
+    mqtt_topic_value_type_t tipo;
+} test_topicos[] = {
+    { TEST_LEVEL_TANQUE_PRINCIPAL_TOPIC,                MQTT_TOPIC_VALUE_FLOAT },
+    { TEST_LEVEL_TANQUE_ACIDO_TOPIC,                    MQTT_TOPIC_VALUE_FLOAT },
+    { TEST_LEVEL_TANQUE_ALCALINO_TOPIC,                 MQTT_TOPIC_VALUE_FLOAT },
+    { TEST_LEVEL_TANQUE_AGUA_TOPIC,                     MQTT_TOPIC_VALUE_FLOAT },
+    { TEST_LEVEL_TANQUE_SUSTRATO_TOPIC,                 MQTT_TOPIC_VALUE_FLOAT },
+    { LUZ_AMB_STATE_MQTT_TOPIC,                         MQTT_TOPIC_VALUE_ON_OFF },
+    { NEW_PUMP_ON_TIME_MQTT_TOPIC,                      MQTT_TOPIC_VALUE_FLOAT },
+    { NEW_PUMP_OFF_TIME_MQTT_TOPIC,                     MQTT_TOPIC_VALUE_FLOAT },
+    { PUMP_MANUAL_MODE_MQTT_TOPIC,                      MQTT_TOPIC_VALUE_MODE },
+    { MANUAL_MODE_PUMP_STATE_MQTT_TOPIC,                MQTT_TOPIC_VALUE_ON_OFF },
+    { NEW_TDS_SP_MQTT_TOPIC,                            MQTT_TOPIC_VALUE_FLOAT },
+    { TDS_MANUAL_MODE_MQTT_TOPIC,                       MQTT_TOPIC_VALUE_MODE },
+    { MANUAL_MODE_VALVULA_AUM_TDS_STATE_MQTT_TOPIC,     MQTT_TOPIC_VALUE_ON_OFF },
+    { MANUAL_MODE_VALVULA_DISM_TDS_STATE_MQTT_TOPIC,    MQTT_TOPIC_VALUE_ON_OFF },
+    { TEST_TDS_VALUE_TOPIC,                             MQTT_TOPIC_VALUE_FLOAT },
+    { NEW_TEMP_SP_MQTT_TOPIC,                           MQTT_TOPIC_VALUE_FLOAT },
+    { TEMP_SOLUC_MANUAL_MODE_MQTT_TOPIC,                MQTT_TOPIC_VALUE_MODE },
+    { MANUAL_MODE_REFRIGERADOR_STATE_MQTT_TOPIC,        MQTT_TOPIC_VALUE_ON_OFF },
+    { MANUAL_MODE_CALEFACTOR_STATE_MQTT_TOPIC,          MQTT_TOPIC_VALUE_ON_OFF },
+    { TEST_TEMP_SOLUC_VALUE_TOPIC,                      MQTT_TOPIC_VALUE_FLOAT },
+    { NEW_PH_SP_MQTT_TOPIC,                             MQTT_TOPIC_VALUE_FLOAT },
+    { PH_MANUAL_MODE_MQTT_TOPIC,                        MQTT_TOPIC_VALUE_MODE },
+    { MANUAL_MODE_VALVULA_AUM_PH_STATE_MQTT_TOPIC,      MQTT_TOPIC_VALUE_ON_OFF },
+    { MANUAL_MODE_VALVULA_DISM_PH_STATE_MQTT_TOPIC,     MQTT_TOPIC_VALUE_ON_OFF },
+    { TEST_PH_VALUE_TOPIC,                              MQTT_TOPIC_VALUE_FLOAT },
+    { PH_CALIBRATION_MQTT_TOPIC,                        MQTT_TOPIC_VALUE_RAW },
+};
+
+#define TEST_TOPICOS (sizeof(test_topicos) / sizeof(test_topicos[0]))
+
+/* Tópicos que llegan al broker pero que el nodo no registra (publicados por el propio nodo o por otros clientes). */
+static const char *test_desconocidos[] = {
+    PUMP_STATE_MQTT_TOPIC,
+    TDS_SOLUC_MQTT_TOPIC,
+    PH_CALIBRATION_STATE_MQTT_TOPIC,
+    "/Ensayo/CO2",
+};
+
+/*==================[DESPACHO ORIGINAL]======================================*/
+
+/* Lista de tópicos del despacho original, tal como estaba antes de la tabla de hash. */
+static struct {
+    char data[50];
+    char topic[100];
+    CallbackFunction topic_cb;
+} test_lista_original[MQTT_MAX_TOPIC_NUM];
+
+static unsigned int test_num_original;
+
+/* Búsqueda original: copia del nombre a un buffer auxiliar y comparación con todos los tópicos registrados. */
+static int test_buscar_original(const char *topic, int topic_len)
+{
+    char topic_aux[100] = "";
+    strncpy(topic_aux, topic, topic_len);
+
+    int encontrado = -1;
+
+    for(int i = 0; i < test_num_original; i++)
+    {
+        if(!strcmp(test_lista_original[i].topic, topic_aux))
+        {
+            encontrado = i;
+            continue;
+        }
+    }
+
+    return encontrado;
+}
+
+/* Despacho original del evento MQTT_EVENT_DATA, con el callback ejecutado en el event loop del cliente. */
+static void test_despacho_original(esp_mqtt_event_handle_t event)
+{
+    char topic_aux[100] = "";
+    strncpy(topic_aux, event->topic, event->topic_len);
+
+    for(int i = 0; i < test_num_original; i++)
+    {
+        if(!strcmp(test_lista_original[i].topic, topic_aux))
+        {
+            memset(test_lista_original[i].data, 0, sizeof(test_lista_original[i].data));
+            strncpy(test_lista_original[i].data, event->data, event->data_len);
+
+            if(test_lista_original[i].topic_cb != NULL)
+            {
+                test_lista_original[i].topic_cb(NULL);
+            }
+
+            continue;
+        }
+    }
+}
+
+/*==================[SECUENCIA]==============================================*/
+
+static char test_buffer[TEST_BUFFER_LEN];
+static esp_mqtt_event_t test_eventos[TEST_MENSAJES];
+static int test_topico_esperado[TEST_MENSAJES];
+
+static uint32_t test_semilla = 1;
+static uint32_t test_callbacks;
+
+static uint32_t test_rand(void)
+{
+    test_semilla ^= test_semilla << 13;
+    test_semilla ^= test_semilla >> 17;
+    test_semilla ^= test_semilla << 5;
+    return test_semilla;
+}
+
+static void test_callback(void *pvParameters)
+{
+    test_callbacks++;
+}
+
+/* Dato válido para el tipo del tópico. */
+static int test_dato(mqtt_topic_value_type_t tipo, char *dato, size_t len)
+{
+    switch(tipo)
+    {
+    case MQTT_TOPIC_VALUE_ON_OFF:
+        return snprintf(dato, len, "%s", test_rand() & 1 ? "ON" : "OFF");
+
+    case MQTT_TOPIC_VALUE_MODE:
+        return snprintf(dato, len, "%s", test_rand() & 1 ? "MANUAL" : "AUTO");
+
+    default:
+        return snprintf(dato, len, "%.2f", (test_rand() % 140000) / 100.0);
+    }
+}
+
+/**
+ *  Arma la secuencia de mensajes en un único buffer, como en el buffer de recepción del cliente: cada tópico está
+ *  seguido por su dato, y cada dato por el tópico del mensaje siguiente.
+ */
+static void test_armar_secuencia(void)
+{
+    size_t pos = 0;
+
+    for(int i = 0; i < TEST_MENSAJES; i++)
+    {
+        const char *topic;
+        mqtt_topic_value_type_t tipo = MQTT_TOPIC_VALUE_FLOAT;
+
+        if(test_rand() % 100 < TEST_DESCONOCIDOS_PCT)
+        {
+            topic = test_desconocidos[test_rand() % (sizeof(test_desconocidos) / sizeof(test_desconocidos[0]))];
+            test_topico_esperado[i] = -1;
+        }
+
+        else
+        {
+            int t = test_rand() % TEST_TOPICOS;
+
+            topic = test_topicos[t].topic;
+            tipo = test_topicos[t].tipo;
+            test_topico_esperado[i] = t;
+        }
+
+        char dato[16];
+        int dato_len = test_dato(tipo, dato, sizeof(dato));
+        int topic_len = strlen(topic);
+
+        memcpy(&test_buffer[pos], topic, topic_len);
+        memcpy(&test_buffer[pos + topic_len], dato, dato_len);
+
+        test_eventos[i] = (esp_mqtt_event_t) {
+            .event_id = MQTT_EVENT_DATA,
+            .client = (esp_mqtt_client_handle_t) 1,
+            .topic = &test_buffer[pos],
+            .topic_len = topic_len,
+            .data = &test_buffer[pos + topic_len],
+            .data_len = dato_len,
+            .total_data_len = dato_len,
+        };
+
+        pos += topic_len + dato_len;
+    }
+}
+
+/**
+ *  Cantidad de nombres completos que compara la tabla de hash para un tópico: los tópicos del recorrido de la tabla
+ *  con el mismo hash y el mismo largo.
+ */
+static uint32_t test_comparaciones_hash(const char *topic, size_t topic_len)
+{
+    uint32_t hash = mqtt_topic_hash(topic, topic_len);
+    uint32_t comparaciones = 0;
+
+    for(uint32_t i = 0; i < MQTT_TOPIC_HASH_TABLE_SIZE; i++)
+    {
+        uint8_t slot = mqtt_topic_hash_table[(hash + i) & MQTT_TOPIC_HASH_TABLE_MASK];
+
+        if(slot == 0)
+        {
+            break;
+        }
+
+        mqtt_topic_handle_t topic_handle = &mqtt_topic_list[slot - 1];
+
+        if(topic_handle->topic_hash == hash && topic_handle->topic_len == topic_len)
+        {
+            comparaciones++;
+
+            if(!memcmp(topic_handle->topic, topic, topic_len))
+            {
+                break;
+            }
+        }
+    }
+
+    return comparaciones;
+}
+
+/*==================[BENCHMARK]==============================================*/
+
+static uint64_t test_ciclos(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t test_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static volatile intptr_t test_sumidero;
+
+/* Despacho actual: handler de eventos y, como lo haría la tarea de ingreso, ejecución del callback encolado. */
+static void test_despacho_actual(esp_mqtt_event_handle_t event)
+{
+    uint8_t topic_index;
+
+    mocks_handler(NULL, "MQTT", MQTT_EVENT_DATA, event);
+
+    if(xQueueReceive(mqtt_ingress_queue, &topic_index, 0) == pdTRUE)
+    {
+        mqtt_topic_list[topic_index].topic_cb(&mqtt_topic_list[topic_index]);
+    }
+}
+
+static void test_benchmark(void)
+{
+    uint64_t ns[5], c[5];
+
+    ns[0] = test_ns(), c[0] = test_ciclos();
+
+    for(int r = 0; r < TEST_REPETICIONES; r++)
+    {
+        for(int i = 0; i < TEST_MENSAJES; i++)
+        {
+            test_sumidero = (intptr_t) mqtt_find_topic(test_eventos[i].topic, test_eventos[i].topic_len);
+        }
+    }
+
+    ns[1] = test_ns(), c[1] = test_ciclos();
+
+    for(int r = 0; r < TEST_REPETICIONES; r++)
+    {
+        for(int i = 0; i < TEST_MENSAJES; i++)
+        {
+            test_sumidero = test_buscar_original(test_eventos[i].topic, test_eventos[i].topic_len);
+        }
+    }
+
+    ns[2] = test_ns(), c[2] = test_ciclos();
+
+    for(int r = 0; r < TEST_REPETICIONES; r++)
+    {
+        for(int i = 0; i < TEST_MENSAJES; i++)
+        {
+            test_despacho_actual(&test_eventos[i]);
+        }
+    }
+
+    ns[3] = test_ns(), c[3] = test_ciclos();
+
+    for(int r = 0; r < TEST_REPETICIONES; r++)
+    {
+        for(int i = 0; i < TEST_MENSAJES; i++)
+        {
+            test_despacho_original(&test_eventos[i]);
+        }
+    }
+
+    ns[4] = test_ns(), c[4] = test_ciclos();
+
+    const double n = (double) TEST_MENSAJES * TEST_REPETICIONES;
+
+    printf("benchmark (host), búsqueda del tópico: hash %.1f ns, %.1f ciclos por mensaje | strcmp original %.1f ns, %.1f ciclos por mensaje\n",
+           (ns[1] - ns[0]) / n, (c[1] - c[0]) / n, (ns[2] - ns[1]) / n, (c[2] - c[1]) / n);
+    printf("benchmark (host), despacho completo: actual %.1f ns, %.1f ciclos por mensaje | original %.1f ns, %.1f ciclos por mensaje\n",
+           (ns[3] - ns[2]) / n, (c[3] - c[2]) / n, (ns[4] - ns[3]) / n, (c[4] - c[3]) / n);
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    esp_mqtt_client_handle_t client;
+
+    mocks_reset();
+
+    if(mqtt_initialize_and_connect("mqtt://test", &client) != ESP_OK || mocks_handler == NULL)
+    {
+        printf("FAIL: no se pudo inicializar la librería\n");
+        return 1;
+    }
+
+    mqtt_topic_t lista[TEST_TOPICOS] = {0};
+
+    for(size_t i = 0; i < TEST_TOPICOS; i++)
+    {
+        strcpy(lista[i].topic_name, test_topicos[i].topic);
+        lista[i].topic_function_cb = test_callback;
+        lista[i].value_type = test_topicos[i].tipo;
+
+        strcpy(test_lista_original[i].topic, test_topicos[i].topic);
+        test_lista_original[i].topic_cb = test_callback;
+    }
+
+    test_num_original = TEST_TOPICOS;
+
+    if(mqtt_suscribe_to_topics(lista, TEST_TOPICOS, client, 0) != ESP_OK)
+    {
+        printf("FAIL: no se pudo suscribir a los tópicos\n");
+        return 1;
+    }
+
+    test_armar_secuencia();
+
+    /**
+     *  Una pasada de la secuencia por cada despacho, verificando mensaje a mensaje el tópico encontrado, y al
+     *  final los datos guardados y los callbacks ejecutados.
+     */
+    uint32_t distintos = 0, comparaciones_hash = 0, comparaciones_hash_max = 0, callbacks_actual, callbacks_original;
+
+    for(int i = 0; i < TEST_MENSAJES; i++)
+    {
+        mqtt_topic_handle_t handle = mqtt_find_topic(test_eventos[i].topic, test_eventos[i].topic_len);
+        int actual = handle != NULL ? (int) (handle - mqtt_topic_list) : -1;
+        int original = test_buscar_original(test_eventos[i].topic, test_eventos[i].topic_len);
+
+        distintos += actual != original || actual != test_topico_esperado[i];
+
+        uint32_t comparaciones = test_comparaciones_hash(test_eventos[i].topic, test_eventos[i].topic_len);
+
+        comparaciones_hash += comparaciones;
+
+        if(comparaciones > comparaciones_hash_max)
+        {
+            comparaciones_hash_max = comparaciones;
+        }
+    }
+
+    test_callbacks = 0;
+
+    for(int i = 0; i < TEST_MENSAJES; i++)
+    {
+        test_despacho_actual(&test_eventos[i]);
+    }
+
+    callbacks_actual = test_callbacks;
+    test_callbacks = 0;
+
+    for(int i = 0; i < TEST_MENSAJES; i++)
+    {
+        test_despacho_original(&test_eventos[i]);
+    }
+
+    callbacks_original = test_callbacks;
+
+    uint32_t datos_distintos = 0;
+
+    for(size_t i = 0; i < TEST_TOPICOS; i++)
+    {
+        char dato[MQTT_TOPIC_DATA_MAX_LEN];
+
+        if(mqtt_get_char_data_from_handle(&mqtt_topic_list[i], dato) != ESP_OK || strcmp(dato, test_lista_original[i].data))
+        {
+            datos_distintos++;
+        }
+    }
+
+    mqtt_ingress_stats_t stats;
+    mqtt_get_ingress_stats(&stats);
+
+    printf("%d mensajes en %u tópicos registrados: %u tópicos distintos, %u datos distintos, %u/%u callbacks (actual/original), %u rechazados, %u descartados\n",
+           TEST_MENSAJES, (unsigned int) TEST_TOPICOS, distintos, datos_distintos, callbacks_actual, callbacks_original,
+           mqtt_get_rejected_payload_count(), stats.dropped);
+    printf("comparaciones de nombres por mensaje: hash %.3f (máximo %u) | strcmp original %u\n",
+           (double) comparaciones_hash / TEST_MENSAJES, comparaciones_hash_max, test_num_original);
+
+    test_benchmark();
+
+    bool ok = distintos == 0 && datos_distintos == 0 && callbacks_actual == callbacks_original
+              && mqtt_get_rejected_payload_count() == 0 && stats.dropped == 0 && comparaciones_hash_max <= 1;
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,255 @@
+/**
+ * @file test_mqtt_ingress.c
+ * @brief   Test de la cola de ingreso de la librería MQTT, que saca la ejecución de los callbacks de los tópicos del
+ *          event loop del cliente MQTT hacia la tarea "vTaskMqttIngress()".
+ *
+ *          -Consumidor detenido: llegan más mensajes que la capacidad de la cola sin que la tarea de ingreso se
+ *           ejecute. Se verifica que la cola se llena, que los mensajes excedentes se cuentan como descartados sin
+ *           bloquear al handler, que el último dato de cada tópico igualmente se guarda, y que al reanudarse la
+ *           tarea ejecuta los callbacks encolados y vuelve a bloquearse con la cola vacía.
+ *
+ *          -Callbacks lentos: los callbacks demoran entre 0 y 200 us (espera activa con el reloj del host) y la tarea
+ *           de ingreso se ejecuta luego de cada mensaje. Se mide el tiempo del handler de eventos por mensaje, que
+ *           es el tiempo durante el cual el event loop del cliente no atiende la conexión, y se lo compara con el
+ *           despacho original, que ejecutaba el callback dentro del event loop.
+ */
+
+#include <time.h>
+
+#include "mqtt_mocks.h"
+
+#include "MQTT_PUBL_SUSCR.c"
+
+/* Mensajes del escenario con el consumidor detenido, y mensajes por demora del escenario con callbacks lentos. */
+#define TEST_MENSAJES_DETENIDO 100
+#define TEST_MENSAJES_LENTO 2000
+
+/* Demoras de los callbacks, en us. */
+static const uint32_t test_demoras_us[] = { 0, 10, 50, 200 };
+
+#define TEST_DEMORAS (sizeof(test_demoras_us) / sizeof(test_demoras_us[0]))
+
+/* Tiempo máximo del handler por mensaje, en us, admitido con cualquier demora de los callbacks. */
+#define TEST_HANDLER_MAX_US 5.0
+
+static const char *test_topicos[] = {
+    "NodeRed/Sensores de la solucion/pH/SP",
+    "/PhSoluc/Modo",
+    "/PhSoluc/Modo_Manual/Valvula_aum_ph",
+    "/TdsSoluc/Modo_Manual/Valvula_dism_tds",
+};
+
+#define TEST_TOPICOS (sizeof(test_topicos) / sizeof(test_topicos[0]))
+
+static uint32_t test_callbacks;
+static uint32_t test_demora_us;
+
+/*==================[AUXILIARES]=============================================*/
+
+static uint64_t test_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/* Callback lento: espera activa durante la demora configurada. */
+static void test_callback(void *pvParameters)
+{
+    test_callbacks++;
+
+    for(uint64_t fin = test_ns() + test_demora_us * 1000u; test_ns() < fin; )
+    {
+    }
+}
+
+/* Mensaje "i" de la secuencia: dato float en uno de los tópicos, con el tópico sin terminar en nulo. */
+static void test_mensaje(uint32_t i, esp_mqtt_event_t *event, char *buffer, size_t len)
+{
+    const char *topic = test_topicos[i % TEST_TOPICOS];
+    int topic_len = strlen(topic);
+    int dato_len = snprintf(&buffer[topic_len], len - topic_len, "%u", (unsigned int) i);
+
+    memcpy(buffer, topic, topic_len);
+
+    *event = (esp_mqtt_event_t) {
+        .event_id = MQTT_EVENT_DATA,
+        .client = (esp_mqtt_client_handle_t) 1,
+        .topic = buffer,
+        .topic_len = topic_len,
+        .data = &buffer[topic_len],
+        .data_len = dato_len,
+    };
+}
+
+/* Despacho original del evento MQTT_EVENT_DATA: el callback se ejecutaba dentro del event loop del cliente. */
+static void test_despacho_original(esp_mqtt_event_handle_t event)
+{
+    char topic_aux[100] = "";
+    strncpy(topic_aux, event->topic, event->topic_len);
+
+    for(int i = 0; i < mqtt_topic_num; i++)
+    {
+        if(!strcmp(mqtt_topic_list[i].topic, topic_aux))
+        {
+            memset(mqtt_topic_list[i].data, 0, sizeof(mqtt_topic_list[i].data));
+            strncpy(mqtt_topic_list[i].data, event->data, event->data_len);
+
+            if(mqtt_topic_list[i].topic_cb != NULL)
+            {
+                mqtt_topic_list[i].topic_cb(NULL);
+            }
+
+            continue;
+        }
+    }
+}
+
+/*==================[ESCENARIOS]=============================================*/
+
+static bool test_consumidor_detenido(void)
+{
+    mqtt_ingress_stats_t inicio, lleno, fin;
+    uint32_t seq_inicio[TEST_TOPICOS];
+
+    mqtt_get_ingress_stats(&inicio);
+
+    for(size_t t = 0; t < TEST_TOPICOS; t++)
+    {
+        seq_inicio[t] = mqtt_get_topic_seq(&mqtt_topic_list[t]);
+    }
+
+    test_callbacks = 0;
+    test_demora_us = 0;
+
+    for(uint32_t i = 0; i < TEST_MENSAJES_DETENIDO; i++)
+    {
+        esp_mqtt_event_t event;
+        char buffer[128];
+
+        test_mensaje(i, &event, buffer, sizeof(buffer));
+        mocks_handler(NULL, "MQTT", MQTT_EVENT_DATA, &event);
+    }
+
+    mqtt_get_ingress_stats(&lleno);
+
+    /* El último dato de cada tópico se guarda aunque su callback se haya descartado. */
+    bool datos_ok = 1;
+
+    for(size_t t = 0; t < TEST_TOPICOS; t++)
+    {
+        float valor;
+        uint32_t ultimo = TEST_MENSAJES_DETENIDO - TEST_TOPICOS + t;
+
+        datos_ok &= mqtt_get_topic_seq(&mqtt_topic_list[t]) - seq_inicio[t] == 2 * (TEST_MENSAJES_DETENIDO / TEST_TOPICOS);
+        datos_ok &= mqtt_get_float_data_from_handle(&mqtt_topic_list[t], &valor) == ESP_OK && valor == ultimo;
+    }
+
+    /* Se reanuda la tarea de ingreso, que debe vaciar la cola y bloquearse. */
+    mocks_correr_tarea(vTaskMqttIngress, 0);
+    mqtt_get_ingress_stats(&fin);
+
+    uint32_t encolados = lleno.queued - inicio.queued;
+    uint32_t descartados = lleno.dropped - inicio.dropped;
+
+    bool ok = datos_ok && lleno.depth == MQTT_INGRESS_QUEUE_LEN && lleno.high_water == MQTT_INGRESS_QUEUE_LEN
+              && encolados == MQTT_INGRESS_QUEUE_LEN && descartados == TEST_MENSAJES_DETENIDO - MQTT_INGRESS_QUEUE_LEN
+              && fin.depth == 0 && test_callbacks == encolados && fin.dropped == lleno.dropped;
+
+    printf("%s: consumidor detenido, %u mensajes: profundidad %u (máxima %u, capacidad %u), %u encolados, %u descartados, "
+           "%u callbacks al reanudar, profundidad final %u, datos %s\n",
+           ok ? "ok" : "FAIL", TEST_MENSAJES_DETENIDO, lleno.depth, lleno.high_water, MQTT_INGRESS_QUEUE_LEN, encolados,
+           descartados, test_callbacks, fin.depth, datos_ok ? "ok" : "FAIL");
+
+    return ok;
+}
+
+static bool test_callbacks_lentos(void)
+{
+    double handler_us[TEST_DEMORAS], original_us[TEST_DEMORAS];
+    bool ok = 1;
+
+    for(size_t d = 0; d < TEST_DEMORAS; d++)
+    {
+        uint64_t handler_ns = 0, original_ns = 0;
+
+        test_demora_us = test_demoras_us[d];
+        test_callbacks = 0;
+
+        for(uint32_t i = 0; i < TEST_MENSAJES_LENTO; i++)
+        {
+            esp_mqtt_event_t event;
+            char buffer[128];
+
+            test_mensaje(i, &event, buffer, sizeof(buffer));
+
+            uint64_t t0 = test_ns();
+            mocks_handler(NULL, "MQTT", MQTT_EVENT_DATA, &event);
+            uint64_t t1 = test_ns();
+
+            handler_ns += t1 - t0;
+
+            /* La tarea de ingreso ejecuta el callback fuera del event loop. */
+            mocks_correr_tarea(vTaskMqttIngress, 0);
+
+            t0 = test_ns();
+            test_despacho_original(&event);
+            original_ns += test_ns() - t0;
+        }
+
+        mqtt_ingress_stats_t stats;
+        mqtt_get_ingress_stats(&stats);
+
+        handler_us[d] = handler_ns / 1000.0 / TEST_MENSAJES_LENTO;
+        original_us[d] = original_ns / 1000.0 / TEST_MENSAJES_LENTO;
+
+        bool ok_demora = test_callbacks == 2 * TEST_MENSAJES_LENTO && stats.depth == 0
+                         && handler_us[d] <= TEST_HANDLER_MAX_US && original_us[d] >= test_demora_us;
+
+        printf("%s: callbacks de %3u us: handler %.2f us por mensaje | despacho original %.2f us por mensaje\n",
+               ok_demora ? "ok" : "FAIL", test_demora_us, handler_us[d], original_us[d]);
+
+        ok &= ok_demora;
+    }
+
+    return ok;
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    esp_mqtt_client_handle_t client;
+
+    mocks_reset();
+
+    if(mqtt_initialize_and_connect("mqtt://test", &client) != ESP_OK || mocks_handler == NULL)
+    {
+        printf("FAIL: no se pudo inicializar la librería\n");
+        return 1;
+    }
+
+    mqtt_topic_t lista[TEST_TOPICOS] = {0};
+
+    for(size_t i = 0; i < TEST_TOPICOS; i++)
+    {
+        strcpy(lista[i].topic_name, test_topicos[i]);
+        lista[i].topic_function_cb = test_callback;
+        lista[i].value_type = MQTT_TOPIC_VALUE_FLOAT;
+    }
+
+    if(mqtt_suscribe_to_topics(lista, TEST_TOPICOS, client, 0) != ESP_OK)
+    {
+        printf("FAIL: no se pudo suscribir a los tópicos\n");
+        return 1;
+    }
+
+    int fallas = 0;
+
+    fallas += !test_consumidor_detenido();
+    fallas += !test_callbacks_lentos();
+
+    printf("%s: %d fallas\n", fallas ? "FAIL" : "PASS", fallas);
+
+    return fallas ? 1 : 0;
+}
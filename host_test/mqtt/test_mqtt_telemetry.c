@@ -0,0 +1,386 @@
+/**
+ * @file test_mqtt_telemetry.c
+ * @brief   Test del tráfico de telemetría de la librería MQTT en sus tres formatos: un mensaje por tópico (por
+ *          defecto), trama agregada JSON (DEBUG_TELEMETRIA_AGREGADA) y trama agregada binaria (con
+ *          DEBUG_TELEMETRIA_FORMATO_BINARIO). El test se compila una vez por formato (ver el Makefile).
+ *
+ *          Se publican las 22 variables de telemetría de la aplicación (sensores ambientales, de nivel y de la
+ *          solución), una muestra por segundo de cada una con una caminata al azar, durante 10 minutos simulados,
+ *          primero sin política de publicación y luego con las políticas por excepción de la aplicación. Se miden
+ *          las publicaciones por minuto y los bytes por minuto en el cable (paquetes PUBLISH con QoS 0, con sus
+ *          encabezados), frente a los que habría publicado el formato por tópico con los mismos valores.
+ *
+ *          Cada trama agregada se decodifica y se verifica que cada valor incluido sea el último valor aceptado por
+ *          la política de la variable, y que al final de cada escenario no queden valores sin enviar. En el formato
+ *          por tópico se verifica cada valor publicado, y que los bytes medidos coinciden con los calculados.
+ */
+
+#include <math.h>
+
+#include "mqtt_mocks.h"
+
+#include "MQTT_PUBL_SUSCR.c"
+
+#include "APP_CO2.h"
+#undef GPIO_PIN_CO2_SENSOR  /* El header del lazo de temperatura reutiliza el nombre para el pin del DS18B20. */
+#include "APP_DHT11.h"
+#include "APP_LEVEL_SENSOR.h"
+#include "APP_LIGHT_SENSOR.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_TDS_SOLUCION.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_TEMP_SOLUCION.h"
+#include "AUXILIARES_ALGORITMO_CONTROL_pH_SOLUCION.h"
+
+#if defined(DEBUG_TELEMETRIA_AGREGADA) && defined(DEBUG_TELEMETRIA_FORMATO_BINARIO)
+#define TEST_FORMATO "binario"
+#elif defined(DEBUG_TELEMETRIA_AGREGADA)
+#define TEST_FORMATO "JSON"
+#else
+#define TEST_FORMATO "por tópico"
+#endif
+
+/* Duración de cada escenario y período de muestreo de las variables. */
+#define TEST_DURACION_MS 600000
+#define TEST_MUESTREO_MS 1000
+
+/*==================[VARIABLES]==============================================*/
+
+/* Variables de telemetría de la aplicación, con sus decimales y bandas muertas, y el rango de la caminata al azar. */
+static const struct {
+    const char *topic;
+    uint8_t decimales;
+    float banda;            /* Banda muerta absoluta de la aplicación (0 = sin banda). */
+    float inicial;
+    float paso;             /* Paso máximo de la caminata al azar por muestra. */
+} test_vars[] = {
+    { CO2_AMB_MQTT_TOPIC,                   3, CO2_AMB_PUBLISH_DEADBAND,        600,   8 },
+    { TEMP_AMB_MQTT_TOPIC,                  3, TEMP_AMB_PUBLISH_DEADBAND,       22,    0.1 },
+    { HUM_AMB_MQTT_TOPIC,                   3, HUM_AMB_PUBLISH_DEADBAND,        60,    0.3 },
+    { SENSOR_NIVEL_TANQUE_PRINCIPAL_MQTT_TOPIC, 3, NIVEL_TANQUE_PUBLISH_DEADBAND, 0.8, 0.004 },
+    { SENSOR_NIVEL_TANQUE_ACIDO_MQTT_TOPIC, 3, NIVEL_TANQUE_PUBLISH_DEADBAND,   0.5,   0.002 },
+    { SENSOR_NIVEL_TANQUE_ALCALINO_MQTT_TOPIC, 3, NIVEL_TANQUE_PUBLISH_DEADBAND, 0.5,  0.002 },
+    { SENSOR_NIVEL_TANQUE_AGUA_MQTT_TOPIC,  3, NIVEL_TANQUE_PUBLISH_DEADBAND,   0.7,   0.004 },
+    { SENSOR_NIVEL_TANQUE_SUSTRATO_MQTT_TOPIC, 3, NIVEL_TANQUE_PUBLISH_DEADBAND, 0.6,  0.002 },
+    { VOLUMEN_TANQUE_PRINCIPAL_MQTT_TOPIC,  2, VOLUMEN_TANQUE_PUBLISH_DEADBAND, 80,    0.04 },
+    { VOLUMEN_TANQUE_ACIDO_MQTT_TOPIC,      2, VOLUMEN_TANQUE_PUBLISH_DEADBAND, 5,     0.02 },
+    { VOLUMEN_TANQUE_ALCALINO_MQTT_TOPIC,   2, VOLUMEN_TANQUE_PUBLISH_DEADBAND, 5,     0.02 },
+    { VOLUMEN_TANQUE_AGUA_MQTT_TOPIC,       2, VOLUMEN_TANQUE_PUBLISH_DEADBAND, 60,    0.04 },
+    { VOLUMEN_TANQUE_SUSTRATO_MQTT_TOPIC,   2, VOLUMEN_TANQUE_PUBLISH_DEADBAND, 10,    0.02 },
+    { CAUDAL_TANQUE_PRINCIPAL_MQTT_TOPIC,   2, CAUDAL_TANQUE_PUBLISH_DEADBAND,  0,     0.04 },
+    { CAUDAL_TANQUE_ACIDO_MQTT_TOPIC,       2, CAUDAL_TANQUE_PUBLISH_DEADBAND,  0,     0.02 },
+    { CAUDAL_TANQUE_ALCALINO_MQTT_TOPIC,    2, CAUDAL_TANQUE_PUBLISH_DEADBAND,  0,     0.02 },
+    { CAUDAL_TANQUE_AGUA_MQTT_TOPIC,        2, CAUDAL_TANQUE_PUBLISH_DEADBAND,  0,     0.04 },
+    { CAUDAL_TANQUE_SUSTRATO_MQTT_TOPIC,    2, CAUDAL_TANQUE_PUBLISH_DEADBAND,  0,     0.02 },
+    { LUZ_AMB_MQTT_TOPIC,                   0, 0.5,                             1,     0 },
+    { TDS_SOLUC_MQTT_TOPIC,                 3, 0,                               800,   2 },
+    { TEMP_SOLUC_MQTT_TOPIC,                3, TEMP_SOLUC_PUBLISH_DEADBAND,     21,    0.03 },
+    { PH_SOLUC_MQTT_TOPIC,                  3, PH_SOLUC_PUBLISH_DEADBAND,       6,     0.008 },
+};
+
+#define TEST_VARS (sizeof(test_vars) / sizeof(test_vars[0]))
+
+/* Valor actual de cada variable, y último valor aceptado por la política de publicación. */
+static float test_valor[TEST_VARS];
+static float test_aceptado[TEST_VARS];
+
+/* Publicaciones y bytes que habría realizado el formato por tópico con los valores aceptados. */
+static uint32_t test_por_topico_publicaciones;
+static uint64_t test_por_topico_bytes;
+
+/* Valores entregados en las tramas, y valores de las tramas que no coinciden con el último aceptado. */
+static uint32_t test_entregados;
+static uint32_t test_errores;
+
+static uint32_t test_semilla = 1;
+
+/*==================[AUXILIARES]=============================================*/
+
+static float test_rand_unif(void)
+{
+    test_semilla ^= test_semilla << 13;
+    test_semilla ^= test_semilla >> 17;
+    test_semilla ^= test_semilla << 5;
+    return (test_semilla >> 8) / (float) (1u << 24);
+}
+
+static int test_var_por_topico(const char *topic, size_t len)
+{
+    for(size_t i = 0; i < TEST_VARS; i++)
+    {
+        if(strlen(test_vars[i].topic) == len && !memcmp(test_vars[i].topic, topic, len))
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Verifica un valor entregado contra el valor esperado, con la resolución de los decimales publicados. */
+static void test_verificar(int var, double valor, float esperado, bool exacto)
+{
+    test_entregados++;
+
+    double tolerancia = exacto ? 0 : 0.5 * pow(10, -test_vars[var].decimales) + 1e-6 * fabs(esperado);
+
+    if(fabs(valor - esperado) > tolerancia)
+    {
+        test_errores++;
+    }
+}
+
+/*==================[DECODIFICACION]=========================================*/
+
+#ifndef DEBUG_TELEMETRIA_FORMATO_BINARIO
+static void test_decodificar_json(const char *data, int len)
+{
+    char trama[MQTT_TELEMETRY_FRAME_BUFFER_LEN + 1];
+
+    memcpy(trama, data, len);
+    trama[len] = '\0';
+
+    const char *p = strstr(trama, "\"d\":{");
+
+    if(p == NULL)
+    {
+        test_errores++;
+        return;
+    }
+
+    p += 5;
+
+    while(*p == '"')
+    {
+        const char *fin = strchr(p + 1, '"');
+
+        if(fin == NULL || fin[1] != ':')
+        {
+            test_errores++;
+            return;
+        }
+
+        int var = test_var_por_topico(p + 1, fin - p - 1);
+        char *resto;
+        double valor = strtod(fin + 2, &resto);
+
+        if(var < 0)
+        {
+            test_errores++;
+            return;
+        }
+
+        test_verificar(var, valor, test_aceptado[var], 0);
+
+        p = resto + (*resto == ',');
+    }
+
+    if(strcmp(p, "}}"))
+    {
+        test_errores++;
+    }
+}
+#endif
+
+#ifdef DEBUG_TELEMETRIA_FORMATO_BINARIO
+static int test_var_por_id(unsigned int id)
+{
+    return id < mqtt_telemetry_var_num ? test_var_por_topico(mqtt_telemetry_vars[id].topic, strlen(mqtt_telemetry_vars[id].topic)) : -1;
+}
+
+static void test_decodificar_binario(const char *data, int len)
+{
+    const uint8_t *trama = (const uint8_t *) data;
+
+    if(len < 6 || trama[0] != MQTT_TELEMETRY_FRAME_VERSION || len != 6 + trama[1] * (1 + sizeof(float)))
+    {
+        test_errores++;
+        return;
+    }
+
+    for(int i = 6; i < len; i += 1 + sizeof(float))
+    {
+        float valor;
+        int var = test_var_por_id(trama[i]);
+
+        memcpy(&valor, &trama[i + 1], sizeof(float));
+
+        if(var < 0)
+        {
+            test_errores++;
+            continue;
+        }
+
+        test_verificar(var, valor, test_aceptado[var], 1);
+    }
+}
+#endif
+
+static void test_publicacion(const char *topic, const char *data, int len)
+{
+    if(!strcmp(topic, MQTT_TELEMETRY_FRAME_TOPIC))
+    {
+        #ifdef DEBUG_TELEMETRIA_FORMATO_BINARIO
+        test_decodificar_binario(data, len);
+        #else
+        test_decodificar_json(data, len);
+        #endif
+    }
+
+    else if(strcmp(topic, MQTT_TELEMETRY_MAP_TOPIC))
+    {
+        int var = test_var_por_topico(topic, strlen(topic));
+
+        /* En el formato por tópico, el valor se publica al aceptarlo la política: es el valor actual de la variable. */
+        if(var >= 0)
+        {
+            test_verificar(var, strtod(data, NULL), test_valor[var], 0);
+        }
+
+        else
+        {
+            test_errores++;
+        }
+    }
+}
+
+/*==================[ESCENARIOS]=============================================*/
+
+/* Una muestra de una variable: se publica y, si la política la acepta, se contabiliza como en el formato por tópico. */
+static void test_muestra(int i)
+{
+    mqtt_telemetry_stats_t antes, despues;
+
+    test_valor[i] += test_vars[i].paso * (2 * test_rand_unif() - 1);
+
+    /* La luminosidad es un estado binario que cambia cada varios minutos. */
+    if(test_vars[i].paso == 0 && test_rand_unif() < 0.005)
+    {
+        test_valor[i] = !test_valor[i];
+    }
+
+    mqtt_get_telemetry_stats(test_vars[i].topic, &antes);
+    mqtt_publish_telemetry((esp_mqtt_client_handle_t) 1, test_vars[i].topic, test_valor[i], test_vars[i].decimales);
+    mqtt_get_telemetry_stats(test_vars[i].topic, &despues);
+
+    if(despues.sent != antes.sent)
+    {
+        char dato[20];
+        int len = snprintf(dato, sizeof(dato), "%.*f", test_vars[i].decimales, test_valor[i]);
+
+        test_aceptado[i] = test_valor[i];
+        test_por_topico_publicaciones++;
+        test_por_topico_bytes += mocks_bytes_publish(strlen(test_vars[i].topic), len);
+    }
+}
+
+static bool test_escenario(const char *nombre)
+{
+    uint32_t publicaciones = mocks_mqtt.publicaciones;
+    uint64_t bytes = mocks_mqtt.bytes_cable;
+    int64_t inicio_us = mocks_ahora_us;
+
+    test_por_topico_publicaciones = 0;
+    test_por_topico_bytes = 0;
+    test_entregados = 0;
+    test_errores = 0;
+
+    for(uint32_t t_ms = 0; t_ms < TEST_DURACION_MS; t_ms += TEST_MUESTREO_MS)
+    {
+        mocks_ahora_us = inicio_us + (int64_t) t_ms * 1000;
+
+        for(size_t i = 0; i < TEST_VARS; i++)
+        {
+            test_muestra(i);
+        }
+
+        #ifdef DEBUG_TELEMETRIA_AGREGADA
+        /* Al final de cada período de la trama se ejecuta una pasada de la tarea de telemetría. */
+        if((t_ms + TEST_MUESTREO_MS) % MQTT_TELEMETRY_FRAME_PERIOD_MS == 0)
+        {
+            mocks_ahora_us = inicio_us + (int64_t) (t_ms + TEST_MUESTREO_MS - MQTT_TELEMETRY_FRAME_PERIOD_MS) * 1000;
+            mocks_correr_tarea(vTaskMqttTelemetry, 1);
+        }
+        #endif
+    }
+
+    mocks_ahora_us = inicio_us + (int64_t) TEST_DURACION_MS * 1000;
+
+    publicaciones = mocks_mqtt.publicaciones - publicaciones;
+    bytes = mocks_mqtt.bytes_cable - bytes;
+
+    /* Valores aceptados por la política que quedaron sin enviar al final del escenario. */
+    uint32_t pendientes = 0;
+
+    #ifdef DEBUG_TELEMETRIA_AGREGADA
+    for(unsigned int i = 0; i < mqtt_telemetry_var_num; i++)
+    {
+        pendientes += mqtt_telemetry_vars[i].updated;
+    }
+    #endif
+
+    const double minutos = TEST_DURACION_MS / 60000.0;
+
+    printf("%s, %s: %.1f publicaciones por minuto, %.0f bytes por minuto en el cable, %u valores entregados, %u pendientes\n",
+           TEST_FORMATO, nombre, publicaciones / minutos, bytes / minutos, test_entregados, pendientes);
+    printf("    por tópico con los mismos valores: %.1f publicaciones por minuto, %.0f bytes por minuto en el cable (%.1f %%)\n",
+           test_por_topico_publicaciones / minutos, test_por_topico_bytes / minutos, 100.0 * bytes / test_por_topico_bytes);
+
+    #ifdef DEBUG_TELEMETRIA_AGREGADA
+    bool ok = test_errores == 0 && pendientes == 0 && bytes < test_por_topico_bytes
+              && publicaciones <= TEST_DURACION_MS / MQTT_TELEMETRY_FRAME_PERIOD_MS + 1;
+    #else
+    bool ok = test_errores == 0 && publicaciones == test_por_topico_publicaciones && bytes == test_por_topico_bytes
+              && test_entregados == publicaciones;
+    #endif
+
+    if(!ok)
+    {
+        printf("FAIL: %s, %u valores entregados distintos del último aceptado\n", nombre, test_errores);
+    }
+
+    return ok;
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    esp_mqtt_client_handle_t client;
+
+    mocks_reset();
+
+    if(mqtt_initialize_and_connect("mqtt://test", &client) != ESP_OK || mocks_handler == NULL)
+    {
+        printf("FAIL: no se pudo inicializar la librería\n");
+        return 1;
+    }
+
+    esp_mqtt_event_t conectado = { .event_id = MQTT_EVENT_CONNECTED, .client = client };
+    mocks_handler(NULL, "MQTT", MQTT_EVENT_CONNECTED, &conectado);
+
+    mocks_publicacion = test_publicacion;
+
+    for(size_t i = 0; i < TEST_VARS; i++)
+    {
+        test_valor[i] = test_vars[i].inicial;
+    }
+
+    int fallas = 0;
+
+    fallas += !test_escenario("sin política de publicación");
+
+    for(size_t i = 0; i < TEST_VARS; i++)
+    {
+        mqtt_telemetry_policy_t politica = {
+            .abs_deadband = test_vars[i].banda,
+            .max_silence_ms = 60000,
+        };
+
+        mqtt_set_telemetry_policy(test_vars[i].topic, &politica);
+    }
+
+    fallas += !test_escenario("políticas de la aplicación");
+
+    printf("%s: %d fallas\n", fallas ? "FAIL" : "PASS", fallas);
+
+    return fallas ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+/**
+ * @file test_signal_filters.c
+ * @brief   Test de los filtros de la librería SIGNAL_FILTERS contra su cálculo por fuerza bruta (ordenando las muestras):
+ *
+ *          -Mediana móvil: ventanas de 1 a 64 muestras, con secuencias al azar de valores continuos, de valores
+ *           enteros con muchas repeticiones (como las cuentas del ADC), y monótonas, verificando la mediana luego de
+ *           cada muestra, incluyendo el llenado inicial de la ventana.
+ *          -Media recortada: bloques de 1 a 64 muestras y recortes de 0 a 8 muestras por extremo (todas las
+ *           combinaciones válidas), verificando el resultado de cada bloque. Con muestras enteras el resultado debe
+ *           ser exacto; con muestras continuas, igual salvo el redondeo del orden de la suma.
+ *
+ *          Además, mide el costo por muestra frente al ordenamiento por el método de la burbuja que realizaban los
+ *          sensores de pH y TDS originales, aplicado a la misma ventana o bloque en cada muestra (mediana) o en cada
+ *          bloque (media recortada), con las ventanas del sensor original (10), del buffer del motor del ADC previo a
+ *          los filtros (16) y del motor actual (ADC_ENGINE_MEDIAN_WINDOW, y bloques de ADC_ENGINE_DECIMATION muestras
+ *          recortando ADC_ENGINE_TRIM). El costo en ciclos se mide en el host: sirve para comparar ambas versiones,
+ *          pero no es el costo en el ESP32.
+ */
+
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "SIGNAL_FILTERS.c"
+
+#include "ADC_ENGINE.h"
+
+/* Ventana máxima de la mediana y bloque máximo de la media recortada del fuzz, y secuencias por configuración. */
+#define TEST_VENTANA_MAX 64
+#define TEST_SECUENCIAS 20
+
+/* Error relativo admitido en la media recortada con muestras continuas (orden de la suma). */
+#define TEST_ERROR_REL_MAX 1e-5
+
+/* Muestras del benchmark. */
+#define TEST_BENCH_MUESTRAS 200000
+
+typedef enum {
+    TEST_CONTINUA,          /* Valores continuos al azar. */
+    TEST_ENTERA,            /* Cuentas del ADC con muchas repeticiones. */
+    TEST_MONOTONA,          /* Rampa creciente o decreciente. */
+    TEST_TIPOS,
+} test_tipo_t;
+
+static uint32_t test_semilla = 1;
+
+/*==================[AUXILIARES]=============================================*/
+
+static uint32_t test_rand(void)
+{
+    test_semilla ^= test_semilla << 13;
+    test_semilla ^= test_semilla >> 17;
+    test_semilla ^= test_semilla << 5;
+    return test_semilla;
+}
+
+static float test_muestra(test_tipo_t tipo, int i, bool creciente)
+{
+    switch(tipo)
+    {
+    case TEST_CONTINUA:
+        return (test_rand() >> 8) / (float) (1u << 24) * 200.0f - 100.0f;
+
+    case TEST_ENTERA:
+        return 2000 + (int) (test_rand() % 9) - 4;
+
+    default:
+        return creciente ? i * 0.5f : -i * 0.5f;
+    }
+}
+
+static int test_comparar(const void *a, const void *b)
+{
+    float x = *(const float *) a, y = *(const float *) b;
+    return (x > y) - (x < y);
+}
+
+static float test_mediana_referencia(const float *muestras, int n)
+{
+    float ordenadas[TEST_VENTANA_MAX];
+
+    memcpy(ordenadas, muestras, n * sizeof(float));
+    qsort(ordenadas, n, sizeof(float), test_comparar);
+
+    return (n & 1) ? ordenadas[n / 2] : (ordenadas[n / 2 - 1] + ordenadas[n / 2]) / 2;
+}
+
+static double test_media_recortada_referencia(const float *muestras, int n, int trim)
+{
+    float ordenadas[TEST_VENTANA_MAX];
+    double suma = 0;
+
+    memcpy(ordenadas, muestras, n * sizeof(float));
+    qsort(ordenadas, n, sizeof(float), test_comparar);
+
+    for(int i = trim; i < n - trim; i++)
+    {
+        suma += ordenadas[i];
+    }
+
+    return suma / (n - 2 * trim);
+}
+
+/*==================[FUZZ]===================================================*/
+
+static bool test_fuzz_mediana(void)
+{
+    uint32_t verificadas = 0, errores = 0;
+
+    for(int ventana = 1; ventana <= TEST_VENTANA_MAX; ventana++)
+    {
+        for(int s = 0; s < TEST_SECUENCIAS; s++)
+        {
+            test_tipo_t tipo = s % TEST_TIPOS;
+            bool creciente = (s / TEST_TIPOS) & 1;
+            int largo = 4 * ventana + test_rand() % 50;
+
+            filter_median_t filtro;
+            float historia[4 * TEST_VENTANA_MAX + 50];
+
+            if(filter_median_init(&filtro, ventana) != ESP_OK)
+            {
+                return 0;
+            }
+
+            errores += filter_median_get(&filtro) != 0;
+
+            for(int i = 0; i < largo; i++)
+            {
+                historia[i] = test_muestra(tipo, i, creciente);
+                filter_median_add(&filtro, historia[i]);
+
+                int n = i + 1 < ventana ? i + 1 : ventana;
+                float referencia = test_mediana_referencia(&historia[i + 1 - n], n);
+
+                if(filter_median_get(&filtro) != referencia)
+                {
+                    if(errores++ < 5)
+                    {
+                        printf("mediana: ventana %d, secuencia %d, muestra %d: %f, esperada %f\n",
+                               ventana, s, i, filter_median_get(&filtro), referencia);
+                    }
+                }
+
+                verificadas++;
+            }
+
+            filter_median_deinit(&filtro);
+        }
+    }
+
+    printf("%s: mediana móvil, ventanas de 1 a %d, %u medianas verificadas, %u distintas\n",
+           errores ? "FAIL" : "ok", TEST_VENTANA_MAX, verificadas, errores);
+
+    return errores == 0;
+}
+
+static bool test_fuzz_media_recortada(void)
+{
+    uint32_t configuraciones = 0, bloques = 0, errores = 0;
+    double error_rel_max = 0;
+
+    for(int trim = 0; trim <= FILTER_TRIM_MAX; trim++)
+    {
+        for(int largo = 1; largo <= TEST_VENTANA_MAX; largo++)
+        {
+            filter_trimmed_mean_t filtro;
+
+            /* Los bloques que no dejan muestras luego del recorte deben rechazarse. */
+            if(largo <= 2 * trim)
+            {
+                errores += filter_trimmed_mean_init(&filtro, largo, trim) != ESP_ERR_INVALID_ARG;
+                continue;
+            }
+
+            if(filter_trimmed_mean_init(&filtro, largo, trim) != ESP_OK)
+            {
+                errores++;
+                continue;
+            }
+
+            configuraciones++;
+
+            for(int s = 0; s < TEST_SECUENCIAS; s++)
+            {
+                test_tipo_t tipo = s % TEST_TIPOS;
+                bool creciente = (s / TEST_TIPOS) & 1;
+                float bloque[TEST_VENTANA_MAX];
+
+                for(int i = 0; i < largo; i++)
+                {
+                    bloque[i] = test_muestra(tipo, i, creciente);
+
+                    /* Solo la última muestra del bloque completa el bloque. */
+                    if(filter_trimmed_mean_add(&filtro, bloque[i]) != (i == largo - 1))
+                    {
+                        errores++;
+                    }
+                }
+
+                double referencia = test_media_recortada_referencia(bloque, largo, trim);
+                double valor = filter_trimmed_mean_get(&filtro);
+                bool ok;
+
+                if(tipo == TEST_CONTINUA)
+                {
+                    double error_rel = fabs(valor - referencia) / 100.0;
+
+                    error_rel_max = error_rel > error_rel_max ? error_rel : error_rel_max;
+                    ok = error_rel <= TEST_ERROR_REL_MAX;
+                }
+
+                else
+                {
+                    ok = valor == (float) referencia;
+                }
+
+                if(!ok && errores++ < 5)
+                {
+                    printf("media recortada: bloque %d, recorte %d, secuencia %d: %f, esperada %f\n",
+                           largo, trim, s, valor, referencia);
+                }
+
+                bloques++;
+            }
+        }
+    }
+
+    printf("%s: media recortada, bloques de 1 a %d, recortes de 0 a %d, %u configuraciones, %u bloques verificados, "
+           "%u distintos, error relativo máximo (muestras continuas) %.2e\n",
+           errores ? "FAIL" : "ok", TEST_VENTANA_MAX, FILTER_TRIM_MAX, configuraciones, bloques, errores, error_rel_max);
+
+    return errores == 0;
+}
+
+/*==================[BENCHMARK]==============================================*/
+
+static uint64_t test_ciclos(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static volatile float test_sumidero;
+
+/* Ordenamiento original de los sensores de pH y TDS (método de la burbuja), generalizado a n muestras. */
+static void test_burbuja(int *buffer, int n)
+{
+    int aux = 0;
+
+    for(int i = 1; i < n; i++)
+    {
+        for(int j = 0; j < n - i; j++)
+        {
+            if(buffer[j] > buffer[j + 1])
+            {
+                aux = buffer[j];
+                buffer[j] = buffer[j + 1];
+                buffer[j + 1] = aux;
+            }
+        }
+    }
+}
+
+static int test_bench_muestras[TEST_BENCH_MUESTRAS];
+
+/* Mediana de cada ventana: heap de la librería frente a copiar y ordenar la ventana en cada muestra. */
+static bool test_bench_mediana(int ventana, int muestras)
+{
+    static int anillo[ADC_ENGINE_MEDIAN_WINDOW], copia[ADC_ENGINE_MEDIAN_WINDOW];
+    filter_median_t filtro;
+
+    filter_median_init(&filtro, ventana);
+
+    uint64_t c0 = test_ciclos();
+
+    for(int i = 0; i < muestras; i++)
+    {
+        filter_median_add(&filtro, test_bench_muestras[i]);
+        test_sumidero = filter_median_get(&filtro);
+    }
+
+    uint64_t c1 = test_ciclos();
+
+    for(int i = 0; i < muestras; i++)
+    {
+        anillo[i % ventana] = test_bench_muestras[i];
+
+        int n = i + 1 < ventana ? i + 1 : ventana;
+
+        memcpy(copia, anillo, n * sizeof(int));
+        test_burbuja(copia, n);
+        test_sumidero = copia[n / 2];
+    }
+
+    uint64_t c2 = test_ciclos();
+
+    filter_median_deinit(&filtro);
+
+    double heap = (double) (c1 - c0) / muestras, burbuja = (double) (c2 - c1) / muestras;
+
+    printf("benchmark (host), mediana de %3d valores: heap %.1f ciclos por muestra | burbuja %.1f ciclos por muestra\n",
+           ventana, heap, burbuja);
+
+    return ventana < 64 || heap < burbuja;
+}
+
+/* Media recortada de cada bloque: inserción en los extremos por muestra frente a ordenar el bloque completo. */
+static void test_bench_media_recortada(int largo, int trim, int muestras)
+{
+    static int bloque[ADC_ENGINE_DECIMATION];
+    filter_trimmed_mean_t filtro;
+
+    filter_trimmed_mean_init(&filtro, largo, trim);
+
+    uint64_t c0 = test_ciclos();
+
+    for(int i = 0; i < muestras; i++)
+    {
+        if(filter_trimmed_mean_add(&filtro, test_bench_muestras[i]))
+        {
+            test_sumidero = filter_trimmed_mean_get(&filtro);
+        }
+    }
+
+    uint64_t c1 = test_ciclos();
+
+    for(int i = 0; i < muestras; i++)
+    {
+        bloque[i % largo] = test_bench_muestras[i];
+
+        if(i % largo == largo - 1)
+        {
+            int32_t suma = 0;
+
+            test_burbuja(bloque, largo);
+
+            for(int j = trim; j < largo - trim; j++)
+            {
+                suma += bloque[j];
+            }
+
+            test_sumidero = (float) suma / (largo - 2 * trim);
+        }
+    }
+
+    uint64_t c2 = test_ciclos();
+
+    printf("benchmark (host), media recortada de %d muestras (recorte %d): librería %.1f ciclos por muestra | burbuja %.1f ciclos por muestra\n",
+           largo, trim, (double) (c1 - c0) / muestras, (double) (c2 - c1) / muestras);
+}
+
+static bool test_benchmark(void)
+{
+    /* Cuentas del ADC alrededor de un valor medio, con ruido y algunos impulsos. */
+    for(int i = 0; i < TEST_BENCH_MUESTRAS; i++)
+    {
+        test_bench_muestras[i] = 2000 + (int) (test_rand() % 41) - 20 + ((test_rand() % 100) == 0 ? 1500 : 0);
+    }
+
+    bool ok = 1;
+
+    ok &= test_bench_mediana(10, TEST_BENCH_MUESTRAS);
+    ok &= test_bench_mediana(16, TEST_BENCH_MUESTRAS);
+    ok &= test_bench_mediana(64, TEST_BENCH_MUESTRAS);
+    ok &= test_bench_mediana(ADC_ENGINE_MEDIAN_WINDOW, TEST_BENCH_MUESTRAS / 40);
+
+    test_bench_media_recortada(ADC_ENGINE_DECIMATION, ADC_ENGINE_TRIM, TEST_BENCH_MUESTRAS);
+
+    return ok;
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    int fallas = 0;
+
+    fallas += !test_fuzz_mediana();
+    fallas += !test_fuzz_media_recortada();
+    fallas += !test_benchmark();
+
+    printf("%s: %d fallas\n", fallas ? "FAIL" : "PASS", fallas);
+
+    return fallas ? 1 : 0;
+}
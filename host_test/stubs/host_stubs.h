@@ -0,0 +1,198 @@
+/*
+
+    Declaraciones mínimas de ESP-IDF y FreeRTOS para compilar los módulos de "main" en el host
+
+    Solo se declaran los tipos, macros y funciones que usan los módulos. Cada test define las funciones
+    que necesita su módulo (I2C, colas, ticks, etc.) con el comportamiento que quiere simular.
+
+*/
+
+#ifndef HOST_STUBS_H_   /* Include guard */
+#define HOST_STUBS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
+#define ESP_ERR_NOT_FOUND 0x105
+#define ESP_ERR_TIMEOUT 0x107
+#define ESP_ERR_INVALID_RESPONSE 0x108
+#define ESP_ERR_INVALID_CRC 0x109
+#define ESP_ERR_NVS_NO_FREE_PAGES 0x110d
+#define ESP_ERR_NVS_NEW_VERSION_FOUND 0x1110
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERROR_CHECK(x) (void)(x)
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) (x)
+const char* esp_err_to_name(esp_err_t);
+/* Los LOG no se imprimen, pero se compila el formato para que el compilador verifique los argumentos. */
+#define HOST_LOG(tag, fmt, ...) do { if(0) { printf(fmt, ##__VA_ARGS__); } (void)(tag); } while(0)
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGV(tag, fmt, ...) HOST_LOG(tag, fmt, ##__VA_ARGS__)
+#define ESP_RETURN_ON_ERROR(x, tag, ...) do { esp_err_t e_=(x); (void)(tag); if(e_!=ESP_OK) return e_; } while(0)
+#define ESP_RETURN_ON_FALSE(c, err, tag, ...) do { (void)(tag); if(!(c)) return err; } while(0)
+#define ESP_GOTO_ON_ERROR(x, goto_tag, log_tag, ...) do { (void)(log_tag); ret=(x); if(ret!=ESP_OK) goto goto_tag; } while(0)
+#define BIT(n) (1UL<<(n))
+#define IRAM_ATTR
+#define ESP_INTR_FLAG_IRAM 0
+/* FreeRTOS */
+typedef int BaseType_t; typedef unsigned UBaseType_t; typedef uint32_t TickType_t;
+typedef void* TaskHandle_t; typedef void* TimerHandle_t; typedef void* QueueHandle_t; typedef void* SemaphoreHandle_t; typedef void* EventGroupHandle_t; typedef uint32_t EventBits_t;
+typedef struct { int x; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(m) (void)(m)
+#define portEXIT_CRITICAL(m) (void)(m)
+#define portENTER_CRITICAL_ISR(m) (void)(m)
+#define portEXIT_CRITICAL_ISR(m) (void)(m)
+#define taskENTER_CRITICAL(m) (void)(m)
+#define taskEXIT_CRITICAL(m) (void)(m)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define errQUEUE_FULL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_RATE_MS 1
+#define portTICK_PERIOD_MS 1
+#define configTICK_RATE_HZ 100
+#define tskNO_AFFINITY 0x7fffffff
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define pdTICKS_TO_MS(x) ((uint32_t)(x))
+#define portYIELD_FROM_ISR(x) (void)(x)
+typedef void (*TaskFunction_t)(void*);
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*);
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t*, BaseType_t);
+void vTaskDelay(TickType_t); void vTaskDelayUntil(TickType_t*, TickType_t); TickType_t xTaskGetTickCount(void); TickType_t xTaskGetTickCountFromISR(void);
+uint32_t ulTaskNotifyTake(BaseType_t, TickType_t); BaseType_t xTaskNotifyGive(TaskHandle_t); void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t*);
+typedef enum { eNoAction, eSetBits, eIncrement, eSetValueWithOverwrite } eNotifyAction;
+BaseType_t xTaskNotify(TaskHandle_t, uint32_t, eNotifyAction); BaseType_t xTaskNotifyFromISR(TaskHandle_t, uint32_t, eNotifyAction, BaseType_t*); BaseType_t xTaskNotifyWait(uint32_t, uint32_t, uint32_t*, TickType_t);
+TaskHandle_t xTaskGetCurrentTaskHandle(void); void vTaskDelete(TaskHandle_t); void vTaskSuspend(TaskHandle_t);
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t);
+TimerHandle_t xTimerCreate(const char*, TickType_t, UBaseType_t, void*, TimerCallbackFunction_t);
+BaseType_t xTimerStart(TimerHandle_t, TickType_t); BaseType_t xTimerStop(TimerHandle_t, TickType_t); BaseType_t xTimerReset(TimerHandle_t, TickType_t);
+BaseType_t xTimerChangePeriod(TimerHandle_t, TickType_t, TickType_t); TickType_t xTimerGetExpiryTime(TimerHandle_t); BaseType_t xTimerIsTimerActive(TimerHandle_t); void* pvTimerGetTimerID(TimerHandle_t);
+BaseType_t xTimerStartFromISR(TimerHandle_t, BaseType_t*); BaseType_t xTimerResetFromISR(TimerHandle_t, BaseType_t*);
+QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t); BaseType_t xQueueSend(QueueHandle_t, const void*, TickType_t); BaseType_t xQueueSendToBack(QueueHandle_t, const void*, TickType_t);
+BaseType_t xQueueSendFromISR(QueueHandle_t, const void*, BaseType_t*); BaseType_t xQueueReceive(QueueHandle_t, void*, TickType_t); UBaseType_t uxQueueMessagesWaiting(QueueHandle_t); BaseType_t xQueueOverwrite(QueueHandle_t, const void*); BaseType_t xQueueReset(QueueHandle_t); BaseType_t xQueueReceiveFromISR(QueueHandle_t, void*, BaseType_t*);
+SemaphoreHandle_t xSemaphoreCreateMutex(void); SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void); SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t); BaseType_t xSemaphoreGive(SemaphoreHandle_t); BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t); BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t); BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t, BaseType_t*);
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t);
+EventGroupHandle_t xEventGroupCreate(void); EventBits_t xEventGroupSetBits(EventGroupHandle_t, EventBits_t); EventBits_t xEventGroupWaitBits(EventGroupHandle_t, EventBits_t, BaseType_t, BaseType_t, TickType_t);
+/* esp_timer */
+int64_t esp_timer_get_time(void);
+void ets_delay_us(uint32_t);
+/* gpio */
+typedef int gpio_num_t;
+typedef enum { GPIO_MODE_DEF_INPUT=1, GPIO_MODE_DEF_OUTPUT=2, GPIO_MODE_INPUT=1, GPIO_MODE_OUTPUT=2, GPIO_MODE_INPUT_OUTPUT, GPIO_MODE_INPUT_OUTPUT_OD, GPIO_MODE_OUTPUT_OD, GPIO_MODE_DISABLE } gpio_mode_t;
+typedef enum { GPIO_INTR_DISABLE, GPIO_INTR_POSEDGE, GPIO_INTR_NEGEDGE, GPIO_INTR_ANYEDGE, GPIO_INTR_LOW_LEVEL, GPIO_INTR_HIGH_LEVEL } gpio_int_type_t;
+typedef enum { GPIO_PULLUP_DISABLE, GPIO_PULLUP_ENABLE } gpio_pullup_t; typedef enum { GPIO_PULLDOWN_DISABLE, GPIO_PULLDOWN_ENABLE } gpio_pulldown_t;
+typedef enum { GPIO_PULLUP_ONLY, GPIO_PULLDOWN_ONLY, GPIO_PULLUP_PULLDOWN, GPIO_FLOATING } gpio_pull_mode_t;
+typedef struct { uint64_t pin_bit_mask; gpio_mode_t mode; gpio_pullup_t pull_up_en; gpio_pulldown_t pull_down_en; gpio_int_type_t intr_type; } gpio_config_t;
+typedef void (*gpio_isr_t)(void*);
+esp_err_t gpio_config(const gpio_config_t*); esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t); esp_err_t gpio_set_level(gpio_num_t, uint32_t); int gpio_get_level(gpio_num_t);
+esp_err_t gpio_set_intr_type(gpio_num_t, gpio_int_type_t); esp_err_t gpio_install_isr_service(int); esp_err_t gpio_isr_handler_add(gpio_num_t, gpio_isr_t, void*); esp_err_t gpio_isr_handler_remove(gpio_num_t);
+esp_err_t gpio_intr_enable(gpio_num_t); esp_err_t gpio_intr_disable(gpio_num_t); esp_err_t gpio_set_pull_mode(gpio_num_t, gpio_pull_mode_t); esp_err_t gpio_pullup_en(gpio_num_t); esp_err_t gpio_reset_pin(gpio_num_t);
+/* adc */
+typedef enum { ADC1_CHANNEL_0, ADC1_CHANNEL_1, ADC1_CHANNEL_2, ADC1_CHANNEL_3, ADC1_CHANNEL_4, ADC1_CHANNEL_5, ADC1_CHANNEL_6, ADC1_CHANNEL_7, ADC1_CHANNEL_MAX } adc1_channel_t;
+typedef enum { ADC_WIDTH_BIT_9, ADC_WIDTH_BIT_10, ADC_WIDTH_BIT_11, ADC_WIDTH_BIT_12 } adc_bits_width_t;
+typedef enum { ADC_ATTEN_DB_0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_11 } adc_atten_t;
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+typedef enum { ADC_CONV_SINGLE_UNIT_1 = 1 } adc_digi_convert_mode_t;
+typedef enum { ADC_DIGI_OUTPUT_FORMAT_TYPE1, ADC_DIGI_OUTPUT_FORMAT_TYPE2 } adc_digi_output_format_t;
+#define SOC_ADC_DIGI_MAX_BITWIDTH 12
+#define SOC_ADC_DIGI_MIN_BITWIDTH 9
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW 20000
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH 2000000
+#define SOC_ADC_PATT_LEN_MAX 16
+#define SOC_ADC_DIGI_RESULT_BYTES 2
+typedef struct { uint8_t atten; uint8_t channel; uint8_t unit; uint8_t bit_width; } adc_digi_pattern_config_t;
+typedef struct { bool conv_limit_en; uint32_t conv_limit_num; uint32_t pattern_num; adc_digi_pattern_config_t *adc_pattern; uint32_t sample_freq_hz; adc_digi_convert_mode_t conv_mode; adc_digi_output_format_t format; } adc_digi_configuration_t;
+typedef struct { uint32_t max_store_buf_size; uint32_t conv_num_each_intr; uint32_t adc1_chan_mask; uint32_t adc2_chan_mask; } adc_digi_init_config_t;
+typedef struct { union { struct { uint16_t data: 12; uint16_t channel: 4; } type1; struct { uint16_t data: 11; uint16_t channel: 4; uint16_t unit: 1; } type2; uint16_t val; }; } adc_digi_output_data_t;
+esp_err_t adc_digi_initialize(const adc_digi_init_config_t*); esp_err_t adc_digi_controller_configure(const adc_digi_configuration_t*); esp_err_t adc_digi_start(void); esp_err_t adc_digi_stop(void); esp_err_t adc_digi_read_bytes(uint8_t*, uint32_t, uint32_t*, uint32_t); esp_err_t adc_digi_deinitialize(void);
+esp_err_t adc1_config_width(adc_bits_width_t); esp_err_t adc1_config_channel_atten(adc1_channel_t, adc_atten_t); int adc1_get_raw(adc1_channel_t);
+/* i2c */
+typedef int i2c_port_t;
+typedef enum { I2C_MODE_SLAVE, I2C_MODE_MASTER } i2c_mode_t;
+typedef struct { i2c_mode_t mode; int sda_io_num; int scl_io_num; bool sda_pullup_en; bool scl_pullup_en; union { struct { uint32_t clk_speed; } master; }; uint32_t clk_flags; } i2c_config_t;
+esp_err_t i2c_param_config(i2c_port_t, const i2c_config_t*); esp_err_t i2c_driver_install(i2c_port_t, i2c_mode_t, size_t, size_t, int);
+esp_err_t i2c_master_write_read_device(i2c_port_t, uint8_t, const uint8_t*, size_t, uint8_t*, size_t, TickType_t);
+esp_err_t i2c_master_write_to_device(i2c_port_t, uint8_t, const uint8_t*, size_t, TickType_t);
+/* nvs */
+typedef uint32_t nvs_handle_t; typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+esp_err_t nvs_flash_init(void); esp_err_t nvs_flash_erase(void); esp_err_t nvs_open(const char*, nvs_open_mode_t, nvs_handle_t*); void nvs_close(nvs_handle_t); esp_err_t nvs_commit(nvs_handle_t);
+esp_err_t nvs_set_blob(nvs_handle_t, const char*, const void*, size_t); esp_err_t nvs_get_blob(nvs_handle_t, const char*, void*, size_t*); esp_err_t nvs_erase_key(nvs_handle_t, const char*);
+esp_err_t nvs_set_u32(nvs_handle_t, const char*, uint32_t); esp_err_t nvs_get_u32(nvs_handle_t, const char*, uint32_t*); esp_err_t nvs_set_u64(nvs_handle_t, const char*, uint64_t); esp_err_t nvs_get_u64(nvs_handle_t, const char*, uint64_t*);
+/* mqtt */
+typedef void* esp_mqtt_client_handle_t; typedef const char* esp_event_base_t;
+typedef enum { MQTT_EVENT_ANY=-1, MQTT_EVENT_ERROR=0, MQTT_EVENT_CONNECTED, MQTT_EVENT_DISCONNECTED, MQTT_EVENT_SUBSCRIBED, MQTT_EVENT_UNSUBSCRIBED, MQTT_EVENT_PUBLISHED, MQTT_EVENT_DATA, MQTT_EVENT_BEFORE_CONNECT } esp_mqtt_event_id_t;
+typedef enum { MQTT_ERROR_TYPE_NONE, MQTT_ERROR_TYPE_TCP_TRANSPORT } esp_mqtt_error_type_t;
+typedef struct { esp_err_t esp_tls_last_esp_err; int esp_tls_stack_err; int esp_tls_cert_verify_flags; esp_mqtt_error_type_t error_type; int connect_return_code; int esp_transport_sock_errno; } esp_mqtt_error_codes_t;
+typedef struct { esp_mqtt_event_id_t event_id; esp_mqtt_client_handle_t client; void* user_context; char* data; int data_len; int total_data_len; int current_data_offset; char* topic; int topic_len; int msg_id; int session_present; esp_mqtt_error_codes_t* error_handle; bool retain; int qos; bool dup; } esp_mqtt_event_t;
+typedef esp_mqtt_event_t* esp_mqtt_event_handle_t;
+typedef struct { const char* uri; bool disable_auto_reconnect; int task_prio; int task_stack; int buffer_size; int keepalive; } esp_mqtt_client_config_t;
+#define ESP_EVENT_ANY_ID -1
+typedef void (*esp_event_handler_t)(void*, esp_event_base_t, int32_t, void*);
+esp_mqtt_client_handle_t esp_mqtt_client_init(const esp_mqtt_client_config_t*); esp_err_t esp_mqtt_client_register_event(esp_mqtt_client_handle_t, int, esp_event_handler_t, void*);
+esp_err_t esp_mqtt_client_start(esp_mqtt_client_handle_t); int esp_mqtt_client_subscribe(esp_mqtt_client_handle_t, const char*, int); int esp_mqtt_client_publish(esp_mqtt_client_handle_t, const char*, const char*, int, int, int); int esp_mqtt_client_enqueue(esp_mqtt_client_handle_t, const char*, const char*, int, int, int, bool);
+/* uart */
+typedef int uart_port_t;
+typedef enum { UART_DATA_8_BITS = 3 } uart_word_length_t; typedef enum { UART_PARITY_DISABLE } uart_parity_t; typedef enum { UART_STOP_BITS_1 = 1 } uart_stop_bits_t; typedef enum { UART_HW_FLOWCTRL_DISABLE } uart_hw_flowcontrol_t;
+typedef enum { UART_SCLK_APB } uart_sclk_t;
+typedef struct { int baud_rate; uart_word_length_t data_bits; uart_parity_t parity; uart_stop_bits_t stop_bits; uart_hw_flowcontrol_t flow_ctrl; uint8_t rx_flow_ctrl_thresh; uart_sclk_t source_clk; } uart_config_t;
+typedef enum { UART_DATA, UART_BREAK, UART_BUFFER_FULL, UART_FIFO_OVF, UART_FRAME_ERR, UART_PARITY_ERR, UART_DATA_BREAK, UART_PATTERN_DET, UART_EVENT_MAX } uart_event_type_t;
+typedef struct { uart_event_type_t type; size_t size; bool timeout_flag; } uart_event_t;
+#define UART_PIN_NO_CHANGE (-1)
+esp_err_t uart_driver_install(uart_port_t, int, int, int, QueueHandle_t*, int); esp_err_t uart_param_config(uart_port_t, const uart_config_t*); esp_err_t uart_set_pin(uart_port_t, int, int, int, int);
+int uart_write_bytes(uart_port_t, const void*, size_t); int uart_read_bytes(uart_port_t, void*, uint32_t, TickType_t); esp_err_t uart_flush_input(uart_port_t);
+/* rmt */
+typedef int rmt_channel_t;
+#define RMT_CHANNEL_0 0
+#define RMT_CHANNEL_1 1
+#define RMT_CHANNEL_2 2
+#define RMT_CHANNEL_3 3
+#define RMT_CHANNEL_4 4
+typedef struct { union { struct { uint32_t duration0 :15; uint32_t level0 :1; uint32_t duration1 :15; uint32_t level1 :1; }; uint32_t val; }; } rmt_item32_t;
+typedef enum { RMT_MODE_TX, RMT_MODE_RX } rmt_mode_t;
+typedef struct { bool filter_en; uint8_t filter_ticks_thresh; uint16_t idle_threshold; } rmt_rx_config_t;
+typedef struct { rmt_mode_t rmt_mode; rmt_channel_t channel; gpio_num_t gpio_num; uint8_t clk_div; uint8_t mem_block_num; uint32_t flags; union { rmt_rx_config_t rx_config; }; } rmt_config_t;
+typedef void* RingbufHandle_t;
+#define RMT_DEFAULT_CONFIG_RX(gpio, channel_id) { .rmt_mode = RMT_MODE_RX, .channel = channel_id, .gpio_num = gpio, .clk_div = 80, .mem_block_num = 1, .flags = 0, .rx_config = { .idle_threshold = 12000, .filter_ticks_thresh = 100, .filter_en = true } }
+esp_err_t rmt_config(const rmt_config_t*); esp_err_t rmt_driver_install(rmt_channel_t, size_t, int); esp_err_t rmt_get_ringbuf_handle(rmt_channel_t, RingbufHandle_t*);
+esp_err_t rmt_rx_start(rmt_channel_t, bool); esp_err_t rmt_rx_stop(rmt_channel_t); esp_err_t rmt_set_gpio(rmt_channel_t, rmt_mode_t, gpio_num_t, bool);
+void* xRingbufferReceive(RingbufHandle_t, size_t*, TickType_t); void vRingbufferReturnItem(RingbufHandle_t, void*);
+/* pcnt */
+typedef int pcnt_unit_t; typedef int pcnt_channel_t;
+#define PCNT_UNIT_0 0
+#define PCNT_CHANNEL_0 0
+#define PCNT_PIN_NOT_USED (-1)
+typedef enum { PCNT_COUNT_DIS, PCNT_COUNT_INC, PCNT_COUNT_DEC } pcnt_count_mode_t; typedef enum { PCNT_MODE_KEEP, PCNT_MODE_REVERSE, PCNT_MODE_DISABLE } pcnt_ctrl_mode_t;
+typedef struct { int pulse_gpio_num; int ctrl_gpio_num; pcnt_ctrl_mode_t lctrl_mode; pcnt_ctrl_mode_t hctrl_mode; pcnt_count_mode_t pos_mode; pcnt_count_mode_t neg_mode; int16_t counter_h_lim; int16_t counter_l_lim; pcnt_unit_t unit; pcnt_channel_t channel; } pcnt_config_t;
+typedef enum { PCNT_EVT_H_LIM = 0x10 } pcnt_evt_type_t;
+esp_err_t pcnt_unit_config(const pcnt_config_t*); esp_err_t pcnt_set_filter_value(pcnt_unit_t, uint16_t); esp_err_t pcnt_filter_enable(pcnt_unit_t); esp_err_t pcnt_counter_pause(pcnt_unit_t); esp_err_t pcnt_counter_resume(pcnt_unit_t); esp_err_t pcnt_counter_clear(pcnt_unit_t); esp_err_t pcnt_get_counter_value(pcnt_unit_t, int16_t*);
+esp_err_t pcnt_event_enable(pcnt_unit_t, pcnt_evt_type_t); esp_err_t pcnt_isr_service_install(int); esp_err_t pcnt_isr_handler_add(pcnt_unit_t, void (*)(void*), void*);
+/* mcpwm */
+/* misc */
+esp_err_t esp_event_loop_create_default(void); esp_err_t esp_netif_init(void);
+#define TIMER_BASE_CLK 80000000
+#ifndef STUB_UART_EXTRA
+#define STUB_UART_EXTRA
+#define UART_NUM_2 2
+esp_err_t uart_driver_delete(uart_port_t);
+#endif
+#ifndef ESP_ERR_NOT_SUPPORTED
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#endif
+
+#endif // HOST_STUBS_H_
@@ -0,0 +1,218 @@
+/**
+ * @file test_tds_q16.c
+ * @brief   Test de la conversión en punto fijo del sensor de TDS: compara "TDS_sensor_raw_to_ppm_q16()" con el
+ *          coeficiente de "TDS_sensor_temp_comp_coef()" contra la fórmula del fabricante evaluada en doble precisión,
+ *
+ *          ppm = (133.42 * Vc^3 - 255.86 * Vc^2 + 857.39 * Vc) * 0.5,   Vc = (raw * 3.3 / 4096) / (1 + 0.02 * (T - 25))
+ *
+ *          para los 4096 valores del ADC y todo el rango de la tabla de compensación (0 a 50 °C, cada 0.1 °C), y
+ *          verifica el error máximo. Además, mide el costo por conversión frente a la conversión original en float
+ *          (cuyas constantes en double promueven todo el cálculo a double).
+ *
+ *          El costo en ciclos se mide en el host: sirve para comparar ambas versiones, pero no es el costo en el
+ *          ESP32, donde la diferencia es mayor ya que el double se emula por software.
+ */
+
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "TDS_SENSOR.c"
+
+/**
+ *  Errores máximos admitidos frente a la fórmula del fabricante: en todo el dominio, dentro del rango de medición del
+ *  sensor, relativo al valor, y sin compensación de temperatura. El error lo domina la interpolación lineal de la tabla
+ *  de compensación (hasta 0.04 % del coeficiente entre grados), amplificado por el polinomio cúbico en el extremo
+ *  superior de la tensión compensada (16400 ppm a 0 °C, fuera del rango del sensor).
+ */
+#define TEST_ERROR_MAX_PPM 20.0
+#define TEST_ERROR_RANGO_MAX_PPM 1.0
+#define TEST_ERROR_MAX_REL 0.0015
+#define TEST_ERROR_SIN_COMP_MAX_PPM 0.05
+
+/* Rango de medición del sensor (SEN0244), y valor mínimo desde el que se mide el error relativo, en ppm. */
+#define TEST_RANGO_PPM 1000
+#define TEST_REL_MIN_PPM 100
+
+/* Cantidad de conversiones del benchmark. */
+#define TEST_BENCH_CONVERSIONES 4000000
+
+/*==================[MOCKS]==================================================*/
+
+esp_err_t DS18B20_getFreshTemp(DS18B20_sensor_temp_t *temp, uint32_t max_age_ms)
+{
+    return ESP_FAIL;
+}
+
+esp_err_t adc_engine_add_channel(adc1_channel_t channel, uint32_t period_ms, AdcEngineCallbackFunction callback)
+{
+    return ESP_OK;
+}
+
+esp_err_t filter_ema_init(filter_ema_t *filter, float alpha)
+{
+    return ESP_OK;
+}
+
+float filter_ema_add(filter_ema_t *filter, float value)
+{
+    return value;
+}
+
+/*==================[REFERENCIA]=============================================*/
+
+static double test_ppm_referencia(uint16_t raw, double temp)
+{
+    double v = raw * (3.3 / 4096.0) / (1.0 + 0.02 * (temp - 25.0));
+
+    return (133.42 * v * v * v - 255.86 * v * v + 857.39 * v) * 0.5;
+}
+
+/* Conversión original, tal como estaba antes de la conversión en punto fijo. */
+static float test_ppm_original(uint16_t raw, DS18B20_sensor_temp_t DS18B20_temp)
+{
+    float TDS_voltage;
+
+    TDS_voltage = raw * (3.3 / 4096.0);
+
+    float TDS_temp_comp_coef = 1.0 + 0.02 * (DS18B20_temp - 25.0);
+    float TDS_compensation_voltage = TDS_voltage / TDS_temp_comp_coef;
+    float TDS_ppm = (133.42 * TDS_compensation_voltage * TDS_compensation_voltage * TDS_compensation_voltage - 255.86 * TDS_compensation_voltage * TDS_compensation_voltage + 857.39 * TDS_compensation_voltage) * 0.5;
+
+    return TDS_ppm;
+}
+
+/*==================[BENCHMARK]==============================================*/
+
+static uint64_t test_ciclos(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static uint64_t test_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static volatile float test_sumidero;
+
+static void test_benchmark(void)
+{
+    uint64_t ns0 = test_ns(), c0 = test_ciclos();
+
+    for(uint32_t i = 0; i < TEST_BENCH_CONVERSIONES; i++)
+    {
+        uint16_t raw = i & 4095;
+        int32_t temp_deci = (i >> 12) % 501;
+
+        test_sumidero = TDS_sensor_raw_to_ppm_q16(raw, TDS_sensor_temp_comp_coef(temp_deci)) / (float) TDS_SENSOR_Q16_ONE;
+    }
+
+    uint64_t ns1 = test_ns(), c1 = test_ciclos();
+
+    for(uint32_t i = 0; i < TEST_BENCH_CONVERSIONES; i++)
+    {
+        uint16_t raw = i & 4095;
+        int32_t temp_deci = (i >> 12) % 501;
+
+        test_sumidero = test_ppm_original(raw, temp_deci / 10.0f);
+    }
+
+    uint64_t ns2 = test_ns(), c2 = test_ciclos();
+
+    printf("benchmark (host): Q16 %.1f ns, %.1f ciclos por conversión | float original %.1f ns, %.1f ciclos por conversión\n",
+           (double) (ns1 - ns0) / TEST_BENCH_CONVERSIONES, (double) (c1 - c0) / TEST_BENCH_CONVERSIONES,
+           (double) (ns2 - ns1) / TEST_BENCH_CONVERSIONES, (double) (c2 - c1) / TEST_BENCH_CONVERSIONES);
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    TDS_sensor_build_temp_comp_table();
+
+    double error_max = 0, error_rango_max = 0, error_rel_max = 0, ref_max = 0;
+    uint16_t raw_max = 0;
+    int32_t temp_max = 0;
+
+    /**
+     *  Se recorren los 4096 valores del ADC para cada temperatura entre 0 y 50 °C, cada 0.1 °C (la resolución
+     *  con la que se interpola la tabla).
+     */
+    for(int32_t temp_deci = 0; temp_deci <= (TDS_SENSOR_TEMP_COMP_TABLE_LEN - 1) * 10; temp_deci++)
+    {
+        uint32_t comp_q16 = TDS_sensor_temp_comp_coef(temp_deci);
+
+        for(uint32_t raw = 0; raw < 4096; raw++)
+        {
+            double ppm = TDS_sensor_raw_to_ppm_q16(raw, comp_q16) / (double) TDS_SENSOR_Q16_ONE;
+            double ref = test_ppm_referencia(raw, temp_deci / 10.0);
+            double error = fabs(ppm - ref);
+
+            if(error > error_max)
+            {
+                error_max = error;
+                raw_max = raw;
+                temp_max = temp_deci;
+            }
+
+            if(ref <= TEST_RANGO_PPM && error > error_rango_max)
+            {
+                error_rango_max = error;
+            }
+
+            if(ref >= TEST_REL_MIN_PPM && error / ref > error_rel_max)
+            {
+                error_rel_max = error / ref;
+            }
+
+            if(ref > ref_max)
+            {
+                ref_max = ref;
+            }
+        }
+    }
+
+    printf("error máximo: %.4f ppm (raw %u, %.1f °C, salida máxima %.0f ppm)\n", error_max, raw_max, temp_max / 10.0, ref_max);
+    printf("error máximo hasta %d ppm: %.4f ppm\n", TEST_RANGO_PPM, error_rango_max);
+    printf("error relativo máximo desde %d ppm: %.4f %%\n", TEST_REL_MIN_PPM, error_rel_max * 100);
+
+    /**
+     *  Sin compensación (coeficiente 1), la conversión debe coincidir con la fórmula a 25 °C.
+     */
+    double error_sin_comp = 0;
+
+    for(uint32_t raw = 0; raw < 4096; raw++)
+    {
+        double error = fabs(TDS_sensor_raw_to_ppm_q16(raw, TDS_SENSOR_Q16_ONE) / (double) TDS_SENSOR_Q16_ONE - test_ppm_referencia(raw, 25));
+
+        if(error > error_sin_comp)
+        {
+            error_sin_comp = error;
+        }
+    }
+
+    printf("error máximo sin compensación: %.4f ppm\n", error_sin_comp);
+
+    test_benchmark();
+
+    bool ok = error_max <= TEST_ERROR_MAX_PPM
+              && error_rango_max <= TEST_ERROR_RANGO_MAX_PPM
+              && error_rel_max <= TEST_ERROR_MAX_REL
+              && error_sin_comp <= TEST_ERROR_SIN_COMP_MAX_PPM;
+
+    printf("%s: errores máximos admitidos %.1f ppm, %.1f ppm hasta %d ppm, %.3f %% desde %d ppm, %.2f ppm sin compensación\n",
+           ok ? "PASS" : "FAIL", TEST_ERROR_MAX_PPM, TEST_ERROR_RANGO_MAX_PPM, TEST_RANGO_PPM, TEST_ERROR_MAX_REL * 100,
+           TEST_REL_MIN_PPM, TEST_ERROR_SIN_COMP_MAX_PPM);
+
+    return ok ? 0 : 1;
+}
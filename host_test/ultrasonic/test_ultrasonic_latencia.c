@@ -0,0 +1,450 @@
+/**
+ * @file test_ultrasonic_latencia.c
+ * @brief   Test de la captura del pulso de respuesta del sensor ultrasónico por interrupción, y histograma de la latencia
+ *          que las mediciones imponen al resto de las tareas, frente al driver original, que esperaba el pulso de
+ *          respuesta leyendo el pin dentro de una sección crítica (con las interrupciones deshabilitadas).
+ *
+ *          Ambos drivers miden con "ultrasonic_measure_distance_cm()", cada 200 ms (5 mediciones por segundo, como la
+ *          tarea de niveles original), un sensor HC-SR04 simulado en tiempo simulado: el pulso de respuesta comienza
+ *          un tiempo fijo luego del pulso de inicio, y dura lo que tarda el sonido en recorrer la distancia ida y
+ *          vuelta. Las distancias se eligen al azar en el rango del sensor, y algunas mediciones fallan: el sensor no
+ *          responde (sin flanco de subida), o el pulso de respuesta no termina (sin flanco de bajada).
+ *
+ *          Otra tarea, que se despierta cada 1 ms, no puede ejecutarse mientras las interrupciones están deshabilitadas:
+ *          su latencia es el tiempo que falta para que se vuelvan a habilitar. En el driver original, ese tiempo es el
+ *          de cada sección crítica; en el actual, no hay secciones críticas y solo se cuenta la ejecución de la rutina
+ *          de interrupción de cada flanco, con una duración estimada (TEST_ISR_US) ya que no puede medirse en el host.
+ *
+ *          Además, se verifica que el driver actual mide la distancia correcta y que retorna el error correspondiente
+ *          a cada falla del sensor.
+ */
+
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+
+/* Las secciones críticas de los drivers se registran para calcular el tiempo con las interrupciones deshabilitadas. */
+#undef portENTER_CRITICAL
+#undef portEXIT_CRITICAL
+#define portENTER_CRITICAL(m) test_entrar_critica()
+#define portEXIT_CRITICAL(m) test_salir_critica()
+
+static void test_entrar_critica(void);
+static void test_salir_critica(void);
+
+#include "ultrasonic_sensor.c"
+
+/* Driver original, con sus funciones renombradas para compilarlo en la misma unidad de traducción. */
+#define TAG old_TAG
+#define ultrasonic_sensor_init old_ultrasonic_sensor_init
+#define ultrasonic_measure_distance_cm old_ultrasonic_measure_distance_cm
+#define ultrasonic_measure_level old_ultrasonic_measure_level
+
+/* El driver original se compila sin cambios, incluidas sus variables sin uso. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-variable"
+#include "old_ultrasonic/ultrasonic_sensor.c"
+#pragma GCC diagnostic pop
+
+#undef TAG
+#undef ultrasonic_sensor_init
+#undef ultrasonic_measure_distance_cm
+#undef ultrasonic_measure_level
+
+/* Pin del sensor, período de las mediciones y de la otra tarea, y tiempo simulado. */
+#define TEST_PIN 4
+#define TEST_PERIODO_MEDICION_US 200000
+#define TEST_PERIODO_TAREA_US 1000
+#define TEST_MEDICIONES 1500
+
+/* Sensor simulado: demora del pulso de respuesta, rango de distancias (cm), y fallas (una cada TEST_FALLA_PROB mediciones). */
+#define TEST_DEMORA_ECO_US 450
+#define TEST_DISTANCIA_MIN 3
+#define TEST_DISTANCIA_MAX 250
+#define TEST_FALLA_PROB 50
+
+/**
+ *  Duración estimada de la rutina de interrupción en el ESP32 (despacho del servicio de interrupciones de GPIO,
+ *  lectura del timer y del pin, y notificación), en us.
+ */
+#define TEST_ISR_US 5
+
+/* Error máximo admitido de la distancia medida por el driver actual, en cm. */
+#define TEST_ERROR_MAX_CM 0.05
+
+/* Lecturas del pin por us en la espera activa del driver original. */
+#define TEST_LECTURA_US 1
+
+/* Intervalos con las interrupciones deshabilitadas registrados. */
+#define TEST_INTERVALOS_MAX 8192
+
+#define TEST_SIN_FLANCO INT64_MAX
+
+typedef enum {
+    TEST_SENSOR_OK,
+    TEST_SENSOR_SIN_RESPUESTA,          /* Sin flanco de subida. */
+    TEST_SENSOR_PULSO_TRABADO,          /* Sin flanco de bajada. */
+} test_falla_t;
+
+/* Límites de las clases del histograma de latencia, en us. */
+static const int64_t test_clases_us[] = { 0, 10, 100, 1000, 10000, 100000 };
+
+#define TEST_CLASES (sizeof(test_clases_us) / sizeof(test_clases_us[0]) + 1)
+
+typedef struct {
+    int64_t inicio_us;
+    int64_t fin_us;
+} test_intervalo_t;
+
+typedef struct {
+    uint32_t mediciones;
+    uint32_t secciones_criticas;
+    uint32_t interrupciones;
+    uint32_t errores;               /* Mediciones con un resultado distinto del esperado. */
+    double error_max_cm;
+    uint32_t histograma[TEST_CLASES];
+    uint32_t despertares;
+    int64_t latencia_max_us;
+    int64_t deshabilitado_us;
+    int64_t duracion_us;
+} test_resultado_t;
+
+static uint32_t test_semilla;
+
+/* Tiempo simulado, en us. */
+static int64_t test_ahora_us;
+
+/* Pulso de respuesta del sensor simulado, nivel del pin como salida, y flancos ya atendidos por la interrupción. */
+static int64_t test_subida_us, test_bajada_us;
+static int test_nivel_salida;
+static bool test_subida_atendida, test_bajada_atendida;
+static float test_distancia_cm;
+
+/* Interrupción del pin registrada por el driver, y notificaciones recibidas por la tarea. */
+static gpio_isr_t test_isr;
+static void *test_isr_arg;
+static bool test_intr_habilitada;
+static uint32_t test_notificaciones;
+
+/* Intervalos con las interrupciones deshabilitadas. */
+static test_intervalo_t test_intervalos[TEST_INTERVALOS_MAX];
+static uint32_t test_intervalos_num;
+static uint32_t test_secciones_criticas;
+static uint32_t test_interrupciones;
+
+/*==================[AUXILIARES]=============================================*/
+
+static uint32_t test_rand(void)
+{
+    test_semilla ^= test_semilla << 13;
+    test_semilla ^= test_semilla >> 17;
+    test_semilla ^= test_semilla << 5;
+    return test_semilla;
+}
+
+static void test_registrar_intervalo(int64_t inicio_us, int64_t fin_us)
+{
+    if(test_intervalos_num < TEST_INTERVALOS_MAX)
+    {
+        test_intervalos[test_intervalos_num++] = (test_intervalo_t) { inicio_us, fin_us };
+    }
+}
+
+static void test_entrar_critica(void)
+{
+    test_secciones_criticas++;
+    test_registrar_intervalo(test_ahora_us, TEST_SIN_FLANCO);
+}
+
+static void test_salir_critica(void)
+{
+    test_intervalos[test_intervalos_num - 1].fin_us = test_ahora_us;
+}
+
+/* Atiende la interrupción de un flanco del pulso de respuesta, si está habilitada. */
+static void test_flanco(int64_t t_us)
+{
+    test_ahora_us = t_us;
+
+    if(test_intr_habilitada && test_isr != NULL)
+    {
+        test_interrupciones++;
+        test_registrar_intervalo(t_us, t_us + TEST_ISR_US);
+        test_isr(test_isr_arg);
+    }
+}
+
+/**
+ *  Latencia de la tarea que se despierta cada TEST_PERIODO_TAREA_US: si se despierta con las interrupciones
+ *  deshabilitadas, se ejecuta al terminar el intervalo.
+ */
+static void test_histograma(test_resultado_t *r)
+{
+    uint32_t k = 0;
+
+    for(int64_t t = 0; t < r->duracion_us; t += TEST_PERIODO_TAREA_US)
+    {
+        while(k < test_intervalos_num && test_intervalos[k].fin_us <= t)
+        {
+            k++;
+        }
+
+        int64_t latencia_us = (k < test_intervalos_num && test_intervalos[k].inicio_us <= t) ? test_intervalos[k].fin_us - t : 0;
+        uint32_t c = 0;
+
+        while(c < TEST_CLASES - 1 && latencia_us > test_clases_us[c])
+        {
+            c++;
+        }
+
+        r->histograma[c]++;
+        r->despertares++;
+        r->latencia_max_us = latencia_us > r->latencia_max_us ? latencia_us : r->latencia_max_us;
+    }
+
+    for(uint32_t i = 0; i < test_intervalos_num; i++)
+    {
+        r->deshabilitado_us += test_intervalos[i].fin_us - test_intervalos[i].inicio_us;
+    }
+}
+
+/*==================[MOCKS]==================================================*/
+
+int64_t esp_timer_get_time(void)
+{
+    return test_ahora_us;
+}
+
+void ets_delay_us(uint32_t us)
+{
+    test_ahora_us += us;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t modo)
+{
+    return ESP_OK;
+}
+
+/* El flanco de bajada del pulso de inicio dispara el pulso de respuesta del sensor simulado. */
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t nivel)
+{
+    if(test_nivel_salida && !nivel)
+    {
+        test_falla_t falla = TEST_SENSOR_OK;
+        uint32_t azar = test_rand() % TEST_FALLA_PROB;
+
+        if(azar == 0)
+        {
+            falla = TEST_SENSOR_SIN_RESPUESTA;
+        }
+
+        else if(azar == 1)
+        {
+            falla = TEST_SENSOR_PULSO_TRABADO;
+        }
+
+        test_distancia_cm = TEST_DISTANCIA_MIN + (test_rand() % 10000) * (TEST_DISTANCIA_MAX - TEST_DISTANCIA_MIN) / 10000.0f;
+
+        int64_t pulso_us = lround(test_distancia_cm / 0.0171607);
+
+        test_subida_us = (falla == TEST_SENSOR_SIN_RESPUESTA) ? TEST_SIN_FLANCO : test_ahora_us + TEST_DEMORA_ECO_US;
+        test_bajada_us = (falla != TEST_SENSOR_OK) ? TEST_SIN_FLANCO : test_subida_us + pulso_us;
+        test_subida_atendida = 0;
+        test_bajada_atendida = 0;
+    }
+
+    test_nivel_salida = nivel;
+
+    return ESP_OK;
+}
+
+/* Cada lectura del pin consume tiempo, de forma que la espera activa del driver original avanza el tiempo simulado. */
+int gpio_get_level(gpio_num_t pin)
+{
+    int nivel = test_ahora_us >= test_subida_us && test_ahora_us < test_bajada_us;
+
+    test_ahora_us += TEST_LECTURA_US;
+
+    return nivel;
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t tipo)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t isr, void *arg)
+{
+    test_isr = isr;
+    test_isr_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin)
+{
+    test_intr_habilitada = 1;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin)
+{
+    test_intr_habilitada = 0;
+    return ESP_OK;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return (TaskHandle_t) 1;
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t tarea, uint32_t valor, eNotifyAction accion, BaseType_t *despertada)
+{
+    test_notificaciones |= valor;
+    *despertada = pdTRUE;
+    return pdPASS;
+}
+
+/* La tarea queda bloqueada: se atienden los flancos del pulso de respuesta hasta que llega la notificación o el timeout. */
+BaseType_t xTaskNotifyWait(uint32_t limpiar_entrada, uint32_t limpiar_salida, uint32_t *valor, TickType_t espera)
+{
+    int64_t limite_us = test_ahora_us + (int64_t) espera * portTICK_PERIOD_MS * 1000;
+
+    if(!test_subida_atendida && test_subida_us <= limite_us)
+    {
+        test_subida_atendida = 1;
+        test_flanco(test_subida_us > test_ahora_us ? test_subida_us : test_ahora_us);
+    }
+
+    if(!test_notificaciones && !test_bajada_atendida && test_bajada_us <= limite_us)
+    {
+        test_bajada_atendida = 1;
+        test_flanco(test_bajada_us > test_ahora_us ? test_bajada_us : test_ahora_us);
+    }
+
+    if(test_notificaciones)
+    {
+        test_notificaciones &= ~limpiar_salida;
+        return pdTRUE;
+    }
+
+    test_ahora_us = limite_us;
+
+    return pdFALSE;
+}
+
+/*==================[ESCENARIOS]=============================================*/
+
+static void test_medir(esp_err_t (*medir)(ultrasonic_sens_t *, float *), ultrasonic_sens_t *sensor, test_resultado_t *r)
+{
+    test_semilla = 1;
+    test_ahora_us = 0;
+    test_intervalos_num = 0;
+    test_secciones_criticas = 0;
+    test_interrupciones = 0;
+
+    for(uint32_t i = 0; i < TEST_MEDICIONES; i++)
+    {
+        float distancia_cm = 0;
+
+        /* Si una medición se extiende más que el período, la siguiente comienza al terminar. */
+        int64_t inicio_us = (int64_t) i * TEST_PERIODO_MEDICION_US;
+        test_ahora_us = (test_ahora_us > inicio_us) ? test_ahora_us : inicio_us;
+        test_subida_us = TEST_SIN_FLANCO;
+        test_bajada_us = TEST_SIN_FLANCO;
+
+        esp_err_t ret = medir(sensor, &distancia_cm);
+        esp_err_t esperado = (test_subida_us == TEST_SIN_FLANCO) ? ESP_ERR_ULTRASONIC_PING_TIMEOUT :
+                             (test_bajada_us == TEST_SIN_FLANCO) ? ESP_ERR_ULTRASONIC_ECHO_TIMEOUT : ESP_OK;
+
+        if(ret != esperado)
+        {
+            r->errores++;
+        }
+
+        else if(ret == ESP_OK)
+        {
+            double error_cm = fabs(distancia_cm - test_distancia_cm);
+            r->error_max_cm = error_cm > r->error_max_cm ? error_cm : r->error_max_cm;
+        }
+
+        r->mediciones++;
+    }
+
+    r->duracion_us = (int64_t) TEST_MEDICIONES * TEST_PERIODO_MEDICION_US;
+    r->duracion_us = (test_ahora_us > r->duracion_us) ? test_ahora_us : r->duracion_us;
+    r->secciones_criticas = test_secciones_criticas;
+    r->interrupciones = test_interrupciones;
+
+    test_histograma(r);
+}
+
+static void test_imprimir(const char *nombre, const test_resultado_t *r)
+{
+    printf("%s: %u mediciones, %u resultados distintos del esperado, error máximo %.3f cm, %u secciones críticas, "
+           "%u interrupciones, interrupciones deshabilitadas %.3f %% del tiempo\n",
+           nombre, r->mediciones, r->errores, r->error_max_cm, r->secciones_criticas, r->interrupciones,
+           100.0 * r->deshabilitado_us / r->duracion_us);
+
+    printf("    latencia de la tarea de %d us (%u despertares), máxima %lld us:", TEST_PERIODO_TAREA_US, r->despertares,
+           (long long) r->latencia_max_us);
+
+    for(uint32_t c = 0; c < TEST_CLASES; c++)
+    {
+        if(c == 0)
+        {
+            printf(" 0 us: %u", r->histograma[c]);
+        }
+
+        else if(c < TEST_CLASES - 1)
+        {
+            printf(" | hasta %lld us: %u", (long long) test_clases_us[c], r->histograma[c]);
+        }
+
+        else
+        {
+            printf(" | más de %lld us: %u", (long long) test_clases_us[c - 1], r->histograma[c]);
+        }
+    }
+
+    printf("\n");
+}
+
+/*==================[TEST]===================================================*/
+
+int main(void)
+{
+    ultrasonic_sens_t sensor = { .trigg_echo_pin = TEST_PIN };
+    test_resultado_t actual = {0}, original = {0};
+
+    if(ultrasonic_sensor_init(&sensor) != ESP_OK || test_isr == NULL)
+    {
+        printf("FAIL: no se pudo inicializar el sensor\n");
+        return 1;
+    }
+
+    test_medir(ultrasonic_measure_distance_cm, &sensor, &actual);
+
+    test_isr = NULL;
+    test_intr_habilitada = 0;
+    old_ultrasonic_sensor_init(&sensor);
+
+    test_medir(old_ultrasonic_measure_distance_cm, &sensor, &original);
+
+    test_imprimir("captura por interrupción", &actual);
+    test_imprimir("driver original", &original);
+
+    /**
+     *  Con el driver actual, la latencia de la otra tarea no supera la duración de la rutina de interrupción.
+     */
+    bool ok = actual.errores == 0 && actual.error_max_cm <= TEST_ERROR_MAX_CM && actual.secciones_criticas == 0
+              && actual.latencia_max_us <= TEST_ISR_US;
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,475 @@
+/**
+ * @file ACTUATOR_SERVICE.c
+ * @author Franco Bisciglia, David Kündinger
+ * @brief   Servicio de accionamiento de los relés de la placa de actuadores. Es el único módulo que escribe en el MCP23008,
+ *          agrupando los cambios pedidos por las distintas MEFs y callbacks.
+ * @version 0.1
+ * @date 2023-01-01
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+
+/**
+ * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
+ *
+ *      Las MEFs y callbacks no acceden directamente al bus I2C, sino que piden el estado deseado de los relés mediante
+ *  "actuator_service_set_relay()" o "actuator_service_set_relay_mask()". El pedido se combina, sin bloqueos (mediante una
+ *  operación atómica compare-and-swap), en un buzón de 16 bits: el byte alto es la máscara de relés pedidos y el byte bajo
+ *  su estado, de forma que un pedido más nuevo sobre el mismo relé reemplaza al anterior.
+ *
+ *      Una única tarea toma el buzón completo, aplica todos los cambios en una sola transacción del MCP23008 (una escritura
+ *  I2C), publica el nuevo estado ("ON"/"OFF") de los relés que cambiaron y tengan un tópico MQTT asignado mediante
+ *  "actuator_service_set_state_topic()", y espera un tick antes de volver a leer el buzón. De esta forma, una ráfaga de
+ *  cambios se convierte en una única escritura y una publicación por relé, como máximo una vez por tick. Si la escritura
+ *  falla, el pedido se vuelve a encolar (sin pisar pedidos más nuevos) y se reintenta.
+ *
+ *      Además, por cada relé se lleva la cantidad de conmutaciones y el tiempo total activado (bit en 1), para monitorear
+ *  su desgaste, que se obtienen mediante "actuator_service_get_relay_stats()".
+ *
+ *      Los módulos que dependen del estado de algún relé (por ejemplo, los enclavamientos de los algoritmos de control
+ *  con la bomba de solución) pueden asignar funciones callback mediante "actuator_service_add_change_callback()", que se
+ *  ejecutan luego de cada escritura que cambie el estado de algún relé, en lugar de consultar el estado periódicamente.
+ */
+
+
+
+//==================================| INCLUDES |==================================//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "MQTT_PUBL_SUSCR.h"
+#include "MCP23008.h"
+#include "ACTUATOR_SERVICE.h"
+
+//==================================| MACROS AND TYPDEF |==================================//
+
+/* Máscara con todos los relés de la placa. */
+#define ACTUATOR_SERVICE_RELAY_MASK ((1 << ACTUATOR_SERVICE_RELAY_NUM) - 1)
+
+/* Tiempo de espera antes de reintentar una escritura fallida en el MCP23008. */
+#define ACTUATOR_SERVICE_RETRY_PERIOD_MS 100
+
+//==================================| INTERNAL DATA DEFINITION |==================================//
+
+/* Tag para imprimir información en el LOG. */
+static const char *TAG = "ACTUATOR_SERVICE";
+
+/* Handle del cliente MQTT. */
+static esp_mqtt_client_handle_t Cliente_MQTT = NULL;
+
+/* Handle de la tarea del servicio de actuadores. */
+static TaskHandle_t xActuatorServiceTaskHandle = NULL;
+
+/* Buzón de pedidos: bits 15..8 -> máscara de relés pedidos, bits 7..0 -> estado pedido. */
+static uint32_t actuator_mailbox = 0;
+
+/* Estado de los relés aplicado por el servicio. Solo lo modifica la tarea del servicio. */
+static uint8_t actuator_applied_state = 0;
+
+/* Tópicos MQTT en los que se publica el estado de cada relé (string vacío = no se publica). */
+static char actuator_state_topics[ACTUATOR_SERVICE_RELAY_NUM][MQTT_TOPIC_NAME_MAX_LEN];
+
+/* Estadísticas de desgaste de cada relé. */
+static uint32_t actuator_switch_count[ACTUATOR_SERVICE_RELAY_NUM];
+static uint64_t actuator_on_time_us[ACTUATOR_SERVICE_RELAY_NUM];
+static int64_t actuator_on_since_us[ACTUATOR_SERVICE_RELAY_NUM];
+
+/* Funciones callback de cambio de estado de los relés. */
+static ActuatorServiceChangeCallbackFunction actuator_change_callbacks[ACTUATOR_SERVICE_MAX_CHANGE_CALLBACKS];
+static int actuator_change_callback_count = 0;
+
+/* Spinlock para el acceso a los tópicos y estadísticas de los relés. */
+static portMUX_TYPE actuator_mux = portMUX_INITIALIZER_UNLOCKED;
+
+//==================================| EXTERNAL DATA DEFINITION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
+
+static void actuator_service_post(uint8_t mask, uint8_t state, bool override);
+static void actuator_service_publish_state(int8_t relay_num, bool relay_state);
+static void vTaskActuatorService(void *pvParameters);
+
+//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función que combina un pedido en el buzón de pedidos, sin bloqueos.
+ *
+ * @param mask      Máscara de los relés pedidos.
+ * @param state     Estado pedido de los relés de la máscara.
+ * @param override  1 -> El pedido reemplaza a los pedidos pendientes sobre los mismos relés.
+ *                  0 -> Solo se agregan los relés sin pedidos pendientes (utilizado al reencolar un pedido fallido).
+ */
+static void actuator_service_post(uint8_t mask, uint8_t state, bool override)
+{
+    uint32_t old_request = __atomic_load_n(&actuator_mailbox, __ATOMIC_RELAXED);
+    uint32_t new_request;
+
+    do
+    {
+        uint8_t old_mask = old_request >> 8;
+        uint8_t old_state = old_request & 0xFF;
+        uint8_t new_bits = override ? mask : (mask & ~old_mask);
+
+        new_request = ((uint32_t) (old_mask | new_bits) << 8) | ((old_state & ~new_bits) | (state & new_bits));
+    }
+    while(!__atomic_compare_exchange_n(&actuator_mailbox, &old_request, new_request, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+}
+
+
+
+/**
+ * @brief   Función que publica el estado de un relé en su tópico MQTT, si tiene uno asignado.
+ *
+ * @param relay_num     Número de relé.
+ * @param relay_state   Estado del relé.
+ */
+static void actuator_service_publish_state(int8_t relay_num, bool relay_state)
+{
+    char topic[MQTT_TOPIC_NAME_MAX_LEN];
+
+    portENTER_CRITICAL(&actuator_mux);
+    strcpy(topic, actuator_state_topics[relay_num]);
+    portEXIT_CRITICAL(&actuator_mux);
+
+    if(Cliente_MQTT == NULL || topic[0] == '\0')
+    {
+        return;
+    }
+
+    mqtt_publish_data(Cliente_MQTT, topic, relay_state ? "ON" : "OFF", 0, MQTT_PUBLISH_KEEP_LATEST);
+}
+
+
+
+/**
+ * @brief   Tarea del servicio de actuadores. Aplica los pedidos acumulados en el buzón en una única escritura
+ *          al MCP23008, publica el estado de los relés que cambiaron y actualiza sus estadísticas.
+ *
+ * @param pvParameters  Parámetro que se le pasa a la tarea en su creación.
+ */
+static void vTaskActuatorService(void *pvParameters)
+{
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /**
+         *  Se toma el buzón completo, dejándolo vacío para nuevos pedidos.
+         */
+        uint32_t request = __atomic_exchange_n(&actuator_mailbox, 0, __ATOMIC_ACQ_REL);
+        uint8_t mask = request >> 8;
+        uint8_t state = request & 0xFF;
+
+        if(!mask)
+        {
+            continue;
+        }
+
+        /**
+         *  Se aplican todos los cambios en una única transacción del MCP23008.
+         */
+        esp_err_t ret = begin_relay_transaction();
+
+        if(ret == ESP_OK)
+        {
+            set_relay_mask(mask, state);
+            ret = commit_relay_transaction();
+        }
+
+        /**
+         *  Si falla la escritura, se vuelve a encolar el pedido sin pisar los pedidos más nuevos, y se reintenta.
+         */
+        if(ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to apply relay state. Retrying.");
+
+            actuator_service_post(mask, state, 0);
+            vTaskDelay(pdMS_TO_TICKS(ACTUATOR_SERVICE_RETRY_PERIOD_MS));
+            xTaskNotifyGive(xActuatorServiceTaskHandle);
+            continue;
+        }
+
+        uint8_t new_state = (actuator_applied_state & ~mask) | (state & mask);
+        uint8_t changed = actuator_applied_state ^ new_state;
+        actuator_applied_state = new_state;
+
+        /**
+         *  Se actualizan las estadísticas de los relés que cambiaron y se publica su nuevo estado.
+         */
+        int64_t now_us = esp_timer_get_time();
+
+        for(int8_t i = 0; i < ACTUATOR_SERVICE_RELAY_NUM; i++)
+        {
+            if(!(changed & BIT(i)))
+            {
+                continue;
+            }
+
+            bool relay_state = (new_state >> i) & 1;
+
+            portENTER_CRITICAL(&actuator_mux);
+
+            actuator_switch_count[i]++;
+
+            if(relay_state)
+            {
+                actuator_on_since_us[i] = now_us;
+            }
+
+            else
+            {
+                actuator_on_time_us[i] += now_us - actuator_on_since_us[i];
+            }
+
+            portEXIT_CRITICAL(&actuator_mux);
+
+            actuator_service_publish_state(i, relay_state);
+        }
+
+        /**
+         *  Se avisa del cambio a los módulos que asignaron una función callback.
+         */
+        for(int i = 0; changed && i < actuator_change_callback_count; i++)
+        {
+            actuator_change_callbacks[i](changed, new_state);
+        }
+
+        /**
+         *  Se espera un tick antes de volver a leer el buzón, de forma de agrupar los pedidos que
+         *  lleguen mientras tanto en una única escritura.
+         */
+        vTaskDelay(1);
+    }
+}
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para inicializar el servicio de actuadores. Debe llamarse luego de "MCP23008_init()" y antes
+ *          de inicializar las MEFs que accionan los relés.
+ *
+ * @param mqtt_client   Handle del cliente MQTT.
+ * @return esp_err_t
+ */
+esp_err_t actuator_service_init(esp_mqtt_client_handle_t mqtt_client)
+{
+    /**
+     *  Copiamos el handle del cliente MQTT en la variable interna.
+     */
+    Cliente_MQTT = mqtt_client;
+
+    /**
+     *  Se parte del estado actual de los relés, y se inicia la cuenta del tiempo activado de los relés
+     *  que ya están activados.
+     */
+    int64_t now_us = esp_timer_get_time();
+
+    for(int8_t i = 0; i < ACTUATOR_SERVICE_RELAY_NUM; i++)
+    {
+        if(get_relay_state(i))
+        {
+            actuator_applied_state |= BIT(i);
+            actuator_on_since_us[i] = now_us;
+        }
+    }
+
+    //=======================| CREACION TAREAS |=======================//
+
+    /**
+     *  Se crea la tarea del servicio de actuadores.
+     */
+    if(xActuatorServiceTaskHandle == NULL)
+    {
+        xTaskCreate(
+            vTaskActuatorService,
+            "vTaskActuatorService",
+            ACTUATOR_SERVICE_TASK_STACK_SIZE,
+            NULL,
+            ACTUATOR_SERVICE_TASK_PRIORITY,
+            &xActuatorServiceTaskHandle);
+
+        /**
+         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
+         */
+        if(xActuatorServiceTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create vTaskActuatorService task.");
+            return ESP_FAIL;
+        }
+    }
+
+    /**
+     *  Si hubo pedidos antes de crear la tarea, se aplican.
+     */
+    xTaskNotifyGive(xActuatorServiceTaskHandle);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para pedir el estado de un relé. El cambio se aplica de forma asíncrona en la tarea del servicio.
+ *
+ * @param relay_num     Número de relé (RELE_1 ... RELE_7).
+ * @param relay_state   Estado pedido (0-1).
+ * @return esp_err_t
+ */
+esp_err_t actuator_service_set_relay(int8_t relay_num, bool relay_state)
+{
+    ESP_RETURN_ON_FALSE(relay_num >= 0 && relay_num < ACTUATOR_SERVICE_RELAY_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid relay number.");
+
+    return actuator_service_set_relay_mask(BIT(relay_num), relay_state ? BIT(relay_num) : 0);
+}
+
+
+
+/**
+ * @brief   Función para pedir el estado de varios relés a la vez. El cambio se aplica de forma asíncrona en la tarea
+ *          del servicio, en una única escritura.
+ *
+ * @param mask      Máscara con los bits de los relés a modificar (BIT(RELE_1) | BIT(RELE_2) ...).
+ * @param state     Estado de los relés indicados en la máscara (bit en 1 = relé en 1).
+ * @return esp_err_t
+ */
+esp_err_t actuator_service_set_relay_mask(uint8_t mask, uint8_t state)
+{
+    mask &= ACTUATOR_SERVICE_RELAY_MASK;
+
+    ESP_RETURN_ON_FALSE(mask, ESP_ERR_INVALID_ARG, TAG, "Invalid relay mask.");
+
+    actuator_service_post(mask, state, 1);
+
+    if(xActuatorServiceTaskHandle != NULL)
+    {
+        xTaskNotifyGive(xActuatorServiceTaskHandle);
+    }
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para conocer el estado pedido de un relé, es decir, el último estado pedido si hay un pedido
+ *          pendiente, o el estado actual del relé en caso contrario.
+ *
+ * @param relay_num     Número de relé (RELE_1 ... RELE_7).
+ * @return true     Relé activado.
+ * @return false    Relé desactivado, o número de relé inválido.
+ */
+bool actuator_service_get_relay(int8_t relay_num)
+{
+    ESP_RETURN_ON_FALSE(relay_num >= 0 && relay_num < ACTUATOR_SERVICE_RELAY_NUM, false, TAG, "Invalid relay number.");
+
+    uint32_t request = __atomic_load_n(&actuator_mailbox, __ATOMIC_ACQUIRE);
+
+    if((request >> 8) & BIT(relay_num))
+    {
+        return (request >> relay_num) & 1;
+    }
+
+    return get_relay_state(relay_num);
+}
+
+
+
+/**
+ * @brief   Función para asignar el tópico MQTT en el que se publica el estado ("ON"/"OFF") de un relé cada vez que
+ *          cambia. Al asignarlo, se publica el estado actual.
+ *
+ * @param relay_num     Número de relé (RELE_1 ... RELE_7).
+ * @param topic         Nombre del tópico MQTT.
+ * @return esp_err_t
+ */
+esp_err_t actuator_service_set_state_topic(int8_t relay_num, const char* topic)
+{
+    ESP_RETURN_ON_FALSE(relay_num >= 0 && relay_num < ACTUATOR_SERVICE_RELAY_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid relay number.");
+    ESP_RETURN_ON_FALSE(topic != NULL && strlen(topic) < MQTT_TOPIC_NAME_MAX_LEN, ESP_ERR_INVALID_ARG, TAG, "Invalid topic.");
+
+    portENTER_CRITICAL(&actuator_mux);
+    strcpy(actuator_state_topics[relay_num], topic);
+    portEXIT_CRITICAL(&actuator_mux);
+
+    actuator_service_publish_state(relay_num, actuator_service_get_relay(relay_num));
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para obtener las estadísticas de desgaste de un relé (conmutaciones y tiempo activado).
+ *
+ * @param relay_num     Número de relé (RELE_1 ... RELE_7).
+ * @param stats         Puntero a la estructura donde se guardan las estadísticas.
+ * @return esp_err_t
+ */
+esp_err_t actuator_service_get_relay_stats(int8_t relay_num, actuator_relay_stats_t* stats)
+{
+    ESP_RETURN_ON_FALSE(relay_num >= 0 && relay_num < ACTUATOR_SERVICE_RELAY_NUM && stats != NULL,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&actuator_mux);
+
+    uint64_t on_time_us = actuator_on_time_us[relay_num];
+
+    if((actuator_applied_state >> relay_num) & 1)
+    {
+        on_time_us += now_us - actuator_on_since_us[relay_num];
+    }
+
+    stats->switch_count = actuator_switch_count[relay_num];
+    stats->on_time_ms = on_time_us / 1000;
+
+    portEXIT_CRITICAL(&actuator_mux);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para asignar una función callback que se ejecuta cada vez que cambia el estado de algún relé.
+ *
+ * @param callback  Función callback.
+ * @return esp_err_t
+ */
+esp_err_t actuator_service_add_change_callback(ActuatorServiceChangeCallbackFunction callback)
+{
+    ESP_RETURN_ON_FALSE(callback != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&actuator_mux);
+
+    if(actuator_change_callback_count < ACTUATOR_SERVICE_MAX_CHANGE_CALLBACKS)
+    {
+        actuator_change_callbacks[actuator_change_callback_count] = callback;
+        actuator_change_callback_count++;
+    }
+
+    else
+    {
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    portEXIT_CRITICAL(&actuator_mux);
+
+    ESP_RETURN_ON_ERROR(ret, TAG, "Too many change callbacks.");
+
+    return ESP_OK;
+}
\ No newline at end of file
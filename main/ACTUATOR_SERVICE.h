@@ -0,0 +1,78 @@
+/*
+
+    Servicio de accionamiento de los relés de la placa de actuadores (MCP23008)
+
+*/
+
+#ifndef ACTUATOR_SERVICE_H_   /* Include guard */
+#define ACTUATOR_SERVICE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+#include "MCP23008.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/* Cantidad de relés de la placa de actuadores. */
+#define ACTUATOR_SERVICE_RELAY_NUM 7
+
+/**
+ *  @brief  Configuración de la tarea del servicio de actuadores. Pueden redefinirse antes de incluir este archivo.
+ */
+#ifndef ACTUATOR_SERVICE_TASK_PRIORITY
+#define ACTUATOR_SERVICE_TASK_PRIORITY 4
+#endif
+
+#ifndef ACTUATOR_SERVICE_TASK_STACK_SIZE
+#define ACTUATOR_SERVICE_TASK_STACK_SIZE 3072
+#endif
+
+/* Cantidad máxima de funciones callback de cambio de estado de los relés. */
+#define ACTUATOR_SERVICE_MAX_CHANGE_CALLBACKS 4
+
+/**
+ *  @brief  Puntero a función que será utilizado para ejecutar la función que se pase como callback cada vez
+ *          que el servicio aplica un cambio en el estado de los relés. Recibe la máscara de relés que cambiaron
+ *          y el nuevo estado de todos los relés. Se ejecuta en la tarea del servicio, por lo que no debe bloquearse.
+ */
+typedef void (*ActuatorServiceChangeCallbackFunction)(uint8_t changed_mask, uint8_t state);
+
+/**
+ * @brief   Estadísticas de desgaste de un relé.
+ *
+ */
+typedef struct {
+    uint32_t switch_count;  /* Cantidad de conmutaciones del relé. */
+    uint64_t on_time_ms;    /* Tiempo total que el relé estuvo activado (bit en 1), incluyendo el período actual. */
+} actuator_relay_stats_t;
+
+/*==================[EXTERNAL DATA DECLARATION]==============================*/
+
+/*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
+
+esp_err_t actuator_service_init(esp_mqtt_client_handle_t mqtt_client);
+esp_err_t actuator_service_set_relay(int8_t relay_num, bool relay_state);
+esp_err_t actuator_service_set_relay_mask(uint8_t mask, uint8_t state);
+bool actuator_service_get_relay(int8_t relay_num);
+esp_err_t actuator_service_set_state_topic(int8_t relay_num, const char* topic);
+esp_err_t actuator_service_get_relay_stats(int8_t relay_num, actuator_relay_stats_t* stats);
+esp_err_t actuator_service_add_change_callback(ActuatorServiceChangeCallbackFunction callback);
+
+/*==================[END OF FILE]============================================*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ACTUATOR_SERVICE_H_
\ No newline at end of file
@@ -0,0 +1,451 @@
+/**
+ * @file ADC_ENGINE.c
+ * @author Franco Bisciglia, David Kündinger
+ * @brief   Librería de adquisición continua del ADC1 mediante DMA, compartida por los sensores analógicos (pH, TDS, etc).
+ * @version 0.1
+ * @date 2023-01-01
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+
+
+/**
+ * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
+ *
+ *          En lugar de que cada sensor analógico tenga su propia tarea tomando conversiones aisladas con "adc1_get_raw()",
+ *      el ADC1 se configura en modo continuo (DMA), muestreando todos los canales agregados mediante "adc_engine_add_channel()"
+ *      a una frecuencia total ADC_ENGINE_SAMPLE_FREQ_HZ (repartida entre los canales).
+ *
+ *          Una única tarea lee los bloques de muestras del DMA y, por cada canal, calcula la media recortada de cada bloque de
+ *      ADC_ENGINE_DECIMATION muestras (decimación, descartando las ADC_ENGINE_TRIM muestras de cada extremo), y la agrega a una
+ *      mediana móvil de los últimos ADC_ENGINE_MEDIAN_WINDOW valores, que descarta los valores afectados por ruido impulsivo.
+ *      Ambos filtros (librería SIGNAL_FILTERS) se actualizan muestra a muestra, sin ordenar bloques completos.
+ *
+ *          Cada canal puede tener una función callback, que se ejecuta desde la tarea del motor cada "period_ms" con el
+ *      valor filtrado del canal. Además, el valor filtrado puede obtenerse en cualquier momento con "adc_engine_get_raw()".
+ *
+ *          Al agregar un canal, la tarea del motor detiene el DMA y lo vuelve a configurar con el nuevo patrón de canales. La
+ *      configuración del driver y la lectura del DMA se realizan solo desde la tarea del motor.
+ */
+
+
+
+//==================================| INCLUDES |==================================//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "driver/adc.h"
+
+#include "ADC_ENGINE.h"
+#include "SIGNAL_FILTERS.h"
+
+//==================================| MACROS AND TYPDEF |==================================//
+
+/* Tamaño en bytes de cada lectura del buffer DMA, y del buffer interno del driver. */
+#define ADC_ENGINE_FRAME_SIZE 256
+#define ADC_ENGINE_DMA_BUFFER_SIZE 4096
+
+/* Tiempo máximo de espera de una lectura del buffer DMA, en ms. */
+#define ADC_ENGINE_READ_TIMEOUT_MS 100
+
+/* Estructura con los datos de adquisición de cada canal del ADC1. */
+typedef struct {
+    bool enabled;                               /* Canal agregado al patrón de muestreo. */
+    filter_trimmed_mean_t decimation;           /* Media recortada de cada bloque de muestras (decimación). */
+    filter_median_t median;                     /* Mediana móvil de los valores decimados. */
+    uint32_t period_ms;                         /* Período de ejecución de la función callback. */
+    int64_t last_callback_us;                   /* Instante de la última ejecución de la función callback. */
+    AdcEngineCallbackFunction callback;         /* Función callback del canal. */
+} adc_engine_channel_t;
+
+//==================================| INTERNAL DATA DEFINITION |==================================//
+
+/* Tag para imprimir información en el LOG. */
+static const char *TAG = "ADC_ENGINE_LIBRARY";
+
+/* Handle de la tarea del motor de adquisición. */
+static TaskHandle_t xAdcEngineTaskHandle = NULL;
+
+/* Mutex para el acceso a los datos de los canales y a la configuración del driver. */
+static SemaphoreHandle_t xAdcEngineMutex = NULL;
+
+/* Datos de adquisición de cada canal del ADC1. */
+static adc_engine_channel_t adc_engine_channels[ADC1_CHANNEL_MAX];
+
+/* Bandera que indica si el DMA del ADC está en funcionamiento. Solo la modifica la tarea del motor. */
+static bool adc_engine_running = 0;
+
+/* Bandera que indica que se agregó un canal y se debe volver a configurar el ADC. */
+static bool adc_engine_reconfigure_flag = 0;
+
+/* Estadísticas del motor de adquisición. */
+static adc_engine_stats_t adc_engine_stats = {0};
+
+//==================================| EXTERNAL DATA DEFINITION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
+
+static esp_err_t adc_engine_configure(void);
+static uint16_t adc_engine_value(const adc_engine_channel_t *ch);
+static void vTaskAdcEngine(void *pvParameters);
+
+//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función que (re)configura el ADC1 en modo continuo con todos los canales agregados, y lo pone en
+ *          funcionamiento. Se llama desde la tarea del motor, con el mutex tomado.
+ *
+ * @return esp_err_t
+ */
+static esp_err_t adc_engine_configure(void)
+{
+    /**
+     *  Si el DMA estaba en funcionamiento, se detiene y se libera el driver para volver a configurarlo.
+     */
+    if(adc_engine_running)
+    {
+        adc_digi_stop();
+        adc_digi_deinitialize();
+        adc_engine_running = 0;
+    }
+
+    /**
+     *  Se arma la máscara y el patrón de muestreo con los canales agregados.
+     */
+    adc_digi_pattern_config_t adc_pattern[SOC_ADC_PATT_LEN_MAX] = {0};
+    uint32_t adc1_chan_mask = 0;
+    uint32_t pattern_num = 0;
+
+    for(int i = 0; i < ADC1_CHANNEL_MAX; i++)
+    {
+        if(!adc_engine_channels[i].enabled)
+        {
+            continue;
+        }
+
+        adc1_chan_mask |= BIT(i);
+
+        adc_pattern[pattern_num].atten = ADC_ATTEN_DB_11;
+        adc_pattern[pattern_num].channel = i;
+        adc_pattern[pattern_num].unit = 0;
+        adc_pattern[pattern_num].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        pattern_num++;
+    }
+
+    adc_digi_init_config_t adc_dma_config = {
+        .max_store_buf_size = ADC_ENGINE_DMA_BUFFER_SIZE,
+        .conv_num_each_intr = ADC_ENGINE_FRAME_SIZE,
+        .adc1_chan_mask = adc1_chan_mask,
+        .adc2_chan_mask = 0,
+    };
+
+    ESP_RETURN_ON_ERROR(adc_digi_initialize(&adc_dma_config), TAG, "Failed to initialize ADC DMA.");
+
+    /**
+     *  Se configura el controlador digital del ADC. Se utiliza una atenuación de 11 dB, lo que implica un
+     *  rango de tensión de hasta aproximadamente 3,1 V, y una resolución de 12 bits.
+     */
+    adc_digi_configuration_t dig_cfg = {
+        .conv_limit_en = 1,
+        .conv_limit_num = 250,
+        .pattern_num = pattern_num,
+        .adc_pattern = adc_pattern,
+        .sample_freq_hz = ADC_ENGINE_SAMPLE_FREQ_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+
+    ESP_RETURN_ON_ERROR(adc_digi_controller_configure(&dig_cfg), TAG, "Failed to configure ADC controller.");
+    ESP_RETURN_ON_ERROR(adc_digi_start(), TAG, "Failed to start ADC DMA.");
+
+    adc_engine_running = 1;
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función que obtiene el valor filtrado de un canal (mediana móvil de los valores decimados),
+ *          redondeado a cuentas del ADC.
+ *
+ * @param ch    Datos del canal.
+ * @return uint16_t     Valor filtrado.
+ */
+static uint16_t adc_engine_value(const adc_engine_channel_t *ch)
+{
+    return (uint16_t) (filter_median_get(&ch->median) + 0.5);
+}
+
+
+
+/**
+ * @brief   Tarea del motor de adquisición. Lee los bloques de muestras del DMA, realiza la decimación de cada
+ *          canal, y ejecuta las funciones callback de los canales cuyo período se haya cumplido.
+ *
+ * @param pvParameters  Parámetros pasados a la tarea en su creación.
+ */
+static void vTaskAdcEngine(void *pvParameters)
+{
+    uint8_t frame[ADC_ENGINE_FRAME_SIZE];
+
+    /* Canales cuya función callback se debe ejecutar, y su valor filtrado. */
+    AdcEngineCallbackFunction callbacks[ADC1_CHANNEL_MAX];
+    uint16_t callback_values[ADC1_CHANNEL_MAX];
+
+    while(1)
+    {
+        /**
+         *  Si se agregó un canal, se vuelve a configurar el ADC con el nuevo patrón de muestreo.
+         */
+        xSemaphoreTake(xAdcEngineMutex, portMAX_DELAY);
+
+        if(adc_engine_reconfigure_flag)
+        {
+            adc_engine_reconfigure_flag = 0;
+
+            if(adc_engine_configure() != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to configure ADC engine.");
+            }
+        }
+
+        xSemaphoreGive(xAdcEngineMutex);
+
+        /**
+         *  Si el ADC no está en funcionamiento, se espera a que se agregue un canal.
+         */
+        if(!adc_engine_running)
+        {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+
+        uint32_t len = 0;
+        esp_err_t ret = adc_digi_read_bytes(frame, sizeof(frame), &len, ADC_ENGINE_READ_TIMEOUT_MS);
+
+        xSemaphoreTake(xAdcEngineMutex, portMAX_DELAY);
+
+        /**
+         *  Si el buffer del driver se desbordó, se perdieron muestras, pero los datos leídos son válidos.
+         */
+        if(ret == ESP_ERR_INVALID_STATE)
+        {
+            adc_engine_stats.overflows++;
+            ret = ESP_OK;
+        }
+
+        if(ret == ESP_OK)
+        {
+            adc_engine_stats.frames++;
+
+            /**
+             *  Se agrega cada muestra a la media recortada del canal correspondiente y, al completarse
+             *  un bloque, se agrega su resultado a la mediana móvil del canal.
+             */
+            for(uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES)
+            {
+                adc_digi_output_data_t *p = (adc_digi_output_data_t *) &frame[i];
+                uint8_t channel = p->type1.channel;
+
+                if(channel >= ADC1_CHANNEL_MAX || !adc_engine_channels[channel].enabled)
+                {
+                    continue;
+                }
+
+                adc_engine_channel_t *ch = &adc_engine_channels[channel];
+
+                adc_engine_stats.samples++;
+
+                if(filter_trimmed_mean_add(&ch->decimation, p->type1.data))
+                {
+                    filter_median_add(&ch->median, filter_trimmed_mean_get(&ch->decimation));
+                }
+            }
+        }
+
+        /**
+         *  Se obtienen los canales cuyo período se cumplió, para ejecutar sus funciones callback
+         *  luego de liberar el mutex.
+         */
+        int64_t now_us = esp_timer_get_time();
+
+        for(int i = 0; i < ADC1_CHANNEL_MAX; i++)
+        {
+            adc_engine_channel_t *ch = &adc_engine_channels[i];
+            callbacks[i] = NULL;
+
+            if( ch->enabled && ch->callback != NULL && ch->median.count > 0 &&
+                now_us - ch->last_callback_us >= (int64_t) ch->period_ms * 1000)
+            {
+                ch->last_callback_us = now_us;
+                callbacks[i] = ch->callback;
+                callback_values[i] = adc_engine_value(ch);
+            }
+        }
+
+        xSemaphoreGive(xAdcEngineMutex);
+
+        for(int i = 0; i < ADC1_CHANNEL_MAX; i++)
+        {
+            if(callbacks[i] != NULL)
+            {
+                callbacks[i](callback_values[i]);
+            }
+        }
+    }
+}
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para agregar un canal del ADC1 al motor de adquisición. En el primer llamado, se crea la tarea
+ *          del motor. El ADC se configura de forma asíncrona desde la tarea del motor.
+ *
+ * @param channel       Canal del ADC1.
+ * @param period_ms     Período de ejecución de la función callback, en ms.
+ * @param callback      Función callback que recibe el valor filtrado del canal (puede ser NULL).
+ * @return esp_err_t
+ */
+esp_err_t adc_engine_add_channel(adc1_channel_t channel, uint32_t period_ms, AdcEngineCallbackFunction callback)
+{
+    ESP_RETURN_ON_FALSE(channel >= 0 && channel < ADC1_CHANNEL_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid ADC1 channel.");
+
+    /**
+     *  Se crea el mutex para el acceso a los datos de los canales y al driver.
+     */
+    if(xAdcEngineMutex == NULL)
+    {
+        xAdcEngineMutex = xSemaphoreCreateMutex();
+
+        if(xAdcEngineMutex == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create ADC engine mutex.");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    xSemaphoreTake(xAdcEngineMutex, portMAX_DELAY);
+
+    adc_engine_channel_t *ch = &adc_engine_channels[channel];
+
+    ch->period_ms = period_ms;
+    ch->callback = callback;
+    ch->last_callback_us = esp_timer_get_time();
+
+    /**
+     *  Si el canal es nuevo, se inicializan sus filtros y se debe volver a configurar el patrón de
+     *  muestreo del ADC.
+     */
+    esp_err_t ret = ESP_OK;
+
+    if(!ch->enabled)
+    {
+        ret = filter_trimmed_mean_init(&ch->decimation, ADC_ENGINE_DECIMATION, ADC_ENGINE_TRIM);
+
+        if(ret == ESP_OK)
+        {
+            ret = filter_median_init(&ch->median, ADC_ENGINE_MEDIAN_WINDOW);
+        }
+
+        if(ret == ESP_OK)
+        {
+            ch->enabled = 1;
+            adc_engine_reconfigure_flag = 1;
+        }
+    }
+
+    xSemaphoreGive(xAdcEngineMutex);
+
+    ESP_RETURN_ON_ERROR(ret, TAG, "Failed to initialize channel filters.");
+
+    //========================| CREACIÓN DE TAREA |===========================//
+
+    /**
+     *  Se crea la tarea encargada de leer las muestras del DMA y ejecutar las funciones
+     *  callback de los canales.
+     */
+    if(xAdcEngineTaskHandle == NULL)
+    {
+        xTaskCreate(
+            vTaskAdcEngine,
+            "vTaskAdcEngine",
+            ADC_ENGINE_TASK_STACK_SIZE,
+            NULL,
+            ADC_ENGINE_TASK_PRIORITY,
+            &xAdcEngineTaskHandle);
+
+        /**
+         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
+         */
+        if(xAdcEngineTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create vTaskAdcEngine task.");
+            return ESP_FAIL;
+        }
+    }
+
+    xTaskNotifyGive(xAdcEngineTaskHandle);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para obtener el valor filtrado de un canal (mediana móvil de las medias recortadas), en cuentas del ADC.
+ *
+ * @param channel   Canal del ADC1.
+ * @param raw       Variable donde se guardará el valor obtenido.
+ * @return esp_err_t    ESP_ERR_INVALID_STATE si el canal todavía no tiene valores.
+ */
+esp_err_t adc_engine_get_raw(adc1_channel_t channel, uint16_t *raw)
+{
+    ESP_RETURN_ON_FALSE(channel >= 0 && channel < ADC1_CHANNEL_MAX && raw != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+    ESP_RETURN_ON_FALSE(xAdcEngineMutex != NULL, ESP_ERR_INVALID_STATE, TAG, "ADC engine not initialized.");
+
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(xAdcEngineMutex, portMAX_DELAY);
+
+    if(adc_engine_channels[channel].enabled && adc_engine_channels[channel].median.count > 0)
+    {
+        *raw = adc_engine_value(&adc_engine_channels[channel]);
+        ret = ESP_OK;
+    }
+
+    xSemaphoreGive(xAdcEngineMutex);
+
+    return ret;
+}
+
+
+
+/**
+ * @brief   Función para obtener las estadísticas del motor de adquisición.
+ *
+ * @param stats     Puntero a la estructura donde se guardan las estadísticas.
+ */
+void adc_engine_get_stats(adc_engine_stats_t *stats)
+{
+    if(stats == NULL || xAdcEngineMutex == NULL)
+    {
+        return;
+    }
+
+    xSemaphoreTake(xAdcEngineMutex, portMAX_DELAY);
+    *stats = adc_engine_stats;
+    xSemaphoreGive(xAdcEngineMutex);
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+/*
+
+    Motor de adquisición continua (DMA) del ADC1
+
+*/
+
+#ifndef ADC_ENGINE_H_   /* Include guard */
+#define ADC_ENGINE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/adc.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/**
+ *  @brief  Configuración del motor de adquisición. Pueden redefinirse antes de incluir este archivo.
+ */
+#ifndef ADC_ENGINE_SAMPLE_FREQ_HZ
+#define ADC_ENGINE_SAMPLE_FREQ_HZ 20000         // Frecuencia total de muestreo del ADC1 (repartida entre los canales). Mínimo 20 kHz en el ESP32.
+#endif
+
+#ifndef ADC_ENGINE_DECIMATION
+#define ADC_ENGINE_DECIMATION 100               // Cantidad de muestras de un canal que se promedian (media recortada) en cada valor de la ventana de mediana.
+#endif
+
+#ifndef ADC_ENGINE_TRIM
+#define ADC_ENGINE_TRIM 8                       // Cantidad de muestras descartadas en cada extremo de la media recortada (hasta FILTER_TRIM_MAX).
+#endif
+
+#ifndef ADC_ENGINE_MEDIAN_WINDOW
+#define ADC_ENGINE_MEDIAN_WINDOW 256            // Cantidad de valores promediados sobre los que se calcula la mediana móvil de cada canal.
+#endif
+
+#ifndef ADC_ENGINE_TASK_PRIORITY
+#define ADC_ENGINE_TASK_PRIORITY 6
+#endif
+
+#ifndef ADC_ENGINE_TASK_STACK_SIZE
+#define ADC_ENGINE_TASK_STACK_SIZE 4096
+#endif
+
+/**
+ *  @brief  Puntero a función que será utilizado para ejecutar la función que se pase
+ *          como callback cada vez que se cumpla el período de un canal. Recibe el valor
+ *          filtrado (mediana móvil de las medias recortadas) del canal, en cuentas del ADC.
+ */
+typedef void (*AdcEngineCallbackFunction)(uint16_t raw);
+
+/* Estadísticas del motor de adquisición */
+typedef struct {
+    uint32_t frames;        /* Cantidad de lecturas del buffer DMA. */
+    uint32_t samples;       /* Cantidad total de muestras procesadas. */
+    uint32_t overflows;     /* Cantidad de veces que se desbordó el buffer DMA (muestras perdidas). */
+} adc_engine_stats_t;
+
+/*==================[EXTERNAL DATA DECLARATION]==============================*/
+
+/*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
+
+esp_err_t adc_engine_add_channel(adc1_channel_t channel, uint32_t period_ms, AdcEngineCallbackFunction callback);
+esp_err_t adc_engine_get_raw(adc1_channel_t channel, uint16_t *raw);
+void adc_engine_get_stats(adc_engine_stats_t *stats);
+
+/*==================[END OF FILE]============================================*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ADC_ENGINE_H_
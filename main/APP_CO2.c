@@ -75,12 +75,9 @@ static void CallbackGetCO2Data(void *pvParameters)
     {
         amb_CO2 = CODIGO_ERROR_SENSOR_CO2;
         
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_CO2);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_CO2);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         ESP_LOGE(app_co2_tag, "CO2 SENSOR ERROR DETECTED");
     }
@@ -92,15 +89,10 @@ static void CallbackGetCO2Data(void *pvParameters)
 
 
     /**
-     *  Si hay una conexión con el broker MQTT, se publica el valor de CO2 sensado, o
+     *  Se publica el valor de CO2 sensado (si no hay conexión, queda pendiente), o
      *  su codigo de error en tal caso.
      */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%.3f", amb_CO2);
-        esp_mqtt_client_publish(Cliente_MQTT, CO2_AMB_MQTT_TOPIC, buffer, 0, 0, 0);
-    }
+    mqtt_publish_telemetry(Cliente_MQTT, CO2_AMB_MQTT_TOPIC, amb_CO2, 3);
 
 }
 
@@ -123,7 +115,16 @@ esp_err_t APP_CO2_init(esp_mqtt_client_handle_t mqtt_client)
      *  Inicializamos el sensor de CO2. En caso de detectar error,
      *  se retorna con error.
      */
-    if(CO2_sensor_init(GPIO_PIN_CO2_SENSOR) != ESP_OK)
+    CO2_sensor_config_t CO2_sensor_config = {
+        .backend = CO2_SENSOR_INTERFAZ,
+        .pwm_pin = GPIO_PIN_CO2_SENSOR,
+        .uart_port = CO2_SENSOR_UART_PUERTO,
+        .uart_tx_pin = GPIO_PIN_CO2_SENSOR_UART_TX,
+        .uart_rx_pin = GPIO_PIN_CO2_SENSOR_UART_RX,
+        .auto_calibration = CO2_SENSOR_AUTOCALIBRACION,
+    };
+
+    if(CO2_sensor_init(&CO2_sensor_config) != ESP_OK)
     {
         ESP_LOGE(app_co2_tag, "FAILED TO INITIALIZE CO2 SENSOR.");
         return ESP_FAIL;
@@ -135,5 +136,19 @@ esp_err_t APP_CO2_init(esp_mqtt_client_handle_t mqtt_client)
      */
     CO2_sensor_callback_function_on_new_measurment(CallbackGetCO2Data);
     
+    /**
+     *  Asignamos la política de publicación por excepción del nivel de CO2, para
+     *  no publicar valores que no variaron respecto del último publicado.
+     */
+    mqtt_telemetry_policy_t politica_publicacion = {
+        .abs_deadband = CO2_AMB_PUBLISH_DEADBAND,
+        .max_silence_ms = CO2_AMB_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    if(mqtt_set_telemetry_policy(CO2_AMB_MQTT_TOPIC, &politica_publicacion) != ESP_OK)
+    {
+        ESP_LOGW(app_co2_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
+    }
+
     return ESP_OK;
 }
\ No newline at end of file
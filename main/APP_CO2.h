@@ -24,6 +24,13 @@ extern "C" {
 /* Código de error que se carga en el valor de CO2 al detectar un error de sensado. */
 #define CODIGO_ERROR_SENSOR_CO2 -5
 
+/**
+ *  Política de publicación del nivel de CO2: se publica al variar más que la banda muerta
+ *  respecto del último valor publicado, o cada cierto tiempo sin variación (heartbeat).
+ */
+#define CO2_AMB_PUBLISH_DEADBAND 20
+#define CO2_AMB_PUBLISH_MAX_SILENCE_MS 60000
+
 /**
  *  Definición de los tópicos MQTT a suscribirse o publicar.
  */
@@ -32,6 +39,17 @@ extern "C" {
 /* Definición del pin GPIO al cual está conectado el sensor de CO2. */
 #define GPIO_PIN_CO2_SENSOR 33
 
+/**
+ *  Interfaz del sensor de CO2 (CO2_SENSOR_BACKEND_PWM, CO2_SENSOR_BACKEND_UART o CO2_SENSOR_BACKEND_AUTO), y
+ *  configuración de la UART: puerto, pines, y autocalibración de la línea de base (deshabilitada, ya que en el
+ *  invernadero el nivel de CO2 no vuelve necesariamente a 400 ppm cada día).
+ */
+#define CO2_SENSOR_INTERFAZ CO2_SENSOR_BACKEND_AUTO
+#define CO2_SENSOR_UART_PUERTO UART_NUM_2
+#define GPIO_PIN_CO2_SENSOR_UART_TX 17
+#define GPIO_PIN_CO2_SENSOR_UART_RX 16
+#define CO2_SENSOR_AUTOCALIBRACION 0
+
 /*======================[EXTERNAL DATA DECLARATION]==============================*/
 
 /*=====================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
@@ -24,6 +24,7 @@
 
 #include "MQTT_PUBL_SUSCR.h"
 #include "DHT11_SENSOR.h"
+#include "ultrasonic_sensor.h"
 #include "ALARMAS_USUARIO.h"
 #include "APP_DHT11.h"
 
@@ -81,26 +82,29 @@ static void CallbackGetTempHumData(void *pvParameters)
     {
         amb_temp = CODIGO_ERROR_SENSOR_DHT11_TEMP_AMB;
         
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_DTH11_TEMP);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_DTH11_TEMP);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         ESP_LOGE(app_dht11_tag, "DHT11 SENSOR TEMP ERROR DETECTED");
     }
 
+    else
+    {
+        /**
+         *  Se compensa la velocidad del sonido de los sensores de nivel ultrasónicos con
+         *  la temperatura ambiente medida.
+         */
+        ultrasonic_set_air_temperature(amb_temp);
+    }
+
     if(return_status_hum == ESP_FAIL || amb_hum < LIMITE_INFERIOR_RANGO_VALIDO_HUM_AMB || amb_hum > LIMITE_SUPERIOR_RANGO_VALIDO_HUM_AMB)
     {
         amb_hum = CODIGO_ERROR_SENSOR_DHT11_HUM_AMB;
         
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_DTH11_HUM);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_DTH11_HUM);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         ESP_LOGE(app_dht11_tag, "DHT11 SENSOR HUM ERROR DETECTED");
     }
@@ -113,18 +117,11 @@ static void CallbackGetTempHumData(void *pvParameters)
 
 
     /**
-     *  Si hay una conexión con el broker MQTT, se publican los valores de temperatura y
+     *  Se publican (o quedan pendientes, si no hay conexión) los valores de temperatura y
      *  humedad relativa sensados, o su codigo de error en tal caso.
      */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%.3f", amb_temp);
-        esp_mqtt_client_publish(Cliente_MQTT, TEMP_AMB_MQTT_TOPIC, buffer, 0, 0, 0);
-
-        snprintf(buffer, sizeof(buffer), "%.3f", amb_hum);
-        esp_mqtt_client_publish(Cliente_MQTT, HUM_AMB_MQTT_TOPIC, buffer, 0, 0, 0);
-    }
+    mqtt_publish_telemetry(Cliente_MQTT, TEMP_AMB_MQTT_TOPIC, amb_temp, 3);
+    mqtt_publish_telemetry(Cliente_MQTT, HUM_AMB_MQTT_TOPIC, amb_hum, 3);
 
 }
 
@@ -159,5 +156,26 @@ esp_err_t APP_DHT11_init(esp_mqtt_client_handle_t mqtt_client)
      */
     DHT11_callback_function_on_new_measurment(CallbackGetTempHumData);
     
+    /**
+     *  Asignamos la política de publicación por excepción de la temperatura y humedad
+     *  ambiente, para no publicar valores que no variaron respecto del último publicado.
+     */
+    mqtt_telemetry_policy_t politica_publicacion = {
+        .abs_deadband = TEMP_AMB_PUBLISH_DEADBAND,
+        .max_silence_ms = DHT11_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    if(mqtt_set_telemetry_policy(TEMP_AMB_MQTT_TOPIC, &politica_publicacion) != ESP_OK)
+    {
+        ESP_LOGW(app_dht11_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
+    }
+
+    politica_publicacion.abs_deadband = HUM_AMB_PUBLISH_DEADBAND;
+
+    if(mqtt_set_telemetry_policy(HUM_AMB_MQTT_TOPIC, &politica_publicacion) != ESP_OK)
+    {
+        ESP_LOGW(app_dht11_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
+    }
+
     return ESP_OK;
 }
\ No newline at end of file
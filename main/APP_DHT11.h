@@ -31,6 +31,14 @@ extern "C" {
 /* Código de error que se carga en el valor de humedad relativa al detectar un error de sensado. */
 #define CODIGO_ERROR_SENSOR_DHT11_HUM_AMB -6
 
+/**
+ *  Política de publicación de la temperatura y humedad ambiente: se publican al variar más que la
+ *  banda muerta respecto del último valor publicado, o cada cierto tiempo sin variación (heartbeat).
+ */
+#define TEMP_AMB_PUBLISH_DEADBAND 0.5
+#define HUM_AMB_PUBLISH_DEADBAND 1
+#define DHT11_PUBLISH_MAX_SILENCE_MS 60000
+
 /**
  *  Definición de los tópicos MQTT a suscribirse o publicar.
  */
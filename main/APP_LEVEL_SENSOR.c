@@ -23,9 +23,12 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "esp_timer.h"
+
 #include "MQTT_PUBL_SUSCR.h"
 #include "mqtt_client.h"
 #include "ultrasonic_sensor.h"
+#include "TANK_MODEL.h"
 #include "ALARMAS_USUARIO.h"
 #include "APP_LEVEL_SENSOR.h"
 
@@ -33,6 +36,32 @@
 
 //==================================| MACROS AND TYPDEF |==================================//
 
+/* Cantidad de tanques de la unidad secundaria. */
+#define NUMERO_TANQUES 5
+
+/* Estructura con los datos de medición y de planificación de cada tanque. */
+typedef struct {
+    ultrasonic_sens_t *sensor;          /* Sensor de nivel del tanque. */
+    tank_model_t *tank;                 /* Modelo geométrico del tanque. */
+    tank_model_config_t tank_config;    /* Dimensiones del tanque. */
+    char *mqtt_publ_topic;              /* Tópico en donde se publica el nivel del tanque. */
+    char *mqtt_volume_topic;            /* Tópico en donde se publica el volumen de líquido del tanque. */
+    char *mqtt_fill_rate_topic;         /* Tópico en donde se publica el caudal de llenado del tanque. */
+    alarms_t sensor_error_alarm;        /* Alarma de error de sensado. */
+    alarms_t below_limit_alarm;         /* Alarma de nivel por debajo del límite. */
+    bool *below_limit_flag;             /* Bandera de nivel por debajo del límite. */
+    bool *sensor_error_flag;            /* Bandera de error de sensado. */
+    uint32_t period_ms;                 /* Período de medición. */
+    uint8_t acoustic_group;             /* Grupo acústico del sensor. */
+    bool enabled;                       /* Tanque habilitado para medición. */
+    bool in_flight;                     /* Hay una medición en curso. */
+    int64_t trigger_us;                 /* Instante de inicio de la medición en curso. */
+    int64_t next_due_us;                /* Instante de inicio de la próxima medición. */
+    app_level_sensor_stats_t stats;     /* Estadísticas de medición. */
+    tank_model_reading_t reading;       /* Última medición válida convertida con el modelo del tanque. */
+    bool has_reading;                   /* Indica si ya hay una medición válida. */
+} level_tank_sched_t;
+
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 /* Tag para imprimir información en el LOG. */
@@ -51,12 +80,12 @@ static ultrasonic_sens_t sensor_nivel_tanque_alcalino = {0};
 static ultrasonic_sens_t sensor_nivel_tanque_agua = {0};
 static ultrasonic_sens_t sensor_nivel_tanque_sustrato = {0};
 
-/* Variables que representan las dimensiones de los 5 tanques. */
-static storage_tank_t tanque_principal = {0};
-static storage_tank_t tanque_acido = {0};
-static storage_tank_t tanque_alcalino = {0};
-static storage_tank_t tanque_agua = {0};
-static storage_tank_t tanque_sustrato = {0};
+/* Variables que representan los modelos geométricos de los 5 tanques. */
+static tank_model_t tanque_principal = {0};
+static tank_model_t tanque_acido = {0};
+static tank_model_t tanque_alcalino = {0};
+static tank_model_t tanque_agua = {0};
+static tank_model_t tanque_sustrato = {0};
 
 /* Banderas que determinan si el nivel del tanque correspondiente está por debajo del límite establecido. */
 static bool tanque_principal_below_limit_flag = 0;
@@ -72,15 +101,90 @@ static bool tanque_alcalino_sensor_error_flag = 0;
 static bool tanque_agua_sensor_error_flag = 0;
 static bool tanque_sustrato_sensor_error_flag = 0;
 
+/* Datos de medición y de planificación de los 5 tanques. */
+static level_tank_sched_t level_tanks[NUMERO_TANQUES] = {
+    [TANQUE_PRINCIPAL] = {
+        .sensor = &sensor_nivel_tanque_principal, .tank = &tanque_principal,
+        .tank_config = {
+            .height_cm = NIVEL_TANQUE_PRINCIPAL_ALTURA_CM, .sensor_offset_cm = NIVEL_TANQUE_PRINCIPAL_OFFSET_SENSOR_CM,
+            .shape = TANK_SHAPE_CYLINDER, .diameter_cm = NIVEL_TANQUE_PRINCIPAL_DIAMETRO_CM,
+        },
+        .mqtt_publ_topic = SENSOR_NIVEL_TANQUE_PRINCIPAL_MQTT_TOPIC,
+        .mqtt_volume_topic = VOLUMEN_TANQUE_PRINCIPAL_MQTT_TOPIC, .mqtt_fill_rate_topic = CAUDAL_TANQUE_PRINCIPAL_MQTT_TOPIC,
+        .sensor_error_alarm = ALARMA_ERROR_SENSOR_NIVEL_TANQUE_PRINC, .below_limit_alarm = ALARMA_NIVEL_TANQUE_PRINCIPAL_BAJO,
+        .below_limit_flag = &tanque_principal_below_limit_flag, .sensor_error_flag = &tanque_principal_sensor_error_flag,
+        .period_ms = NIVEL_TANQUE_PRINCIPAL_PERIODO_MS, .acoustic_group = NIVEL_TANQUE_PRINCIPAL_GRUPO_ACUSTICO,
+    },
+    [TANQUE_ACIDO] = {
+        .sensor = &sensor_nivel_tanque_acido, .tank = &tanque_acido,
+        .tank_config = {
+            .height_cm = NIVEL_TANQUE_ACIDO_ALTURA_CM, .sensor_offset_cm = NIVEL_TANQUE_ACIDO_OFFSET_SENSOR_CM,
+            .shape = TANK_SHAPE_CYLINDER, .diameter_cm = NIVEL_TANQUE_ACIDO_DIAMETRO_CM,
+        },
+        .mqtt_publ_topic = SENSOR_NIVEL_TANQUE_ACIDO_MQTT_TOPIC,
+        .mqtt_volume_topic = VOLUMEN_TANQUE_ACIDO_MQTT_TOPIC, .mqtt_fill_rate_topic = CAUDAL_TANQUE_ACIDO_MQTT_TOPIC,
+        .sensor_error_alarm = ALARMA_ERROR_SENSOR_NIVEL_TANQUE_ACIDO, .below_limit_alarm = ALARMA_NIVEL_TANQUE_ACIDO_BAJO,
+        .below_limit_flag = &tanque_acido_below_limit_flag, .sensor_error_flag = &tanque_acido_sensor_error_flag,
+        .period_ms = NIVEL_TANQUE_ACIDO_PERIODO_MS, .acoustic_group = NIVEL_TANQUE_ACIDO_GRUPO_ACUSTICO,
+    },
+    [TANQUE_ALCALINO] = {
+        .sensor = &sensor_nivel_tanque_alcalino, .tank = &tanque_alcalino,
+        .tank_config = {
+            .height_cm = NIVEL_TANQUE_ALCALINO_ALTURA_CM, .sensor_offset_cm = NIVEL_TANQUE_ALCALINO_OFFSET_SENSOR_CM,
+            .shape = TANK_SHAPE_CYLINDER, .diameter_cm = NIVEL_TANQUE_ALCALINO_DIAMETRO_CM,
+        },
+        .mqtt_publ_topic = SENSOR_NIVEL_TANQUE_ALCALINO_MQTT_TOPIC,
+        .mqtt_volume_topic = VOLUMEN_TANQUE_ALCALINO_MQTT_TOPIC, .mqtt_fill_rate_topic = CAUDAL_TANQUE_ALCALINO_MQTT_TOPIC,
+        .sensor_error_alarm = ALARMA_ERROR_SENSOR_NIVEL_TANQUE_ALCALINO, .below_limit_alarm = ALARMA_NIVEL_TANQUE_ALCALINO_BAJO,
+        .below_limit_flag = &tanque_alcalino_below_limit_flag, .sensor_error_flag = &tanque_alcalino_sensor_error_flag,
+        .period_ms = NIVEL_TANQUE_ALCALINO_PERIODO_MS, .acoustic_group = NIVEL_TANQUE_ALCALINO_GRUPO_ACUSTICO,
+    },
+    [TANQUE_AGUA] = {
+        .sensor = &sensor_nivel_tanque_agua, .tank = &tanque_agua,
+        .tank_config = {
+            .height_cm = NIVEL_TANQUE_AGUA_ALTURA_CM, .sensor_offset_cm = NIVEL_TANQUE_AGUA_OFFSET_SENSOR_CM,
+            .shape = TANK_SHAPE_CYLINDER, .diameter_cm = NIVEL_TANQUE_AGUA_DIAMETRO_CM,
+        },
+        .mqtt_publ_topic = SENSOR_NIVEL_TANQUE_AGUA_MQTT_TOPIC,
+        .mqtt_volume_topic = VOLUMEN_TANQUE_AGUA_MQTT_TOPIC, .mqtt_fill_rate_topic = CAUDAL_TANQUE_AGUA_MQTT_TOPIC,
+        .sensor_error_alarm = ALARMA_ERROR_SENSOR_NIVEL_TANQUE_AGUA, .below_limit_alarm = ALARMA_NIVEL_TANQUE_AGUA_BAJO,
+        .below_limit_flag = &tanque_agua_below_limit_flag, .sensor_error_flag = &tanque_agua_sensor_error_flag,
+        .period_ms = NIVEL_TANQUE_AGUA_PERIODO_MS, .acoustic_group = NIVEL_TANQUE_AGUA_GRUPO_ACUSTICO,
+    },
+    [TANQUE_SUSTRATO] = {
+        .sensor = &sensor_nivel_tanque_sustrato, .tank = &tanque_sustrato,
+        .tank_config = {
+            .height_cm = NIVEL_TANQUE_SUSTRATO_ALTURA_CM, .sensor_offset_cm = NIVEL_TANQUE_SUSTRATO_OFFSET_SENSOR_CM,
+            .shape = TANK_SHAPE_CYLINDER, .diameter_cm = NIVEL_TANQUE_SUSTRATO_DIAMETRO_CM,
+        },
+        .mqtt_publ_topic = SENSOR_NIVEL_TANQUE_SUSTRATO_MQTT_TOPIC,
+        .mqtt_volume_topic = VOLUMEN_TANQUE_SUSTRATO_MQTT_TOPIC, .mqtt_fill_rate_topic = CAUDAL_TANQUE_SUSTRATO_MQTT_TOPIC,
+        .sensor_error_alarm = ALARMA_ERROR_SENSOR_NIVEL_TANQUE_NUTRIENTES, .below_limit_alarm = ALARMA_NIVEL_TANQUE_SUSTRATO_BAJO,
+        .below_limit_flag = &tanque_sustrato_below_limit_flag, .sensor_error_flag = &tanque_sustrato_sensor_error_flag,
+        .period_ms = NIVEL_TANQUE_SUSTRATO_PERIODO_MS, .acoustic_group = NIVEL_TANQUE_SUSTRATO_GRUPO_ACUSTICO,
+    },
+};
+
+/* Duración del último barrido completo (todos los tanques habilitados medidos al menos una vez), en ms. */
+static uint32_t level_sweep_time_ms = 0;
+
+/* Spinlock para la lectura de las estadísticas desde otras tareas. */
+static portMUX_TYPE level_stats_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Funciones callback de cambio de las banderas de los tanques. */
+static AppLevelSensorChangeCallbackFunction level_change_callbacks[APP_LEVEL_SENSOR_MAX_CHANGE_CALLBACKS];
+static int level_change_callback_count = 0;
+
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
 static void vTaskLevelSensors(void *pvParameters);
-static esp_err_t tank_control(  ultrasonic_sens_t level_sensor, storage_tank_t tank, char *mqtt_publ_topic, 
+static esp_err_t tank_control(  esp_err_t return_status, float tank_level, char *mqtt_publ_topic, 
                                 alarms_t mqtt_sensor_error_alarm, alarms_t mqtt_below_limit_alarm,
-                                bool *below_limit_tank_flag, bool *sensor_error_flag,
-                                char *test_sensor_value_topic);
+                                bool *below_limit_tank_flag, bool *sensor_error_flag);
+static esp_err_t tank_control_notify(tanques_unidad_sec_t tanque, esp_err_t return_status, float tank_level);
+static void CallbackGetLevelForced(tanques_unidad_sec_t tanque, void *pvParameters);
 static void CallbackGetLevelTanquePrincipal(void *pvParameters);
 static void CallbackGetLevelTanqueAcido(void *pvParameters);
 static void CallbackGetLevelTanqueAlcalino(void *pvParameters);
@@ -90,70 +194,180 @@ static void CallbackGetLevelTanqueSustrato(void *pvParameters);
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
- * @brief   Tarea encargada de obtener los niveles de líquido de los 5 tanques de la unidad secundaria
- *          de forma períodica (1 seg).
+ * @brief   Tarea encargada de obtener los niveles de líquido de los 5 tanques de la unidad secundaria.
+ * 
+ *          Cada tanque se mide con su propio período. Las mediciones de sensores de distintos grupos acústicos
+ *          se realizan en simultáneo, mientras que las de un mismo grupo se realizan de a una, respetando el tiempo
+ *          de guarda entre ellas. La tarea inicia las mediciones y queda bloqueada hasta que algún sensor notifique
+ *          el fin de su pulso de respuesta, o hasta el próximo evento planificado (inicio de medición, fin del tiempo
+ *          de guarda o timeout de una medición en curso).
  * 
  * @param pvParameters
  */
 static void vTaskLevelSensors(void *pvParameters)
 {
-    while(1)
+    /* Instante a partir del cual cada grupo acústico puede iniciar una nueva medición. */
+    int64_t group_free_us[NIVEL_TANQUE_GRUPOS_ACUSTICOS] = {0};
+
+    /* Máscara de grupos acústicos con una medición en curso. */
+    uint32_t group_busy = 0;
+
+    /* Máscara de tanques habilitados, y de tanques que todavía no se midieron en el barrido actual. */
+    uint32_t enabled_mask = 0;
+
+    for(int i = 0; i < NUMERO_TANQUES; i++)
     {
-        #ifdef DEBUG_SENSOR_NIVEL_TANQUE_PRINCIPAL
-        if(tank_control(sensor_nivel_tanque_principal, tanque_principal, SENSOR_NIVEL_TANQUE_PRINCIPAL_MQTT_TOPIC, 
-                        ALARMA_ERROR_SENSOR_NIVEL_TANQUE_PRINC, ALARMA_NIVEL_TANQUE_PRINCIPAL_BAJO, 
-                        &tanque_principal_below_limit_flag, &tanque_principal_sensor_error_flag, NULL) != ESP_OK)
-        {
-            ESP_LOGE(app_level_sensor_tag, "ERROR EN TANQUE PRINCIPAL.");
-        }
-        #endif
+        enabled_mask |= level_tanks[i].enabled ? BIT(i) : 0;
+    }
 
+    uint32_t sweep_pending = enabled_mask;
+    int64_t sweep_start_us = esp_timer_get_time();
 
-        #ifdef DEBUG_SENSOR_NIVEL_TANQUE_ACIDO
-        if(tank_control(sensor_nivel_tanque_acido, tanque_acido, SENSOR_NIVEL_TANQUE_ACIDO_MQTT_TOPIC, 
-                        ALARMA_ERROR_SENSOR_NIVEL_TANQUE_ACIDO, ALARMA_NIVEL_TANQUE_ACIDO_BAJO, 
-                        &tanque_acido_below_limit_flag, &tanque_acido_sensor_error_flag, NULL) != ESP_OK)
-        {
-            ESP_LOGE(app_level_sensor_tag, "ERROR EN TANQUE ACIDO.");
-        }
-        #endif
+    while(1)
+    {
+        int64_t now_us = esp_timer_get_time();
+        int64_t next_event_us = now_us + 1000000;
 
-        #ifdef DEBUG_SENSOR_NIVEL_TANQUE_ALCALINO
-        if(tank_control(sensor_nivel_tanque_alcalino, tanque_alcalino, SENSOR_NIVEL_TANQUE_ALCALINO_MQTT_TOPIC, 
-                        ALARMA_ERROR_SENSOR_NIVEL_TANQUE_ALCALINO, ALARMA_NIVEL_TANQUE_ALCALINO_BAJO, 
-                        &tanque_alcalino_below_limit_flag, &tanque_alcalino_sensor_error_flag, NULL) != ESP_OK)
+        /**
+         *  Se procesan las mediciones en curso que hayan finalizado, correcta o incorrectamente.
+         */
+        for(int i = 0; i < NUMERO_TANQUES; i++)
         {
-            ESP_LOGE(app_level_sensor_tag, "ERROR EN TANQUE ALCALINO.");
+            level_tank_sched_t *t = &level_tanks[i];
+
+            if(!t->in_flight)
+            {
+                continue;
+            }
+
+            float distance_cm = 0;
+            esp_err_t return_status = ultrasonic_get_distance_cm(t->sensor, &distance_cm);
+
+            if(return_status == ESP_ERR_ULTRASONIC_IN_PROGRESS)
+            {
+                int64_t timeout_us = t->trigger_us + ULTRASONIC_TIMEOUT_MS * 1000;
+                next_event_us = (timeout_us < next_event_us) ? timeout_us : next_event_us;
+                continue;
+            }
+
+            t->in_flight = 0;
+            group_busy &= ~BIT(t->acoustic_group);
+            group_free_us[t->acoustic_group] = now_us + NIVEL_TANQUE_TIEMPO_GUARDA_MS * 1000;
+
+            /**
+             *  La duración del pulso de respuesta se toma de los flancos capturados en la interrupción, y no del
+             *  instante en que la tarea procesa la medición, que incluye la demora de planificación.
+             */
+            uint32_t echo_us = 0;
+
+            if(ultrasonic_get_echo_time_us(t->sensor, &echo_us) != ESP_OK)
+            {
+                echo_us = 0;
+            }
+
+            portENTER_CRITICAL(&level_stats_mux);
+            t->stats.measurements++;
+            t->stats.last_echo_us = echo_us;
+
+            if(return_status == ESP_ERR_ULTRASONIC_PING_TIMEOUT || return_status == ESP_ERR_ULTRASONIC_ECHO_TIMEOUT)
+            {
+                t->stats.timeouts++;
+            }
+            portEXIT_CRITICAL(&level_stats_mux);
+
+            /**
+             *  Se convierte la distancia medida en nivel, volumen y caudal de llenado con el modelo del tanque.
+             */
+            tank_model_reading_t reading = {0};
+
+            if(return_status == ESP_OK)
+            {
+                tank_model_update(t->tank, distance_cm, now_us, &reading);
+            }
+
+            if(tank_control_notify(i, return_status, reading.level) != ESP_OK)
+            {
+                ESP_LOGE(app_level_sensor_tag, "ERROR EN TANQUE %d.", i);
+            }
+
+            else
+            {
+                portENTER_CRITICAL(&level_stats_mux);
+                t->reading = reading;
+                t->has_reading = 1;
+                portEXIT_CRITICAL(&level_stats_mux);
+
+                mqtt_publish_telemetry(Cliente_MQTT, t->mqtt_volume_topic, reading.volume_l, 2);
+                mqtt_publish_telemetry(Cliente_MQTT, t->mqtt_fill_rate_topic, reading.fill_rate_l_min, 2);
+            }
+
+            /**
+             *  Al completarse la medición de todos los tanques habilitados, se registra la duración del barrido.
+             */
+            sweep_pending &= ~BIT(i);
+
+            if(sweep_pending == 0)
+            {
+                portENTER_CRITICAL(&level_stats_mux);
+                level_sweep_time_ms = (now_us - sweep_start_us) / 1000;
+                portEXIT_CRITICAL(&level_stats_mux);
+
+                ESP_LOGI(app_level_sensor_tag, "BARRIDO DE TANQUES: %u ms", level_sweep_time_ms);
+
+                sweep_start_us = now_us;
+                sweep_pending = enabled_mask;
+            }
         }
-        #endif
 
-        #ifdef DEBUG_SENSOR_NIVEL_TANQUE_AGUA
-        if(tank_control(sensor_nivel_tanque_agua, tanque_agua, SENSOR_NIVEL_TANQUE_AGUA_MQTT_TOPIC, 
-                        ALARMA_ERROR_SENSOR_NIVEL_TANQUE_AGUA, ALARMA_NIVEL_TANQUE_AGUA_BAJO, 
-                        &tanque_agua_below_limit_flag, &tanque_agua_sensor_error_flag, NULL) != ESP_OK)
+        /**
+         *  Se inician las mediciones de los tanques cuyo período se cumplió, si su grupo acústico está libre.
+         */
+        for(int i = 0; i < NUMERO_TANQUES; i++)
         {
-            ESP_LOGE(app_level_sensor_tag, "ERROR EN TANQUE AGUA.");
-        }
-        #endif
+            level_tank_sched_t *t = &level_tanks[i];
+            uint8_t group = t->acoustic_group;
 
-        #ifdef DEBUG_SENSOR_NIVEL_TANQUE_SUSTRATO
-        if(tank_control(sensor_nivel_tanque_sustrato, tanque_sustrato, SENSOR_NIVEL_TANQUE_SUSTRATO_MQTT_TOPIC, 
-                        ALARMA_ERROR_SENSOR_NIVEL_TANQUE_NUTRIENTES, ALARMA_NIVEL_TANQUE_SUSTRATO_BAJO, 
-                        &tanque_sustrato_below_limit_flag, &tanque_sustrato_sensor_error_flag, NULL) != ESP_OK)
-        {
-            ESP_LOGE(app_level_sensor_tag, "ERROR EN TANQUE SUSTRATO.");
+            if(!t->enabled || t->in_flight || (group_busy & BIT(group)))
+            {
+                continue;
+            }
+
+            int64_t ready_us = (t->next_due_us > group_free_us[group]) ? t->next_due_us : group_free_us[group];
+
+            if(now_us < ready_us)
+            {
+                next_event_us = (ready_us < next_event_us) ? ready_us : next_event_us;
+                continue;
+            }
+
+            t->next_due_us = now_us + (int64_t) t->period_ms * 1000;
+
+            if(ultrasonic_start_measurement(t->sensor, NULL) != ESP_OK)
+            {
+                ESP_LOGE(app_level_sensor_tag, "ERROR EN TANQUE %d.", i);
+                continue;
+            }
+
+            t->in_flight = 1;
+            t->trigger_us = now_us;
+            group_busy |= BIT(group);
+
+            int64_t timeout_us = now_us + ULTRASONIC_TIMEOUT_MS * 1000;
+            next_event_us = (timeout_us < next_event_us) ? timeout_us : next_event_us;
         }
-        #endif
 
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        /**
+         *  Se espera la notificación de fin de medición de algún sensor, o el próximo evento planificado.
+         */
+        TickType_t wait_ticks = pdMS_TO_TICKS((next_event_us - now_us + 999) / 1000);
+        xTaskNotifyWait(0, UINT32_MAX, NULL, (wait_ticks > 0) ? wait_ticks : 1);
     }
-    
 }
 
 
 
 /**
- * @brief   Función encargada de obtener el nivel de líquido del tanque pasado como argumento.
+ * @brief   Función encargada de procesar el nivel de líquido obtenido del tanque pasado como argumento.
  *          
  *          En caso de detectarse error de sensado, se publica la alarma en el tópico MQTT común de alarmas,
  *          y se setea la bandera de error de sensado.
@@ -162,43 +376,23 @@ static void vTaskLevelSensors(void *pvParameters)
  *          considerado como válido), se publica la alarma en el tópico MQTT común de alarmas, y se setea
  *          la bandera de nivel debajo del límite.
  * 
- * @param level_sensor              Estructura que representa el pin del sensor de nivel.
- * @param tank                      Estructura que representa las dimensiones del tanque.
+ * @param return_status             Resultado de la medición del nivel del tanque.
+ * @param tank_level                Nivel del tanque medido, como un valor entre 0 (tanque vacio) y 1 (tanque lleno).
  * @param mqtt_publ_topic           Tópico en donde se publica el nivel de líquido del tanque sensado.
  * @param mqtt_sensor_error_alarm   Alarma correspondiente a error de sensado del sensor de nivel del tanque (ver ALARMAS_USUARIO.h).
  * @param mqtt_below_limit_alarm    Alarma correspondiente a nivel del tanque menor que el límite establecido (ver ALARMAS_USUARIO.h).
  * @param below_limit_tank_flag     Bandera que determina si el nivel del tanque está por debajo del límite establecido o no.
  * @param sensor_error_flag         Bandera para determinar si hubo error de sensado del sensor de nivel del tanque o no.
- * @param test_sensor_value_topic   Tópico del cual se simula obtener el dato del sensor de nivel cuando está configurada la opción de forzar valor del sensor.
  * 
  * @return esp_err_t 
  */
-static esp_err_t tank_control(  ultrasonic_sens_t level_sensor, storage_tank_t tank, char *mqtt_publ_topic, 
+static esp_err_t tank_control(  esp_err_t return_status, float tank_level, char *mqtt_publ_topic, 
                                 alarms_t mqtt_sensor_error_alarm, alarms_t mqtt_below_limit_alarm,
-                                bool *below_limit_tank_flag, bool *sensor_error_flag,
-                                char *test_sensor_value_topic)
+                                bool *below_limit_tank_flag, bool *sensor_error_flag)
 {
     *sensor_error_flag = 0;
     *below_limit_tank_flag = 0;
 
-    #ifndef DEBUG_FORZAR_VALORES_SENSORES_APP_LEVEL_SENSOR
-    esp_err_t return_status = ESP_FAIL;
-    #else
-    esp_err_t return_status = ESP_OK;
-    #endif
-
-    /**
-     *  Se obtiene el nivel del tanque correspondiente, como un valor entre 0 (tanque vacio)
-     *  y 1 (tanque lleno).
-     */
-    float tank_level = 1;
-
-    #ifndef DEBUG_FORZAR_VALORES_SENSORES_APP_LEVEL_SENSOR
-    return_status = ultrasonic_measure_level(&level_sensor, &tank, &tank_level);
-    #else
-    mqtt_get_float_data_from_topic(test_sensor_value_topic, &tank_level);
-    #endif
-
     ESP_LOGI(app_level_sensor_tag, "NEW MEASUREMENT ARRIVED: %.3f", tank_level);
 
     /**
@@ -208,14 +402,11 @@ static esp_err_t tank_control(  ultrasonic_sens_t level_sensor, storage_tank_t t
      *  En caso de que no se cumplan estas condiciones, se publica el mensaje de alarma en el tópico MQTT común de alarmas, y
      *  se setea la bandera de error de sensor.
      */
-    if(return_status == ESP_FAIL || tank_level < LIMITE_INFERIOR_RANGO_VALIDO_NIVEL_TANQUE || tank_level > LIMITE_SUPERIOR_RANGO_VALIDO_NIVEL_TANQUE)
+    if(return_status != ESP_OK || tank_level < LIMITE_INFERIOR_RANGO_VALIDO_NIVEL_TANQUE || tank_level > LIMITE_SUPERIOR_RANGO_VALIDO_NIVEL_TANQUE)
     {
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", mqtt_sensor_error_alarm);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", mqtt_sensor_error_alarm);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         *sensor_error_flag = 1;
 
@@ -229,12 +420,7 @@ static esp_err_t tank_control(  ultrasonic_sens_t level_sensor, storage_tank_t t
      *  En caso de que no se haya detectado error de sensado, se publica el valor obtenido en el tópico MQTT
      *  correspondiente.
      */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%.3f", tank_level);
-        esp_mqtt_client_publish(Cliente_MQTT, mqtt_publ_topic, buffer, 0, 0, 0);
-    }
+    mqtt_publish_telemetry(Cliente_MQTT, mqtt_publ_topic, tank_level, 3);
 
     ESP_LOGI(app_level_sensor_tag, "NEW MEASUREMENT ARRIVED: %.3f", tank_level);
 
@@ -246,12 +432,9 @@ static esp_err_t tank_control(  ultrasonic_sens_t level_sensor, storage_tank_t t
     */
     if(tank_level < LIMITE_INFERIOR_ALARMA_NIVEL_TANQUE){
 
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", mqtt_below_limit_alarm);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", mqtt_below_limit_alarm);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         *below_limit_tank_flag = 1;
 
@@ -264,6 +447,57 @@ static esp_err_t tank_control(  ultrasonic_sens_t level_sensor, storage_tank_t t
 
 
 
+/**
+ * @brief   Función que procesa una nueva medición de nivel de un tanque mediante "tank_control()" y, si cambió
+ *          alguna de sus banderas (nivel por debajo del límite o error de sensado), ejecuta las funciones callback
+ *          de cambio asignadas.
+ *
+ * @param tanque            Tanque al cual corresponde la medición.
+ * @param return_status     Resultado de la medición del nivel del tanque.
+ * @param tank_level        Nivel del tanque medido.
+ * @return esp_err_t        Resultado de "tank_control()".
+ */
+static esp_err_t tank_control_notify(tanques_unidad_sec_t tanque, esp_err_t return_status, float tank_level)
+{
+    level_tank_sched_t *t = &level_tanks[tanque];
+
+    bool below_limit_flag = *t->below_limit_flag;
+    bool sensor_error_flag = *t->sensor_error_flag;
+
+    esp_err_t ret = tank_control(   return_status, tank_level, t->mqtt_publ_topic, t->sensor_error_alarm, t->below_limit_alarm,
+                                    t->below_limit_flag, t->sensor_error_flag);
+
+    if(below_limit_flag != *t->below_limit_flag || sensor_error_flag != *t->sensor_error_flag)
+    {
+        for(int i = 0; i < level_change_callback_count; i++)
+        {
+            level_change_callbacks[i](tanque);
+        }
+    }
+
+    return ret;
+}
+
+
+
+/**
+ *  @brief  Función que procesa un nuevo valor de nivel del tanque pasado como argumento, en el caso en el cual
+ *          se desea forzar el valor de sensado vía tópico MQTT.
+ * 
+ * @param tanque        Tanque al cual corresponde el valor.
+ * @param pvParameters  Handle del tópico MQTT en el cual llegó el valor.
+ */
+static void CallbackGetLevelForced(tanques_unidad_sec_t tanque, void *pvParameters)
+{
+    float tank_level = 1;
+
+    mqtt_get_topic_float((mqtt_topic_handle_t) pvParameters, &tank_level);
+
+    tank_control_notify(tanque, ESP_OK, tank_level);
+}
+
+
+
 /**
  *  @brief  Función de callback que se ejecuta cuando llega un mensaje al tópico MQTT
  *          correspondiente con un nuevo valor nivel en el caso en el cual se desea
@@ -273,9 +507,7 @@ static esp_err_t tank_control(  ultrasonic_sens_t level_sensor, storage_tank_t t
  */
 static void CallbackGetLevelTanquePrincipal(void *pvParameters)
 {
-    tank_control(   sensor_nivel_tanque_principal, tanque_principal, SENSOR_NIVEL_TANQUE_PRINCIPAL_MQTT_TOPIC, 
-                    ALARMA_ERROR_SENSOR_NIVEL_TANQUE_PRINC, ALARMA_NIVEL_TANQUE_PRINCIPAL_BAJO, 
-                    &tanque_principal_below_limit_flag, &tanque_principal_sensor_error_flag, TEST_LEVEL_TANQUE_PRINCIPAL_TOPIC);
+    CallbackGetLevelForced(TANQUE_PRINCIPAL, pvParameters);
 }
 
 
@@ -289,9 +521,7 @@ static void CallbackGetLevelTanquePrincipal(void *pvParameters)
  */
 static void CallbackGetLevelTanqueAcido(void *pvParameters)
 {
-    tank_control(   sensor_nivel_tanque_acido, tanque_acido, SENSOR_NIVEL_TANQUE_ACIDO_MQTT_TOPIC, 
-                    ALARMA_ERROR_SENSOR_NIVEL_TANQUE_ACIDO, ALARMA_NIVEL_TANQUE_ACIDO_BAJO, 
-                    &tanque_acido_below_limit_flag, &tanque_acido_sensor_error_flag, TEST_LEVEL_TANQUE_ACIDO_TOPIC);
+    CallbackGetLevelForced(TANQUE_ACIDO, pvParameters);
 }
 
 
@@ -305,9 +535,7 @@ static void CallbackGetLevelTanqueAcido(void *pvParameters)
  */
 static void CallbackGetLevelTanqueAlcalino(void *pvParameters)
 {
-    tank_control(   sensor_nivel_tanque_alcalino, tanque_alcalino, SENSOR_NIVEL_TANQUE_ALCALINO_MQTT_TOPIC, 
-                    ALARMA_ERROR_SENSOR_NIVEL_TANQUE_ALCALINO, ALARMA_NIVEL_TANQUE_ALCALINO_BAJO, 
-                    &tanque_alcalino_below_limit_flag, &tanque_alcalino_sensor_error_flag, TEST_LEVEL_TANQUE_ALCALINO_TOPIC);
+    CallbackGetLevelForced(TANQUE_ALCALINO, pvParameters);
 }
 
 
@@ -321,9 +549,7 @@ static void CallbackGetLevelTanqueAlcalino(void *pvParameters)
  */
 static void CallbackGetLevelTanqueAgua(void *pvParameters)
 {
-    tank_control(   sensor_nivel_tanque_agua, tanque_agua, SENSOR_NIVEL_TANQUE_AGUA_MQTT_TOPIC, 
-                    ALARMA_ERROR_SENSOR_NIVEL_TANQUE_AGUA, ALARMA_NIVEL_TANQUE_AGUA_BAJO, 
-                    &tanque_agua_below_limit_flag, &tanque_agua_sensor_error_flag, TEST_LEVEL_TANQUE_AGUA_TOPIC);
+    CallbackGetLevelForced(TANQUE_AGUA, pvParameters);
 }
 
 
@@ -337,9 +563,7 @@ static void CallbackGetLevelTanqueAgua(void *pvParameters)
  */
 static void CallbackGetLevelTanqueSustrato(void *pvParameters)
 {
-    tank_control(   sensor_nivel_tanque_sustrato, tanque_sustrato, SENSOR_NIVEL_TANQUE_SUSTRATO_MQTT_TOPIC, 
-                    ALARMA_ERROR_SENSOR_NIVEL_TANQUE_NUTRIENTES, ALARMA_NIVEL_TANQUE_SUSTRATO_BAJO, 
-                    &tanque_sustrato_below_limit_flag, &tanque_sustrato_sensor_error_flag, TEST_LEVEL_TANQUE_SUSTRATO_TOPIC);
+    CallbackGetLevelForced(TANQUE_SUSTRATO, pvParameters);
 }
 
 
@@ -378,19 +602,14 @@ esp_err_t app_level_sensor_init(esp_mqtt_client_handle_t mqtt_client)
      *  Se inicializan los sensores de nivel de los 5 tanques de la unidad secundaria.
      */
     sensor_nivel_tanque_principal.trigg_echo_pin = GPIO_PIN_LEVEL_SENSOR_TANQUE_PRINCIPAL;
-    tanque_principal.height = 25;
 
     sensor_nivel_tanque_acido.trigg_echo_pin = GPIO_PIN_LEVEL_SENSOR_TANQUE_ACIDO;
-    tanque_acido.height = 25;
 
     sensor_nivel_tanque_alcalino.trigg_echo_pin = GPIO_PIN_LEVEL_SENSOR_TANQUE_ALCALINO;
-    tanque_alcalino.height = 25;
 
     sensor_nivel_tanque_agua.trigg_echo_pin = GPIO_PIN_LEVEL_SENSOR_TANQUE_AGUA;
-    tanque_agua.height = 25;
 
     sensor_nivel_tanque_sustrato.trigg_echo_pin = GPIO_PIN_LEVEL_SENSOR_TANQUE_SUSTRATO;
-    tanque_sustrato.height = 25;
 
     ultrasonic_sensor_init(&sensor_nivel_tanque_principal);
     ultrasonic_sensor_init(&sensor_nivel_tanque_acido);
@@ -398,6 +617,38 @@ esp_err_t app_level_sensor_init(esp_mqtt_client_handle_t mqtt_client)
     ultrasonic_sensor_init(&sensor_nivel_tanque_agua);
     ultrasonic_sensor_init(&sensor_nivel_tanque_sustrato);
 
+    /**
+     *  Se inicializan los modelos geométricos de los 5 tanques, precalculando sus tablas de volumen.
+     */
+    for(int i = 0; i < NUMERO_TANQUES; i++)
+    {
+        ESP_RETURN_ON_ERROR(tank_model_init(level_tanks[i].tank, &level_tanks[i].tank_config), 
+                            app_level_sensor_tag, "Failed to init tank model.");
+    }
+
+    /**
+     *  Se habilitan para su medición los tanques configurados.
+     */
+    #ifdef DEBUG_SENSOR_NIVEL_TANQUE_PRINCIPAL
+    level_tanks[TANQUE_PRINCIPAL].enabled = 1;
+    #endif
+
+    #ifdef DEBUG_SENSOR_NIVEL_TANQUE_ACIDO
+    level_tanks[TANQUE_ACIDO].enabled = 1;
+    #endif
+
+    #ifdef DEBUG_SENSOR_NIVEL_TANQUE_ALCALINO
+    level_tanks[TANQUE_ALCALINO].enabled = 1;
+    #endif
+
+    #ifdef DEBUG_SENSOR_NIVEL_TANQUE_AGUA
+    level_tanks[TANQUE_AGUA].enabled = 1;
+    #endif
+
+    #ifdef DEBUG_SENSOR_NIVEL_TANQUE_SUSTRATO
+    level_tanks[TANQUE_SUSTRATO].enabled = 1;
+    #endif
+
 
     //=======================| CREACION TAREAS |=======================//
     
@@ -428,6 +679,53 @@ esp_err_t app_level_sensor_init(esp_mqtt_client_handle_t mqtt_client)
     #endif
 
 
+    //=======================| POLÍTICA DE PUBLICACIÓN |=======================//
+
+    /**
+     *  Se asigna la política de publicación por excepción de los niveles de los 5 tanques, para
+     *  no publicar valores que no variaron respecto del último publicado.
+     */
+    mqtt_telemetry_policy_t politica_publicacion = {
+        .abs_deadband = NIVEL_TANQUE_PUBLISH_DEADBAND,
+        .max_silence_ms = NIVEL_TANQUE_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    const char* topicos_nivel[] = {
+        SENSOR_NIVEL_TANQUE_PRINCIPAL_MQTT_TOPIC,
+        SENSOR_NIVEL_TANQUE_ACIDO_MQTT_TOPIC,
+        SENSOR_NIVEL_TANQUE_ALCALINO_MQTT_TOPIC,
+        SENSOR_NIVEL_TANQUE_AGUA_MQTT_TOPIC,
+        SENSOR_NIVEL_TANQUE_SUSTRATO_MQTT_TOPIC,
+    };
+
+    for(int i = 0; i < sizeof(topicos_nivel) / sizeof(topicos_nivel[0]); i++)
+    {
+        if(mqtt_set_telemetry_policy(topicos_nivel[i], &politica_publicacion) != ESP_OK)
+        {
+            ESP_LOGW(app_level_sensor_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
+        }
+    }
+
+    mqtt_telemetry_policy_t politica_publicacion_volumen = {
+        .abs_deadband = VOLUMEN_TANQUE_PUBLISH_DEADBAND,
+        .max_silence_ms = NIVEL_TANQUE_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    mqtt_telemetry_policy_t politica_publicacion_caudal = {
+        .abs_deadband = CAUDAL_TANQUE_PUBLISH_DEADBAND,
+        .max_silence_ms = NIVEL_TANQUE_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    for(int i = 0; i < NUMERO_TANQUES; i++)
+    {
+        if(mqtt_set_telemetry_policy(level_tanks[i].mqtt_volume_topic, &politica_publicacion_volumen) != ESP_OK ||
+            mqtt_set_telemetry_policy(level_tanks[i].mqtt_fill_rate_topic, &politica_publicacion_caudal) != ESP_OK)
+        {
+            ESP_LOGW(app_level_sensor_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
+        }
+    }
+
+
     //=======================| TÓPICOS MQTT |=======================//
 
     /**
@@ -442,14 +740,19 @@ esp_err_t app_level_sensor_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = TEST_LEVEL_TANQUE_PRINCIPAL_TOPIC,
         [0].topic_function_cb = CallbackGetLevelTanquePrincipal,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = TEST_LEVEL_TANQUE_ACIDO_TOPIC,
         [1].topic_function_cb = CallbackGetLevelTanqueAcido,
+        [1].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [2].topic_name = TEST_LEVEL_TANQUE_ALCALINO_TOPIC,
         [2].topic_function_cb = CallbackGetLevelTanqueAlcalino,
+        [2].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [3].topic_name = TEST_LEVEL_TANQUE_AGUA_TOPIC,
         [3].topic_function_cb = CallbackGetLevelTanqueAgua,
+        [3].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [4].topic_name = TEST_LEVEL_TANQUE_SUSTRATO_TOPIC,
         [4].topic_function_cb = CallbackGetLevelTanqueSustrato,
+        [4].value_type = MQTT_TOPIC_VALUE_FLOAT,
     };
 
     /**
@@ -569,4 +872,113 @@ bool app_level_sensor_error_sensor_detected(tanques_unidad_sec_t tanque)
     }
 
     return state;
+}
+
+
+
+/**
+ * @brief   Función para obtener las estadísticas de medición del sensor de nivel del tanque pasado como argumento.
+ * 
+ * @param tanque    Tanque del cual se quieren obtener las estadísticas.
+ * @param stats     Puntero a la estructura donde se copian las estadísticas.
+ * @return esp_err_t 
+ */
+esp_err_t app_level_sensor_get_stats(tanques_unidad_sec_t tanque, app_level_sensor_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(tanque < NUMERO_TANQUES && stats != NULL, ESP_ERR_INVALID_ARG, app_level_sensor_tag, "Invalid argument.");
+
+    portENTER_CRITICAL(&level_stats_mux);
+    *stats = level_tanks[tanque].stats;
+    portEXIT_CRITICAL(&level_stats_mux);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para obtener la duración del último barrido completo de los sensores de nivel, es decir,
+ *          el tiempo en el cual todos los tanques habilitados se midieron al menos una vez.
+ * 
+ * @return uint32_t     Duración del último barrido, en ms (0 si todavía no se completó ninguno).
+ */
+uint32_t app_level_sensor_get_sweep_time_ms(void)
+{
+    uint32_t sweep_time_ms;
+
+    portENTER_CRITICAL(&level_stats_mux);
+    sweep_time_ms = level_sweep_time_ms;
+    portEXIT_CRITICAL(&level_stats_mux);
+
+    return sweep_time_ms;
+}
+
+
+
+/**
+ * @brief   Función para obtener el volumen de líquido y el caudal de llenado del tanque pasado como argumento,
+ *          correspondientes a la última medición válida de su sensor de nivel.
+ * 
+ * @param tanque            Tanque del cual se quiere obtener el volumen.
+ * @param volume_l          Variable donde se guarda el volumen de líquido, en litros.
+ * @param fill_rate_l_min   Variable donde se guarda el caudal de llenado (negativo si se vacía), en L/min. Puede ser NULL.
+ * @return esp_err_t    ESP_ERR_INVALID_STATE si todavía no hay una medición válida del tanque.
+ */
+esp_err_t app_level_sensor_get_volume(tanques_unidad_sec_t tanque, float *volume_l, float *fill_rate_l_min)
+{
+    ESP_RETURN_ON_FALSE(tanque < NUMERO_TANQUES && volume_l != NULL, ESP_ERR_INVALID_ARG, app_level_sensor_tag, "Invalid argument.");
+
+    portENTER_CRITICAL(&level_stats_mux);
+    bool has_reading = level_tanks[tanque].has_reading;
+    tank_model_reading_t reading = level_tanks[tanque].reading;
+    portEXIT_CRITICAL(&level_stats_mux);
+
+    if(!has_reading)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *volume_l = reading.volume_l;
+
+    if(fill_rate_l_min != NULL)
+    {
+        *fill_rate_l_min = reading.fill_rate_l_min;
+    }
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para asignar una función callback que se ejecuta cada vez que cambia la bandera de nivel por
+ *          debajo del límite o de error de sensado de algún tanque.
+ * 
+ * @param callback  Función callback.
+ * @return esp_err_t 
+ */
+esp_err_t app_level_sensor_add_change_callback(AppLevelSensorChangeCallbackFunction callback)
+{
+    ESP_RETURN_ON_FALSE(callback != NULL, ESP_ERR_INVALID_ARG, app_level_sensor_tag, "Invalid argument.");
+
+    esp_err_t ret = ESP_OK;
+
+    portENTER_CRITICAL(&level_stats_mux);
+
+    if(level_change_callback_count < APP_LEVEL_SENSOR_MAX_CHANGE_CALLBACKS)
+    {
+        level_change_callbacks[level_change_callback_count] = callback;
+        level_change_callback_count++;
+    }
+
+    else
+    {
+        ret = ESP_ERR_NO_MEM;
+    }
+
+    portEXIT_CRITICAL(&level_stats_mux);
+
+    ESP_RETURN_ON_ERROR(ret, app_level_sensor_tag, "Too many change callbacks.");
+
+    return ESP_OK;
 }
\ No newline at end of file
@@ -13,6 +13,8 @@ extern "C" {
 
 /*==================================[INCLUDES]=============================================*/
 
+#include <stdint.h>
+
 /*============================[DEFINES AND MACROS]=====================================*/
 
 /**
@@ -24,6 +26,18 @@ extern "C" {
 #define SENSOR_NIVEL_TANQUE_AGUA_MQTT_TOPIC "Sensores de nivel/Tanque agua"
 #define SENSOR_NIVEL_TANQUE_SUSTRATO_MQTT_TOPIC "Sensores de nivel/Tanque sustrato"
 
+#define VOLUMEN_TANQUE_PRINCIPAL_MQTT_TOPIC "Sensores de nivel/Tanque principal/Volumen"
+#define VOLUMEN_TANQUE_ACIDO_MQTT_TOPIC "Sensores de nivel/Tanque acido/Volumen"
+#define VOLUMEN_TANQUE_ALCALINO_MQTT_TOPIC "Sensores de nivel/Tanque alcalino/Volumen"
+#define VOLUMEN_TANQUE_AGUA_MQTT_TOPIC "Sensores de nivel/Tanque agua/Volumen"
+#define VOLUMEN_TANQUE_SUSTRATO_MQTT_TOPIC "Sensores de nivel/Tanque sustrato/Volumen"
+
+#define CAUDAL_TANQUE_PRINCIPAL_MQTT_TOPIC "Sensores de nivel/Tanque principal/Caudal"
+#define CAUDAL_TANQUE_ACIDO_MQTT_TOPIC "Sensores de nivel/Tanque acido/Caudal"
+#define CAUDAL_TANQUE_ALCALINO_MQTT_TOPIC "Sensores de nivel/Tanque alcalino/Caudal"
+#define CAUDAL_TANQUE_AGUA_MQTT_TOPIC "Sensores de nivel/Tanque agua/Caudal"
+#define CAUDAL_TANQUE_SUSTRATO_MQTT_TOPIC "Sensores de nivel/Tanque sustrato/Caudal"
+
 #define TEST_LEVEL_TANQUE_PRINCIPAL_TOPIC "/Ensayo/SensorNivel/TanquePrincipal"
 #define TEST_LEVEL_TANQUE_ACIDO_TOPIC "/Ensayo/SensorNivel/TanqueAcido"
 #define TEST_LEVEL_TANQUE_ALCALINO_TOPIC "/Ensayo/SensorNivel/TanqueAlcalino"
@@ -37,6 +51,30 @@ extern "C" {
 #define GPIO_PIN_LEVEL_SENSOR_TANQUE_AGUA 27
 #define GPIO_PIN_LEVEL_SENSOR_TANQUE_SUSTRATO 26
 
+/**
+ *  Dimensiones de los tanques (cilíndricos), en cm: altura útil desde el fondo hasta el nivel de llenado máximo, distancia
+ *  desde el sensor hasta dicho nivel (zona muerta del sensor), y diámetro.
+ */
+#define NIVEL_TANQUE_PRINCIPAL_ALTURA_CM 25
+#define NIVEL_TANQUE_PRINCIPAL_OFFSET_SENSOR_CM 0
+#define NIVEL_TANQUE_PRINCIPAL_DIAMETRO_CM 30
+
+#define NIVEL_TANQUE_ACIDO_ALTURA_CM 25
+#define NIVEL_TANQUE_ACIDO_OFFSET_SENSOR_CM 0
+#define NIVEL_TANQUE_ACIDO_DIAMETRO_CM 12
+
+#define NIVEL_TANQUE_ALCALINO_ALTURA_CM 25
+#define NIVEL_TANQUE_ALCALINO_OFFSET_SENSOR_CM 0
+#define NIVEL_TANQUE_ALCALINO_DIAMETRO_CM 12
+
+#define NIVEL_TANQUE_AGUA_ALTURA_CM 25
+#define NIVEL_TANQUE_AGUA_OFFSET_SENSOR_CM 0
+#define NIVEL_TANQUE_AGUA_DIAMETRO_CM 20
+
+#define NIVEL_TANQUE_SUSTRATO_ALTURA_CM 25
+#define NIVEL_TANQUE_SUSTRATO_OFFSET_SENSOR_CM 0
+#define NIVEL_TANQUE_SUSTRATO_DIAMETRO_CM 12
+
 /**
  *  Definición del rango de nivel de líquido del tanque considerado como válido.
  */
@@ -46,6 +84,47 @@ extern "C" {
 /* Definición del valor límite en el cual si se está por debajo del mismo, se considera que debe rellenarse el tanque. */
 #define LIMITE_INFERIOR_ALARMA_NIVEL_TANQUE 0.3
 
+/**
+ *  Política de publicación de los niveles de los tanques: se publican al variar más que la banda
+ *  muerta respecto del último valor publicado, o cada cierto tiempo sin variación (heartbeat).
+ */
+#define NIVEL_TANQUE_PUBLISH_DEADBAND 0.01
+#define NIVEL_TANQUE_PUBLISH_MAX_SILENCE_MS 60000
+#define VOLUMEN_TANQUE_PUBLISH_DEADBAND 0.05
+#define CAUDAL_TANQUE_PUBLISH_DEADBAND 0.05
+
+/**
+ *  Período de medición del nivel de cada tanque, en ms. El tanque principal se mide más seguido que los
+ *  tanques de reactivos, cuyo nivel varía lentamente.
+ */
+#define NIVEL_TANQUE_PRINCIPAL_PERIODO_MS 1000
+#define NIVEL_TANQUE_ACIDO_PERIODO_MS 10000
+#define NIVEL_TANQUE_ALCALINO_PERIODO_MS 10000
+#define NIVEL_TANQUE_AGUA_PERIODO_MS 5000
+#define NIVEL_TANQUE_SUSTRATO_PERIODO_MS 10000
+
+/**
+ *  Grupo acústico de cada sensor de nivel. Los sensores de un mismo grupo pueden interferirse entre sí
+ *  (tanques contiguos), por lo que nunca se miden en simultáneo, y entre el fin de una medición y el inicio
+ *  de la siguiente del mismo grupo se respeta un tiempo de guarda, para que se atenúen los ecos. Los sensores
+ *  de distintos grupos se miden en simultáneo.
+ */
+#define NIVEL_TANQUE_PRINCIPAL_GRUPO_ACUSTICO 0
+#define NIVEL_TANQUE_ACIDO_GRUPO_ACUSTICO 1
+#define NIVEL_TANQUE_ALCALINO_GRUPO_ACUSTICO 1
+#define NIVEL_TANQUE_AGUA_GRUPO_ACUSTICO 2
+#define NIVEL_TANQUE_SUSTRATO_GRUPO_ACUSTICO 1
+
+#define NIVEL_TANQUE_GRUPOS_ACUSTICOS 3
+#define NIVEL_TANQUE_TIEMPO_GUARDA_MS 30
+
+/* Estadísticas de medición del sensor de nivel de un tanque. */
+typedef struct {
+    uint32_t measurements;      /* Cantidad de mediciones finalizadas (correctas o con error). */
+    uint32_t timeouts;          /* Cantidad de mediciones sin pulso de respuesta completo dentro del tiempo de espera. */
+    uint32_t last_echo_us;      /* Duración del último pulso de respuesta, tomada en la interrupción (0 si no llegó completo). */
+} app_level_sensor_stats_t;
+
 /* Enumeración para diferenciar los tanques de la unidad secundaria. */
 typedef enum{
     TANQUE_PRINCIPAL = 0,
@@ -55,6 +134,16 @@ typedef enum{
     TANQUE_SUSTRATO,
 } tanques_unidad_sec_t;
 
+/* Cantidad máxima de funciones callback de cambio de las banderas de los tanques. */
+#define APP_LEVEL_SENSOR_MAX_CHANGE_CALLBACKS 4
+
+/**
+ *  @brief  Puntero a función que será utilizado para ejecutar la función que se pase como callback cada vez
+ *          que cambia la bandera de nivel por debajo del límite o de error de sensado de un tanque. Recibe el
+ *          tanque cuyas banderas cambiaron.
+ */
+typedef void (*AppLevelSensorChangeCallbackFunction)(tanques_unidad_sec_t tanque);
+
 /*======================[EXTERNAL DATA DECLARATION]==============================*/
 
 /*=====================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
@@ -62,6 +151,10 @@ typedef enum{
 esp_err_t app_level_sensor_init(esp_mqtt_client_handle_t mqtt_client);
 bool app_level_sensor_level_below_limit(tanques_unidad_sec_t tanque);
 bool app_level_sensor_error_sensor_detected(tanques_unidad_sec_t tanque);
+esp_err_t app_level_sensor_get_stats(tanques_unidad_sec_t tanque, app_level_sensor_stats_t *stats);
+uint32_t app_level_sensor_get_sweep_time_ms(void);
+esp_err_t app_level_sensor_get_volume(tanques_unidad_sec_t tanque, float *volume_l, float *fill_rate_l_min);
+esp_err_t app_level_sensor_add_change_callback(AppLevelSensorChangeCallbackFunction callback);
 
 /*==================[END OF FILE]============================================*/
 #ifdef __cplusplus
@@ -77,24 +77,16 @@ static void vLightsTimerCallback( TimerHandle_t pxTimer )
          *  el sensor de luz ubicado en la unidad secundaria, se publica una alarma en el tópico común
          *  de alarmas via MQTT.
          */
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", ALARMA_FALLA_ILUMINACION);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", ALARMA_FALLA_ILUMINACION);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
     }
 
 
     /**
      *  Se publica en el tópico correspondiente el valor sensado por el sensor de luz.
      */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%i", light_trigger());
-        esp_mqtt_client_publish(Cliente_MQTT, LUZ_AMB_MQTT_TOPIC, buffer, 0, 0, 0);
-    }
+    mqtt_publish_telemetry(Cliente_MQTT, LUZ_AMB_MQTT_TOPIC, light_trigger(), 0);
 }
 
 
@@ -108,26 +100,22 @@ static void vLightsTimerCallback( TimerHandle_t pxTimer )
 static void CallbackNewLightState(void *pvParameters)
 {
     /**
-     *  Se obtiene el nuevo estado de las luces desde el tópico MQTT.
+     *  Se obtiene el nuevo estado de las luces desde el tópico MQTT, ya interpretado
+     *  al llegar el mensaje.
      */
-    char buffer[50];
-    mqtt_get_char_data_from_topic(LUZ_AMB_STATE_MQTT_TOPIC, buffer);
+    bool lights_state;
 
+    if(mqtt_get_topic_on_off((mqtt_topic_handle_t) pvParameters, &lights_state) != ESP_OK)
+    {
+        return;
+    }
 
     /**
      *  A partir del dato obtenido del tópico MQTT, que puede ser "ON" si las luces deberían 
      *  estar encendidas u "OFF" si deberían estar apagadas, se modifica el estado de la variable 
      *  interna que será luego comparado con el valor entregado por el sensor de luz.
      */
-    if(!strcmp("ON", buffer))
-    {
-        app_light_lights_state = 1;
-    }
-
-    else if(!strcmp("OFF", buffer))
-    {
-        app_light_lights_state = 0;
-    }
+    app_light_lights_state = lights_state;
 }
 
 
@@ -188,6 +176,23 @@ esp_err_t app_light_sensor_init(esp_mqtt_client_handle_t mqtt_client)
     xTimerStart(xTimerControlLuces, 0);
 
 
+    //=======================| POLÍTICA DE PUBLICACIÓN |=======================//
+
+    /**
+     *  Se asigna la política de publicación por excepción del estado de luminosidad, de forma de
+     *  publicarlo solo al cambiar o cada cierto tiempo como heartbeat.
+     */
+    mqtt_telemetry_policy_t politica_publicacion = {
+        .abs_deadband = 0.5,
+        .max_silence_ms = LUZ_AMB_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    if(mqtt_set_telemetry_policy(LUZ_AMB_MQTT_TOPIC, &politica_publicacion) != ESP_OK)
+    {
+        ESP_LOGW(app_light_sensor_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
+    }
+
+
     //=======================| TÓPICOS MQTT |=======================//
 
     /**
@@ -198,6 +203,7 @@ esp_err_t app_light_sensor_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = LUZ_AMB_STATE_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewLightState,
+        [0].value_type = MQTT_TOPIC_VALUE_ON_OFF,
     };
 
     /**
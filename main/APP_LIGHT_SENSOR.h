@@ -24,6 +24,9 @@ extern "C" {
 /* Definición del tiempo cada el cual se controla la iluminación, en ms. */
 #define TIEMPO_CONTROL_LUCES 5000
 
+/* Tiempo máximo sin publicar el estado de luminosidad si no cambia (heartbeat). */
+#define LUZ_AMB_PUBLISH_MAX_SILENCE_MS 60000
+
 /* Definición del pin GPIO al cual está conectado el sensor de luz. */
 #define GPIO_PIN_LIGHT_SENSOR 2
 
@@ -61,26 +61,12 @@ static void CallbackNewPumpOffTime(void *pvParameters);
  */
 static void vBombaTimerCallback( TimerHandle_t pxTimer )
 {
-    /**
-     *  Esta variable sirve para que, en el caso de que un llamado a "xTaskNotifyFromISR()" desbloquee
-     *  una tarea de mayor prioridad que la que estaba corriendo justo antes de entrar en la rutina
-     *  de interrupción, al retornar se haga un context switch a dicha tarea de mayor prioridad en vez
-     *  de a la de menor prioridad (xHigherPriorityTaskWoken = pdTRUE)
-     */
-    BaseType_t xHigherPriorityTaskWoken;
-    xHigherPriorityTaskWoken = pdFALSE;
-
     /**
      *  Se setea la bandera del timer para señalizarle a la MEF "MEFControlBombeoSoluc"
-     *  que se cumplió el tiempo de encendido o apagado de la bomba de solución.
+     *  que se cumplió el tiempo de encendido o apagado de la bomba de solución. La bandera
+     *  se envía en un evento a la tarea de la MEF.
      */
     mef_bombeo_set_timer_flag_value(1);
-
-    /**
-     *  Se le envía un Task Notify a la tarea de la MEF de control de bombeo de solución.
-     */
-    vTaskNotifyGiveFromISR(mef_bombeo_get_task_handle(), &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 
@@ -95,30 +81,21 @@ static void vBombaTimerCallback( TimerHandle_t pxTimer )
 static void CallbackManualMode(void *pvParameters)
 {
     /**
-     *  Se obtiene el mensaje del tópico de modo MANUAL o AUTO.
+     *  Se obtiene el modo (MANUAL o AUTO) del tópico, ya interpretado al llegar el mensaje.
      */
-    char buffer[10];
-    mqtt_get_char_data_from_topic(PUMP_MANUAL_MODE_MQTT_TOPIC, buffer);
+    mqtt_topic_mode_t modo;
 
-    /**
-     *  Dependiendo si el mensaje fue "MANUAL" o "AUTO", se setea o resetea
-     *  la bandera correspondiente para señalizarle a la MEF de control de
-     *  bombeo de solución que debe pasar al estado de modo MANUAL o AUTOMATICO.
-     */
-    if(!strcmp("MANUAL", buffer))
+    if(mqtt_get_topic_mode((mqtt_topic_handle_t) pvParameters, &modo) != ESP_OK)
     {
-        mef_bombeo_set_manual_mode_flag_value(1);
-    }
-
-    else if(!strcmp("AUTO", buffer))
-    {
-        mef_bombeo_set_manual_mode_flag_value(0);
+        return;
     }
 
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de bombeo de solución.
+     *  Dependiendo si el modo fue "MANUAL" o "AUTO", se setea o resetea
+     *  la bandera correspondiente para señalizarle a la MEF de control de
+     *  bombeo de solución que debe pasar al estado de modo MANUAL o AUTOMATICO.
      */
-    xTaskNotifyGive(mef_bombeo_get_task_handle());
+    mef_bombeo_set_manual_mode_flag_value(modo == MQTT_TOPIC_MODE_MANUAL);
 }
 
 
@@ -133,9 +110,9 @@ static void CallbackManualMode(void *pvParameters)
 static void CallbackManualModeNewActuatorState(void *pvParameters)
 {
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de bombeo de solución.
+     *  Se le avisa a la MEF que debe aplicar el nuevo estado pedido de la bomba.
      */
-    xTaskNotifyGive(mef_bombeo_get_task_handle());
+    mef_bombeo_notify_manual_mode_actuator_state();
 }
 
 
@@ -153,7 +130,7 @@ static void CallbackNewPumpOnTime(void *pvParameters)
      *  Se obtiene el nuevo valor de tiempo de encendido de la bomba.
      */
     pump_time_t tiempo_on_bomba = 0;
-    mqtt_get_float_data_from_topic(NEW_PUMP_ON_TIME_MQTT_TOPIC, &tiempo_on_bomba);
+    mqtt_get_topic_float((mqtt_topic_handle_t) pvParameters, &tiempo_on_bomba);
 
     ESP_LOGI(aux_control_bombeo_tag, "NUEVO TIEMPO ENCENDIDO BOMBA: %.0f", tiempo_on_bomba);
 
@@ -178,7 +155,7 @@ static void CallbackNewPumpOffTime(void *pvParameters)
      *  Se obtiene el nuevo valor de tiempo de apagado de la bomba.
      */
     pump_time_t tiempo_off_bomba = 0;
-    mqtt_get_float_data_from_topic(NEW_PUMP_OFF_TIME_MQTT_TOPIC, &tiempo_off_bomba);
+    mqtt_get_topic_float((mqtt_topic_handle_t) pvParameters, &tiempo_off_bomba);
 
     ESP_LOGI(aux_control_bombeo_tag, "NUEVO TIEMPO APAGADO BOMBA: %.0f", tiempo_off_bomba);
 
@@ -242,12 +219,16 @@ esp_err_t aux_control_bombeo_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = NEW_PUMP_ON_TIME_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewPumpOnTime,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = NEW_PUMP_OFF_TIME_MQTT_TOPIC,
         [1].topic_function_cb = CallbackNewPumpOffTime,
+        [1].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [2].topic_name = PUMP_MANUAL_MODE_MQTT_TOPIC,
         [2].topic_function_cb = CallbackManualMode,
+        [2].value_type = MQTT_TOPIC_VALUE_MODE,
         [3].topic_name = MANUAL_MODE_PUMP_STATE_MQTT_TOPIC,
         [3].topic_function_cb = CallbackManualModeNewActuatorState,
+        [3].value_type = MQTT_TOPIC_VALUE_ON_OFF,
     };
 
     /**
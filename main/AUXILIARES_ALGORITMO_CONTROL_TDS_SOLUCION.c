@@ -19,7 +19,6 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
 
 #include "MQTT_PUBL_SUSCR.h"
 #include "TDS_SENSOR.h"
@@ -39,14 +38,10 @@ static const char *aux_control_tds_tag = "AUXILIAR_CONTROL_TDS_SOLUCION";
 /* Handle del cliente MQTT. */
 static esp_mqtt_client_handle_t Cliente_MQTT = NULL;
 
-/* Handle del timer utilizado para control de apertura y cierre de las válvulas de control de TDS. */
-static TimerHandle_t xTimerValvulaTDS = NULL;
-
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
-static void vTimerCallback( TimerHandle_t pxTimer );
 static void CallbackManualMode(void *pvParameters);
 static void CallbackManualModeNewActuatorState(void *pvParameters);
 static void CallbackGetTdsData(void *pvParameters);
@@ -54,39 +49,6 @@ static void CallbackNewTdsSP(void *pvParameters);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
-/**
- * @brief   Función de callback del timer de control de apertura y cierre de las válvulas de aumento
- *          y disminución de TDS.
- * 
- * @param pxTimer   Handle del timer para el cual se cumplió el timeout.
- */
-static void vTimerCallback( TimerHandle_t pxTimer )
-{
-    /**
-     *  Esta variable sirve para que, en el caso de que un llamado a "xTaskNotifyFromISR()" desbloquee
-     *  una tarea de mayor prioridad que la que estaba corriendo justo antes de entrar en la rutina
-     *  de interrupción, al retornar se haga un context switch a dicha tarea de mayor prioridad en vez
-     *  de a la de menor prioridad (xHigherPriorityTaskWoken = pdTRUE)
-     */
-    BaseType_t xHigherPriorityTaskWoken;
-    xHigherPriorityTaskWoken = pdFALSE;
-
-    /**
-     *  Se setea la bandera del timer para señalizarle a la MEF "MEFControlAperturaValvulaTDS"
-     *  que se cumplió el tiempo de apertura o cierre de la válvula de control de TDS
-     *  correspondiente.
-     */
-    mef_tds_set_timer_flag_value(1);
-
-    /**
-     *  Se le envía un Task Notify a la tarea de la MEF de control de TDS.
-     */
-    vTaskNotifyGiveFromISR(mef_tds_get_task_handle(), &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-}
-
-
-
 /**
  * @brief   Función de callback que se ejecuta cuando llega un mensaje MQTT en el tópico
  *          correspondiente al modo MANUAL, para indicar si se quiere pasar a modo
@@ -97,30 +59,21 @@ static void vTimerCallback( TimerHandle_t pxTimer )
 static void CallbackManualMode(void *pvParameters)
 {
     /**
-     *  Se obtiene el mensaje del tópico de modo MANUAL o AUTO.
-     */
-    char buffer[10];
-    mqtt_get_char_data_from_topic(TDS_MANUAL_MODE_MQTT_TOPIC, buffer);
-
-    /**
-     *  Dependiendo si el mensaje fue "MANUAL" o "AUTO", se setea o resetea
-     *  la bandera correspondiente para señalizarle a la MEF de control de
-     *  TDS que debe pasar al estado de modo MANUAL o AUTOMATICO.
+     *  Se obtiene el modo (MANUAL o AUTO) del tópico, ya interpretado al llegar el mensaje.
      */
-    if(!strcmp("MANUAL", buffer))
-    {
-        mef_tds_set_manual_mode_flag_value(1);
-    }
+    mqtt_topic_mode_t modo;
 
-    else if(!strcmp("AUTO", buffer))
+    if(mqtt_get_topic_mode((mqtt_topic_handle_t) pvParameters, &modo) != ESP_OK)
     {
-        mef_tds_set_manual_mode_flag_value(0);
+        return;
     }
 
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de TDS.
+     *  Dependiendo si el modo fue "MANUAL" o "AUTO", se setea o resetea
+     *  la bandera correspondiente para señalizarle a la MEF de control de
+     *  TDS que debe pasar al estado de modo MANUAL o AUTOMATICO.
      */
-    xTaskNotifyGive(mef_tds_get_task_handle());
+    mef_tds_set_manual_mode_flag_value(modo == MQTT_TOPIC_MODE_MANUAL);
 }
 
 
@@ -136,9 +89,9 @@ static void CallbackManualMode(void *pvParameters)
 static void CallbackManualModeNewActuatorState(void *pvParameters)
 {
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de TDS.
+     *  Se le avisa a la MEF que debe aplicar el nuevo estado pedido de los actuadores.
      */
-    xTaskNotifyGive(mef_tds_get_task_handle());
+    mef_tds_notify_manual_mode_actuator_state();
 }
 
 
@@ -168,8 +121,16 @@ static void CallbackGetTdsData(void *pvParameters)
     
     #ifndef DEBUG_FORZAR_VALORES_SENSORES_ALGORITMO_CONTROL_TDS
     return_status = TDS_getValue(&soluc_tds);
+
+    /**
+     *  Si no había una medición de temperatura válida y reciente, el valor no está compensado por temperatura.
+     */
+    if(!TDS_sensor_is_temp_compensated())
+    {
+        ESP_LOGW(aux_control_tds_tag, "TDS SIN COMPENSACION DE TEMPERATURA");
+    }
     #else
-    mqtt_get_float_data_from_topic(TEST_TDS_VALUE_TOPIC, &soluc_tds);
+    mqtt_get_topic_float(mqtt_get_topic_handle(TEST_TDS_VALUE_TOPIC), &soluc_tds);
     #endif
 
     ESP_LOGI(aux_control_tds_tag, "VALOR TDS: %.3f", soluc_tds);
@@ -186,12 +147,9 @@ static void CallbackGetTdsData(void *pvParameters)
      */
     if(return_status == ESP_FAIL || soluc_tds < LIMITE_INFERIOR_RANGO_VALIDO_TDS || soluc_tds > LIMITE_SUPERIOR_RANGO_VALIDO_TDS)
     {
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_TDS);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_TDS);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         soluc_tds = CODIGO_ERROR_SENSOR_TDS;
         mef_tds_set_sensor_error_flag_value(1);
@@ -206,14 +164,9 @@ static void CallbackGetTdsData(void *pvParameters)
 
 
     /**
-     *  Si hay una conexión con el broker MQTT, se publica el valor de TDS sensado.
+     *  Se publica el valor de TDS sensado (si no hay conexión con el broker MQTT, queda pendiente).
      */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%.3f", soluc_tds);
-        esp_mqtt_client_publish(Cliente_MQTT, TDS_SOLUC_MQTT_TOPIC, buffer, 0, 0, 0);
-    }
+    mqtt_publish_telemetry(Cliente_MQTT, TDS_SOLUC_MQTT_TOPIC, soluc_tds, 3);
 
     mef_tds_set_tds_value(soluc_tds);
 }
@@ -232,7 +185,7 @@ static void CallbackNewTdsSP(void *pvParameters)
      *  Se obtiene el nuevo valor de SP de TDS.
      */
     TDS_sensor_ppm_t SP_tds_soluc = 0;
-    mqtt_get_float_data_from_topic(NEW_TDS_SP_MQTT_TOPIC, &SP_tds_soluc);
+    mqtt_get_topic_float((mqtt_topic_handle_t) pvParameters, &SP_tds_soluc);
 
     ESP_LOGI(aux_control_tds_tag, "NUEVO SP: %.3f", SP_tds_soluc);
 
@@ -299,30 +252,20 @@ esp_err_t aux_control_tds_init(esp_mqtt_client_handle_t mqtt_client)
     #endif
 
 
-    //=======================| INIT TIMERS |=======================//
+    //=======================| POLÍTICA DE PUBLICACIÓN |=======================//
 
     /**
-     *  Se inicializa el timer utilizado para el control de tiempo de apertura y cierre
-     *  de las válvulas de aumento y disminución del TDS de la solución.
-     * 
-     *  Se inicializa su período en 1 tick dado que no es relevante en su inicialización, ya que
-     *  el tiempo de apertura y cierre de la válvula se asignará en la MEF cuando corresponda, pero
-     *  no puede ponerse 0.
+     *  Se asigna la política de publicación por excepción del valor de TDS, para no publicar
+     *  valores que no variaron respecto del último publicado.
      */
-    xTimerValvulaTDS = xTimerCreate("Timer Valvulas Tds",       // Nombre interno que se le da al timer (no es relevante).
-                              1,                                // Período del timer en ticks.
-                              pdFALSE,                          // pdFALSE -> El timer NO se recarga solo al cumplirse el timeout. pdTRUE -> El timer se recarga solo al cumplirse el timeout.
-                              (void *)0,                        // ID de identificación del timer.
-                              vTimerCallback                    // Nombre de la función de callback del timer.
-    );
+    mqtt_telemetry_policy_t politica_publicacion = {
+        .rel_deadband = TDS_SOLUC_PUBLISH_REL_DEADBAND,
+        .max_silence_ms = TDS_SOLUC_PUBLISH_MAX_SILENCE_MS,
+    };
 
-    /**
-     *  Se verifica que se haya creado el timer correctamente.
-     */
-    if(xTimerValvulaTDS == NULL)
+    if(mqtt_set_telemetry_policy(TDS_SOLUC_MQTT_TOPIC, &politica_publicacion) != ESP_OK)
     {
-        ESP_LOGE(aux_control_tds_tag, "FAILED TO CREATE TIMER.");
-        return ESP_FAIL;
+        ESP_LOGW(aux_control_tds_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
     }
 
 
@@ -337,14 +280,19 @@ esp_err_t aux_control_tds_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = NEW_TDS_SP_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewTdsSP,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = TDS_MANUAL_MODE_MQTT_TOPIC,
         [1].topic_function_cb = CallbackManualMode,
+        [1].value_type = MQTT_TOPIC_VALUE_MODE,
         [2].topic_name = MANUAL_MODE_VALVULA_AUM_TDS_STATE_MQTT_TOPIC,
         [2].topic_function_cb = CallbackManualModeNewActuatorState,
+        [2].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [3].topic_name = MANUAL_MODE_VALVULA_DISM_TDS_STATE_MQTT_TOPIC,
         [3].topic_function_cb = CallbackManualModeNewActuatorState,
+        [3].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [4].topic_name = TEST_TDS_VALUE_TOPIC,
-        [4].topic_function_cb = CallbackGetTdsData
+        [4].topic_function_cb = CallbackGetTdsData,
+        [4].value_type = MQTT_TOPIC_VALUE_FLOAT
     };
 
     /**
@@ -360,12 +308,16 @@ esp_err_t aux_control_tds_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = NEW_TDS_SP_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewTdsSP,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = TDS_MANUAL_MODE_MQTT_TOPIC,
         [1].topic_function_cb = CallbackManualMode,
+        [1].value_type = MQTT_TOPIC_VALUE_MODE,
         [2].topic_name = MANUAL_MODE_VALVULA_AUM_TDS_STATE_MQTT_TOPIC,
         [2].topic_function_cb = CallbackManualModeNewActuatorState,
+        [2].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [3].topic_name = MANUAL_MODE_VALVULA_DISM_TDS_STATE_MQTT_TOPIC,
         [3].topic_function_cb = CallbackManualModeNewActuatorState,
+        [3].value_type = MQTT_TOPIC_VALUE_ON_OFF,
     };
 
     /**
@@ -380,17 +332,4 @@ esp_err_t aux_control_tds_init(esp_mqtt_client_handle_t mqtt_client)
     #endif
 
     return ESP_OK;
-}
-
-
-
-/**
- * @brief   Función que retorna el Handle del timer de control de tiempo de apertura
- *          y cierre de las válvulas de control de TDS.
- * 
- * @return TimerHandle_t    Handle del timer.
- */
-TimerHandle_t aux_control_tds_get_timer_handle(void)
-{
-    return xTimerValvulaTDS;
 }
\ No newline at end of file
@@ -16,7 +16,6 @@ extern "C" {
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
 #include "mqtt_client.h"
 #include "driver/adc.h"
 
@@ -42,6 +41,13 @@ extern "C" {
 /* Código de error que se carga en el valor de TDS al detectar un error de sensado. */
 #define CODIGO_ERROR_SENSOR_TDS -10
 
+/**
+ *  Política de publicación del valor de TDS: se publica al variar más que la banda muerta relativa
+ *  (fracción del último valor publicado), o cada cierto tiempo sin variación (heartbeat).
+ */
+#define TDS_SOLUC_PUBLISH_REL_DEADBAND 0.01
+#define TDS_SOLUC_PUBLISH_MAX_SILENCE_MS 60000
+
 /* Canal del ADC1 en el cual está conectado el sensor de TDS. */
 #define ADC1_CH_TDS_SENSOR ADC1_CHANNEL_3
 
@@ -50,7 +56,6 @@ extern "C" {
 /*=====================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
 
 esp_err_t aux_control_tds_init(esp_mqtt_client_handle_t mqtt_client);
-TimerHandle_t aux_control_tds_get_timer_handle(void);
 
 /*==================[END OF FILE]============================================*/
 #ifdef __cplusplus
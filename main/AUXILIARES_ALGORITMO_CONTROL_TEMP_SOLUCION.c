@@ -60,30 +60,21 @@ void CallbackNewTempSolucSP(void *pvParameters);
 void CallbackManualMode(void *pvParameters)
 {
     /**
-     *  Se obtiene el mensaje del tópico de modo MANUAL o AUTO.
+     *  Se obtiene el modo (MANUAL o AUTO) del tópico, ya interpretado al llegar el mensaje.
      */
-    char buffer[10];
-    mqtt_get_char_data_from_topic(TEMP_SOLUC_MANUAL_MODE_MQTT_TOPIC, buffer);
+    mqtt_topic_mode_t modo;
 
-    /**
-     *  Dependiendo si el mensaje fue "MANUAL" o "AUTO", se setea o resetea
-     *  la bandera correspondiente para señalizarle a la MEF de control de
-     *  TDS que debe pasar al estado de modo MANUAL o AUTOMATICO.
-     */
-    if(!strcmp("MANUAL", buffer))
-    {
-        mef_temp_soluc_set_manual_mode_flag_value(1);
-    }
-
-    else if(!strcmp("AUTO", buffer))
+    if(mqtt_get_topic_mode((mqtt_topic_handle_t) pvParameters, &modo) != ESP_OK)
     {
-        mef_temp_soluc_set_manual_mode_flag_value(0);
+        return;
     }
 
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de TDS.
+     *  Dependiendo si el modo fue "MANUAL" o "AUTO", se setea o resetea
+     *  la bandera correspondiente para señalizarle a la MEF de control de
+     *  TDS que debe pasar al estado de modo MANUAL o AUTOMATICO.
      */
-    xTaskNotifyGive(mef_temp_soluc_get_task_handle());
+    mef_temp_soluc_set_manual_mode_flag_value(modo == MQTT_TOPIC_MODE_MANUAL);
 }
 
 
@@ -100,9 +91,9 @@ void CallbackManualMode(void *pvParameters)
 void CallbackManualModeNewActuatorState(void *pvParameters)
 {
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de temperatura de solución.
+     *  Se le avisa a la MEF que debe aplicar el nuevo estado pedido de los actuadores.
      */
-    xTaskNotifyGive(mef_temp_soluc_get_task_handle());
+    mef_temp_soluc_notify_manual_mode_actuator_state();
 }
 
 
@@ -133,7 +124,7 @@ void CallbackGetTempSolucData(void *pvParameters)
     #ifndef DEBUG_FORZAR_VALORES_SENSORES_ALGORITMO_CONTROL_TEMP_SOLUC
     return_status = DS18B20_getTemp(&temp_soluc);
     #else
-    mqtt_get_float_data_from_topic(TEST_TEMP_SOLUC_VALUE_TOPIC, &temp_soluc);
+    mqtt_get_topic_float(mqtt_get_topic_handle(TEST_TEMP_SOLUC_VALUE_TOPIC), &temp_soluc);
     #endif
 
     ESP_LOGI(aux_control_temp_soluc_tag, "VALOR TEMP: %.3f", temp_soluc);
@@ -150,12 +141,9 @@ void CallbackGetTempSolucData(void *pvParameters)
      */
     if(return_status == ESP_FAIL || temp_soluc < LIMITE_INFERIOR_RANGO_VALIDO_TEMPERATURA_SOLUC || temp_soluc > LIMITE_SUPERIOR_RANGO_VALIDO_TEMPERATURA_SOLUC)
     {
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_DS18B20);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_DS18B20);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         temp_soluc = CODIGO_ERROR_SENSOR_TEMPERATURA_SOLUC;
         mef_temp_soluc_set_sensor_error_flag_value(1);
@@ -170,14 +158,9 @@ void CallbackGetTempSolucData(void *pvParameters)
 
 
     /**
-     *  Si hay una conexión con el broker MQTT, se publica el valor de temperatura sensado.
+     *  Se publica el valor de temperatura sensado (si no hay conexión con el broker MQTT, queda pendiente).
      */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%.3f", temp_soluc);
-        esp_mqtt_client_publish(Cliente_MQTT, TEMP_SOLUC_MQTT_TOPIC, buffer, 0, 0, 0);
-    }
+    mqtt_publish_telemetry(Cliente_MQTT, TEMP_SOLUC_MQTT_TOPIC, temp_soluc, 3);
 
     mef_temp_soluc_set_temp_soluc_value(temp_soluc);
 }
@@ -196,7 +179,7 @@ void CallbackNewTempSolucSP(void *pvParameters)
      *  Se obtiene el nuevo valor de SP de temperatura de solución.
      */
     DS18B20_sensor_temp_t SP_temp_soluc = 0;
-    mqtt_get_float_data_from_topic(NEW_TEMP_SP_MQTT_TOPIC, &SP_temp_soluc);
+    mqtt_get_topic_float((mqtt_topic_handle_t) pvParameters, &SP_temp_soluc);
 
     ESP_LOGI(aux_control_temp_soluc_tag, "NUEVO SP: %.3f", SP_temp_soluc);
 
@@ -262,6 +245,23 @@ esp_err_t aux_control_temp_soluc_init(esp_mqtt_client_handle_t mqtt_client)
     DS18B20_callback_function_on_new_measurment(CallbackGetTempSolucData);
     #endif
 
+    //=======================| POLÍTICA DE PUBLICACIÓN |=======================//
+
+    /**
+     *  Se asigna la política de publicación por excepción de la temperatura de la solución, para
+     *  no publicar valores que no variaron respecto del último publicado.
+     */
+    mqtt_telemetry_policy_t politica_publicacion = {
+        .abs_deadband = TEMP_SOLUC_PUBLISH_DEADBAND,
+        .max_silence_ms = TEMP_SOLUC_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    if(mqtt_set_telemetry_policy(TEMP_SOLUC_MQTT_TOPIC, &politica_publicacion) != ESP_OK)
+    {
+        ESP_LOGW(aux_control_temp_soluc_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
+    }
+
+
     //=======================| TÓPICOS MQTT |=======================//
 
     /**
@@ -273,14 +273,19 @@ esp_err_t aux_control_temp_soluc_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = NEW_TEMP_SP_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewTempSolucSP,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = TEMP_SOLUC_MANUAL_MODE_MQTT_TOPIC,
         [1].topic_function_cb = CallbackManualMode,
+        [1].value_type = MQTT_TOPIC_VALUE_MODE,
         [2].topic_name = MANUAL_MODE_REFRIGERADOR_STATE_MQTT_TOPIC,
         [2].topic_function_cb = CallbackManualModeNewActuatorState,
+        [2].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [3].topic_name = MANUAL_MODE_CALEFACTOR_STATE_MQTT_TOPIC,
         [3].topic_function_cb = CallbackManualModeNewActuatorState,
+        [3].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [4].topic_name = TEST_TEMP_SOLUC_VALUE_TOPIC,
-        [4].topic_function_cb = CallbackGetTempSolucData
+        [4].topic_function_cb = CallbackGetTempSolucData,
+        [4].value_type = MQTT_TOPIC_VALUE_FLOAT
     };
 
     /**
@@ -296,12 +301,16 @@ esp_err_t aux_control_temp_soluc_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = NEW_TEMP_SP_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewTempSolucSP,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = TEMP_SOLUC_MANUAL_MODE_MQTT_TOPIC,
         [1].topic_function_cb = CallbackManualMode,
+        [1].value_type = MQTT_TOPIC_VALUE_MODE,
         [2].topic_name = MANUAL_MODE_REFRIGERADOR_STATE_MQTT_TOPIC,
         [2].topic_function_cb = CallbackManualModeNewActuatorState,
+        [2].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [3].topic_name = MANUAL_MODE_CALEFACTOR_STATE_MQTT_TOPIC,
-        [3].topic_function_cb = CallbackManualModeNewActuatorState
+        [3].topic_function_cb = CallbackManualModeNewActuatorState,
+        [3].value_type = MQTT_TOPIC_VALUE_ON_OFF
     };
 
     /**
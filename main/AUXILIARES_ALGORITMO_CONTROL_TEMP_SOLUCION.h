@@ -42,6 +42,13 @@ extern "C" {
 /* Código de error que se carga en el valor de temperatura de la solución al detectar un error de sensado. */
 #define CODIGO_ERROR_SENSOR_TEMPERATURA_SOLUC -2
 
+/**
+ *  Política de publicación de la temperatura de la solución: se publica al variar más que la banda
+ *  muerta respecto del último valor publicado, o cada cierto tiempo sin variación (heartbeat).
+ */
+#define TEMP_SOLUC_PUBLISH_DEADBAND 0.1
+#define TEMP_SOLUC_PUBLISH_MAX_SILENCE_MS 60000
+
 /* Definición del pin GPIO al cual está conectado el sensor DS18B20. */
 #define GPIO_PIN_CO2_SENSOR 18
 
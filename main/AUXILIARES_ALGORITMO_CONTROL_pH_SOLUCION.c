@@ -13,16 +13,17 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "esp_log.h"
 #include "esp_err.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
 
 #include "MQTT_PUBL_SUSCR.h"
 #include "pH_SENSOR.h"
+#include "MCP23008.h"
 #include "ALARMAS_USUARIO.h"
 #include "MEF_ALGORITMO_CONTROL_pH_SOLUCION.h"
 #include "AUXILIARES_ALGORITMO_CONTROL_pH_SOLUCION.h"
@@ -39,54 +40,19 @@ static const char *aux_control_ph_tag = "AUXILIAR_CONTROL_PH_SOLUCION";
 /* Handle del cliente MQTT. */
 static esp_mqtt_client_handle_t Cliente_MQTT = NULL;
 
-/* Handle del timer utilizado para control de apertura y cierre de las válvulas de control de pH. */
-static TimerHandle_t xTimerValvulaPh = NULL;
-
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
-static void vPhTimerCallback( TimerHandle_t pxTimer );
 static void CallbackManualMode(void *pvParameters);
 static void CallbackManualModeNewActuatorState(void *pvParameters);
 static void CallbackGetPhData(void *pvParameters);
 static void CallbackNewPhSP(void *pvParameters);
+static void CallbackPhCalibration(void *pvParameters);
+static void CallbackPhTrigger(const MCP23008_pH_trigger_event_t *event);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
-/**
- * @brief   Función de callback del timer de control de apertura y cierre de las válvulas de aumento
- *          y disminución de pH.
- * 
- * @param pxTimer   Handle del timer para el cual se cumplió el timeout.
- */
-static void vPhTimerCallback( TimerHandle_t pxTimer )
-{
-    /**
-     *  Esta variable sirve para que, en el caso de que un llamado a "xTaskNotifyFromISR()" desbloquee
-     *  una tarea de mayor prioridad que la que estaba corriendo justo antes de entrar en la rutina
-     *  de interrupción, al retornar se haga un context switch a dicha tarea de mayor prioridad en vez
-     *  de a la de menor prioridad (xHigherPriorityTaskWoken = pdTRUE)
-     */
-    BaseType_t xHigherPriorityTaskWoken;
-    xHigherPriorityTaskWoken = pdFALSE;
-
-    /**
-     *  Se setea la bandera del timer para señalizarle a la MEF "MEFControlAperturaValvulaPh"
-     *  que se cumplió el tiempo de apertura o cierre de la válvula de control de pH
-     *  correspondiente.
-     */
-    mef_ph_set_timer_flag_value(1);
-
-    /**
-     *  Se le envía un Task Notify a la tarea de la MEF de control de pH.
-     */
-    vTaskNotifyGiveFromISR(mef_ph_get_task_handle(), &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-}
-
-
-
 /**
  * @brief   Función de callback que se ejecuta cuando llega un mensaje MQTT en el tópico
  *          correspondiente al modo MANUAL, para indicar si se quiere pasar a modo
@@ -97,30 +63,21 @@ static void vPhTimerCallback( TimerHandle_t pxTimer )
 static void CallbackManualMode(void *pvParameters)
 {
     /**
-     *  Se obtiene el mensaje del tópico de modo MANUAL o AUTO.
+     *  Se obtiene el modo (MANUAL o AUTO) del tópico, ya interpretado al llegar el mensaje.
      */
-    char buffer[10];
-    mqtt_get_char_data_from_topic(PH_MANUAL_MODE_MQTT_TOPIC, buffer);
+    mqtt_topic_mode_t modo;
 
-    /**
-     *  Dependiendo si el mensaje fue "MANUAL" o "AUTO", se setea o resetea
-     *  la bandera correspondiente para señalizarle a la MEF de control de
-     *  pH que debe pasar al estado de modo MANUAL o AUTOMATICO.
-     */
-    if(!strcmp("MANUAL", buffer))
+    if(mqtt_get_topic_mode((mqtt_topic_handle_t) pvParameters, &modo) != ESP_OK)
     {
-        mef_ph_set_manual_mode_flag_value(1);
-    }
-
-    else if(!strcmp("AUTO", buffer))
-    {
-        mef_ph_set_manual_mode_flag_value(0);
+        return;
     }
 
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de pH.
+     *  Dependiendo si el modo fue "MANUAL" o "AUTO", se setea o resetea
+     *  la bandera correspondiente para señalizarle a la MEF de control de
+     *  pH que debe pasar al estado de modo MANUAL o AUTOMATICO.
      */
-    xTaskNotifyGive(mef_ph_get_task_handle());
+    mef_ph_set_manual_mode_flag_value(modo == MQTT_TOPIC_MODE_MANUAL);
 }
 
 
@@ -136,9 +93,9 @@ static void CallbackManualMode(void *pvParameters)
 static void CallbackManualModeNewActuatorState(void *pvParameters)
 {
     /**
-     * Se le envía un Task Notify a la tarea de la MEF de control de pH.
+     *  Se le avisa a la MEF que debe aplicar el nuevo estado pedido de los actuadores.
      */
-    xTaskNotifyGive(mef_ph_get_task_handle());
+    mef_ph_notify_manual_mode_actuator_state();
 }
 
 
@@ -167,7 +124,7 @@ static void CallbackGetPhData(void *pvParameters)
     pH_sensor_ph_t soluc_pH;
 
     #ifdef DEBUG_FORZAR_VALORES_SENSORES_ALGORITMO_CONTROL_PH
-    mqtt_get_float_data_from_topic(TEST_PH_VALUE_TOPIC, &soluc_pH);
+    mqtt_get_topic_float(mqtt_get_topic_handle(TEST_PH_VALUE_TOPIC), &soluc_pH);
     #else
     return_status = pH_getValue(&soluc_pH);
     #endif
@@ -185,12 +142,9 @@ static void CallbackGetPhData(void *pvParameters)
      */
     if(return_status == ESP_FAIL || soluc_pH < LIMITE_INFERIOR_RANGO_VALIDO_PH || soluc_pH > LIMITE_SUPERIOR_RANGO_VALIDO_PH)
     {
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_PH);
-            esp_mqtt_client_publish(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
+        char buffer[10];
+        snprintf(buffer, sizeof(buffer), "%i", ALARMA_ERROR_SENSOR_PH);
+        mqtt_publish_data(Cliente_MQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
         soluc_pH = CODIGO_ERROR_SENSOR_PH;
         mef_ph_set_sensor_error_flag_value(1);
@@ -205,14 +159,9 @@ static void CallbackGetPhData(void *pvParameters)
 
 
     /**
-     *  Si hay una conexión con el broker MQTT, se publica el valor de pH sensado.
+     *  Se publica el valor de pH sensado (si no hay conexión con el broker MQTT, queda pendiente).
      */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%.3f", soluc_pH);
-        esp_mqtt_client_publish(Cliente_MQTT, PH_SOLUC_MQTT_TOPIC, buffer, 0, 0, 0);
-    }
+    mqtt_publish_telemetry(Cliente_MQTT, PH_SOLUC_MQTT_TOPIC, soluc_pH, 3);
 
     mef_ph_set_ph_value(soluc_pH);
 }
@@ -231,7 +180,7 @@ static void CallbackNewPhSP(void *pvParameters)
      *  Se obtiene el nuevo valor de SP de pH.
      */
     pH_sensor_ph_t SP_ph_soluc = 0;
-    mqtt_get_float_data_from_topic(NEW_PH_SP_MQTT_TOPIC, &SP_ph_soluc);
+    mqtt_get_topic_float((mqtt_topic_handle_t) pvParameters, &SP_ph_soluc);
 
     ESP_LOGI(aux_control_ph_tag, "NUEVO SP: %.3f", SP_ph_soluc);
 
@@ -261,8 +210,76 @@ static void CallbackNewPhSP(void *pvParameters)
     ESP_LOGI(aux_control_ph_tag, "LIMITE SUPERIOR: %.3f", limite_superior_ph_soluc);
 }
 
+
+
+
+/**
+ *  @brief  Función de callback que se ejecuta cuando llega un comando de calibración del sensor de pH.
+ *          Se publica el resultado del comando en el tópico de estado de la calibración.
+ * 
+ * @param pvParameters 
+ */
+static void CallbackPhCalibration(void *pvParameters)
+{
+    char comando[MQTT_TOPIC_DATA_MAX_LEN];
+    char buffer[MQTT_TOPIC_DATA_MAX_LEN + 8];
+    esp_err_t ret;
+
+    if(mqtt_get_char_data_from_handle((mqtt_topic_handle_t) pvParameters, comando) != ESP_OK)
+    {
+        return;
+    }
+
+    if(!strcmp(comando, "APLICAR"))
+    {
+        ret = pH_sensor_calibration_commit();
+    }
+
+    else if(!strcmp(comando, "BORRAR"))
+    {
+        ret = pH_sensor_calibration_clear();
+    }
+
+    else if(!strcmp(comando, "RESET"))
+    {
+        ret = pH_sensor_calibration_reset();
+    }
+
+    else
+    {
+        /**
+         *  Si no es un comando, se interpreta como el pH de la solución buffer del nuevo punto de calibración.
+         */
+        char *fin;
+        float buffer_pH = strtof(comando, &fin);
+
+        ret = (fin != comando) ? pH_sensor_calibration_add_point(buffer_pH) : ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(aux_control_ph_tag, "CALIBRACION pH \"%s\": %s", comando, esp_err_to_name(ret));
+
+    snprintf(buffer, sizeof(buffer), "%s: %s", comando, (ret == ESP_OK) ? "OK" : "ERROR");
+    mqtt_publish_data(Cliente_MQTT, PH_CALIBRATION_STATE_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
+}
+
 //==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
 
+/**
+ *  @brief  Función de callback que se ejecuta cuando cambia el estado del Trigger pH, a partir de la
+ *          interrupción del MCP23008.
+ * 
+ * @param event     Evento de cambio del Trigger pH, con el instante del flanco y la latencia medida.
+ */
+static void CallbackPhTrigger(const MCP23008_pH_trigger_event_t *event)
+{
+    /**
+     *  Se carga el evento en la MEF de control de pH, que se lo envía a la tarea del motor de control.
+     */
+    mef_ph_set_ph_trigger_event(event);
+}
+
+
+
 /**
  * @brief   Función para inicializar el módulo de funciones auxiliares del algoritmo de control de pH. 
  * 
@@ -298,30 +315,28 @@ esp_err_t aux_control_ph_init(esp_mqtt_client_handle_t mqtt_client)
     #endif
 
 
-    //=======================| INIT TIMERS |=======================//
+    //=======================| INIT TRIGGER PH |=======================//
 
     /**
-     *  Se inicializa el timer utilizado para el control de tiempo de apertura y cierre
-     *  de las válvulas de aumento y disminución del pH de la solución.
-     * 
-     *  Se inicializa su período en 1 tick dado que no es relevante en su inicialización, ya que
-     *  el tiempo de apertura y cierre de la válvula se asignará en la MEF cuando corresponda, pero
-     *  no puede ponerse 0.
+     *  Se asigna la función callback que será llamada al cambiar el estado del Trigger pH.
      */
-    xTimerValvulaPh = xTimerCreate("Timer Valvulas pH",       // Nombre interno que se le da al timer (no es relevante).
-                              1,                                // Período del timer en ticks.
-                              pdFALSE,                          // pdFALSE -> El timer NO se recarga solo al cumplirse el timeout. pdTRUE -> El timer se recarga solo al cumplirse el timeout.
-                              (void *)1,                        // ID de identificación del timer.
-                              vPhTimerCallback                    // Nombre de la función de callback del timer.
-    );
+    MCP23008_pH_trigger_callback_function_on_event(CallbackPhTrigger);
+
+
+    //=======================| POLÍTICA DE PUBLICACIÓN |=======================//
 
     /**
-     *  Se verifica que se haya creado el timer correctamente.
+     *  Se asigna la política de publicación por excepción del valor de pH, para no publicar
+     *  valores que no variaron respecto del último publicado.
      */
-    if(xTimerValvulaPh == NULL)
+    mqtt_telemetry_policy_t politica_publicacion = {
+        .abs_deadband = PH_SOLUC_PUBLISH_DEADBAND,
+        .max_silence_ms = PH_SOLUC_PUBLISH_MAX_SILENCE_MS,
+    };
+
+    if(mqtt_set_telemetry_policy(PH_SOLUC_MQTT_TOPIC, &politica_publicacion) != ESP_OK)
     {
-        ESP_LOGE(aux_control_ph_tag, "FAILED TO CREATE TIMER.");
-        return ESP_FAIL;
+        ESP_LOGW(aux_control_ph_tag, "FAILED TO SET MQTT PUBLISH POLICY.");
     }
 
 
@@ -336,20 +351,28 @@ esp_err_t aux_control_ph_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = NEW_PH_SP_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewPhSP,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = PH_MANUAL_MODE_MQTT_TOPIC,
         [1].topic_function_cb = CallbackManualMode,
+        [1].value_type = MQTT_TOPIC_VALUE_MODE,
         [2].topic_name = MANUAL_MODE_VALVULA_AUM_PH_STATE_MQTT_TOPIC,
         [2].topic_function_cb = CallbackManualModeNewActuatorState,
+        [2].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [3].topic_name = MANUAL_MODE_VALVULA_DISM_PH_STATE_MQTT_TOPIC,
         [3].topic_function_cb = CallbackManualModeNewActuatorState,
+        [3].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [4].topic_name = TEST_PH_VALUE_TOPIC,
         [4].topic_function_cb = CallbackGetPhData,
+        [4].value_type = MQTT_TOPIC_VALUE_FLOAT,
+        [5].topic_name = PH_CALIBRATION_MQTT_TOPIC,
+        [5].topic_function_cb = CallbackPhCalibration,
+        [5].value_type = MQTT_TOPIC_VALUE_RAW,
     };
 
     /**
      *  Se realiza la suscripción a los tópicos MQTT y la asignación de callbacks correspondientes.
      */
-    if(mqtt_suscribe_to_topics(list_of_topics, 5, Cliente_MQTT, 0) != ESP_OK)
+    if(mqtt_suscribe_to_topics(list_of_topics, 6, Cliente_MQTT, 0) != ESP_OK)
     {
         ESP_LOGE(aux_control_ph_tag, "FAILED TO SUSCRIBE TO MQTT TOPICS.");
         return ESP_FAIL;
@@ -359,18 +382,25 @@ esp_err_t aux_control_ph_init(esp_mqtt_client_handle_t mqtt_client)
     mqtt_topic_t list_of_topics[] = {
         [0].topic_name = NEW_PH_SP_MQTT_TOPIC,
         [0].topic_function_cb = CallbackNewPhSP,
+        [0].value_type = MQTT_TOPIC_VALUE_FLOAT,
         [1].topic_name = PH_MANUAL_MODE_MQTT_TOPIC,
         [1].topic_function_cb = CallbackManualMode,
+        [1].value_type = MQTT_TOPIC_VALUE_MODE,
         [2].topic_name = MANUAL_MODE_VALVULA_AUM_PH_STATE_MQTT_TOPIC,
         [2].topic_function_cb = CallbackManualModeNewActuatorState,
+        [2].value_type = MQTT_TOPIC_VALUE_ON_OFF,
         [3].topic_name = MANUAL_MODE_VALVULA_DISM_PH_STATE_MQTT_TOPIC,
         [3].topic_function_cb = CallbackManualModeNewActuatorState,
+        [3].value_type = MQTT_TOPIC_VALUE_ON_OFF,
+        [4].topic_name = PH_CALIBRATION_MQTT_TOPIC,
+        [4].topic_function_cb = CallbackPhCalibration,
+        [4].value_type = MQTT_TOPIC_VALUE_RAW,
     };
 
     /**
      *  Se realiza la suscripción a los tópicos MQTT y la asignación de callbacks correspondientes.
      */
-    if(mqtt_suscribe_to_topics(list_of_topics, 4, Cliente_MQTT, 0) != ESP_OK)
+    if(mqtt_suscribe_to_topics(list_of_topics, 5, Cliente_MQTT, 0) != ESP_OK)
     {
         ESP_LOGE(aux_control_ph_tag, "FAILED TO SUSCRIBE TO MQTT TOPICS.");
         return ESP_FAIL;
@@ -378,17 +408,4 @@ esp_err_t aux_control_ph_init(esp_mqtt_client_handle_t mqtt_client)
     #endif
 
     return ESP_OK;
-}
-
-
-
-/**
- * @brief   Función que retorna el Handle del timer de control de tiempo de apertura
- *          y cierre de las válvulas de control de pH.
- * 
- * @return TimerHandle_t    Handle del timer.
- */
-TimerHandle_t aux_control_ph_get_timer_handle(void)
-{
-    return xTimerValvulaPh;
 }
\ No newline at end of file
@@ -16,7 +16,6 @@ extern "C" {
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/timers.h"
 #include "mqtt_client.h"
 #include "driver/adc.h"
 
@@ -37,6 +36,15 @@ extern "C" {
 
 #define TEST_PH_VALUE_TOPIC   "/Ensayo/pH"
 
+/**
+ *  Tópico de comandos de calibración del sensor de pH, y tópico donde se publica el resultado de cada comando.
+ *  Comandos: pH de la solución buffer en la que está el transductor (por ejemplo "4", "7" o "10") para cargar
+ *  un punto, "APLICAR" para aplicar y guardar los puntos cargados, "BORRAR" para descartarlos, y "RESET" para
+ *  volver a la calibración por defecto.
+ */
+#define PH_CALIBRATION_MQTT_TOPIC   "/PhSoluc/Calibracion"
+#define PH_CALIBRATION_STATE_MQTT_TOPIC   "/PhSoluc/Calibracion/Estado"
+
 /**
  *  Definición del rango de pH de la solución considerado como válido.
  */
@@ -46,6 +54,13 @@ extern "C" {
 /* Código de error que se carga en el valor de pH al detectar un error de sensado. */
 #define CODIGO_ERROR_SENSOR_PH -2
 
+/**
+ *  Política de publicación del valor de pH: se publica al variar más que la banda muerta
+ *  respecto del último valor publicado, o cada cierto tiempo sin variación (heartbeat).
+ */
+#define PH_SOLUC_PUBLISH_DEADBAND 0.02
+#define PH_SOLUC_PUBLISH_MAX_SILENCE_MS 60000
+
 /* Canal del ADC1 en el cual está conectado el sensor de pH. */
 #define ADC1_CH_PH_SENSOR ADC1_CHANNEL_0
 
@@ -54,7 +69,6 @@ extern "C" {
 /*=====================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
 
 esp_err_t aux_control_ph_init(esp_mqtt_client_handle_t mqtt_client);
-TimerHandle_t aux_control_ph_get_timer_handle(void);
 
 /*==================[END OF FILE]============================================*/
 #ifdef __cplusplus
@@ -1,8 +1,10 @@
 /**
  * @file CO2_SENSOR.c
  * @author Franco Bisciglia, David Kündinger
- * @brief   Librería mediante la cual se obtienen datos del sensor MH-Z19C de CO2. Dichos datos consisten en pulsos PWM, cuyo ancho
- *          varía de forma directamente proporcional a la concentración de CO2 en el ambiente.
+ * @brief   Librería mediante la cual se obtienen datos del sensor MH-Z19C de CO2, ya sea a partir de su salida PWM, cuyo ancho
+ *          de pulso varía de forma directamente proporcional a la concentración de CO2 en el ambiente, o mediante comandos por UART.
+ *          Los flancos del PWM se marcan temporalmente en la rutina de interrupción, por lo que la medición no depende de la
+ *          latencia del planificador. Por UART, cada pedido espera su respuesta con la cola de eventos del driver.
  * @version 0.1
  * @date 2022-12-29
  * 
@@ -15,11 +17,17 @@
 //==================================| INCLUDES |==================================//
 
 #include <stdio.h>
+#include <inttypes.h>
 
 #include "driver/gpio.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "driver/uart.h"
+#include "mhz19b.h"
 
 #include <esp_timer.h>
 #include "esp_err.h"
@@ -37,6 +45,40 @@
  */
 #define warm_up_expired(start, len) ((esp_timer_get_time() - (start)) >= (len * 1000000))
 
+/* Cantidad de flancos que puede guardar la rutina de interrupción hasta que la tarea los procese (potencia de 2). */
+#define CO2_SENSOR_EDGE_RING_LEN 16
+
+/* Tiempo máximo de espera de un flanco del PWM antes de considerar un error de timeout (período nominal de 1004 ms). */
+#define CO2_SENSOR_EDGE_TIMEOUT_MS 1060
+
+/* Rango válido del período del PWM (1004 ms +-5 %), en us. */
+#define CO2_SENSOR_PERIOD_MIN_US 953000
+#define CO2_SENSOR_PERIOD_MAX_US 1055000
+
+/* Período de lectura del sensor por UART (intervalo mínimo entre lecturas del sensor), en ms. */
+#define CO2_SENSOR_UART_PERIOD_MS MHZ19B_READ_INTERVAL_MS
+
+/* Tiempo máximo de espera de la respuesta a un comando por UART, en ms. */
+#define CO2_SENSOR_UART_TIMEOUT_MS MHZ19B_SERIAL_RX_TIMEOUT_MS
+
+/* Tamaño de la cola de eventos del driver de UART. */
+#define CO2_SENSOR_UART_QUEUE_LEN 10
+
+/* Flanco del PWM marcado temporalmente por la rutina de interrupción. */
+typedef struct {
+    int64_t time_us;        /* Instante del flanco. */
+    bool level;             /* Nivel del pin luego del flanco (1: flanco ascendente). */
+} co2_sensor_edge_t;
+
+/**
+ *  Estado de la decodificación del PWM: instantes del último flanco ascendente y del último flanco descendente
+ *  posterior a él. Cada ciclo completo (ascendente, descendente, ascendente) da una medición.
+ */
+typedef struct {
+    int64_t rise_us;        /* Instante del último flanco ascendente (0 si no hay). */
+    int64_t fall_us;        /* Instante del flanco descendente posterior a "rise_us" (0 si no hay). */
+} co2_sensor_decoder_t;
+
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 /* Tag para imprimir información en el LOG. */
@@ -51,11 +93,30 @@ static TaskHandle_t xCO2TaskHandle = NULL;
 /* Puntero a función que apuntará a la función callback pasada como argumento en la función de configuración de callback. */
 CO2SensorCallbackFunction CO2SensorCallback = NULL;
 
-/* Bandera para verificar si se obtuvo un pulso de PWM desde el sensor de CO2 */
-static bool CO2_interr_flag = 0;
+/* Interfaz en uso para obtener los datos del sensor. */
+static CO2_sensor_backend_t CO2_backend = CO2_SENSOR_BACKEND_PWM;
+
+/* Puerto UART del sensor, cola de eventos del driver, y mutex para que los comandos no se superpongan. */
+static uart_port_t CO2_uart_port;
+static QueueHandle_t CO2_uart_queue = NULL;
+static SemaphoreHandle_t xCO2UartMutex = NULL;
+
+/**
+ *  Buffer circular de flancos: la rutina de interrupción escribe en "head" y la tarea lee desde "tail". Si el buffer
+ *  se llena se descartan los flancos nuevos y se señaliza, para reiniciar la decodificación.
+ */
+static co2_sensor_edge_t CO2_edge_ring[CO2_SENSOR_EDGE_RING_LEN];
+static volatile uint32_t CO2_edge_head = 0;
+static volatile uint32_t CO2_edge_tail = 0;
+static volatile bool CO2_edge_overflow = 0;
 
 /* Variable en donde se guarda el valor de CO2 obtenido por PWM. */
-static unsigned long CO2_ppm_pwm = 0;
+static CO2_sensor_ppm_t CO2_ppm_pwm = CO2_SENSOR_MEASURE_ERROR;
+
+/* Últimas mediciones válidas, para el promedio de CO2_SENSOR_AVERAGE_CYCLES ciclos. */
+static CO2_sensor_ppm_t CO2_ppm_history[CO2_SENSOR_AVERAGE_CYCLES];
+static int CO2_ppm_history_idx = 0;
+static int CO2_ppm_history_count = 0;
 
 /* Variable utilizada para controlar el tiempo de calentamiento del sensor de CO2. */
 int64_t CO2_warm_up_time_start = 0;
@@ -65,223 +126,222 @@ int64_t CO2_warm_up_time_start = 0;
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
 static void vTaskGetCO2ByPWM(void *pvParameters);
-static void co2_sensor_isr_handler(void *args);
+static void vTaskGetCO2ByUART(void *pvParameters);
+static void IRAM_ATTR co2_sensor_isr_handler(void *args);
+static esp_err_t co2_sensor_pwm_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin);
+static esp_err_t co2_sensor_uart_init(const CO2_sensor_config_t *CO2_sens_config);
+static esp_err_t co2_sensor_uart_command(uint8_t cmd, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7, uint8_t *response);
+static bool co2_sensor_decode_edge(co2_sensor_decoder_t *decoder, const co2_sensor_edge_t *edge, int64_t *th_us, int64_t *period_us);
+static void co2_sensor_new_measurement(CO2_sensor_ppm_t ppm);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
- * @brief   Rutina de servicio de interrupción de GPIO, mediante la cual se controla la lectura de flancos
- *          del pulso de PWM del sensor de CO2.
+ * @brief   Rutina de servicio de interrupción de GPIO, por ambos flancos del pulso de PWM del sensor de CO2.
+ *          Se guarda el instante y el tipo de flanco en el buffer circular, y se notifica a la tarea.
  * 
  * @param args  Parámetros pasados a la rutina de servicios de interrupción de GPIO.
  */
-static void co2_sensor_isr_handler(void *args)
+static void IRAM_ATTR co2_sensor_isr_handler(void *args)
 {
-    /**
-     *  Esta variable sirve para que, en el caso de que un llamado a "xTaskNotifyFromISR()" desbloquee
-     *  una tarea de mayor prioridad que la que estaba corriendo justo antes de entrar en la rutina
-     *  de interrupción, al retornar se haga un context switch a dicha tarea de mayor prioridad en vez
-     *  de a la de menor prioridad (xHigherPriorityTaskWoken = pdTRUE)
-     */
-    BaseType_t xHigherPriorityTaskWoken;
-    xHigherPriorityTaskWoken = pdFALSE;
+    int64_t now_us = esp_timer_get_time();
+    uint32_t head = CO2_edge_head;
 
-    /**
-     *  Enviamos un Task Notify a la tarea de obtención de nivel de CO2, para que continúe con su
-     *  rutina de conversión. Además, seteamos la bandera para que dicha tarea pueda saber que 
-     *  efectivamente ocurrió la interrupción y no hubo timeout.
-     */
-    vTaskNotifyGiveFromISR(xCO2TaskHandle, &xHigherPriorityTaskWoken);
-    CO2_interr_flag = 1;
+    if(head - CO2_edge_tail >= CO2_SENSOR_EDGE_RING_LEN)
+    {
+        CO2_edge_overflow = 1;
+    }
+
+    else
+    {
+        CO2_edge_ring[head % CO2_SENSOR_EDGE_RING_LEN].time_us = now_us;
+        CO2_edge_ring[head % CO2_SENSOR_EDGE_RING_LEN].level = gpio_get_level(CO2_SENSOR_PWM_PIN);
+        CO2_edge_head = head + 1;
+    }
 
     /**
-     *  Devolvemos el procesador a la tarea que corresponda. En el caso de que xHigherPriorityTaskWoken = pdTRUE,
-     *  implica que se debe realizar un context switch a la tarea de mayor prioridad que fue desbloqueada.
+     *  Enviamos un Task Notify a la tarea de obtención de nivel de CO2, para que procese los flancos.
+     *  En el caso de que se desbloquee una tarea de mayor prioridad que la que estaba corriendo, al
+     *  retornar se realiza un context switch a dicha tarea (xHigherPriorityTaskWoken = pdTRUE).
      */
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    vTaskNotifyGiveFromISR(xCO2TaskHandle, &xHigherPriorityTaskWoken);
     portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-
 }
 
 
+
 /**
- * @brief   Tarea encargada de obtener una medición de CO2 en ppm del sensor de CO2.
+ * @brief   Función que procesa un flanco del PWM. Al completarse un ciclo (ascendente, descendente, ascendente)
+ *          se devuelven el tiempo en alto y el período del ciclo.
  * 
- * @param pvParameters  Parámetros pasados a la tarea en su creación.
+ * @param decoder       Estado de la decodificación.
+ * @param edge          Flanco a procesar.
+ * @param th_us         Variable donde se guarda el tiempo en alto del ciclo, en us.
+ * @param period_us     Variable donde se guarda el período del ciclo, en us.
+ * @return true     Se completó un ciclo.
+ * @return false    No se completó un ciclo.
  */
-static void vTaskGetCO2ByPWM(void *pvParameters)
+static bool co2_sensor_decode_edge(co2_sensor_decoder_t *decoder, const co2_sensor_edge_t *edge, int64_t *th_us, int64_t *period_us)
 {
-    while(1)
-    {
-        CO2_interr_flag = 0;
-
-        //========================| MEDICIÓN PULSO EN ALTO |===========================//
+    bool cycle_done = 0;
 
-        /**
-         *  Se configura la interrupción por flanco ascendente en el pin correspondiente
-         *  al PWM del sensor de CO2, de modo de detectar el inicio del pulso en alto
-         *  de la señal PWM.
-         */
-        gpio_set_intr_type(CO2_SENSOR_PWM_PIN, GPIO_INTR_POSEDGE);
-        gpio_intr_enable(CO2_SENSOR_PWM_PIN);
-
-
-        /**
-         *  Se espera a recibir un Task Notify desde la rutina de interrupción. En caso
-         *  de que se cumpla el tiempo de timeout, se procede a lanzar un mensaje de
-         *  error de timeout, se saltea el proceso hasta el final (error_tag), donde
-         *  se ejecuta la función de callback, y se le carga al valor de CO2 el código 
-         *  de error definido.
-         */
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1060));
-        
-        if(!CO2_interr_flag)
+    if(edge->level)
+    {
+        if(decoder->rise_us != 0 && decoder->fall_us != 0)
         {
-            CO2_ppm_pwm = CO2_SENSOR_MEASURE_ERROR;
-            ESP_LOGE(TAG, "TIMEOUT ERROR: Didn't get any high pulse PWM signal.");
-            goto error_tag;
+            *th_us = decoder->fall_us - decoder->rise_us;
+            *period_us = edge->time_us - decoder->rise_us;
+            cycle_done = 1;
         }
 
-        CO2_interr_flag = 0;
+        decoder->rise_us = edge->time_us;
+        decoder->fall_us = 0;
+    }
 
+    else if(decoder->rise_us != 0)
+    {
+        decoder->fall_us = edge->time_us;
+    }
 
-        /**
-         *  Se crea una variable donde se guardará el tiempo actual que lleva corriendo
-         *  el programa, para luego medir el ancho del pulso en alto como diferencia de 
-         *  tiempos.
-         */
-        int64_t high_time_start;
-        high_time_start = esp_timer_get_time();
+    return cycle_done;
+}
 
 
-        /**
-         *  Se configura la interrupción por flanco descendente en el pin correspondiente
-         *  al PWM del sensor de CO2, de modo de detectar el fin del pulso en alto
-         *  de la señal PWM.
-         */
-        gpio_set_intr_type(CO2_SENSOR_PWM_PIN, GPIO_INTR_NEGEDGE);
 
+/**
+ * @brief   Función que guarda una nueva medición de CO2 (o el código de error), promediando las últimas
+ *          CO2_SENSOR_AVERAGE_CYCLES mediciones válidas, y ejecuta la función callback configurada.
+ * 
+ * @param ppm   Concentración de CO2 del último ciclo, o CO2_SENSOR_MEASURE_ERROR.
+ */
+static void co2_sensor_new_measurement(CO2_sensor_ppm_t ppm)
+{
+    if(ppm == CO2_SENSOR_MEASURE_ERROR)
+    {
+        CO2_ppm_history_count = 0;
+        CO2_ppm_pwm = CO2_SENSOR_MEASURE_ERROR;
+    }
 
-       /**
-         *  Se espera a recibir un Task Notify desde la rutina de interrupción. En caso
-         *  de que se cumpla el tiempo de timeout, se procede a lanzar un mensaje de
-         *  error de timeout, se saltea el proceso hasta el final (error_tag), donde
-         *  se ejecuta la función de callback, y se le carga al valor de CO2 el código 
-         *  de error definido.
-         */
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1060));
+    else
+    {
+        CO2_ppm_history[CO2_ppm_history_idx] = ppm;
+        CO2_ppm_history_idx = (CO2_ppm_history_idx + 1) % CO2_SENSOR_AVERAGE_CYCLES;
 
-        if(!CO2_interr_flag)
+        if(CO2_ppm_history_count < CO2_SENSOR_AVERAGE_CYCLES)
         {
-            CO2_ppm_pwm = CO2_SENSOR_MEASURE_ERROR;
-            ESP_LOGE(TAG, "TIMEOUT ERROR: Didn't get any high pulse PWM signal.");
-            goto error_tag;
+            CO2_ppm_history_count++;
         }
 
-        CO2_interr_flag = 0;
-
-
-        /**
-         *  Variable correspondiente al tiempo en alto del pulso PWM del sensor
-         *  de CO2.
-         */
-        int64_t th = 0;
-        th = esp_timer_get_time() - high_time_start;
-
-        
-
-        //========================| MEDICIÓN PULSO EN BAJO |===========================//
-
-        /**
-         *  Se crea una variable donde se guardará el tiempo actual que lleva corriendo
-         *  el programa, para luego medir el ancho del pulso en bajo como diferencia de 
-         *  tiempos.
-         */
-        int64_t low_time_start;
-        low_time_start = esp_timer_get_time();
-        
-        /**
-         *  Se configura la interrupción por flanco descendente en el pin correspondiente
-         *  al PWM del sensor de CO2, de modo de detectar el fin del pulso en alto
-         *  de la señal PWM.
-         */
-        gpio_set_intr_type(CO2_SENSOR_PWM_PIN, GPIO_INTR_POSEDGE);
-
+        CO2_sensor_ppm_t sum = 0;
 
-        /**
-         *  Se espera a recibir un Task Notify desde la rutina de interrupción. En caso
-         *  de que se cumpla el tiempo de timeout, se procede a lanzar un mensaje de
-         *  error de timeout, se saltea el proceso hasta el final (error_tag), donde
-         *  se ejecuta la función de callback, y se le carga al valor de CO2 el código 
-         *  de error definido.
-         */
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1060));
-
-        if(!CO2_interr_flag)
+        for(int i = 0; i < CO2_ppm_history_count; i++)
         {
-            CO2_ppm_pwm = CO2_SENSOR_MEASURE_ERROR;
-            ESP_LOGE(TAG, "TIMEOUT ERROR: Didn't get any low pulse PWM signal.");
-            goto error_tag;
+            sum += CO2_ppm_history[i];
         }
 
-        CO2_interr_flag = 0;
+        CO2_ppm_pwm = sum / CO2_ppm_history_count;
+    }
 
+    /**
+     *  Se ejecuta la función callback configurada, verificando anteriormente que ya
+     *  haya pasado el tiempo de calentamiento del sensor.
+     */
+    if(CO2SensorCallback != NULL && !CO2_sensor_is_warming_up())
+    {
+        CO2SensorCallback(NULL);
+    }
+}
 
-        /**
-         *  Variable correspondiente al tiempo en bajo del pulso PWM del sensor
-         *  de CO2.
-         */
-        int64_t tl = 0;
-        tl = esp_timer_get_time() - low_time_start;
 
 
+/**
+ * @brief   Tarea encargada de obtener una medición de CO2 en ppm del sensor de CO2 por cada ciclo del PWM, a partir
+ *          de los flancos marcados temporalmente por la rutina de interrupción.
+ * 
+ * @param pvParameters  Parámetros pasados a la tarea en su creación.
+ */
+static void vTaskGetCO2ByPWM(void *pvParameters)
+{
+    co2_sensor_decoder_t decoder = {0};
 
-        //========================| OBTENCIÓN DE VALOR DE CO2 |===========================//
+    /**
+     *  Se habilita la interrupción recién con el handle de la tarea cargado, ya que la rutina de
+     *  interrupción lo utiliza para notificarla.
+     */
+    xCO2TaskHandle = xTaskGetCurrentTaskHandle();
+    gpio_intr_enable(CO2_SENSOR_PWM_PIN);
 
+    while(1)
+    {
         /**
-         *  A partir de los tiempos en alto y en bajo del pulso PWM, se obtiene el valor
-         *  de CO2 en ppm.
+         *  Se espera a recibir un Task Notify desde la rutina de interrupción. En caso de que se cumpla
+         *  el tiempo de timeout sin ningún flanco, se carga al valor de CO2 el código de error definido,
+         *  y se reinicia la decodificación.
          */
-        CO2_ppm_pwm = 5000 * (th - 2) / (th + tl - 4);
+        if(ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CO2_SENSOR_EDGE_TIMEOUT_MS)) == 0)
+        {
+            ESP_LOGE(TAG, "TIMEOUT ERROR: Didn't get any PWM signal edge.");
+            decoder.rise_us = 0;
+            co2_sensor_new_measurement(CO2_SENSOR_MEASURE_ERROR);
+            continue;
+        }
 
-        
         /**
-         *  Etiqueta que se utiliza como forma de retorno de ejecución parcial de la rutina,
-         *  es decir, para casos en los que, por ejemplo, se cumplió el timeout de espera
-         *  de la respuesta del sensor, y por lo tanto no se debe continuar con la ejecución
-         *  de la rutina, sino que se debe volver a comenzar.
+         *  Si se desbordó el buffer de flancos, se descartan los pendientes y se reinicia la decodificación.
          */
-        error_tag: ;
+        if(CO2_edge_overflow)
+        {
+            ESP_LOGW(TAG, "PWM edge buffer overflow.");
+            decoder.rise_us = 0;
+            CO2_edge_tail = CO2_edge_head;
+            CO2_edge_overflow = 0;
+            continue;
+        }
 
+        //========================| OBTENCIÓN DE VALOR DE CO2 |===========================//
 
-        /**
-         *  Se ejecuta la función callback configurada, verificando anteriormente que ya
-         *  haya pasado el tiempo de calentamiento del sensor.
-         */
-        if(CO2SensorCallback != NULL && !CO2_sensor_is_warming_up())
+        while(CO2_edge_tail != CO2_edge_head)
         {
-            CO2SensorCallback(NULL);
+            co2_sensor_edge_t edge = CO2_edge_ring[CO2_edge_tail % CO2_SENSOR_EDGE_RING_LEN];
+            CO2_edge_tail++;
+
+            int64_t th_us, period_us;
+
+            if(!co2_sensor_decode_edge(&decoder, &edge, &th_us, &period_us))
+            {
+                continue;
+            }
+
+            /**
+             *  A partir del tiempo en alto y del período del pulso PWM, se obtiene el valor de CO2 en ppm,
+             *  según la ecuación del fabricante (tiempos en ms):
+             * 
+             *  ppm = 5000 * (th - 2) / (th + tl - 4)
+             */
+            if(period_us < CO2_SENSOR_PERIOD_MIN_US || period_us > CO2_SENSOR_PERIOD_MAX_US || th_us < 2000 || th_us > period_us - 2000)
+            {
+                ESP_LOGE(TAG, "Invalid PWM cycle (th: %" PRId64 " us, period: %" PRId64 " us).", th_us, period_us);
+                co2_sensor_new_measurement(CO2_SENSOR_MEASURE_ERROR);
+                continue;
+            }
+
+            co2_sensor_new_measurement(5000.0f * (th_us - 2000) / (period_us - 4000));
         }
     }
 }
 
 
 
-//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
-
 /**
- * @brief   Función para inicializar el sensor de CO2.
+ * @brief   Función para inicializar la obtención de datos del sensor por PWM: se configura el pin con interrupción
+ *          por ambos flancos, que se habilita al iniciar la tarea.
  * 
  * @param CO2_sens_pwm_pin  GPIO del pin de PWM del sensor de CO2.
  * @return esp_err_t 
  */
-esp_err_t CO2_sensor_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin)
+static esp_err_t co2_sensor_pwm_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin)
 {
-    /**
-     *  Se guarda el inicio del conteo de tiempo de calentamiento del sensor.
-     * 
-     */
-    CO2_warm_up_time_start = esp_timer_get_time();
-
     /**
      *  Se guarda el número de pin correspondiente al del PWM del sensor de CO2.
      */
@@ -302,8 +362,8 @@ esp_err_t CO2_sensor_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin)
     pGPIOConfig.pull_up_en = GPIO_PULLUP_DISABLE;
     /* Habilitamos o deshabilitamos la resistencia interna de pull-down (deshabilitada en este caso) */
     pGPIOConfig.pull_down_en = GPIO_PULLDOWN_DISABLE;
-    /* Definimos si habilitamos la interrupción, y si es asi, de qué tipo (inicialmente, deshabilitada) */
-    pGPIOConfig.intr_type = GPIO_INTR_DISABLE;
+    /* Definimos si habilitamos la interrupción, y si es asi, de qué tipo (ambos flancos, habilitada al iniciar la tarea) */
+    pGPIOConfig.intr_type = GPIO_INTR_ANYEDGE;
     
     /**
      *  Función para configurar un pin GPIO, incluyendo la interrupción. 
@@ -314,9 +374,12 @@ esp_err_t CO2_sensor_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin)
     /**
      *  Mediante esta función, se habilita el servicio mediante el cual se tienen flags globales individuales
      *  para cada GPIO con interrupción, en vez de tener una unica flag global para todas las interrupciones.
-     *  El 0 es para instanciar las flags en 0.
+     *  El 0 es para instanciar las flags en 0. Si el servicio ya fue instalado por otro módulo, no se
+     *  considera un error.
      */
-    ESP_RETURN_ON_ERROR(gpio_install_isr_service(0), TAG, "Failed to install ISR.");
+    esp_err_t isr_service_ret = gpio_install_isr_service(0);
+    ESP_RETURN_ON_FALSE(isr_service_ret == ESP_OK || isr_service_ret == ESP_ERR_INVALID_STATE, isr_service_ret, 
+                        TAG, "Failed to install ISR.");
 
     /**
      *  Funcion para agregar efectivamente una interrupcion a un GPIO, junto con su handler.
@@ -324,13 +387,254 @@ esp_err_t CO2_sensor_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin)
     ESP_RETURN_ON_ERROR(gpio_isr_handler_add(CO2_sens_pwm_pin, co2_sensor_isr_handler, NULL), 
                         TAG, "Failed to add the ISR handler.");
 
+    gpio_intr_disable(CO2_sens_pwm_pin);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para inicializar la obtención de datos del sensor por UART: se instala el driver de UART con su
+ *          cola de eventos, a 9600 baudios, 8N1.
+ * 
+ * @param CO2_sens_config   Configuración del sensor.
+ * @return esp_err_t 
+ */
+static esp_err_t co2_sensor_uart_init(const CO2_sensor_config_t *CO2_sens_config)
+{
+    CO2_uart_port = CO2_sens_config->uart_port;
+
+    if(xCO2UartMutex == NULL)
+    {
+        xCO2UartMutex = xSemaphoreCreateMutex();
+
+        if(xCO2UartMutex == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create CO2 UART mutex.");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    uart_config_t uart_config = {
+        .baud_rate = 9600,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_APB,
+    };
+
+    ESP_RETURN_ON_ERROR(uart_driver_install(CO2_uart_port, MHZ19B_SERIAL_BUF_LEN * 2, 0, CO2_SENSOR_UART_QUEUE_LEN, &CO2_uart_queue, 0), 
+                        TAG, "Failed to install UART driver.");
+    ESP_RETURN_ON_ERROR(uart_param_config(CO2_uart_port, &uart_config), TAG, "Failed to load UART config.");
+    ESP_RETURN_ON_ERROR(uart_set_pin(CO2_uart_port, CO2_sens_config->uart_tx_pin, CO2_sens_config->uart_rx_pin, 
+                                    UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE), 
+                        TAG, "Failed to set UART pins.");
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para enviar un comando al sensor por UART y obtener su respuesta. La respuesta se recibe a medida
+ *          que el driver la notifica en su cola de eventos, sin sondear el buffer de recepción.
+ * 
+ * @param cmd       Comando (ver mhz19b.h).
+ * @param b3        Byte 3 del comando.
+ * @param b4        Byte 4 del comando.
+ * @param b5        Byte 5 del comando.
+ * @param b6        Byte 6 del comando.
+ * @param b7        Byte 7 del comando.
+ * @param response  Buffer de MHZ19B_SERIAL_RX_BYTES bytes donde se guarda la respuesta, o NULL para los comandos sin
+ *                  respuesta documentada (autocalibración y calibración del cero), que solo se envían.
+ * @return esp_err_t    ESP_ERR_TIMEOUT si no llegó la respuesta completa, ESP_ERR_INVALID_RESPONSE o ESP_ERR_INVALID_CRC
+ *                      si la respuesta no es válida.
+ */
+static esp_err_t co2_sensor_uart_command(uint8_t cmd, uint8_t b3, uint8_t b4, uint8_t b5, uint8_t b6, uint8_t b7, uint8_t *response)
+{
+    uint8_t request[MHZ19B_SERIAL_RX_BYTES] = { 0xFF, 0x01, cmd, b3, b4, b5, b6, b7, 0x00 };
+    request[8] = mhz19b_calc_crc(request);
+
+    int received = 0;
+
+    xSemaphoreTake(xCO2UartMutex, portMAX_DELAY);
+
+    /**
+     *  Se descartan los datos y eventos pendientes de respuestas anteriores, y se envía el comando.
+     */
+    uart_flush_input(CO2_uart_port);
+    xQueueReset(CO2_uart_queue);
+    uart_write_bytes(CO2_uart_port, (const char *) request, sizeof(request));
+
+    if(response == NULL)
+    {
+        xSemaphoreGive(xCO2UartMutex);
+        return ESP_OK;
+    }
+
+    /**
+     *  Se leen los bytes de la respuesta a medida que llegan, hasta completarla o hasta que se cumpla el timeout.
+     */
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(CO2_SENSOR_UART_TIMEOUT_MS);
+
+    while(received < MHZ19B_SERIAL_RX_BYTES)
+    {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        uart_event_t event;
+
+        if(elapsed >= timeout || xQueueReceive(CO2_uart_queue, &event, timeout - elapsed) != pdTRUE)
+        {
+            break;
+        }
+
+        if(event.type == UART_DATA)
+        {
+            size_t len = MHZ19B_SERIAL_RX_BYTES - received;
+            len = (event.size < len) ? event.size : len;
+
+            int read = uart_read_bytes(CO2_uart_port, response + received, len, 0);
+            received += (read > 0) ? read : 0;
+        }
+
+        else if(event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL)
+        {
+            uart_flush_input(CO2_uart_port);
+            xQueueReset(CO2_uart_queue);
+            break;
+        }
+    }
+
+    xSemaphoreGive(xCO2UartMutex);
+
+    if(received < MHZ19B_SERIAL_RX_BYTES)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if(response[0] != 0xFF || response[1] != cmd)
+    {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if(response[8] != mhz19b_calc_crc(response))
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Tarea encargada de obtener una medición de CO2 en ppm del sensor de CO2 por UART, cada
+ *          CO2_SENSOR_UART_PERIOD_MS.
+ * 
+ * @param pvParameters  Parámetros pasados a la tarea en su creación.
+ */
+static void vTaskGetCO2ByUART(void *pvParameters)
+{
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    while(1)
+    {
+        uint8_t response[MHZ19B_SERIAL_RX_BYTES];
+        esp_err_t ret = co2_sensor_uart_command(MHZ19B_CMD_READ_CO2, 0, 0, 0, 0, 0, response);
+
+        if(ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "UART ERROR: %s.", esp_err_to_name(ret));
+            co2_sensor_new_measurement(CO2_SENSOR_MEASURE_ERROR);
+        }
+
+        else
+        {
+            /**
+             *  La concentración de CO2 en ppm se encuentra en los bytes 2 (parte alta) y 3 (parte baja) de la respuesta.
+             */
+            co2_sensor_new_measurement((response[2] << 8) | response[3]);
+        }
+
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(CO2_SENSOR_UART_PERIOD_MS));
+    }
+}
+
+
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para inicializar el sensor de CO2 con la interfaz configurada. Con CO2_SENSOR_BACKEND_AUTO se utiliza
+ *          la UART si el sensor responde a una lectura, y en caso contrario se utiliza la salida PWM.
+ * 
+ * @param CO2_sens_config   Configuración del sensor de CO2.
+ * @return esp_err_t 
+ */
+esp_err_t CO2_sensor_init(const CO2_sensor_config_t *CO2_sens_config)
+{
+    ESP_RETURN_ON_FALSE(CO2_sens_config != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    /**
+     *  Se guarda el inicio del conteo de tiempo de calentamiento del sensor.
+     * 
+     */
+    CO2_warm_up_time_start = esp_timer_get_time();
+
+
+
+    //========================| SELECCIÓN DE INTERFAZ |===========================//
+
+    CO2_backend = CO2_sens_config->backend;
+
+    if(CO2_backend != CO2_SENSOR_BACKEND_PWM)
+    {
+        uint8_t response[MHZ19B_SERIAL_RX_BYTES];
+        esp_err_t ret = co2_sensor_uart_init(CO2_sens_config);
+
+        /**
+         *  Se verifica que el sensor responda con una lectura de CO2, que tiene respuesta con checksum, y luego
+         *  se configura la autocalibración, que no tiene respuesta documentada.
+         */
+        if(ret == ESP_OK)
+        {
+            ret = co2_sensor_uart_command(MHZ19B_CMD_READ_CO2, 0, 0, 0, 0, 0, response);
+        }
+
+        if(ret == ESP_OK)
+        {
+            CO2_backend = CO2_SENSOR_BACKEND_UART;
+            co2_sensor_uart_command(MHZ19B_CMD_SET_AUTO_CAL, CO2_sens_config->auto_calibration ? 0xA0 : 0x00, 0, 0, 0, 0, NULL);
+        }
+
+        else if(CO2_backend == CO2_SENSOR_BACKEND_AUTO)
+        {
+            ESP_LOGW(TAG, "CO2 sensor not responding by UART, using PWM.");
+            uart_driver_delete(CO2_sens_config->uart_port);
+            CO2_backend = CO2_SENSOR_BACKEND_PWM;
+        }
+
+        else
+        {
+            ESP_LOGE(TAG, "CO2 sensor not responding by UART.");
+            return ret;
+        }
+    }
+
+    if(CO2_backend == CO2_SENSOR_BACKEND_PWM)
+    {
+        ESP_RETURN_ON_ERROR(co2_sensor_pwm_init(CO2_sens_config->pwm_pin), TAG, "Failed to init PWM.");
+    }
+
 
 
     //========================| CREACIÓN DE TAREA |===========================//
 
     /**
      *  Se crea la tarea encargada de recibir los datos desde el pin de PWM
-     *  del sensor de CO2.
+     *  o desde la UART del sensor de CO2.
      * 
      *  Se le da una prioridad a la tarea alta, considerando que el máximo de prioridad
      *  es de 5, de modo que no se vea afectado el proceso de recepción de datos desde
@@ -340,8 +644,8 @@ esp_err_t CO2_sensor_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin)
     if(xCO2TaskHandle == NULL)
     {
         xTaskCreate(
-            vTaskGetCO2ByPWM,
-            "vTaskGetCO2ByPWM",
+            (CO2_backend == CO2_SENSOR_BACKEND_UART) ? vTaskGetCO2ByUART : vTaskGetCO2ByPWM,
+            "vTaskGetCO2",
             4096,
             NULL,
             5,
@@ -352,7 +656,7 @@ esp_err_t CO2_sensor_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin)
          */
         if(xCO2TaskHandle == NULL)
         {
-            ESP_LOGE(TAG, "Failed to create vTaskGetCO2ByPWM task.");
+            ESP_LOGE(TAG, "Failed to create vTaskGetCO2 task.");
             return ESP_FAIL;
         }
     }
@@ -411,4 +715,72 @@ bool CO2_sensor_is_warming_up(void)
 void CO2_sensor_callback_function_on_new_measurment(CO2SensorCallbackFunction callback_function)
 {
     CO2SensorCallback = callback_function;
+}
+
+
+
+/**
+ * @brief   Función para saber qué interfaz se utiliza para obtener los datos del sensor.
+ * 
+ * @return CO2_sensor_backend_t     CO2_SENSOR_BACKEND_PWM o CO2_SENSOR_BACKEND_UART.
+ */
+CO2_sensor_backend_t CO2_sensor_get_backend(void)
+{
+    return CO2_backend;
+}
+
+
+
+/**
+ * @brief   Función para habilitar o deshabilitar la autocalibración de la línea de base (ABC) del sensor, que toma
+ *          como 400 ppm el mínimo de cada período de 24 hs. Solo disponible por UART.
+ * 
+ * @param auto_calibration  1: autocalibración habilitada, 0: deshabilitada.
+ * @return esp_err_t    ESP_ERR_NOT_SUPPORTED si el sensor se utiliza por PWM. El comando no tiene respuesta
+ *                      documentada, por lo que para verificarlo se debe usar "CO2_sensor_get_auto_calibration()".
+ */
+esp_err_t CO2_sensor_set_auto_calibration(bool auto_calibration)
+{
+    ESP_RETURN_ON_FALSE(CO2_backend == CO2_SENSOR_BACKEND_UART, ESP_ERR_NOT_SUPPORTED, TAG, "Only supported by UART.");
+
+    return co2_sensor_uart_command(MHZ19B_CMD_SET_AUTO_CAL, auto_calibration ? 0xA0 : 0x00, 0, 0, 0, 0, NULL);
+}
+
+
+
+/**
+ * @brief   Función para saber si la autocalibración de la línea de base del sensor está habilitada. Solo disponible por UART.
+ * 
+ * @param auto_calibration  Variable donde se guarda el estado de la autocalibración.
+ * @return esp_err_t    ESP_ERR_NOT_SUPPORTED si el sensor se utiliza por PWM.
+ */
+esp_err_t CO2_sensor_get_auto_calibration(bool *auto_calibration)
+{
+    ESP_RETURN_ON_FALSE(auto_calibration != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+    ESP_RETURN_ON_FALSE(CO2_backend == CO2_SENSOR_BACKEND_UART, ESP_ERR_NOT_SUPPORTED, TAG, "Only supported by UART.");
+
+    uint8_t response[MHZ19B_SERIAL_RX_BYTES];
+
+    ESP_RETURN_ON_ERROR(co2_sensor_uart_command(MHZ19B_CMD_GET_AUTO_CAL, 0, 0, 0, 0, 0, response), 
+                        TAG, "Failed to get auto calibration.");
+
+    /* El estado de la autocalibración se encuentra en el byte 7 de la respuesta. */
+    *auto_calibration = response[7] & 0x01;
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para calibrar el punto de cero del sensor (400 ppm). El sensor debe estar al aire libre, con el
+ *          calentamiento finalizado, al menos 20 minutos antes de llamar a esta función. Solo disponible por UART.
+ * 
+ * @return esp_err_t    ESP_ERR_NOT_SUPPORTED si el sensor se utiliza por PWM. El comando no tiene respuesta documentada.
+ */
+esp_err_t CO2_sensor_calibrate_zero_point(void)
+{
+    ESP_RETURN_ON_FALSE(CO2_backend == CO2_SENSOR_BACKEND_UART, ESP_ERR_NOT_SUPPORTED, TAG, "Only supported by UART.");
+
+    return co2_sensor_uart_command(MHZ19B_CMD_CAL_ZERO_POINT, 0, 0, 0, 0, 0, NULL);
 }
\ No newline at end of file
@@ -14,8 +14,10 @@ extern "C" {
 /*==================[INCLUDES]=============================================*/
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "esp_err.h"
 #include "driver/gpio.h"
+#include "driver/uart.h"
 
 /*==================[DEFINES AND MACROS]=====================================*/
 
@@ -25,9 +27,34 @@ extern "C" {
  */
 #define CO2_SENSOR_MEASURE_ERROR -5 
 
+/**
+ *  Cantidad de ciclos del PWM (uno por segundo, aproximadamente) cuyas mediciones se promedian en cada valor
+ *  de CO2. Con 1 no se promedia. Puede redefinirse antes de incluir este archivo.
+ */
+#ifndef CO2_SENSOR_AVERAGE_CYCLES
+#define CO2_SENSOR_AVERAGE_CYCLES 1
+#endif
+
 typedef gpio_num_t CO2_sensor_pwm_pin_t;
 typedef float CO2_sensor_ppm_t;
 
+/* Interfaz mediante la cual se obtienen los datos del sensor. */
+typedef enum {
+    CO2_SENSOR_BACKEND_PWM = 0,     /* Salida PWM (una medición por ciclo de ~1 s). */
+    CO2_SENSOR_BACKEND_UART,        /* Comandos por UART (resolución de 1 ppm). */
+    CO2_SENSOR_BACKEND_AUTO,        /* UART si el sensor responde, PWM en caso contrario. */
+} CO2_sensor_backend_t;
+
+/* Configuración del sensor de CO2. */
+typedef struct {
+    CO2_sensor_backend_t backend;       /* Interfaz a utilizar. */
+    CO2_sensor_pwm_pin_t pwm_pin;       /* Pin de PWM del sensor. */
+    uart_port_t uart_port;              /* Puerto UART conectado al sensor. */
+    gpio_num_t uart_tx_pin;             /* Pin TX del ESP32 (RX del sensor). */
+    gpio_num_t uart_rx_pin;             /* Pin RX del ESP32 (TX del sensor). */
+    bool auto_calibration;              /* Autocalibración de la línea de base (ABC) del sensor, solo por UART. */
+} CO2_sensor_config_t;
+
 /**
  *  @brief  Puntero a función que será utilizado para ejecutar la función que se pase
  *          como callback cuando finalice una nueva conversión del sensor.
@@ -38,9 +65,13 @@ typedef void (*CO2SensorCallbackFunction)(void *pvParameters);
 
 /*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
 
-esp_err_t CO2_sensor_init(CO2_sensor_pwm_pin_t CO2_sens_pwm_pin);
+esp_err_t CO2_sensor_init(const CO2_sensor_config_t *CO2_sens_config);
 esp_err_t CO2_sensor_get_CO2(CO2_sensor_ppm_t *CO2_value_buffer);
 bool CO2_sensor_is_warming_up(void);
+CO2_sensor_backend_t CO2_sensor_get_backend(void);
+esp_err_t CO2_sensor_set_auto_calibration(bool auto_calibration);
+esp_err_t CO2_sensor_get_auto_calibration(bool *auto_calibration);
+esp_err_t CO2_sensor_calibrate_zero_point(void);
 void CO2_sensor_callback_function_on_new_measurment(CO2SensorCallbackFunction callback_function);
 
 /*==================[END OF FILE]============================================*/
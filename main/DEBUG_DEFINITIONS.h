@@ -86,6 +86,22 @@ extern "C" {
  */
 #define DEBUG_CONSTANTE_CONVERSION_TIEMPO_BOMBEO 1
 
+/**
+ *  Constantes de debug para seleccionar el modo de publicación de la telemetría de los sensores.
+ * 
+ *  DEBUG_TELEMETRIA_AGREGADA:
+ *  NO DEFINIDA -> Cada valor se publica en su propio tópico MQTT.
+ *  DEFINIDA -> Se publica una única trama por período con todos los valores.
+ * 
+ *  DEBUG_TELEMETRIA_FORMATO_BINARIO (solo con telemetría agregada):
+ *  NO DEFINIDA -> Trama en formato JSON.
+ *  DEFINIDA -> Trama en formato binario.
+ * 
+ *  FILE: MQTT_PUBL_SUSCR.c 
+ */
+// #define DEBUG_TELEMETRIA_AGREGADA 1
+// #define DEBUG_TELEMETRIA_FORMATO_BINARIO 1
+
 /*======================[EXTERNAL DATA DECLARATION]==============================*/
 
 /*=====================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
@@ -14,14 +14,27 @@
 /**
  * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
  *  
- *          
+ *          La trama de 40 bits del sensor se captura por hardware con el periférico RMT en modo recepción, con una
+ *      resolución de 1 us, y luego se decodifica desde el buffer de ítems RMT. De esta forma no se deshabilitan
+ *      las interrupciones durante la lectura, y las interrupciones de WiFi no afectan la temporización.
+ * 
+ *          La secuencia de lectura es:
+ *      1) El ESP32 mantiene la línea en bajo al menos 18 ms (señal de inicio), mediante el GPIO en modo open-drain.
+ *      2) Se habilita la recepción del RMT y se libera la línea.
+ *      3) El sensor responde con un pulso bajo y uno alto de 80 us, y luego envía 40 bits, cada uno formado por un
+ *         pulso bajo de 50 us y un pulso alto de 26-28 us (bit 0) o 70 us (bit 1).
+ *      4) Al quedar la línea en reposo, el RMT finaliza la recepción y deja los pulsos en su ring buffer.
+ * 
+ *          Ante una lectura fallida (trama incompleta o error de checksum) se reintenta según la política de reintentos
+ *      configurada. En cada lectura se guardan los márgenes de temporización, para poder evaluar el estado del sensor.
  */
 
 
 
 //==================================| INCLUDES |==================================//
 
-#include "dht.h"
+#include <string.h>
+
 #include "DHT11_SENSOR.h"
 
 #include "esp_log.h"
@@ -30,9 +43,46 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/ringbuf.h"
 
 //==================================| MACROS AND TYPDEF |==================================//
 
+/* Período de medición del sensor, en ms. */
+#define DHT11_PERIOD_MS 3000
+
+/* Duración de la señal de inicio, en ms (mínimo 18 ms según la hoja de datos). */
+#define DHT11_START_SIGNAL_MS 20
+
+/* Divisor del reloj APB (80 MHz) del RMT, para obtener ticks de 1 us. */
+#define DHT11_RMT_CLK_DIV 80
+
+/* Tiempo sin flancos en la línea, en us, a partir del cual el RMT da por finalizada la trama. */
+#define DHT11_RMT_IDLE_THRESHOLD_US 200
+
+/* Pulsos más cortos que este valor, en ciclos del reloj APB (1,25 us), se descartan como ruido. */
+#define DHT11_RMT_FILTER_TICKS 100
+
+/* Tamaño del ring buffer de recepción del RMT, en bytes. */
+#define DHT11_RMT_RX_BUFFER_SIZE 1024
+
+/* Tiempo máximo de espera de la trama, en ms (la trama dura alrededor de 5 ms). */
+#define DHT11_FRAME_TIMEOUT_MS 50
+
+/* Cantidad de bits de la trama. */
+#define DHT11_FRAME_BITS 40
+
+/* Umbral de decisión entre un bit 0 (26-28 us en alto) y un bit 1 (70 us en alto), en us. */
+#define DHT11_BIT_THRESHOLD_US 48
+
+/* Cantidad máxima de pulsos de una trama, incluyendo la señal de inicio y la respuesta del sensor. */
+#define DHT11_MAX_PULSES 128
+
+/* Pulso de la línea de datos (nivel y duración). */
+typedef struct {
+    uint8_t level;
+    uint16_t duration_us;
+} DHT11_pulse_t;
+
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 /* Tag para imprimir información en el LOG. */
@@ -53,14 +103,172 @@ static DHT11_sensor_hum_t DHT11_hum_value = 0;
 /* Variable que representa el pin GPIO al cual está conectado en sensor DHT11. */
 static DHT11_sensor_data_pin_t DHT11_SENSOR_DATA_PIN;
 
+/* Ring buffer donde el driver RMT deja los pulsos recibidos. */
+static RingbufHandle_t DHT11_rmt_ringbuf = NULL;
+
+/* Política de reintentos. */
+static uint8_t DHT11_max_retries = DHT11_MAX_RETRIES_DEFAULT;
+static uint32_t DHT11_retry_delay_ms = DHT11_RETRY_DELAY_MS_DEFAULT;
+
+/* Márgenes de temporización de la última lectura, y estadísticas acumuladas. */
+static DHT11_sensor_read_info_t DHT11_read_info;
+static DHT11_sensor_stats_t DHT11_stats;
+
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
 static void vTaskGetTempAndHum(void *pvParameters);
+static esp_err_t DHT11_read_frame(uint8_t data[5], DHT11_sensor_read_info_t *info);
+static esp_err_t DHT11_decode_frame(const DHT11_pulse_t *pulses, int pulse_count, uint8_t data[5], DHT11_sensor_read_info_t *info);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
+/**
+ * @brief   Función para decodificar la trama de 40 bits del sensor a partir de los pulsos recibidos.
+ * 
+ *          Se toman los últimos 40 pulsos altos completos (seguidos de un pulso bajo) como los bits de datos,
+ *          y el pulso alto anterior y el bajo que lo precede como la respuesta del sensor. Así se descartan
+ *          los pulsos de la señal de inicio, que dependen de cuándo se habilitó la recepción.
+ * 
+ * @param pulses        Pulsos recibidos.
+ * @param pulse_count   Cantidad de pulsos recibidos.
+ * @param data          Buffer donde se guardan los 5 bytes de la trama.
+ * @param info          Variable donde se guardan los márgenes de temporización de la trama.
+ * @return esp_err_t    ESP_ERR_TIMEOUT si la trama está incompleta, ESP_ERR_INVALID_CRC si falla el checksum.
+ */
+static esp_err_t DHT11_decode_frame(const DHT11_pulse_t *pulses, int pulse_count, uint8_t data[5], DHT11_sensor_read_info_t *info)
+{
+    /**
+     *  Se busca, desde el final, el último pulso alto completo. El último pulso de la trama
+     *  es el bajo de 50 us que envía el sensor al terminar el último bit.
+     */
+    int last = pulse_count - 1;
+
+    while(last > 0 && !(pulses[last].level == 0 && pulses[last - 1].level == 1))
+    {
+        last--;
+    }
+
+    /**
+     *  Se necesitan los 40 bits (pulso bajo y alto cada uno) y la respuesta del sensor.
+     */
+    int first = last - 2 * DHT11_FRAME_BITS - 1;
+
+    if(first < 1 || pulses[first].level != 1 || pulses[first - 1].level != 0)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    info->response_low_us = pulses[first - 1].duration_us;
+    info->response_high_us = pulses[first].duration_us;
+    info->min_bit_margin_us = UINT16_MAX;
+
+    memset(data, 0, 5);
+
+    for(int bit = 0; bit < DHT11_FRAME_BITS; bit++)
+    {
+        uint16_t high_us = pulses[first + 2 + 2 * bit].duration_us;
+        uint16_t margin_us;
+
+        if(high_us > DHT11_BIT_THRESHOLD_US)
+        {
+            data[bit / 8] |= (1 << (7 - (bit % 8)));
+            margin_us = high_us - DHT11_BIT_THRESHOLD_US;
+        }
+
+        else
+        {
+            margin_us = DHT11_BIT_THRESHOLD_US - high_us;
+        }
+
+        if(margin_us < info->min_bit_margin_us)
+        {
+            info->min_bit_margin_us = margin_us;
+        }
+    }
+
+    if(data[4] != (uint8_t) (data[0] + data[1] + data[2] + data[3]))
+    {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para realizar una lectura de la trama del sensor mediante el RMT.
+ * 
+ * @param data      Buffer donde se guardan los 5 bytes de la trama.
+ * @param info      Variable donde se guardan los márgenes de temporización de la trama.
+ * @return esp_err_t 
+ */
+static esp_err_t DHT11_read_frame(uint8_t data[5], DHT11_sensor_read_info_t *info)
+{
+    size_t length = 0;
+    rmt_item32_t *items = NULL;
+
+    /**
+     *  Se descartan pulsos de ruido que hayan quedado en el ring buffer.
+     */
+    while((items = (rmt_item32_t *) xRingbufferReceive(DHT11_rmt_ringbuf, &length, 0)) != NULL)
+    {
+        vRingbufferReturnItem(DHT11_rmt_ringbuf, (void *) items);
+    }
+
+    /**
+     *  Se envía la señal de inicio, y se habilita la recepción antes de liberar la línea para
+     *  no perder la respuesta del sensor, que llega entre 20 y 40 us después.
+     */
+    gpio_set_level(DHT11_SENSOR_DATA_PIN, 0);
+    vTaskDelay(pdMS_TO_TICKS(DHT11_START_SIGNAL_MS) + 1);
+
+    rmt_rx_start(DHT11_RMT_CHANNEL, true);
+    gpio_set_level(DHT11_SENSOR_DATA_PIN, 1);
+
+    items = (rmt_item32_t *) xRingbufferReceive(DHT11_rmt_ringbuf, &length, pdMS_TO_TICKS(DHT11_FRAME_TIMEOUT_MS));
+    rmt_rx_stop(DHT11_RMT_CHANNEL);
+
+    if(items == NULL)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    /**
+     *  Se pasan los ítems RMT (dos pulsos por ítem) a una lista de pulsos. Un pulso de duración
+     *  0 indica el fin de la trama (la línea quedó en reposo).
+     */
+    DHT11_pulse_t pulses[DHT11_MAX_PULSES];
+    int pulse_count = 0;
+
+    for(int i = 0; i < length / sizeof(rmt_item32_t) && pulse_count < DHT11_MAX_PULSES - 1; i++)
+    {
+        if(items[i].duration0 == 0)
+        {
+            break;
+        }
+
+        pulses[pulse_count].level = items[i].level0;
+        pulses[pulse_count++].duration_us = items[i].duration0;
+
+        if(items[i].duration1 == 0)
+        {
+            break;
+        }
+
+        pulses[pulse_count].level = items[i].level1;
+        pulses[pulse_count++].duration_us = items[i].duration1;
+    }
+
+    vRingbufferReturnItem(DHT11_rmt_ringbuf, (void *) items);
+
+    return DHT11_decode_frame(pulses, pulse_count, data, info);
+}
+
+
+
 /**
  * @brief   Tarea encargada de obtener los valores de temperatura y humedad relativa desde el sensor DHT11.
  * 
@@ -71,14 +279,68 @@ static void vTaskGetTempAndHum(void *pvParameters)
     while (1) {
 
         /**
-         *  Se obtiene el valor de temperatura y humedad relativa desde el sensor DHT11.
+         *  Se obtiene el valor de temperatura y humedad relativa desde el sensor DHT11,
+         *  reintentando según la política de reintentos configurada.
          */
-        if(dht_read_float_data(DHT_TYPE_DHT11, DHT11_SENSOR_DATA_PIN, &DHT11_hum_value, &DHT11_temp_value) != ESP_OK)
+        DHT11_sensor_read_info_t info = {0};
+        uint8_t data[5];
+        esp_err_t ret = ESP_FAIL;
+
+        for(int attempt = 0; attempt <= DHT11_max_retries; attempt++)
+        {
+            if(attempt > 0)
+            {
+                DHT11_stats.retries++;
+                vTaskDelay(pdMS_TO_TICKS(DHT11_retry_delay_ms));
+            }
+
+            info.attempts = attempt + 1;
+            ret = DHT11_read_frame(data, &info);
+
+            if(ret == ESP_OK)
+            {
+                break;
+            }
+
+            else if(ret == ESP_ERR_INVALID_CRC)
+            {
+                DHT11_stats.checksum_errors++;
+            }
+
+            else
+            {
+                DHT11_stats.timeouts++;
+            }
+        }
+
+        DHT11_stats.reads++;
+        DHT11_read_info = info;
+
+        if(ret == ESP_OK)
+        {
+            ESP_LOGD(TAG, "Attempts: %d, response: %d/%d us, min bit margin: %d us.", 
+                        info.attempts, info.response_low_us, info.response_high_us, info.min_bit_margin_us);
+
+            /**
+             *  La parte entera y decimal de la humedad están en los bytes 0 y 1, y las de la temperatura
+             *  en los bytes 2 y 3 (el bit más significativo del byte 3 indica temperatura negativa).
+             */
+            DHT11_hum_value = data[0] + data[1] * 0.1;
+            DHT11_temp_value = data[2] + (data[3] & 0x7F) * 0.1;
+
+            if(data[3] & 0x80)
+            {
+                DHT11_temp_value = -DHT11_temp_value;
+            }
+        }
+
+        else
         {
             /**
              *  En caso de error de medición del sensor, cargamos a la variable de temperatura
              *  y de humedad el valor definido para detección de error de forma externa a la librería.
              */
+            DHT11_stats.failures++;
             DHT11_hum_value = DHT11_MEASURE_ERROR;
             DHT11_temp_value = DHT11_MEASURE_ERROR;
             ESP_LOGE(TAG, "Failed to get temp and hum.");
@@ -93,7 +355,7 @@ static void vTaskGetTempAndHum(void *pvParameters)
             DHT11Callback(NULL);
         }
         
-        vTaskDelay(pdMS_TO_TICKS(3000));
+        vTaskDelay(pdMS_TO_TICKS(DHT11_PERIOD_MS));
     }
 }
 
@@ -138,6 +400,31 @@ esp_err_t DTH11_sensor_init(DHT11_sensor_data_pin_t DHT11_sens_data_pin)
 
 
 
+    //========================| CONFIGURACIÓN DEL RMT |===========================//
+
+    /**
+     *  Se configura el canal RMT en modo recepción con ticks de 1 us. La configuración del RMT conecta
+     *  el pin como entrada del periférico, por lo que luego se lo vuelve a configurar en modo open-drain
+     *  (entrada y salida), para poder enviar la señal de inicio. La línea queda en reposo en alto.
+     */
+    if(DHT11_rmt_ringbuf == NULL)
+    {
+        rmt_config_t rmt_rx_config = RMT_DEFAULT_CONFIG_RX(DHT11_sens_data_pin, DHT11_RMT_CHANNEL);
+        rmt_rx_config.clk_div = DHT11_RMT_CLK_DIV;
+        rmt_rx_config.rx_config.idle_threshold = DHT11_RMT_IDLE_THRESHOLD_US;
+        rmt_rx_config.rx_config.filter_ticks_thresh = DHT11_RMT_FILTER_TICKS;
+        rmt_rx_config.rx_config.filter_en = true;
+
+        ESP_RETURN_ON_ERROR(rmt_config(&rmt_rx_config), TAG, "Failed to load rmt config.");
+        ESP_RETURN_ON_ERROR(rmt_driver_install(DHT11_RMT_CHANNEL, DHT11_RMT_RX_BUFFER_SIZE, 0), TAG, "Failed to install rmt driver.");
+        ESP_RETURN_ON_ERROR(rmt_get_ringbuf_handle(DHT11_RMT_CHANNEL, &DHT11_rmt_ringbuf), TAG, "Failed to get rmt ringbuffer.");
+    }
+
+    gpio_set_level(DHT11_sens_data_pin, 1);
+    ESP_RETURN_ON_ERROR(gpio_set_direction(DHT11_sens_data_pin, GPIO_MODE_INPUT_OUTPUT_OD), TAG, "Failed to set gpio direction.");
+
+
+
     //========================| CREACIÓN DE TAREA |===========================//
 
     /**
@@ -232,4 +519,47 @@ esp_err_t DHT11_getHum(DHT11_sensor_hum_t *DHT11_hum_value_buffer)
 void DHT11_callback_function_on_new_measurment(DHT11SensorCallbackFunction callback_function)
 {
     DHT11Callback = callback_function;
+}
+
+
+
+/**
+ * @brief   Función para configurar la política de reintentos ante una lectura fallida del sensor.
+ * 
+ * @param max_retries       Cantidad de reintentos (0 para no reintentar).
+ * @param retry_delay_ms    Espera entre reintentos, en ms (el DHT11 requiere al menos 1000 ms entre lecturas).
+ * @return esp_err_t 
+ */
+esp_err_t DHT11_set_retry_policy(uint8_t max_retries, uint32_t retry_delay_ms)
+{
+    ESP_RETURN_ON_FALSE(retry_delay_ms >= 1000, ESP_ERR_INVALID_ARG, TAG, "Retry delay too short.");
+
+    DHT11_max_retries = max_retries;
+    DHT11_retry_delay_ms = retry_delay_ms;
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para obtener los márgenes de temporización de la última lectura del sensor.
+ * 
+ * @param info  Variable donde se guardan los márgenes.
+ */
+void DHT11_get_read_info(DHT11_sensor_read_info_t *info)
+{
+    *info = DHT11_read_info;
+}
+
+
+
+/**
+ * @brief   Función para obtener las estadísticas acumuladas de lectura del sensor.
+ * 
+ * @param stats     Variable donde se guardan las estadísticas.
+ */
+void DHT11_get_stats(DHT11_sensor_stats_t *stats)
+{
+    *stats = DHT11_stats;
 }
\ No newline at end of file
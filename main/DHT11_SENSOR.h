@@ -16,11 +16,29 @@ extern "C" {
 #include <stdio.h>
 #include "esp_err.h"
 #include "driver/gpio.h"
+#include "driver/rmt.h"
 
 /*==================[DEFINES AND MACROS]=====================================*/
 
 #define DHT11_MEASURE_ERROR -2 
 
+/* Canal RMT utilizado para capturar la trama del sensor. */
+#ifndef DHT11_RMT_CHANNEL
+#define DHT11_RMT_CHANNEL RMT_CHANNEL_0
+#endif
+
+/**
+ *  Política de reintentos por defecto: cantidad de reintentos ante una lectura fallida, y espera entre
+ *  reintentos (el DHT11 requiere al menos 1 s entre lecturas).
+ */
+#ifndef DHT11_MAX_RETRIES_DEFAULT
+#define DHT11_MAX_RETRIES_DEFAULT 2
+#endif
+
+#ifndef DHT11_RETRY_DELAY_MS_DEFAULT
+#define DHT11_RETRY_DELAY_MS_DEFAULT 1100
+#endif
+
 typedef gpio_num_t DHT11_sensor_data_pin_t;
 typedef float DHT11_sensor_temp_t;
 typedef float DHT11_sensor_hum_t;
@@ -31,6 +49,26 @@ typedef float DHT11_sensor_hum_t;
  */
 typedef void (*DHT11SensorCallbackFunction)(void *pvParameters);
 
+/**
+ *  @brief  Márgenes de temporización de la última lectura, para evaluar el estado del sensor. Un margen
+ *          chico indica que la lectura estuvo cerca de fallar (cable largo, pull-up débil, sensor degradado).
+ */
+typedef struct {
+    uint8_t attempts;               /* Intentos realizados en la última lectura (1 si no hubo reintentos). */
+    uint16_t response_low_us;       /* Duración del pulso bajo de respuesta del sensor (nominal 80 us). */
+    uint16_t response_high_us;      /* Duración del pulso alto de respuesta del sensor (nominal 80 us). */
+    uint16_t min_bit_margin_us;     /* Menor distancia entre la duración de un bit y el umbral de decisión entre 0 y 1. */
+} DHT11_sensor_read_info_t;
+
+/* Estadísticas acumuladas de lectura del sensor. */
+typedef struct {
+    uint32_t reads;                 /* Cantidad de lecturas (cada una con sus reintentos). */
+    uint32_t failures;              /* Cantidad de lecturas que fallaron luego de todos los reintentos. */
+    uint32_t retries;               /* Cantidad total de reintentos. */
+    uint32_t timeouts;              /* Intentos en los que no se recibió una trama completa. */
+    uint32_t checksum_errors;       /* Intentos con error de checksum. */
+} DHT11_sensor_stats_t;
+
 /*==================[EXTERNAL DATA DECLARATION]==============================*/
 
 /*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
@@ -39,6 +77,9 @@ esp_err_t DTH11_sensor_init(DHT11_sensor_data_pin_t DHT11_sens_data_pin);
 esp_err_t DHT11_getTemp(DHT11_sensor_temp_t *DHT11_temp_value_buffer);
 esp_err_t DHT11_getHum(DHT11_sensor_hum_t *DHT11_hum_value_buffer);
 void DHT11_callback_function_on_new_measurment(DHT11SensorCallbackFunction callback_function);
+esp_err_t DHT11_set_retry_policy(uint8_t max_retries, uint32_t retry_delay_ms);
+void DHT11_get_read_info(DHT11_sensor_read_info_t *info);
+void DHT11_get_stats(DHT11_sensor_stats_t *stats);
 
 /*==================[END OF FILE]============================================*/
 
@@ -14,14 +14,23 @@
 /**
  * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
  *  
- *          
+ *          Al iniciar se buscan todas las sondas DS18B20 del bus 1-Wire (por ejemplo, en el tanque, y en la entrada y la salida
+ *      de los canales de cultivo). En cada ciclo se envía un único comando de conversión a todas las sondas a la vez, y mientras
+ *      dura la conversión (según la resolución configurada) la tarea queda bloqueada sin ocupar el procesador. Luego se leen
+ *      las temperaturas de todas las sondas, que se obtienen por su dirección ROM.
+ * 
+ *          La sonda principal, cuya temperatura devuelven "DS18B20_getTemp()" y "DS18B20_getFreshTemp()", es la primera
+ *      encontrada en la búsqueda (la de menor dirección ROM).
  */
 
 
 
 //==================================| INCLUDES |==================================//
 
+#include <math.h>
+
 #include "ds18x20.h"
+#include "onewire.h"
 #include "DS18B20_SENSOR.h"
 
 #include "esp_log.h"
@@ -31,8 +40,27 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "esp_timer.h"
+
 //==================================| MACROS AND TYPDEF |==================================//
 
+/* Período de medición de las sondas, en ms. */
+#define DS18B20_PERIOD_MS 1000
+
+/* Tiempo de conversión a 12 bits, en ms (se divide por 2 por cada bit menos de resolución). */
+#define DS18B20_CONVERSION_TIME_12_BITS_MS 750
+
+/* Posición del registro de configuración en el scratchpad, y posición de los bits de resolución en dicho registro. */
+#define DS18B20_SCRATCHPAD_CONFIG 4
+#define DS18B20_CONFIG_RESOLUTION_SHIFT 5
+
+/* Estado de cada sonda del bus. */
+typedef struct {
+    DS18B20_sensor_addr_t addr;         /* Dirección ROM de la sonda. */
+    DS18B20_sensor_temp_t temp;         /* Última temperatura medida (DS18B20_MEASURE_ERROR si la última lectura falló). */
+    int64_t last_valid_us;              /* Instante de la última medición válida (0 si nunca hubo una). */
+} DS18B20_probe_t;
+
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 /* Tag para imprimir información en el LOG. */
@@ -44,8 +72,16 @@ static TaskHandle_t xDS18B20TaskHandle = NULL;
 /* Puntero a función que apuntará a la función callback pasada como argumento en la función de configuración de callback. */
 DS18B20SensorCallbackFunction DS18B20Callback = NULL;
 
-/* Variable donde se guarda el valor de temperatura medido. */
-static DS18B20_sensor_temp_t DS18B20_temp_value = 0;
+/* Sondas encontradas en el bus. */
+static DS18B20_probe_t DS18B20_probes[DS18B20_MAX_PROBES];
+static int DS18B20_probe_count = 0;
+
+/* Resolución configurada de las sondas, en bits, y bandera para aplicarla desde la tarea. */
+static uint8_t DS18B20_resolution_bits = DS18B20_RESOLUTION_DEFAULT;
+static bool DS18B20_resolution_pending = 1;
+
+/* Spinlock para el acceso a los datos de las sondas desde otras tareas. */
+static portMUX_TYPE DS18B20_mux = portMUX_INITIALIZER_UNLOCKED;
 
 /* Variable que representa el pin GPIO al cual está conectado en sensor DS18B20. */
 static DS18B20_sensor_data_pin_t DS18B20_SENSOR_DATA_PIN;
@@ -55,32 +91,181 @@ static DS18B20_sensor_data_pin_t DS18B20_SENSOR_DATA_PIN;
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
 static void vTaskGetTemp(void *pvParameters);
+static void DS18B20_scan_probes(void);
+static void DS18B20_apply_resolution(void);
+static esp_err_t DS18B20_get_probe_temp(int probe_idx, DS18B20_sensor_temp_t *temp, int64_t *last_valid_us);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
- * @brief   Tarea encargada de obtener los valores de temperatura desde el sensor DS18B20.
+ * @brief   Función para buscar las sondas DS18B20 del bus 1-Wire.
+ */
+static void DS18B20_scan_probes(void)
+{
+    ds18x20_addr_t addr_list[DS18B20_MAX_PROBES];
+    size_t found = 0;
+
+    if(ds18x20_scan_devices(DS18B20_SENSOR_DATA_PIN, addr_list, DS18B20_MAX_PROBES, &found) != ESP_OK)
+    {
+        found = 0;
+    }
+
+    if(found > DS18B20_MAX_PROBES)
+    {
+        ESP_LOGW(TAG, "Found %d probes, using the first %d.", (int) found, DS18B20_MAX_PROBES);
+        found = DS18B20_MAX_PROBES;
+    }
+
+    /**
+     *  Se ordenan las sondas por dirección ROM, para que la sonda principal no dependa del orden de la búsqueda.
+     */
+    for(int i = 1; i < found; i++)
+    {
+        for(int j = i; j > 0 && addr_list[j] < addr_list[j - 1]; j--)
+        {
+            ds18x20_addr_t aux = addr_list[j];
+            addr_list[j] = addr_list[j - 1];
+            addr_list[j - 1] = aux;
+        }
+    }
+
+    portENTER_CRITICAL(&DS18B20_mux);
+    for(int i = 0; i < found; i++)
+    {
+        DS18B20_probes[i].addr = addr_list[i];
+        DS18B20_probes[i].temp = DS18B20_MEASURE_ERROR;
+        DS18B20_probes[i].last_valid_us = 0;
+    }
+    DS18B20_probe_count = found;
+    portEXIT_CRITICAL(&DS18B20_mux);
+
+    for(int i = 0; i < found; i++)
+    {
+        ESP_LOGI(TAG, "Probe %d: %08x%08x", i, (uint32_t) (addr_list[i] >> 32), (uint32_t) addr_list[i]);
+    }
+
+    DS18B20_resolution_pending = 1;
+}
+
+
+
+/**
+ * @brief   Función para configurar la resolución de todas las sondas encontradas, conservando los registros
+ *          de alarma (TH y TL) de cada una.
+ */
+static void DS18B20_apply_resolution(void)
+{
+    for(int i = 0; i < DS18B20_probe_count; i++)
+    {
+        uint8_t scratchpad[8];
+
+        if(ds18x20_read_scratchpad(DS18B20_SENSOR_DATA_PIN, DS18B20_probes[i].addr, scratchpad) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to set resolution of probe %d.", i);
+            continue;
+        }
+
+        /**
+         *  Se escriben los registros TH, TL y de configuración (bytes 2 a 4 del scratchpad).
+         */
+        scratchpad[DS18B20_SCRATCHPAD_CONFIG] = ((DS18B20_resolution_bits - 9) << DS18B20_CONFIG_RESOLUTION_SHIFT) | 0x1F;
+        ds18x20_write_scratchpad(DS18B20_SENSOR_DATA_PIN, DS18B20_probes[i].addr, &scratchpad[2]);
+    }
+
+    DS18B20_resolution_pending = 0;
+}
+
+
+
+/**
+ * @brief   Tarea encargada de obtener los valores de temperatura desde las sondas DS18B20.
  * 
  * @param pvParameters  Parámetros pasados a la tarea en su creación.
  */
 static void vTaskGetTemp(void *pvParameters)
 {
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
     while (1) {
 
         /**
-         *  Se obtiene el valor de temperatura desde el sensor DS18B20. 
-         *  
-         *  Al poner como address "DS18X20_ANY", estamos pidiendo el dato a todos los sensores
-         *  DS18B20 del bus, pero al haber uno solo en este caso, esto no afecta en nada.
+         *  Si no hay sondas (no se encontraron, o fallaron todas las lecturas anteriores), se vuelve a buscar en el bus.
          */
-        if(ds18b20_measure_and_read(DS18B20_SENSOR_DATA_PIN, DS18X20_ANY, &DS18B20_temp_value) != ESP_OK)
+        if(DS18B20_probe_count == 0)
+        {
+            DS18B20_scan_probes();
+        }
+
+        if(DS18B20_resolution_pending)
         {
+            DS18B20_apply_resolution();
+        }
+
+        /**
+         *  Se envía el comando de conversión a todas las sondas a la vez, y se espera el tiempo de conversión
+         *  correspondiente a la resolución configurada, sin ocupar el procesador.
+         */
+        ds18x20_addr_t addr_list[DS18B20_MAX_PROBES];
+        float temp_list[DS18B20_MAX_PROBES];
+        int probe_count = DS18B20_probe_count;
+        int valid_count = 0;
+
+        if(probe_count > 0 && ds18x20_measure(DS18B20_SENSOR_DATA_PIN, DS18X20_ANY, false) == ESP_OK)
+        {
+            vTaskDelay(pdMS_TO_TICKS(DS18B20_CONVERSION_TIME_12_BITS_MS >> (12 - DS18B20_resolution_bits)) + 1);
+            onewire_depower(DS18B20_SENSOR_DATA_PIN);
+
             /**
-             *  En caso de error de medición del sensor, cargamos a la variable de temperatura
-             *  el valor definido para detección de error de forma externa a la librería.
+             *  Se leen las temperaturas de todas las sondas. Las que no se pudieron leer conservan el valor NAN.
              */
-            DS18B20_temp_value = DS18B20_MEASURE_ERROR;
-            ESP_LOGE(TAG, "Failed to get temp.");
+            for(int i = 0; i < probe_count; i++)
+            {
+                addr_list[i] = DS18B20_probes[i].addr;
+                temp_list[i] = NAN;
+            }
+
+            ds18x20_read_temp_multi(DS18B20_SENSOR_DATA_PIN, addr_list, probe_count, temp_list);
+        }
+
+        else
+        {
+            for(int i = 0; i < probe_count; i++)
+            {
+                temp_list[i] = NAN;
+            }
+        }
+
+        int64_t now_us = esp_timer_get_time();
+
+        portENTER_CRITICAL(&DS18B20_mux);
+        for(int i = 0; i < probe_count; i++)
+        {
+            /**
+             *  En caso de error de medición de una sonda, cargamos a su temperatura el valor definido
+             *  para detección de error de forma externa a la librería.
+             */
+            if(isnan(temp_list[i]))
+            {
+                DS18B20_probes[i].temp = DS18B20_MEASURE_ERROR;
+            }
+
+            else
+            {
+                DS18B20_probes[i].temp = temp_list[i];
+                DS18B20_probes[i].last_valid_us = now_us;
+                valid_count++;
+            }
+        }
+
+        if(valid_count == 0)
+        {
+            DS18B20_probe_count = 0;
+        }
+        portEXIT_CRITICAL(&DS18B20_mux);
+
+        if(valid_count < probe_count || probe_count == 0)
+        {
+            ESP_LOGE(TAG, "Failed to get temp (%d of %d probes).", probe_count - valid_count, probe_count);
         }
         
         /**
@@ -91,8 +276,34 @@ static void vTaskGetTemp(void *pvParameters)
             DS18B20Callback(NULL);
         }
 
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(DS18B20_PERIOD_MS));
+    }
+}
+
+
+
+/**
+ * @brief   Función para obtener la temperatura de una sonda y el instante de su última medición válida.
+ * 
+ * @param probe_idx         Índice de la sonda.
+ * @param temp              Variable donde se guarda la temperatura.
+ * @param last_valid_us     Variable donde se guarda el instante de la última medición válida.
+ * @return esp_err_t    ESP_FAIL si no existe la sonda o su última medición fue errónea.
+ */
+static esp_err_t DS18B20_get_probe_temp(int probe_idx, DS18B20_sensor_temp_t *temp, int64_t *last_valid_us)
+{
+    esp_err_t ret = ESP_FAIL;
+
+    portENTER_CRITICAL(&DS18B20_mux);
+    if(probe_idx < DS18B20_probe_count && DS18B20_probes[probe_idx].temp != DS18B20_MEASURE_ERROR)
+    {
+        *temp = DS18B20_probes[probe_idx].temp;
+        *last_valid_us = DS18B20_probes[probe_idx].last_valid_us;
+        ret = ESP_OK;
     }
+    portEXIT_CRITICAL(&DS18B20_mux);
+
+    return ret;
 }
 
 //==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
@@ -171,23 +382,48 @@ esp_err_t DS18B20_sensor_init(DS18B20_sensor_data_pin_t DS18B20_sens_data_pin)
 
 /**
  * @brief   Función para guardar en la variable pasada como argumento el valor de temperatura
- *          obtenido del sensor DS18B20.
+ *          obtenido de la sonda DS18B20 principal.
  * 
  * @param DS18B20_value_buffer     Variable donde se guardará el valor de temperatura obtenido.
  * @return esp_err_t 
  */
 esp_err_t DS18B20_getTemp(DS18B20_sensor_temp_t *DS18B20_value_buffer)
 {
+    int64_t last_valid_us;
+
     /**
      *  En caso de que se haya producido un error al sensar, se retorna
      *  ESP_FAIL para indicar la presencia de dicho error.
      */
-    if(DS18B20_temp_value == DS18B20_MEASURE_ERROR)
+    return DS18B20_get_probe_temp(0, DS18B20_value_buffer, &last_valid_us);
+}
+
+
+
+/**
+ * @brief   Función para guardar en la variable pasada como argumento el valor de temperatura
+ *          obtenido de la sonda DS18B20 principal, solo si la medición no es más antigua que la edad indicada.
+ * 
+ * @param DS18B20_value_buffer     Variable donde se guardará el valor de temperatura obtenido.
+ * @param max_age_ms    Edad máxima aceptada de la medición, en ms.
+ * @return esp_err_t    ESP_FAIL si la última medición fue errónea, ESP_ERR_TIMEOUT si es más antigua que max_age_ms.
+ */
+esp_err_t DS18B20_getFreshTemp(DS18B20_sensor_temp_t *DS18B20_value_buffer, uint32_t max_age_ms)
+{
+    DS18B20_sensor_temp_t temp;
+    int64_t last_valid_us;
+
+    if(DS18B20_get_probe_temp(0, &temp, &last_valid_us) != ESP_OK)
     {
         return ESP_FAIL;
     }
 
-    *DS18B20_value_buffer = DS18B20_temp_value;
+    if(esp_timer_get_time() - last_valid_us > (int64_t) max_age_ms * 1000)
+    {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    *DS18B20_value_buffer = temp;
 
     return ESP_OK;
 }
@@ -203,4 +439,93 @@ esp_err_t DS18B20_getTemp(DS18B20_sensor_temp_t *DS18B20_value_buffer)
 void DS18B20_callback_function_on_new_measurment(DS18B20SensorCallbackFunction callback_function)
 {
     DS18B20Callback = callback_function;
+}
+
+
+
+/**
+ * @brief   Función para obtener la cantidad de sondas DS18B20 encontradas en el bus.
+ * 
+ * @return int  Cantidad de sondas.
+ */
+int DS18B20_get_probe_count(void)
+{
+    return DS18B20_probe_count;
+}
+
+
+
+/**
+ * @brief   Función para obtener la dirección ROM de una sonda. Las sondas están ordenadas por dirección ROM,
+ *          siendo la de índice 0 la sonda principal.
+ * 
+ * @param probe_idx     Índice de la sonda (0 a DS18B20_get_probe_count() - 1).
+ * @param addr          Variable donde se guarda la dirección ROM.
+ * @return esp_err_t 
+ */
+esp_err_t DS18B20_get_probe_addr(int probe_idx, DS18B20_sensor_addr_t *addr)
+{
+    ESP_RETURN_ON_FALSE(addr != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    portENTER_CRITICAL(&DS18B20_mux);
+    if(probe_idx >= 0 && probe_idx < DS18B20_probe_count)
+    {
+        *addr = DS18B20_probes[probe_idx].addr;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&DS18B20_mux);
+
+    return ret;
+}
+
+
+
+/**
+ * @brief   Función para guardar en la variable pasada como argumento el valor de temperatura de la sonda
+ *          con la dirección ROM indicada.
+ * 
+ * @param addr                  Dirección ROM de la sonda.
+ * @param DS18B20_value_buffer  Variable donde se guardará el valor de temperatura obtenido.
+ * @return esp_err_t    ESP_ERR_NOT_FOUND si no hay una sonda con esa dirección, ESP_FAIL si su última medición fue errónea.
+ */
+esp_err_t DS18B20_getTempByAddr(DS18B20_sensor_addr_t addr, DS18B20_sensor_temp_t *DS18B20_value_buffer)
+{
+    ESP_RETURN_ON_FALSE(DS18B20_value_buffer != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+
+    portENTER_CRITICAL(&DS18B20_mux);
+    for(int i = 0; i < DS18B20_probe_count; i++)
+    {
+        if(DS18B20_probes[i].addr == addr)
+        {
+            ret = (DS18B20_probes[i].temp == DS18B20_MEASURE_ERROR) ? ESP_FAIL : ESP_OK;
+            *DS18B20_value_buffer = DS18B20_probes[i].temp;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&DS18B20_mux);
+
+    return ret;
+}
+
+
+
+/**
+ * @brief   Función para configurar la resolución de todas las sondas, que se aplica en el siguiente ciclo de medición.
+ *          A menor resolución, menor tiempo de conversión (93,75 ms a 9 bits, 750 ms a 12 bits).
+ * 
+ * @param resolution_bits   Resolución, entre 9 y 12 bits.
+ * @return esp_err_t 
+ */
+esp_err_t DS18B20_set_resolution(uint8_t resolution_bits)
+{
+    ESP_RETURN_ON_FALSE(resolution_bits >= 9 && resolution_bits <= 12, ESP_ERR_INVALID_ARG, TAG, "Invalid resolution.");
+
+    DS18B20_resolution_bits = resolution_bits;
+    DS18B20_resolution_pending = 1;
+
+    return ESP_OK;
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ extern "C" {
 /*==================[INCLUDES]=============================================*/
 
 #include <stdio.h>
+#include <stdint.h>
 #include "esp_err.h"
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
@@ -23,9 +24,23 @@ extern "C" {
 
 #define DS18B20_MEASURE_ERROR -2 
 
+/* Cantidad máxima de sondas DS18B20 en el bus 1-Wire. */
+#define DS18B20_MAX_PROBES 4
+
+/**
+ *  Resolución por defecto de las sondas, en bits (9 a 12). El tiempo de conversión es de 93,75 ms a 9 bits
+ *  (0,5 °C), y se duplica por cada bit adicional hasta 750 ms a 12 bits (0,0625 °C).
+ */
+#ifndef DS18B20_RESOLUTION_DEFAULT
+#define DS18B20_RESOLUTION_DEFAULT 12
+#endif
+
 typedef gpio_num_t DS18B20_sensor_data_pin_t;
 typedef float DS18B20_sensor_temp_t;
 
+/* Dirección ROM (64 bits) de una sonda en el bus 1-Wire. */
+typedef uint64_t DS18B20_sensor_addr_t;
+
 /**
  *  @brief  Puntero a función que será utilizado para ejecutar la función que se pase
  *          como callback cuando finalice una nueva conversión del sensor.
@@ -38,7 +53,12 @@ typedef void (*DS18B20SensorCallbackFunction)(void *pvParameters);
 
 esp_err_t DS18B20_sensor_init(DS18B20_sensor_data_pin_t DS18B20_sens_data_pin);
 esp_err_t DS18B20_getTemp(DS18B20_sensor_temp_t *DS18B20_value_buffer);
+esp_err_t DS18B20_getFreshTemp(DS18B20_sensor_temp_t *DS18B20_value_buffer, uint32_t max_age_ms);
 void DS18B20_callback_function_on_new_measurment(DS18B20SensorCallbackFunction callback_function);
+int DS18B20_get_probe_count(void);
+esp_err_t DS18B20_get_probe_addr(int probe_idx, DS18B20_sensor_addr_t *addr);
+esp_err_t DS18B20_getTempByAddr(DS18B20_sensor_addr_t addr, DS18B20_sensor_temp_t *DS18B20_value_buffer);
+esp_err_t DS18B20_set_resolution(uint8_t resolution_bits);
 
 /*==================[END OF FILE]============================================*/
 
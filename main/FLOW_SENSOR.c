@@ -1,7 +1,8 @@
 /**
  * @file FLOW_SENSOR.c
  * @author Franco Bisciglia, David Kündinger
- * @brief   Librería utilizada para obtener datos desde el sensor de flujo de efecto hall YF-S201.
+ * @brief   Librería utilizada para obtener datos desde el sensor de flujo de efecto hall YF-S201. Los pulsos del sensor se cuentan
+ *          con el periférico PCNT, sin intervención de la CPU por cada pulso.
  * @version 0.1
  * @date 2023-01-01
  * 
@@ -16,6 +17,7 @@
 #include <stdio.h>
 
 #include "driver/gpio.h"
+#include "driver/pcnt.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -23,23 +25,62 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
+#include "nvs_flash.h"
 
 #include "FLOW_SENSOR.h"
 
 //==================================| MACROS AND TYPDEF |==================================//
 
+/* Período de cálculo del caudal a partir de los pulsos contados, en ms. */
+#define FLOW_SENSOR_PERIOD_MS 1000
+
+/* Unidad del periférico PCNT utilizada para contar los pulsos del sensor. */
+#define FLOW_SENSOR_PCNT_UNIT PCNT_UNIT_0
+
+/**
+ *  Límite superior del contador del PCNT: al alcanzarlo el contador vuelve a 0, por lo que los pulsos de cada período se
+ *  obtienen como la diferencia respecto de la lectura anterior, módulo este límite, sin borrar el contador (y sin perder
+ *  los pulsos que lleguen entre la lectura y el borrado).
+ */
+#define FLOW_SENSOR_PCNT_H_LIM 30000
+
+/**
+ *  Filtro de glitches del PCNT: se ignoran los pulsos más cortos que esta cantidad de ciclos del clock APB (80 MHz).
+ *  1023 es el máximo del periférico (12,8 us).
+ */
+#define FLOW_SENSOR_PCNT_FILTER_VALUE 1023
+
+/* Período mínimo entre escrituras del volumen totalizado en memoria NVS, para limitar el desgaste de la flash. */
+#define FLOW_SENSOR_NVS_SAVE_PERIOD_MS 300000
+
+#define FLOW_SENSOR_NVS_NAMESPACE "flow"
+#define FLOW_SENSOR_NVS_KEY_TOTAL "total"
+#define FLOW_SENSOR_NVS_KEY_K_FACTOR "k_factor"
 
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 /* Tag para imprimir información en el LOG. */
 static const char *TAG = "FLOW_SENSOR_LIBRARY";
 
-/* Variable utilizada para contar la cantidad de pulsos por segundo que entrega el sensor de flujo */
-static int flow_sensor_pulse_counter = 0;
-
 /* Variable donde se guarda el valor obtenido de flujo circulante en L/min */
 static float flow_liters_per_min = 0;
 
+/* Volumen totalizado de líquido que circuló por el sensor, en L. */
+static double flow_total_liters = 0;
+
+/* Factor K del sensor, en Hz / (L/min). */
+static float flow_k_factor = FLOW_SENSOR_K_FACTOR_DEFAULT;
+
+/**
+ *  Bandera que indica que se puso en 0 el volumen totalizado y que la tarea debe guardarlo en memoria NVS. La tarea es
+ *  la única que escribe el volumen en NVS, para que un guardado periódico no pise el valor puesto en 0.
+ */
+static bool flow_total_reset_pending = 0;
+
+/* Spinlock para el acceso al volumen totalizado y al factor K desde otras tareas. */
+static portMUX_TYPE flow_mux = portMUX_INITIALIZER_UNLOCKED;
+
 /* Handle de la tarea de obtención del valor de flujo */
 static TaskHandle_t xFlowTaskHandle = NULL;
 
@@ -47,63 +88,111 @@ static TaskHandle_t xFlowTaskHandle = NULL;
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
-static void flow_sensor_isr_handler(void *args);
 static void vTaskGetFlow(void *pvParameters);
+static esp_err_t flow_sensor_nvs_save(const char *key, const void *value, size_t size);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
- * @brief   Rutina de servicio de interrupción del GPIO correspondiente al pin de datos del sensor de flujo,
- *          mediante la cual se incrementa la cantidad de pulsos cada vez que ocurre una interrupción por
- *          flanco ascendente.
- * 
- * @param args      Parámetros pasados a la rutina de servicios de interrupción de GPIO.
- */
-static void flow_sensor_isr_handler(void *args)
-{
-    /**
-     *  Se incrementa la cantidad de pulsos en 1 unidad.
-     */
-    flow_sensor_pulse_counter++;
-}
-
-
-
-/**
- * @brief   Tarea encargada de convertir la cantidad de pulsos por segundo obtenidos desde el sensor
- *          de flujo en flujo en L/min.
+ * @brief   Tarea encargada de convertir la cantidad de pulsos contados por el PCNT en cada período
+ *          en flujo en L/min, y de acumular el volumen totalizado.
  * 
  * @param pvParameters      Parámetros pasados a la tarea en su creación.
  */
 static void vTaskGetFlow(void *pvParameters)
 {
-    /**
-     *  Inicializamos el contador de pulsos en 0.
-     */
-    flow_sensor_pulse_counter = 0;
+    int16_t prev_count = 0;
+    pcnt_get_counter_value(FLOW_SENSOR_PCNT_UNIT, &prev_count);
+
+    int64_t prev_time_us = esp_timer_get_time();
+    int64_t last_save_us = prev_time_us;
+    double saved_total_liters = flow_total_liters;
+
+    TickType_t xLastWakeTime = xTaskGetTickCount();
 
     while(1)
     {
-        /**
-         *  Esperamos un ciclo completo de 1 segundo, para así obtener la frecuencia de pulsos
-         *  directamente en Hz.
-         */
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(FLOW_SENSOR_PERIOD_MS));
+
+        int16_t count = 0;
+        pcnt_get_counter_value(FLOW_SENSOR_PCNT_UNIT, &count);
+        int64_t now_us = esp_timer_get_time();
+
+        uint32_t pulses = (count - prev_count + FLOW_SENSOR_PCNT_H_LIM) % FLOW_SENSOR_PCNT_H_LIM;
+        float elapsed_s = (now_us - prev_time_us) / 1e6f;
+
+        prev_count = count;
+        prev_time_us = now_us;
 
         /**
          *  A partir de la siguiente ecuación provista por el fabricante del sensor:
          * 
-         *  f(Hz) = 7.5 * Q(L/min)
+         *  f(Hz) = K * Q(L/min)
          * 
-         *  Podemos obtener el caudal circulante a partir de la cantidad de pulsos por 
-         *  segundo obtenidos.
+         *  Podemos obtener el caudal circulante a partir de la frecuencia de pulsos, y el volumen
+         *  que circuló en el período, ya que cada pulso corresponde a 1 / (60 * K) litros.
+         */
+        portENTER_CRITICAL(&flow_mux);
+        float k_factor = flow_k_factor;
+        flow_total_liters += pulses / (60.0 * k_factor);
+        double total_liters = flow_total_liters;
+        bool reset = flow_total_reset_pending;
+        flow_total_reset_pending = 0;
+        portEXIT_CRITICAL(&flow_mux);
+
+        flow_liters_per_min = (elapsed_s > 0) ? pulses / (k_factor * elapsed_s) : 0;
+
+        /**
+         *  Se guarda periódicamente el volumen totalizado en memoria NVS, solo si varió, y en el momento si se
+         *  puso en 0.
          */
-        flow_liters_per_min = (flow_sensor_pulse_counter / 7.5);
+        if(reset || (total_liters != saved_total_liters && now_us - last_save_us >= FLOW_SENSOR_NVS_SAVE_PERIOD_MS * 1000LL))
+        {
+            if(flow_sensor_nvs_save(FLOW_SENSOR_NVS_KEY_TOTAL, &total_liters, sizeof(total_liters)) == ESP_OK)
+            {
+                saved_total_liters = total_liters;
+            }
 
-        flow_sensor_pulse_counter = 0;
+            last_save_us = now_us;
+        }
     }
 }
 
+
+
+/**
+ * @brief   Función para guardar un valor en memoria NVS.
+ * 
+ * @param key       Clave del valor.
+ * @param value     Valor a guardar.
+ * @param size      Tamaño del valor.
+ * @return esp_err_t 
+ */
+static esp_err_t flow_sensor_nvs_save(const char *key, const void *value, size_t size)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(FLOW_SENSOR_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+
+    if(ret == ESP_OK)
+    {
+        ret = nvs_set_blob(nvs_handle, key, value, size);
+
+        if(ret == ESP_OK)
+        {
+            ret = nvs_commit(nvs_handle);
+        }
+
+        nvs_close(nvs_handle);
+    }
+
+    if(ret != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to store %s in NVS.", key);
+    }
+
+    return ret;
+}
+
 //==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
@@ -114,40 +203,67 @@ static void vTaskGetFlow(void *pvParameters)
  */
 esp_err_t flow_sensor_init(flux_sensor_data_pin_t flow_sens_data_pin)
 {
-    //========================| CONFIGURACIÓN DE GPIO |===========================//
-
-    /* Variable donde se definen las configuraciones para el GPIO */
-    gpio_config_t pGPIOConfig;
-
-    /* Se define mediante mascara de bits el GPIO que configuraremos */
-    pGPIOConfig.pin_bit_mask = (1ULL << flow_sens_data_pin);
-    /* Se define si el pin es I u O (input en este caso) */
-    pGPIOConfig.mode = GPIO_MODE_DEF_INPUT;
-    /* Habilitamos o deshabilitamos la resistencia interna de pull-up (deshabilitada en este caso) */
-    pGPIOConfig.pull_up_en = GPIO_PULLUP_DISABLE;
-    /* Habilitamos o deshabilitamos la resistencia interna de pull-down (deshabilitada en este caso) */
-    pGPIOConfig.pull_down_en = GPIO_PULLDOWN_DISABLE;
-    /* Definimos si habilitamos la interrupción, y si es asi, de qué tipo (flanco ascendente) */
-    pGPIOConfig.intr_type = GPIO_INTR_POSEDGE;
-    
+    //========================| DATOS GUARDADOS EN NVS |===========================//
+
     /**
-     *  Función para configurar un pin GPIO, incluyendo la interrupción. 
-     *  Se le pasa como parametro un puntero a la variable configurada anteriormente
+     *  Se cargan el volumen totalizado y el factor K guardados en memoria NVS, si los hay.
      */
-    ESP_RETURN_ON_ERROR(gpio_config(&pGPIOConfig), TAG, "Failed to load gpio config.");
+    nvs_handle_t nvs_handle;
+
+    if(nvs_open(FLOW_SENSOR_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK)
+    {
+        double total_liters;
+        float k_factor;
+        size_t size = sizeof(total_liters);
+
+        if(nvs_get_blob(nvs_handle, FLOW_SENSOR_NVS_KEY_TOTAL, &total_liters, &size) == ESP_OK && size == sizeof(total_liters))
+        {
+            flow_total_liters = total_liters;
+        }
+
+        size = sizeof(k_factor);
+
+        if(nvs_get_blob(nvs_handle, FLOW_SENSOR_NVS_KEY_K_FACTOR, &k_factor, &size) == ESP_OK && size == sizeof(k_factor) && k_factor > 0)
+        {
+            flow_k_factor = k_factor;
+        }
+
+        nvs_close(nvs_handle);
+    }
+
+
+
+    //========================| CONFIGURACIÓN DEL PCNT |===========================//
 
     /**
-     *  Mediante esta función, se habilita el servicio mediante el cual se tienen flags globales individuales
-     *  para cada GPIO con interrupción, en vez de tener una unica flag global para todas las interrupciones.
-     *  El 0 es para instanciar las flags en 0.
+     *  Se configura la unidad del PCNT para contar los flancos ascendentes del pin de datos del sensor,
+     *  sin pin de control.
      */
-    ESP_RETURN_ON_ERROR(gpio_install_isr_service(0), TAG, "Failed to install ISR.");
+    pcnt_config_t pcnt_config = {
+        .pulse_gpio_num = flow_sens_data_pin,
+        .ctrl_gpio_num = PCNT_PIN_NOT_USED,
+        .lctrl_mode = PCNT_MODE_KEEP,
+        .hctrl_mode = PCNT_MODE_KEEP,
+        .pos_mode = PCNT_COUNT_INC,
+        .neg_mode = PCNT_COUNT_DIS,
+        .counter_h_lim = FLOW_SENSOR_PCNT_H_LIM,
+        .counter_l_lim = 0,
+        .unit = FLOW_SENSOR_PCNT_UNIT,
+        .channel = PCNT_CHANNEL_0,
+    };
+
+    ESP_RETURN_ON_ERROR(pcnt_unit_config(&pcnt_config), TAG, "Failed to load pcnt config.");
 
     /**
-     *  Funcion para agregar efectivamente una interrupcion a un GPIO, junto con su handler.
+     *  Se habilita el filtro de glitches, para descartar los pulsos espurios cortos.
      */
-    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(flow_sens_data_pin, flow_sensor_isr_handler, NULL), 
-                        TAG, "Failed to add the ISR handler.");
+    ESP_RETURN_ON_ERROR(pcnt_set_filter_value(FLOW_SENSOR_PCNT_UNIT, FLOW_SENSOR_PCNT_FILTER_VALUE), 
+                        TAG, "Failed to set pcnt filter.");
+    ESP_RETURN_ON_ERROR(pcnt_filter_enable(FLOW_SENSOR_PCNT_UNIT), TAG, "Failed to enable pcnt filter.");
+
+    pcnt_counter_pause(FLOW_SENSOR_PCNT_UNIT);
+    pcnt_counter_clear(FLOW_SENSOR_PCNT_UNIT);
+    ESP_RETURN_ON_ERROR(pcnt_counter_resume(FLOW_SENSOR_PCNT_UNIT), TAG, "Failed to start pcnt.");
 
 
 
@@ -155,12 +271,10 @@ esp_err_t flow_sensor_init(flux_sensor_data_pin_t flow_sens_data_pin)
 
     /**
      *  Se crea la tarea encargada de obtener el valor de flujo en L/min a partir
-     *  de la cantidad de pulsos por segundo que entrega el sensor de flujo.
+     *  de la cantidad de pulsos contados por el PCNT en cada período.
      * 
-     *  Se le da una prioridad intermedia de 3, considerando que por un lado se necesita
-     *  una precisión de tiempo para no cometer mucho error en el cálculo del valor de flujo,
-     *  pero por otro lado, en esta aplicación en particular, no es importante el valor
-     *  de flujo en sí, sino solamente conocer si circula o no solución.
+     *  Se le da una prioridad intermedia de 3: el período de cálculo se mide con el timer de alta
+     *  resolución, por lo que una demora en la ejecución de la tarea no introduce error en el caudal.
      */
     if(xFlowTaskHandle == NULL)
     {
@@ -196,6 +310,9 @@ esp_err_t flow_sensor_init(flux_sensor_data_pin_t flow_sens_data_pin)
  */
 esp_err_t flow_sensor_get_flow_L_per_min(flow_sensor_flow_t *flow_value_buffer)
 {
+    ESP_RETURN_ON_FALSE(flow_value_buffer != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+    ESP_RETURN_ON_FALSE(xFlowTaskHandle != NULL, ESP_ERR_INVALID_STATE, TAG, "Flow sensor not initialized.");
+
     *flow_value_buffer = flow_liters_per_min;
 
     return ESP_OK;
@@ -206,14 +323,87 @@ esp_err_t flow_sensor_get_flow_L_per_min(flow_sensor_flow_t *flow_value_buffer)
 /**
  * @brief   Función para saber si hay o no flujo circulando por el sensor de flujo.
  * 
- * @return true     Hay flujo circulando.
+ * @return true     Hay flujo circulando (caudal mayor que FLOW_SENSOR_FLOW_DETECTED_THRESHOLD_L_MIN).
  * @return false    No hay flujo circulando.
  */
 bool flow_sensor_flow_detected()
 {
-    /**
-     *  Se retorna el valor de L/min, pero al retornarlo en formato "bool",
-     *  simplemente se retorna 0 si no hay flujo o 1 si hay algún flujo.
-     */
-    return flow_liters_per_min;
+    return flow_liters_per_min > FLOW_SENSOR_FLOW_DETECTED_THRESHOLD_L_MIN;
+}
+
+
+
+/**
+ * @brief   Función para guardar en la variable pasada como argumento el volumen totalizado de líquido
+ *          que circuló por el sensor de flujo, en L. El volumen se guarda periódicamente en memoria NVS.
+ * 
+ * @param total_value_buffer    Variable donde se guardará el volumen totalizado.
+ * @return esp_err_t 
+ */
+esp_err_t flow_sensor_get_total_L(double *total_value_buffer)
+{
+    ESP_RETURN_ON_FALSE(total_value_buffer != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    portENTER_CRITICAL(&flow_mux);
+    *total_value_buffer = flow_total_liters;
+    portEXIT_CRITICAL(&flow_mux);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para poner en 0 el volumen totalizado, también en memoria NVS. Si la tarea del sensor ya
+ *          fue creada, es ella quien guarda el valor en NVS en su próximo período.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t flow_sensor_reset_total(void)
+{
+    double total_liters = 0;
+
+    portENTER_CRITICAL(&flow_mux);
+    flow_total_liters = total_liters;
+    flow_total_reset_pending = 1;
+    portEXIT_CRITICAL(&flow_mux);
+
+    if(xFlowTaskHandle != NULL)
+    {
+        return ESP_OK;
+    }
+
+    return flow_sensor_nvs_save(FLOW_SENSOR_NVS_KEY_TOTAL, &total_liters, sizeof(total_liters));
+}
+
+
+
+/**
+ * @brief   Función para configurar el factor K del sensor de flujo, según la ecuación f(Hz) = K * Q(L/min).
+ *          El valor se guarda en memoria NVS.
+ * 
+ * @param k_factor  Factor K, en Hz / (L/min).
+ * @return esp_err_t 
+ */
+esp_err_t flow_sensor_set_k_factor(float k_factor)
+{
+    ESP_RETURN_ON_FALSE(k_factor > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid K factor.");
+
+    portENTER_CRITICAL(&flow_mux);
+    flow_k_factor = k_factor;
+    portEXIT_CRITICAL(&flow_mux);
+
+    return flow_sensor_nvs_save(FLOW_SENSOR_NVS_KEY_K_FACTOR, &k_factor, sizeof(k_factor));
+}
+
+
+
+/**
+ * @brief   Función para obtener el factor K configurado del sensor de flujo.
+ * 
+ * @return float    Factor K, en Hz / (L/min).
+ */
+float flow_sensor_get_k_factor(void)
+{
+    return flow_k_factor;
 }
\ No newline at end of file
@@ -14,11 +14,20 @@ extern "C" {
 /*==================[INCLUDES]=============================================*/
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "esp_err.h"
 #include "driver/gpio.h"
 
 /*==================[DEFINES AND MACROS]=====================================*/
 
+/**
+ *  Factor K por defecto del sensor (YF-S201), según la ecuación del fabricante: f(Hz) = K * Q(L/min).
+ */
+#define FLOW_SENSOR_K_FACTOR_DEFAULT 7.5
+
+/* Caudal a partir del cual se considera que circula líquido por el sensor, en L/min. */
+#define FLOW_SENSOR_FLOW_DETECTED_THRESHOLD_L_MIN 0.5
+
 typedef gpio_num_t flux_sensor_data_pin_t;
 typedef float flow_sensor_flow_t;
 
@@ -29,6 +38,10 @@ typedef float flow_sensor_flow_t;
 esp_err_t flow_sensor_init(flux_sensor_data_pin_t flow_sens_data_pin);
 esp_err_t flow_sensor_get_flow_L_per_min(flow_sensor_flow_t *flow_value_buffer);
 bool flow_sensor_flow_detected();
+esp_err_t flow_sensor_get_total_L(double *total_value_buffer);
+esp_err_t flow_sensor_reset_total(void);
+esp_err_t flow_sensor_set_k_factor(float k_factor);
+float flow_sensor_get_k_factor(void);
 
 /*==================[END OF FILE]============================================*/
 
@@ -0,0 +1,1146 @@
+/**
+ * @file HYSTERESIS_CONTROLLER.c
+ * @author Franco Bisciglia, David Kündinger
+ * @brief   Motor de lazos de control por ventana de histéresis, configurados mediante descriptores constantes
+ *          y evaluados por una única tarea.
+ * @version 0.1
+ * @date 2023-01-16
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+
+
+/**
+ * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
+ *
+ *          Los algoritmos de control de pH, TDS y temperatura de la solución implementan la misma jerarquía de MEFs:
+ *
+ *      1) MEF principal: alterna entre modo AUTOMATICO y modo MANUAL. En modo MANUAL, los actuadores se accionan
+ *         desde los tópicos MQTT del descriptor. Al desconectarse del broker MQTT se vuelve al modo AUTOMATICO.
+ *      2) MEF de control de la variable: control por ventana de histéresis con los estados CORRECTO, BAJO y ELEVADO.
+ *      3) MEF de pulsos de dosificación: en los lazos con dosificación por pulsos, abre y cierra la válvula del
+ *         estado BAJO o ELEVADO con los tiempos de apertura y cierre del descriptor.
+ *
+ *          Si el descriptor tiene ganancias distintas de 0, el tiempo de apertura de cada pulso no es fijo, sino que
+ *      se calcula al abrir la válvula con un control PI sobre el error entre el último valor sensado y el set point
+ *      (centro del rango correcto): t = Kp * e + Ki * suma(e), limitado entre los tiempos de apertura mínimo y máximo.
+ *      El término integral se acumula una vez por pulso, se resetea al entrar al estado BAJO o ELEVADO, y no se acumula
+ *      mientras la salida está saturada (anti-windup). Luego de cada pulso, la válvula queda cerrada al menos el tiempo
+ *      muerto de mezcla, ya que el sensor está a la salida del canal de cultivo y la dosis tarda en llegar a él.
+ *
+ *          Cada lazo se describe con un descriptor constante (actuadores, enclavamientos, tiempos de los pulsos,
+ *      tópicos del modo MANUAL), y una única tarea evalúa todos los lazos registrados. Los tiempos de los pulsos se
+ *      controlan con plazos en ticks evaluados por la misma tarea, en lugar de un timer de FreeRTOS por lazo.
+ *
+ *          La tarea no evalúa los lazos periódicamente, sino que queda bloqueada esperando una notificación, o hasta que
+ *      vence el plazo del pulso de dosificación más cercano. Solo los nuevos valores sensados se envían por una cola de
+ *      eventos, ya que descartar una muestra si la cola está llena no tiene consecuencias. Los demás eventos no pasan por
+ *      la cola, sino que se acumulan en una máscara de eventos pendientes por lazo: los eventos con datos (nuevos límites,
+ *      cambio de modo o de error de sensado) guardan además su último valor en el lazo, y los eventos sin datos (estado de
+ *      un actuador en modo MANUAL, cambio de un enclavamiento, desconexión del broker MQTT) solo marcan el bit. Si se
+ *      repiten antes de que se procesen se combinan en uno solo, y no se pueden perder por estar llena la cola. Al
+ *      despertarse, la tarea aplica todos los eventos recibidos, y evalúa una vez las MEFs de cada lazo con algún evento,
+ *      y de los lazos cuyo pulso de dosificación venció.
+ *
+ *          Los cambios de estado de los relés que no pertenecen a ningún lazo (por ejemplo, la bomba de solución) se
+ *      reciben mediante una función callback del servicio de actuadores, y la desconexión del broker MQTT mediante un
+ *      handler de eventos del cliente MQTT. Los cambios de nivel de los tanques los notifica cada lazo mediante
+ *      "hyst_ctrl_notify()". La cantidad de veces que se despierta la tarea y de eventos procesados por tipo se obtiene
+ *      con "hyst_ctrl_get_stats()".
+ */
+
+
+
+//==================================| INCLUDES |==================================//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "mqtt_client.h"
+#include "MQTT_PUBL_SUSCR.h"
+#include "MCP23008.h"
+#include "ACTUATOR_SERVICE.h"
+#include "HYSTERESIS_CONTROLLER.h"
+
+//==================================| MACROS AND TYPDEF |==================================//
+
+/* Cantidad máxima de evaluaciones seguidas de un lazo por despertar de la tarea, para completar transiciones encadenadas. */
+#define HYST_CTRL_MAX_PASADAS 3
+
+/* Estado de un lazo de control. */
+struct hyst_ctrl_loop {
+    const hyst_ctrl_loop_desc_t *desc;      /* Descriptor del lazo. */
+
+    float valor;                            /* Último valor sensado de la variable. */
+    float limite_inferior;                  /* Límite inferior del rango correcto. */
+    float limite_superior;                  /* Límite superior del rango correcto. */
+
+    bool manual_mode_flag;                  /* Bandera de modo MANUAL. */
+    bool sensor_error_flag;                 /* Bandera de error de sensado. */
+
+    /* Banderas utilizadas para controlar las transiciones con reset de las MEFs de control y de pulsos. */
+    bool reset_transition_flag_control;
+    bool reset_transition_flag_pulso;
+
+    /* Bandera que indica que se cumplió el tiempo de apertura o cierre del pulso de dosificación. */
+    bool pulso_finished_flag;
+
+    /* Término integral acumulado del control PI de los pulsos de dosificación. */
+    float integral;
+
+    /* Plazo del pulso de dosificación en curso. */
+    bool pulso_activo;
+    TickType_t pulso_inicio;
+    TickType_t pulso_periodo;
+
+    hyst_ctrl_modo_t modo;
+    hyst_ctrl_estado_t estado;
+    hyst_ctrl_estado_pulso_t estado_pulso;
+
+    /* Últimos datos de los eventos LIMITES, MODO y ERROR_SENSOR pendientes de aplicar, protegidos por "hyst_ctrl_mux". */
+    struct {
+        float limite_inferior;
+        float limite_superior;
+        bool manual_mode_flag;
+        bool sensor_error_flag;
+    } pendiente;
+};
+
+//==================================| INTERNAL DATA DEFINITION |==================================//
+
+/* Tag para imprimir información en el LOG. */
+static const char *TAG = "HYSTERESIS_CONTROLLER";
+
+/* Task Handle de la tarea que evalúa los lazos de control. */
+static TaskHandle_t xHystCtrlTaskHandle = NULL;
+
+/* Cola de eventos con datos de la tarea que evalúa los lazos de control. */
+static QueueHandle_t xHystCtrlEventQueue = NULL;
+
+/* Eventos pendientes de cada lazo (todos salvo MUESTRA), como máscara de bits de "hyst_ctrl_evento_tipo_t". */
+static uint32_t hyst_ctrl_pendientes[HYST_CTRL_MAX_LOOPS];
+
+/* Lazos de control registrados. */
+static struct hyst_ctrl_loop hyst_ctrl_loops[HYST_CTRL_MAX_LOOPS];
+static int hyst_ctrl_loop_count = 0;
+
+/* Máscara de los relés accionados por los lazos registrados. */
+static uint8_t hyst_ctrl_reles_lazos = 0;
+
+/* Bandera que indica si ya se asignó el handler de desconexión del broker MQTT. */
+static bool hyst_ctrl_mqtt_handler_registered = 0;
+
+/* Estadísticas del motor. */
+static hyst_ctrl_stats_t hyst_ctrl_stats;
+
+/* Spinlock para el registro de lazos, los eventos pendientes y las estadísticas. */
+static portMUX_TYPE hyst_ctrl_mux = portMUX_INITIALIZER_UNLOCKED;
+
+//==================================| EXTERNAL DATA DEFINITION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
+
+static void hyst_ctrl_set_actuador(hyst_ctrl_loop_handle_t loop, int8_t relay_num, const char *nombre, bool encendido);
+static bool hyst_ctrl_habilitado(hyst_ctrl_loop_handle_t loop, HystCtrlInterlockFunction bloqueo_actuador);
+static void hyst_ctrl_entrar(hyst_ctrl_loop_handle_t loop, hyst_ctrl_estado_t estado, int8_t relay_num, const char *nombre);
+static void hyst_ctrl_salir(hyst_ctrl_loop_handle_t loop, int8_t relay_num, const char *nombre);
+static uint32_t hyst_ctrl_tiempo_apertura_ms(hyst_ctrl_loop_handle_t loop, int8_t relay_num);
+static uint32_t hyst_ctrl_tiempo_cierre_ms(hyst_ctrl_loop_handle_t loop);
+static void MEFControlPulso(hyst_ctrl_loop_handle_t loop, int8_t relay_num, const char *nombre);
+static void MEFControlVariable(hyst_ctrl_loop_handle_t loop);
+static void hyst_ctrl_modo_manual(hyst_ctrl_loop_handle_t loop);
+static void MEFPrincipal(hyst_ctrl_loop_handle_t loop);
+static esp_err_t hyst_ctrl_post(const hyst_ctrl_evento_t *evento);
+static void hyst_ctrl_post_dato(hyst_ctrl_loop_handle_t loop, hyst_ctrl_evento_tipo_t tipo, float inferior, float superior, bool flag);
+static void hyst_ctrl_actuator_change_callback(uint8_t changed_mask, uint8_t state);
+static void hyst_ctrl_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static void hyst_ctrl_aplicar_pendientes(struct hyst_ctrl_loop *loop, uint32_t pendientes);
+static TickType_t hyst_ctrl_tiempo_espera(void);
+static void vTaskHystCtrl(void *pvParameters);
+
+//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para encender o apagar un actuador del lazo, respetando la polaridad de sus relés.
+ *
+ * @param loop          Lazo de control.
+ * @param relay_num     Relé del actuador.
+ * @param nombre        Nombre del actuador, para el LOG.
+ * @param encendido     Estado del actuador.
+ */
+static void hyst_ctrl_set_actuador(hyst_ctrl_loop_handle_t loop, int8_t relay_num, const char *nombre, bool encendido)
+{
+    actuator_service_set_relay(relay_num, encendido ? loop->desc->nivel_encendido : !loop->desc->nivel_encendido);
+    ESP_LOGW(loop->desc->tag, "%s: %s", nombre, encendido ? "ON" : "OFF");
+}
+
+
+
+/**
+ * @brief   Función que indica si se puede accionar un actuador: no debe haber error de sensado, ni
+ *          estar activo el enclavamiento común del lazo ni el del actuador.
+ *
+ * @param loop              Lazo de control.
+ * @param bloqueo_actuador  Enclavamiento del actuador (NULL si no hay).
+ * @return true     Se puede accionar el actuador.
+ * @return false    El actuador está bloqueado.
+ */
+static bool hyst_ctrl_habilitado(hyst_ctrl_loop_handle_t loop, HystCtrlInterlockFunction bloqueo_actuador)
+{
+    return !(loop->desc->bloqueo != NULL && loop->desc->bloqueo())
+        && !loop->sensor_error_flag
+        && !(bloqueo_actuador != NULL && bloqueo_actuador());
+}
+
+
+
+/**
+ * @brief   Función para transicionar desde el estado CORRECTO al estado BAJO o ELEVADO.
+ *
+ * @param loop          Lazo de control.
+ * @param estado        Nuevo estado.
+ * @param relay_num     Relé del actuador a accionar.
+ * @param nombre        Nombre del actuador, para el LOG.
+ */
+static void hyst_ctrl_entrar(hyst_ctrl_loop_handle_t loop, hyst_ctrl_estado_t estado, int8_t relay_num, const char *nombre)
+{
+    if(loop->desc->tiempo_apertura_ms > 0)
+    {
+        /**
+         *  Se setea la bandera de fin de pulso para que en la sub-MEF de pulsos de dosificación, cuyo
+         *  estado de reset es con la válvula cerrada, se transicione inmediatamente a válvula abierta.
+         *  Se evalúa la sub-MEF en el momento, ya que no hay una próxima evaluación periódica, salvo
+         *  que se esté pasando a modo MANUAL, donde la sub-MEF de pulsos no se evalúa.
+         */
+        loop->pulso_finished_flag = 1;
+        loop->integral = 0;
+
+        if(loop->modo == HYST_CTRL_MODO_AUTO)
+        {
+            MEFControlPulso(loop, relay_num, nombre);
+        }
+    }
+
+    else
+    {
+        hyst_ctrl_set_actuador(loop, relay_num, nombre, 1);
+    }
+
+    loop->estado = estado;
+}
+
+
+
+/**
+ * @brief   Función para transicionar desde el estado BAJO o ELEVADO al estado CORRECTO.
+ *
+ * @param loop          Lazo de control.
+ * @param relay_num     Relé del actuador a apagar.
+ * @param nombre        Nombre del actuador, para el LOG.
+ */
+static void hyst_ctrl_salir(hyst_ctrl_loop_handle_t loop, int8_t relay_num, const char *nombre)
+{
+    if(loop->desc->tiempo_apertura_ms > 0)
+    {
+        loop->reset_transition_flag_pulso = 1;
+    }
+
+    else
+    {
+        hyst_ctrl_set_actuador(loop, relay_num, nombre, 0);
+    }
+
+    loop->estado = HYST_CTRL_CORRECTO;
+}
+
+
+
+/**
+ * @brief   Función que calcula el tiempo de apertura del pulso de dosificación que comienza. Sin control PI, es el
+ *          tiempo de apertura fijo del descriptor. Con control PI, se calcula a partir del error entre el último
+ *          valor sensado y el set point, en el sentido que corrige la válvula accionada.
+ *
+ * @param loop          Lazo de control.
+ * @param relay_num     Relé de la válvula a abrir.
+ * @return uint32_t     Tiempo de apertura, en ms.
+ */
+static uint32_t hyst_ctrl_tiempo_apertura_ms(hyst_ctrl_loop_handle_t loop, int8_t relay_num)
+{
+    const hyst_ctrl_loop_desc_t *desc = loop->desc;
+
+    if(desc->ganancia_kp <= 0 && desc->ganancia_ki <= 0)
+    {
+        return desc->tiempo_apertura_ms;
+    }
+
+    float set_point = (loop->limite_inferior + loop->limite_superior) / 2;
+    float error = (relay_num == desc->actuador_aumento) ? set_point - loop->valor : loop->valor - set_point;
+
+    if(error < 0)
+    {
+        error = 0;
+    }
+
+    float max = desc->tiempo_apertura_max_ms;
+    float min = desc->tiempo_apertura_min_ms;
+    float tiempo = desc->ganancia_kp * error + desc->ganancia_ki * (loop->integral + error);
+
+    /**
+     *  Anti-windup: solo se acumula el error si la salida no está saturada en el máximo.
+     */
+    if(tiempo < max)
+    {
+        loop->integral += error;
+    }
+
+    else
+    {
+        tiempo = max;
+    }
+
+    if(tiempo < min)
+    {
+        tiempo = min;
+    }
+
+    return tiempo;
+}
+
+
+
+/**
+ * @brief   Función que calcula el tiempo de cierre entre pulsos de dosificación: el tiempo de cierre del descriptor,
+ *          extendido al tiempo muerto de mezcla si el lazo usa control PI.
+ *
+ * @param loop          Lazo de control.
+ * @return uint32_t     Tiempo de cierre, en ms.
+ */
+static uint32_t hyst_ctrl_tiempo_cierre_ms(hyst_ctrl_loop_handle_t loop)
+{
+    const hyst_ctrl_loop_desc_t *desc = loop->desc;
+
+    if((desc->ganancia_kp > 0 || desc->ganancia_ki > 0) && desc->tiempo_mezcla_ms > desc->tiempo_cierre_ms)
+    {
+        return desc->tiempo_mezcla_ms;
+    }
+
+    return desc->tiempo_cierre_ms;
+}
+
+
+
+/**
+ * @brief   Función de la MEF de los pulsos de dosificación. Dado que en ningun momento se deben accionar ambas
+ *          válvulas a la vez, se comparte el estado de la MEF entre ambas.
+ *
+ * @param loop          Lazo de control.
+ * @param relay_num     Relé de la válvula a accionar.
+ * @param nombre        Nombre de la válvula, para el LOG.
+ */
+static void MEFControlPulso(hyst_ctrl_loop_handle_t loop, int8_t relay_num, const char *nombre)
+{
+    /**
+     *  Se controla si se debe hacer una transición con reset, caso en el cual se vuelve al estado
+     *  de válvula cerrada y se cancela el plazo del pulso en curso.
+     */
+    if(loop->reset_transition_flag_pulso)
+    {
+        loop->estado_pulso = HYST_CTRL_PULSO_CERRADO;
+        loop->reset_transition_flag_pulso = 0;
+
+        loop->pulso_activo = 0;
+        loop->pulso_finished_flag = 0;
+
+        hyst_ctrl_set_actuador(loop, relay_num, nombre, 0);
+    }
+
+    /**
+     *  Al cumplirse el tiempo de apertura o cierre, se acciona la válvula y se inicia el plazo del pulso siguiente.
+     */
+    if(loop->pulso_finished_flag)
+    {
+        loop->pulso_finished_flag = 0;
+        loop->pulso_activo = 1;
+        loop->pulso_inicio = xTaskGetTickCount();
+
+        switch(loop->estado_pulso)
+        {
+
+        case HYST_CTRL_PULSO_CERRADO:
+
+            loop->pulso_periodo = pdMS_TO_TICKS(hyst_ctrl_tiempo_apertura_ms(loop, relay_num));
+            hyst_ctrl_set_actuador(loop, relay_num, nombre, 1);
+            loop->estado_pulso = HYST_CTRL_PULSO_ABIERTO;
+
+            break;
+
+
+        case HYST_CTRL_PULSO_ABIERTO:
+
+            loop->pulso_periodo = pdMS_TO_TICKS(hyst_ctrl_tiempo_cierre_ms(loop));
+            hyst_ctrl_set_actuador(loop, relay_num, nombre, 0);
+            loop->estado_pulso = HYST_CTRL_PULSO_CERRADO;
+
+            break;
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Función de la MEF de control de la variable. Mediante un control de ventana de histéresis, se accionan
+ *          los actuadores correspondientes según sea requerido para mantener la variable dentro de los límites
+ *          inferior y superior establecidos.
+ *
+ * @param loop  Lazo de control.
+ */
+static void MEFControlVariable(hyst_ctrl_loop_handle_t loop)
+{
+    const hyst_ctrl_loop_desc_t *desc = loop->desc;
+    bool por_pulsos = desc->tiempo_apertura_ms > 0;
+
+    /**
+     *  Se controla si se debe hacer una transición con reset, caso en el cual se vuelve al estado
+     *  CORRECTO, con ambos actuadores apagados.
+     */
+    if(loop->reset_transition_flag_control)
+    {
+        loop->estado = HYST_CTRL_CORRECTO;
+        loop->reset_transition_flag_control = 0;
+
+        if(por_pulsos)
+        {
+            /**
+             *  Se resetea tambien el estado de la MEF de pulsos, una vez por cada válvula,
+             *  ya que se comparte el estado de la MEF entre ambas.
+             */
+            loop->reset_transition_flag_pulso = 1;
+            MEFControlPulso(loop, desc->actuador_aumento, desc->nombre_aumento);
+            loop->reset_transition_flag_pulso = 1;
+            MEFControlPulso(loop, desc->actuador_disminucion, desc->nombre_disminucion);
+        }
+
+        else
+        {
+            /**
+             *  Se apagan ambos actuadores en un único pedido al servicio de actuadores (una sola escritura I2C).
+             */
+            uint8_t mask = BIT(desc->actuador_aumento) | BIT(desc->actuador_disminucion);
+            actuator_service_set_relay_mask(mask, desc->nivel_encendido ? 0 : mask);
+
+            ESP_LOGW(desc->tag, "%s: OFF", desc->nombre_aumento);
+            ESP_LOGW(desc->tag, "%s: OFF", desc->nombre_disminucion);
+        }
+    }
+
+
+    switch(loop->estado)
+    {
+
+    case HYST_CTRL_CORRECTO:
+
+        /**
+         *  En caso de que la variable caiga por debajo del límite inferior de la ventana de histeresis centrada en
+         *  el límite inferior del rango correcto, se cambia al estado en el cual se acciona el actuador de aumento.
+         *  Además, no debe haber error de sensor ni estar activo ningún enclavamiento del actuador.
+         */
+        if( loop->valor < (loop->limite_inferior - (desc->ancho_ventana_hist / 2))
+            && hyst_ctrl_habilitado(loop, desc->bloqueo_aumento))
+        {
+            hyst_ctrl_entrar(loop, HYST_CTRL_BAJO, desc->actuador_aumento, desc->nombre_aumento);
+        }
+
+        /**
+         *  En caso de que la variable suba por encima del límite superior de la ventana de histeresis centrada en
+         *  el límite superior del rango correcto, se cambia al estado en el cual se acciona el actuador de disminución.
+         *  Además, no debe haber error de sensor ni estar activo ningún enclavamiento del actuador.
+         */
+        if( loop->valor > (loop->limite_superior + (desc->ancho_ventana_hist / 2))
+            && hyst_ctrl_habilitado(loop, desc->bloqueo_disminucion))
+        {
+            hyst_ctrl_entrar(loop, HYST_CTRL_ELEVADO, desc->actuador_disminucion, desc->nombre_disminucion);
+        }
+
+        break;
+
+
+    case HYST_CTRL_BAJO:
+
+        /**
+         *  Cuando la variable sobrepase el límite superior de la ventana de histeresis centrada en el límite inferior
+         *  del rango correcto, o se bloquee el actuador, se transiciona al estado CORRECTO.
+         */
+        if( loop->valor > (loop->limite_inferior + (desc->ancho_ventana_hist / 2))
+            || !hyst_ctrl_habilitado(loop, desc->bloqueo_aumento))
+        {
+            hyst_ctrl_salir(loop, desc->actuador_aumento, desc->nombre_aumento);
+        }
+
+        if(por_pulsos)
+        {
+            MEFControlPulso(loop, desc->actuador_aumento, desc->nombre_aumento);
+        }
+
+        break;
+
+
+    case HYST_CTRL_ELEVADO:
+
+        /**
+         *  Cuando la variable caiga por debajo del límite inferior de la ventana de histeresis centrada en el límite
+         *  superior del rango correcto, o se bloquee el actuador, se transiciona al estado CORRECTO.
+         */
+        if( loop->valor < (loop->limite_superior - (desc->ancho_ventana_hist / 2))
+            || !hyst_ctrl_habilitado(loop, desc->bloqueo_disminucion))
+        {
+            hyst_ctrl_salir(loop, desc->actuador_disminucion, desc->nombre_disminucion);
+        }
+
+        if(por_pulsos)
+        {
+            MEFControlPulso(loop, desc->actuador_disminucion, desc->nombre_disminucion);
+        }
+
+        break;
+    }
+}
+
+
+
+/**
+ * @brief   Función del estado MANUAL de la MEF principal de un lazo de control. Se accionan los actuadores según
+ *          el último estado pedido en los tópicos MQTT del modo MANUAL, o se vuelve al modo AUTOMATICO.
+ *
+ * @param loop  Lazo de control.
+ */
+static void hyst_ctrl_modo_manual(hyst_ctrl_loop_handle_t loop)
+{
+    const hyst_ctrl_loop_desc_t *desc = loop->desc;
+
+    /**
+     *  En caso de que se baje la bandera de modo MANUAL, o se produzca una desconexión del broker MQTT,
+     *  se vuelve al modo AUTOMATICO, y se resetea la MEF de control para que los actuadores no queden
+     *  en el estado en el que estaban en modo MANUAL.
+     */
+    if(!loop->manual_mode_flag || !mqtt_check_connection())
+    {
+        loop->modo = HYST_CTRL_MODO_AUTO;
+        loop->manual_mode_flag = 0;
+        loop->reset_transition_flag_control = 1;
+
+        MEFControlVariable(loop);
+
+        return;
+    }
+
+    /**
+     *  Se obtiene el nuevo estado en el que deben estar los actuadores y se accionan los relés correspondientes.
+     */
+    bool manual_mode_state;
+
+    if(mqtt_get_topic_on_off(mqtt_get_topic_handle(desc->topic_manual_aumento), &manual_mode_state) == ESP_OK)
+    {
+        actuator_service_set_relay(desc->actuador_aumento, manual_mode_state);
+        ESP_LOGW(desc->tag, "MANUAL MODE %s: %d", desc->nombre_aumento, manual_mode_state);
+    }
+
+    if(mqtt_get_topic_on_off(mqtt_get_topic_handle(desc->topic_manual_disminucion), &manual_mode_state) == ESP_OK)
+    {
+        actuator_service_set_relay(desc->actuador_disminucion, manual_mode_state);
+        ESP_LOGW(desc->tag, "MANUAL MODE %s: %d", desc->nombre_disminucion, manual_mode_state);
+    }
+}
+
+
+
+/**
+ * @brief   Función de la MEF principal (de mayor jerarquía) de un lazo de control, alternando entre
+ *          el modo automatico o manual de control según se requiera.
+ *
+ * @param loop  Lazo de control.
+ */
+static void MEFPrincipal(hyst_ctrl_loop_handle_t loop)
+{
+    switch(loop->modo)
+    {
+
+    case HYST_CTRL_MODO_AUTO:
+
+        /**
+         *  En caso de que se levante la bandera de modo MANUAL, se debe transicionar a dicho estado,
+         *  en donde el accionamiento de los actuadores será manejado por el usuario vía mensajes MQTT.
+         *  Luego del reset de la MEF de control, se aplica el último estado pedido de los actuadores.
+         */
+        if(loop->manual_mode_flag)
+        {
+            loop->modo = HYST_CTRL_MODO_MANUAL;
+            loop->reset_transition_flag_control = 1;
+
+            MEFControlVariable(loop);
+            hyst_ctrl_modo_manual(loop);
+
+            break;
+        }
+
+        MEFControlVariable(loop);
+
+        break;
+
+
+    case HYST_CTRL_MODO_MANUAL:
+
+        hyst_ctrl_modo_manual(loop);
+
+        break;
+    }
+}
+
+
+
+/**
+ * @brief   Función para encolar un nuevo valor sensado en la cola de la tarea del motor, sin bloquearse, y
+ *          notificar a la tarea. Si la cola está llena la muestra se descarta.
+ *
+ * @param evento    Evento a encolar.
+ * @return esp_err_t    ESP_ERR_INVALID_STATE si todavía no se registró ningún lazo, ESP_ERR_TIMEOUT si la cola está llena.
+ */
+static esp_err_t hyst_ctrl_post(const hyst_ctrl_evento_t *evento)
+{
+    if(xHystCtrlEventQueue == NULL || xHystCtrlTaskHandle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if(xQueueSend(xHystCtrlEventQueue, evento, 0) != pdTRUE)
+    {
+        portENTER_CRITICAL(&hyst_ctrl_mux);
+        hyst_ctrl_stats.descartados++;
+        portEXIT_CRITICAL(&hyst_ctrl_mux);
+
+        ESP_LOGW(TAG, "Event queue full, sample dropped.");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    xTaskNotifyGive(xHystCtrlTaskHandle);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para enviar a la tarea del motor un evento con datos que no se puede perder (LIMITES, MODO o
+ *          ERROR_SENSOR). El dato se guarda en el lazo como último valor recibido y el evento se marca como
+ *          pendiente, igual que los eventos sin datos, por lo que si se repite antes de que la tarea lo procese
+ *          solo se aplica el último valor.
+ *
+ * @param loop      Lazo destinatario del evento.
+ * @param tipo      Tipo de evento.
+ * @param inferior  Límite inferior (HYST_CTRL_EVT_LIMITES).
+ * @param superior  Límite superior (HYST_CTRL_EVT_LIMITES).
+ * @param flag      Estado de la bandera (HYST_CTRL_EVT_MODO y HYST_CTRL_EVT_ERROR_SENSOR).
+ */
+static void hyst_ctrl_post_dato(hyst_ctrl_loop_handle_t loop, hyst_ctrl_evento_tipo_t tipo, float inferior, float superior, bool flag)
+{
+    if(loop == NULL || xHystCtrlTaskHandle == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&hyst_ctrl_mux);
+    switch(tipo)
+    {
+
+    case HYST_CTRL_EVT_LIMITES:
+        loop->pendiente.limite_inferior = inferior;
+        loop->pendiente.limite_superior = superior;
+        break;
+
+    case HYST_CTRL_EVT_MODO:
+        loop->pendiente.manual_mode_flag = flag;
+        break;
+
+    case HYST_CTRL_EVT_ERROR_SENSOR:
+        loop->pendiente.sensor_error_flag = flag;
+        break;
+
+    default:
+        break;
+    }
+
+    hyst_ctrl_pendientes[loop - hyst_ctrl_loops] |= BIT(tipo);
+    portEXIT_CRITICAL(&hyst_ctrl_mux);
+
+    xTaskNotifyGive(xHystCtrlTaskHandle);
+}
+
+
+
+/**
+ * @brief   Función de callback del servicio de actuadores, que se ejecuta al cambiar el estado de algún relé. Si
+ *          cambió algún relé que no pertenece a ningún lazo (por ejemplo, la bomba de solución), se le avisa a todos
+ *          los lazos que pudo cambiar alguno de sus enclavamientos.
+ *
+ * @param changed_mask  Máscara de relés que cambiaron.
+ * @param state         Nuevo estado de los relés.
+ */
+static void hyst_ctrl_actuator_change_callback(uint8_t changed_mask, uint8_t state)
+{
+    if(changed_mask & ~hyst_ctrl_reles_lazos)
+    {
+        hyst_ctrl_notify(NULL, HYST_CTRL_EVT_ENCLAVAMIENTO);
+    }
+}
+
+
+
+/**
+ * @brief   Handler de eventos del cliente MQTT, asignado para el evento de desconexión del broker, ante el cual los
+ *          lazos en modo MANUAL deben volver al modo AUTOMATICO.
+ *
+ * @param handler_args  Datos pasados como argumento al asignar el handler.
+ * @param base          Base del evento.
+ * @param event_id      ID del evento.
+ * @param event_data    Datos del evento.
+ */
+static void hyst_ctrl_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    hyst_ctrl_notify(NULL, HYST_CTRL_EVT_CONEXION_MQTT);
+}
+
+
+
+/**
+ * @brief   Función que aplica al estado del lazo los últimos datos de sus eventos pendientes. Se debe llamar
+ *          dentro de la sección crítica de "hyst_ctrl_mux".
+ *
+ * @param loop          Lazo de control.
+ * @param pendientes    Máscara de eventos pendientes del lazo.
+ */
+static void hyst_ctrl_aplicar_pendientes(struct hyst_ctrl_loop *loop, uint32_t pendientes)
+{
+    if(pendientes & BIT(HYST_CTRL_EVT_LIMITES))
+    {
+        loop->limite_inferior = loop->pendiente.limite_inferior;
+        loop->limite_superior = loop->pendiente.limite_superior;
+    }
+
+    if(pendientes & BIT(HYST_CTRL_EVT_MODO))
+    {
+        loop->manual_mode_flag = loop->pendiente.manual_mode_flag;
+    }
+
+    if(pendientes & BIT(HYST_CTRL_EVT_ERROR_SENSOR))
+    {
+        loop->sensor_error_flag = loop->pendiente.sensor_error_flag;
+    }
+}
+
+
+
+/**
+ * @brief   Función que calcula el tiempo máximo de espera de un evento: hasta el vencimiento del plazo del
+ *          pulso de dosificación más cercano, o indefinido si no hay pulsos en curso.
+ *
+ * @return TickType_t   Tiempo de espera en ticks.
+ */
+static TickType_t hyst_ctrl_tiempo_espera(void)
+{
+    TickType_t espera = portMAX_DELAY;
+    TickType_t ahora = xTaskGetTickCount();
+
+    for(int i = 0; i < hyst_ctrl_loop_count; i++)
+    {
+        struct hyst_ctrl_loop *loop = &hyst_ctrl_loops[i];
+
+        if(loop->pulso_activo)
+        {
+            TickType_t transcurrido = ahora - loop->pulso_inicio;
+            TickType_t restante = (transcurrido >= loop->pulso_periodo) ? 0 : loop->pulso_periodo - transcurrido;
+
+            if(restante < espera)
+            {
+                espera = restante;
+            }
+        }
+    }
+
+    return espera;
+}
+
+
+
+/**
+ * @brief   Tarea que evalúa las MEFs de todos los lazos de control registrados.
+ *
+ * @param pvParameters  Parámetro que se le pasa a la tarea en su creación.
+ */
+static void vTaskHystCtrl(void *pvParameters)
+{
+    hyst_ctrl_evento_t evento;
+    uint32_t pendientes[HYST_CTRL_MAX_LOOPS];
+    uint32_t eventos[HYST_CTRL_EVT_CANTIDAD];
+    bool evaluar[HYST_CTRL_MAX_LOOPS];
+
+    while(1)
+    {
+        /**
+         *  Se espera una notificación de un evento, o hasta que venza el plazo del pulso de dosificación más cercano.
+         */
+        ulTaskNotifyTake(pdTRUE, hyst_ctrl_tiempo_espera());
+
+        memset(eventos, 0, sizeof(eventos));
+
+        /**
+         *  Se toman los eventos pendientes de cada lazo, aplicando el último dato de los eventos con datos. Los
+         *  lazos con algún evento pendiente se evalúan.
+         */
+        portENTER_CRITICAL(&hyst_ctrl_mux);
+        memcpy(pendientes, hyst_ctrl_pendientes, sizeof(pendientes));
+        memset(hyst_ctrl_pendientes, 0, sizeof(hyst_ctrl_pendientes));
+
+        for(int i = 0; i < hyst_ctrl_loop_count; i++)
+        {
+            hyst_ctrl_aplicar_pendientes(&hyst_ctrl_loops[i], pendientes[i]);
+        }
+        portEXIT_CRITICAL(&hyst_ctrl_mux);
+
+        for(int i = 0; i < HYST_CTRL_MAX_LOOPS; i++)
+        {
+            evaluar[i] = pendientes[i] != 0;
+
+            for(int tipo = 0; tipo < HYST_CTRL_EVT_CANTIDAD; tipo++)
+            {
+                if(pendientes[i] & BIT(tipo))
+                {
+                    eventos[tipo]++;
+                }
+            }
+        }
+
+        /**
+         *  Se aplican las muestras de la cola, en orden de llegada, y se evalúa el lazo destinatario.
+         */
+        while(xQueueReceive(xHystCtrlEventQueue, &evento, 0) == pdTRUE)
+        {
+            if(evento.loop != NULL)
+            {
+                evento.loop->valor = evento.valor;
+                evaluar[evento.loop - hyst_ctrl_loops] = 1;
+            }
+
+            eventos[HYST_CTRL_EVT_MUESTRA]++;
+        }
+
+        uint32_t evaluaciones = 0;
+        TickType_t ahora = xTaskGetTickCount();
+
+        for(int i = 0; i < hyst_ctrl_loop_count; i++)
+        {
+            struct hyst_ctrl_loop *loop = &hyst_ctrl_loops[i];
+
+            /**
+             *  Si se cumplió el plazo del pulso de dosificación en curso, se setea la bandera correspondiente
+             *  para señalizarle a la MEF de pulsos que debe accionar la válvula.
+             */
+            if(loop->pulso_activo && (TickType_t) (ahora - loop->pulso_inicio) >= loop->pulso_periodo)
+            {
+                loop->pulso_activo = 0;
+                loop->pulso_finished_flag = 1;
+
+                evaluar[i] = 1;
+                eventos[HYST_CTRL_EVT_PLAZO]++;
+            }
+
+            if(!evaluar[i])
+            {
+                continue;
+            }
+
+            if(loop->desc->on_eval != NULL)
+            {
+                loop->desc->on_eval();
+            }
+
+            /**
+             *  Se evalúa el lazo hasta que la MEF de control no cambie de estado, para completar en este despertar las
+             *  transiciones encadenadas (por ejemplo, de ELEVADO a CORRECTO y de CORRECTO a BAJO ante nuevos límites),
+             *  ya que no hay una próxima evaluación periódica que las complete.
+             */
+            hyst_ctrl_estado_t estado;
+            int pasadas = 0;
+
+            do
+            {
+                estado = loop->estado;
+                MEFPrincipal(loop);
+                evaluaciones++;
+            } while(loop->estado != estado && loop->modo == HYST_CTRL_MODO_AUTO && ++pasadas < HYST_CTRL_MAX_PASADAS);
+        }
+
+        portENTER_CRITICAL(&hyst_ctrl_mux);
+        hyst_ctrl_stats.despertares++;
+        hyst_ctrl_stats.evaluaciones += evaluaciones;
+
+        for(int tipo = 0; tipo < HYST_CTRL_EVT_CANTIDAD; tipo++)
+        {
+            hyst_ctrl_stats.eventos[tipo] += eventos[tipo];
+        }
+        portEXIT_CRITICAL(&hyst_ctrl_mux);
+    }
+}
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para registrar un lazo de control en el motor. Al registrar el primer lazo, se crea la
+ *          tarea que evalúa los lazos.
+ *
+ * @param desc          Descriptor del lazo. Debe permanecer válido mientras el lazo esté registrado.
+ * @param mqtt_client   Handle del cliente MQTT, para recibir los eventos de desconexión del broker.
+ * @param handle        Variable donde se guarda el handle del lazo.
+ * @return esp_err_t
+ */
+esp_err_t hyst_ctrl_register_loop(const hyst_ctrl_loop_desc_t *desc, esp_mqtt_client_handle_t mqtt_client, hyst_ctrl_loop_handle_t *handle)
+{
+    ESP_RETURN_ON_FALSE(desc != NULL && handle != NULL, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+    ESP_RETURN_ON_FALSE(hyst_ctrl_loop_count < HYST_CTRL_MAX_LOOPS, ESP_ERR_NO_MEM, TAG, "Too many control loops.");
+
+    //=======================| INIT COLA DE EVENTOS |=======================//
+
+    /**
+     *  Se crea la cola de eventos de la tarea, y se asigna la función callback del servicio de actuadores
+     *  para detectar los cambios de los enclavamientos.
+     */
+    if(xHystCtrlEventQueue == NULL)
+    {
+        xHystCtrlEventQueue = xQueueCreate(HYST_CTRL_EVENT_QUEUE_LEN, sizeof(hyst_ctrl_evento_t));
+        ESP_RETURN_ON_FALSE(xHystCtrlEventQueue != NULL, ESP_ERR_NO_MEM, TAG, "Failed to create event queue.");
+
+        ESP_RETURN_ON_ERROR(actuator_service_add_change_callback(hyst_ctrl_actuator_change_callback),
+                            TAG, "Failed to add actuator change callback.");
+    }
+
+    /**
+     *  Se asigna el handler de desconexión del broker MQTT.
+     */
+    if(!hyst_ctrl_mqtt_handler_registered && mqtt_client != NULL)
+    {
+        ESP_RETURN_ON_ERROR(esp_mqtt_client_register_event(mqtt_client, MQTT_EVENT_DISCONNECTED, hyst_ctrl_mqtt_event_handler, NULL),
+                            TAG, "Failed to register MQTT event handler.");
+
+        hyst_ctrl_mqtt_handler_registered = 1;
+    }
+
+    //=======================| CREACION TAREAS |=======================//
+
+    /**
+     *  Se crea la tarea mediante la cual se controlará la transicion de las MEFs de todos los lazos de control.
+     */
+    if(xHystCtrlTaskHandle == NULL)
+    {
+        xTaskCreate(
+            vTaskHystCtrl,
+            "vTaskHystCtrl",
+            4096,
+            NULL,
+            2,
+            &xHystCtrlTaskHandle);
+
+        /**
+         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
+         */
+        if(xHystCtrlTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create vTaskHystCtrl task.");
+            return ESP_FAIL;
+        }
+    }
+
+    //=======================| INIT LAZO |=======================//
+
+    /**
+     *  Se inicializa el estado del lazo antes de incrementar la cantidad de lazos, para que la tarea
+     *  no lo evalúe a medio inicializar.
+     */
+    struct hyst_ctrl_loop *loop = &hyst_ctrl_loops[hyst_ctrl_loop_count];
+
+    *loop = (struct hyst_ctrl_loop) {
+        .desc = desc,
+        .valor = desc->valor_inicial,
+        .limite_inferior = desc->limite_inferior,
+        .limite_superior = desc->limite_superior,
+        .modo = HYST_CTRL_MODO_AUTO,
+        .estado = HYST_CTRL_CORRECTO,
+        .estado_pulso = HYST_CTRL_PULSO_CERRADO,
+    };
+
+    portENTER_CRITICAL(&hyst_ctrl_mux);
+    hyst_ctrl_loop_count++;
+    hyst_ctrl_reles_lazos |= BIT(desc->actuador_aumento) | BIT(desc->actuador_disminucion);
+    portEXIT_CRITICAL(&hyst_ctrl_mux);
+
+    *handle = loop;
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función que devuelve el Task Handle de la tarea que evalúa los lazos de control.
+ *
+ * @return TaskHandle_t Task Handle de la tarea.
+ */
+TaskHandle_t hyst_ctrl_get_task_handle(void)
+{
+    return xHystCtrlTaskHandle;
+}
+
+
+
+/**
+ * @brief   Función para notificar un evento sin datos asociados (por ejemplo, nuevo estado pedido de un actuador
+ *          en modo MANUAL, o cambio de un enclavamiento). El evento no se encola, sino que se marca como pendiente
+ *          en el lazo destinatario, por lo que no se puede perder, y si se repite antes de que la tarea lo procese
+ *          se combina con el anterior.
+ *
+ * @param loop  Lazo destinatario del evento (NULL para todos los lazos).
+ * @param tipo  Tipo de evento.
+ * @return esp_err_t    ESP_ERR_INVALID_STATE si todavía no se registró ningún lazo.
+ */
+esp_err_t hyst_ctrl_notify(hyst_ctrl_loop_handle_t loop, hyst_ctrl_evento_tipo_t tipo)
+{
+    ESP_RETURN_ON_FALSE(tipo < HYST_CTRL_EVT_CANTIDAD, ESP_ERR_INVALID_ARG, TAG, "Invalid event type.");
+
+    if(xHystCtrlTaskHandle == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&hyst_ctrl_mux);
+    for(int i = 0; i < hyst_ctrl_loop_count; i++)
+    {
+        if(loop == NULL || loop == &hyst_ctrl_loops[i])
+        {
+            hyst_ctrl_pendientes[i] |= BIT(tipo);
+        }
+    }
+    portEXIT_CRITICAL(&hyst_ctrl_mux);
+
+    xTaskNotifyGive(xHystCtrlTaskHandle);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para obtener las estadísticas del motor.
+ *
+ * @param stats     Puntero a la estructura donde se copian las estadísticas.
+ */
+void hyst_ctrl_get_stats(hyst_ctrl_stats_t *stats)
+{
+    portENTER_CRITICAL(&hyst_ctrl_mux);
+    *stats = hyst_ctrl_stats;
+    portEXIT_CRITICAL(&hyst_ctrl_mux);
+}
+
+
+
+/**
+ * @brief   Función que devuelve la distancia de los límites del rango correcto al set point.
+ *
+ * @param loop  Lazo de control.
+ * @return float    Delta de la variable.
+ */
+float hyst_ctrl_get_delta(hyst_ctrl_loop_handle_t loop)
+{
+    return loop->desc->delta;
+}
+
+
+
+/**
+ * @brief   Función para establecer nuevos límites del rango considerado como correcto. Los límites se guardan
+ *          como pendientes en el lazo, y la tarea del motor los aplica y evalúa el lazo al despertarse.
+ *
+ * @param loop              Lazo de control.
+ * @param limite_inferior   Límite inferior del rango.
+ * @param limite_superior   Límite superior del rango.
+ */
+void hyst_ctrl_set_limits(hyst_ctrl_loop_handle_t loop, float limite_inferior, float limite_superior)
+{
+    hyst_ctrl_post_dato(loop, HYST_CTRL_EVT_LIMITES, limite_inferior, limite_superior, 0);
+}
+
+
+
+/**
+ * @brief   Función para actualizar el valor sensado de la variable. El valor se envía en un evento a la
+ *          tarea del motor, que evalúa el lazo al recibirlo.
+ *
+ * @param loop      Lazo de control.
+ * @param valor     Nuevo valor de la variable.
+ */
+void hyst_ctrl_set_value(hyst_ctrl_loop_handle_t loop, float valor)
+{
+    hyst_ctrl_evento_t evento = {
+        .loop = loop,
+        .valor = valor,
+    };
+
+    hyst_ctrl_post(&evento);
+}
+
+
+
+/**
+ * @brief   Función para cambiar el estado de la bandera de modo MANUAL, utilizada por
+ *          la MEF principal para cambiar entre estado de modo MANUAL y AUTOMATICO.
+ *
+ * @param loop                      Lazo de control.
+ * @param manual_mode_flag_state    Estado de la bandera.
+ */
+void hyst_ctrl_set_manual_mode_flag_value(hyst_ctrl_loop_handle_t loop, bool manual_mode_flag_state)
+{
+    hyst_ctrl_post_dato(loop, HYST_CTRL_EVT_MODO, 0, 0, manual_mode_flag_state);
+}
+
+
+
+/**
+ * @brief   Función para cambiar el estado de la bandera de error de sensor.
+ *
+ * @param loop                      Lazo de control.
+ * @param sensor_error_flag_state   Estado de la bandera.
+ */
+void hyst_ctrl_set_sensor_error_flag_value(hyst_ctrl_loop_handle_t loop, bool sensor_error_flag_state)
+{
+    hyst_ctrl_post_dato(loop, HYST_CTRL_EVT_ERROR_SENSOR, 0, 0, sensor_error_flag_state);
+}
+
+
+
+/**
+ * @brief   Función que devuelve el estado de la MEF de control de la variable.
+ *
+ * @param loop  Lazo de control.
+ * @return hyst_ctrl_estado_t   Estado de la MEF.
+ */
+hyst_ctrl_estado_t hyst_ctrl_get_state(hyst_ctrl_loop_handle_t loop)
+{
+    return loop->estado;
+}
\ No newline at end of file
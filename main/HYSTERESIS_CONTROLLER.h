@@ -0,0 +1,182 @@
+/*
+
+    Motor de lazos de control por ventana de histéresis
+
+*/
+
+#ifndef HYSTERESIS_CONTROLLER_H_   /* Include guard */
+#define HYSTERESIS_CONTROLLER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "mqtt_client.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/* Cantidad máxima de lazos de control que evalúa el motor. */
+#define HYST_CTRL_MAX_LOOPS 4
+
+/* Cantidad de eventos con datos que puede almacenar la cola de eventos del motor. */
+#define HYST_CTRL_EVENT_QUEUE_LEN 16
+
+/**
+ *  @brief  Puntero a función de enclavamiento: retorna true cuando se debe bloquear el accionamiento
+ *          del actuador (por ejemplo, bomba apagada o nivel del tanque de dosificación por debajo del límite).
+ */
+typedef bool (*HystCtrlInterlockFunction)(void);
+
+/**
+ *  @brief  Puntero a función que se ejecuta en cada evaluación de un lazo de control, antes de
+ *          evaluar sus MEFs.
+ */
+typedef void (*HystCtrlHookFunction)(void);
+
+/**
+ *  @brief  Descriptor constante de un lazo de control. El lazo mantiene la variable entre los límites inferior
+ *          y superior, accionando el actuador de aumento cuando cae por debajo de la ventana de histéresis
+ *          centrada en el límite inferior, y el de disminución cuando sube por encima de la ventana centrada
+ *          en el límite superior.
+ *
+ *          Si el tiempo de apertura es 0, el actuador se mantiene encendido mientras la variable esté fuera del
+ *          rango (calefactor, refrigerador). En caso contrario, se acciona por pulsos de dosificación (válvulas de
+ *          dosificación). Si las ganancias son 0, los pulsos tienen los tiempos de apertura y cierre indicados. Si no,
+ *          el tiempo de apertura de cada pulso se calcula con un control PI sobre el error respecto del set point,
+ *          limitado entre los tiempos mínimo y máximo, y entre pulsos la válvula queda cerrada al menos el tiempo
+ *          muerto de mezcla, para que el sensor (a la salida del canal de cultivo) llegue a medir el efecto de la dosis.
+ */
+typedef struct {
+    const char *tag;                                /* Tag para imprimir información en el LOG. */
+
+    float valor_inicial;                            /* Valor de la variable antes de la primera medición. */
+    float limite_inferior;                          /* Límite inferior inicial del rango correcto. */
+    float limite_superior;                          /* Límite superior inicial del rango correcto. */
+    float ancho_ventana_hist;                       /* Ancho de la ventana de histéresis centrada en cada límite. */
+    float delta;                                    /* Distancia de los límites al set point. */
+
+    int8_t actuador_aumento;                        /* Relé del actuador de aumento de la variable. */
+    int8_t actuador_disminucion;                    /* Relé del actuador de disminución de la variable. */
+    const char *nombre_aumento;                     /* Nombre del actuador de aumento, para el LOG. */
+    const char *nombre_disminucion;                 /* Nombre del actuador de disminución, para el LOG. */
+    bool nivel_encendido;                           /* Estado lógico del relé que enciende los actuadores. */
+
+    HystCtrlInterlockFunction bloqueo;              /* Enclavamiento de ambos actuadores (NULL si no hay). */
+    HystCtrlInterlockFunction bloqueo_aumento;      /* Enclavamiento del actuador de aumento (NULL si no hay). */
+    HystCtrlInterlockFunction bloqueo_disminucion;  /* Enclavamiento del actuador de disminución (NULL si no hay). */
+
+    uint32_t tiempo_apertura_ms;                    /* Tiempo de apertura de los pulsos de dosificación (0 sin pulsos). */
+    uint32_t tiempo_cierre_ms;                      /* Tiempo de cierre de los pulsos de dosificación. */
+
+    float ganancia_kp;                              /* Ganancia proporcional: ms de apertura por unidad de error (0 sin PI). */
+    float ganancia_ki;                              /* Ganancia integral: ms de apertura por unidad de error acumulada por pulso. */
+    uint32_t tiempo_apertura_min_ms;                /* Tiempo de apertura mínimo de un pulso con control PI. */
+    uint32_t tiempo_apertura_max_ms;                /* Tiempo de apertura máximo de un pulso con control PI. */
+    uint32_t tiempo_mezcla_ms;                      /* Tiempo muerto de mezcla: cierre mínimo entre pulsos con control PI. */
+
+    const char *topic_manual_aumento;               /* Tópico MQTT del estado del actuador de aumento en modo MANUAL. */
+    const char *topic_manual_disminucion;           /* Tópico MQTT del estado del actuador de disminución en modo MANUAL. */
+
+    HystCtrlHookFunction on_eval;                   /* Función ejecutada en cada evaluación (NULL si no hay). */
+} hyst_ctrl_loop_desc_t;
+
+
+/**
+ *  Enumeración correspondiente a los estados de la MEF principal de un lazo de control.
+ */
+typedef enum {
+    HYST_CTRL_MODO_AUTO = 0,
+    HYST_CTRL_MODO_MANUAL,
+} hyst_ctrl_modo_t;
+
+
+/**
+ *  Enumeración correspondiente a los estados de la MEF de control de la variable.
+ */
+typedef enum {
+    HYST_CTRL_CORRECTO = 0,
+    HYST_CTRL_BAJO,
+    HYST_CTRL_ELEVADO,
+} hyst_ctrl_estado_t;
+
+
+/**
+ *  Enumeración correspondiente a los estados de la MEF de los pulsos de dosificación.
+ */
+typedef enum {
+    HYST_CTRL_PULSO_CERRADO = 0,
+    HYST_CTRL_PULSO_ABIERTO,
+} hyst_ctrl_estado_pulso_t;
+
+
+/* Handle de un lazo de control registrado en el motor. */
+typedef struct hyst_ctrl_loop *hyst_ctrl_loop_handle_t;
+
+
+/**
+ *  Enumeración correspondiente a los tipos de evento que despiertan a la tarea del motor.
+ */
+typedef enum {
+    HYST_CTRL_EVT_MUESTRA = 0,          /* Nuevo valor sensado de la variable. */
+    HYST_CTRL_EVT_ERROR_SENSOR,         /* Cambio de la bandera de error de sensado. */
+    HYST_CTRL_EVT_LIMITES,              /* Nuevos límites del rango correcto. */
+    HYST_CTRL_EVT_MODO,                 /* Cambio entre modo MANUAL y AUTOMATICO. */
+    HYST_CTRL_EVT_ESTADO_MANUAL,        /* Nuevo estado pedido de un actuador en modo MANUAL. */
+    HYST_CTRL_EVT_ENCLAVAMIENTO,        /* Posible cambio de un enclavamiento (bomba, nivel de un tanque). */
+    HYST_CTRL_EVT_CONEXION_MQTT,        /* Desconexión del broker MQTT. */
+    HYST_CTRL_EVT_EXTERNO,              /* Evento sin datos, procesado por la función "on_eval" del lazo. */
+    HYST_CTRL_EVT_PLAZO,                /* Vencimiento del plazo de un pulso de dosificación (generado por la tarea). */
+    HYST_CTRL_EVT_CANTIDAD,
+} hyst_ctrl_evento_tipo_t;
+
+
+/**
+ *  @brief  Evento de la cola del motor. Solo pasan por la cola los nuevos valores sensados (MUESTRA), que se pueden
+ *          descartar si la cola está llena. Los nuevos límites, el modo y el error de sensado se guardan en el lazo
+ *          como último valor recibido, y junto con los eventos sin datos se marcan como pendientes, por lo que no se
+ *          pueden perder.
+ */
+typedef struct {
+    hyst_ctrl_loop_handle_t loop;       /* Lazo destinatario del evento. */
+    float valor;                        /* Nuevo valor sensado de la variable. */
+} hyst_ctrl_evento_t;
+
+
+/* Estadísticas del motor, para verificar la cantidad de veces que se despierta su tarea. */
+typedef struct {
+    uint32_t despertares;                           /* Cantidad de veces que se despertó la tarea. */
+    uint32_t evaluaciones;                          /* Cantidad de evaluaciones de las MEFs de algún lazo. */
+    uint32_t eventos[HYST_CTRL_EVT_CANTIDAD];       /* Cantidad de eventos procesados, por tipo. */
+    uint32_t descartados;                           /* Cantidad de muestras descartadas por estar llena la cola. */
+} hyst_ctrl_stats_t;
+
+/*==================[EXTERNAL DATA DECLARATION]==============================*/
+
+/*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
+
+esp_err_t hyst_ctrl_register_loop(const hyst_ctrl_loop_desc_t *desc, esp_mqtt_client_handle_t mqtt_client, hyst_ctrl_loop_handle_t *handle);
+TaskHandle_t hyst_ctrl_get_task_handle(void);
+esp_err_t hyst_ctrl_notify(hyst_ctrl_loop_handle_t loop, hyst_ctrl_evento_tipo_t tipo);
+void hyst_ctrl_get_stats(hyst_ctrl_stats_t *stats);
+float hyst_ctrl_get_delta(hyst_ctrl_loop_handle_t loop);
+void hyst_ctrl_set_limits(hyst_ctrl_loop_handle_t loop, float limite_inferior, float limite_superior);
+void hyst_ctrl_set_value(hyst_ctrl_loop_handle_t loop, float valor);
+void hyst_ctrl_set_manual_mode_flag_value(hyst_ctrl_loop_handle_t loop, bool manual_mode_flag_state);
+void hyst_ctrl_set_sensor_error_flag_value(hyst_ctrl_loop_handle_t loop, bool sensor_error_flag_state);
+hyst_ctrl_estado_t hyst_ctrl_get_state(hyst_ctrl_loop_handle_t loop);
+
+/*==================[END OF FILE]============================================*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HYSTERESIS_CONTROLLER_H_
@@ -30,6 +30,25 @@
  * 
  *      PARA LEER DEL MCP23008 SERÍA UNA SECUENCIA SIMILAR, DEBE ESCRIBIRSE EL PRIMER BYTE CON LA DIRECCIÓN, EL SEGUNDO BYTE CON EL 
  *      REGISTRO A LEER, EN ESTE CASO EL GPIO QUE ES 0x09, Y LUEGO LEER EL TERCER BYTE QUE TENDRA EL DATO DEL ESTADO DE LOS GPIO.
+ *
+ *      EL ESTADO DE LOS RELÉS SE GUARDA EN UNA COPIA EN RAM DEL REGISTRO OLAT (0x0A). DE ESTA FORMA, "set_relay_state" REALIZA
+ *      UNA ÚNICA ESCRITURA I2C (Y NINGUNA SI EL RELÉ YA ESTABA EN ESE ESTADO), Y "get_relay_state" NO ACCEDE AL BUS. UNA TAREA
+ *      VERIFICA CADA MCP23008_RESYNC_PERIOD_MS QUE LOS REGISTROS DEL MCP23008 COINCIDAN CON LA COPIA (POR EJEMPLO, TRAS UN RESET
+ *      DEL IC POR RUIDO O BAJA TENSIÓN), Y EN CASO CONTRARIO LOS VUELVE A ESCRIBIR. TODOS LOS ACCESOS AL MCP23008 SE REALIZAN CON
+ *      UN MUTEX (RECURSIVO) TOMADO.
+ *
+ *      PARA CAMBIAR EL ESTADO DE VARIOS RELÉS A LA VEZ, SE PUEDE ABRIR UNA TRANSACCIÓN CON "begin_relay_transaction", MODIFICAR
+ *      LOS RELÉS CON "set_relay_mask" O "set_relay_state", Y APLICAR LOS CAMBIOS CON "commit_relay_transaction", QUE REALIZA UNA
+ *      ÚNICA ESCRITURA I2C. MIENTRAS LA TRANSACCIÓN ESTÁ ABIERTA, LA TAREA QUE LA ABRIÓ TIENE EL MUTEX TOMADO, POR LO QUE OTRA TAREA
+ *      NO PUEDE MODIFICAR LOS RELÉS HASTA EL COMMIT. LAS TRANSACCIONES PUEDEN ANIDARSE, Y SOLO EL COMMIT MÁS EXTERNO ESCRIBE EN EL
+ *      MCP23008.
+ *
+ *      EL TRIGGER PH NO SE LEE POR POLLING, SINO QUE SE UTILIZA LA INTERRUPCIÓN POR CAMBIO DEL MCP23008 (GPINTEN/INTCON) EN EL GP7,
+ *      CUYA SALIDA INT (ACTIVA EN BAJO) ESTÁ CONECTADA AL GPIO MCP23008_INT_GPIO_PIN DEL ESP32. LA ISR DE DICHO GPIO SOLO GUARDA EL
+ *      INSTANTE DEL FLANCO Y DESPIERTA A UNA TAREA, QUE LEE LOS REGISTROS INTF, INTCAP (LO QUE LIBERA LA LÍNEA INT) Y GPIO EN UNA ÚNICA
+ *      TRANSACCIÓN. SI EL NIVEL ACTUAL DIFIERE DEL CAPTURADO, EL PIN VOLVIÓ A CAMBIAR MIENTRAS LA INTERRUPCIÓN ESTABA PENDIENTE, Y SE ENTREGA UN
+ *      SEGUNDO EVENTO, DE FORMA QUE EL ESTADO ENTREGADO SIEMPRE SIGUE AL PIN. CADA EVENTO LLEVA EL INSTANTE DEL FLANCO Y LA LATENCIA
+ *      HASTA SU ENTREGA, Y SE PASA A LA FUNCIÓN CALLBACK ASIGNADA MEDIANTE "MCP23008_pH_trigger_callback_function_on_event".
  */
 
 
@@ -40,6 +59,11 @@
 
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "driver/i2c.h"
 #include "driver/gpio.h"
@@ -58,12 +82,48 @@
 /* Tag para imprimir información en el LOG. */
 static const char *TAG = "MCP23008_I2C_LIBRARY";
 
+/* Copia en RAM del registro OLAT del MCP23008, es decir, del estado de los relés. */
+static uint8_t MCP23008_olat_shadow = MCP23008_OLAT_INIT;
+
+/* Estado de los relés de la transacción en curso, y nivel de anidamiento de la transacción. */
+static uint8_t MCP23008_olat_pending = MCP23008_OLAT_INIT;
+static unsigned int MCP23008_transaction_depth = 0;
+
+/* Mutex recursivo para el acceso al MCP23008, a la copia del registro OLAT y a la transacción en curso. */
+static SemaphoreHandle_t xMCP23008Mutex = NULL;
+
+/* Handle de la tarea de verificación del registro OLAT. */
+static TaskHandle_t xMCP23008ResyncTaskHandle = NULL;
+
+/* Estadísticas del acceso al MCP23008. */
+static MCP23008_stats_t MCP23008_stats = {0};
+
+/* Handle de la tarea de atención de la interrupción del MCP23008. */
+static TaskHandle_t xMCP23008IntTaskHandle = NULL;
+
+/**
+ *  Instante del último flanco de la línea INT, tomado en la ISR. La línea no vuelve a bajar hasta que la tarea
+ *  lee el registro INTCAP, por lo que la ISR no lo sobreescribe mientras la tarea lo utiliza.
+ */
+static int64_t MCP23008_int_edge_time_us = 0;
+
+/* Último estado entregado del Trigger pH. */
+static bool MCP23008_pH_trigger_level = 0;
+
+/* Puntero a la función callback que se ejecuta al cambiar el estado del Trigger pH. */
+static MCP23008PhTriggerCallbackFunction MCP23008PhTriggerCallback = NULL;
+
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
 static esp_err_t MCP23008_register_read(uint8_t reg_addr, uint8_t *data, size_t len);
 static esp_err_t MCP23008_register_write_byte(uint8_t reg_addr, uint8_t data);
+static void vTaskMCP23008Resync(void *pvParameters);
+static bool MCP23008_transaction_owned(void);
+static void MCP23008_int_isr_handler(void *args);
+static void MCP23008_pH_trigger_deliver(bool level, int64_t edge_time_us);
+static void vTaskMCP23008Int(void *pvParameters);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
@@ -77,6 +137,8 @@ static esp_err_t MCP23008_register_write_byte(uint8_t reg_addr, uint8_t data);
  */
 static esp_err_t MCP23008_register_read(uint8_t reg_addr, uint8_t *data, size_t len)
 {
+    MCP23008_stats.bus_transactions++;
+
     return i2c_master_write_read_device(I2C_MASTER_NUM, MCP23008_ADDR, &reg_addr, 1, 
                                         data, len, I2C_MASTER_TIMEOUT_MS / portTICK_RATE_MS);
 }
@@ -94,12 +156,198 @@ static esp_err_t MCP23008_register_write_byte(uint8_t reg_addr, uint8_t data)
 {
     uint8_t write_buf[2] = {reg_addr, data};
 
+    MCP23008_stats.bus_transactions++;
+
     return i2c_master_write_to_device(  I2C_MASTER_NUM, MCP23008_ADDR, write_buf, sizeof(write_buf), 
                                         I2C_MASTER_TIMEOUT_MS / portTICK_RATE_MS);
 }
 
 
 
+/**
+ * @brief   FUNCIÓN QUE INDICA SI LA TAREA QUE LA LLAMA TIENE UNA TRANSACCIÓN DE RELÉS ABIERTA.
+ *
+ * @return true     La tarea tiene una transacción abierta.
+ * @return false    La tarea no tiene una transacción abierta.
+ */
+static bool MCP23008_transaction_owned(void)
+{
+    return  xMCP23008Mutex != NULL &&
+            xSemaphoreGetMutexHolder(xMCP23008Mutex) == xTaskGetCurrentTaskHandle() &&
+            MCP23008_transaction_depth > 0;
+}
+
+
+
+/**
+ * @brief   TAREA QUE VERIFICA PERIÓDICAMENTE QUE LOS REGISTROS DE CONFIGURACIÓN DE I/O Y OLAT DEL MCP23008 COINCIDAN
+ *          CON LOS VALORES ESPERADOS. SI NO COINCIDEN (POR EJEMPLO, SI EL IC SE REINICIÓ), SE VUELVEN A ESCRIBIR.
+ *
+ * @param pvParameters
+ */
+static void vTaskMCP23008Resync(void *pvParameters)
+{
+    uint8_t io_config;
+    uint8_t olat;
+
+    while(1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(MCP23008_RESYNC_PERIOD_MS));
+
+        xSemaphoreTakeRecursive(xMCP23008Mutex, portMAX_DELAY);
+
+        MCP23008_stats.resyncs++;
+
+        if( MCP23008_register_read(MCP23008_IO_CONFIG_REG_ADDR, &io_config, 1) == ESP_OK &&
+            MCP23008_register_read(MCP23008_OLAT_REG_ADDR, &olat, 1) == ESP_OK &&
+            (io_config != MCP23008_IO_CONFIG || olat != MCP23008_olat_shadow))
+        {
+            MCP23008_stats.drifts++;
+
+            ESP_LOGW(TAG, "MCP23008 drift detected (IODIR 0x%02X, OLAT 0x%02X, expected OLAT 0x%02X). Rewriting registers.",
+                    io_config, olat, MCP23008_olat_shadow);
+
+            if( MCP23008_register_write_byte(MCP23008_IO_CONFIG_REG_ADDR, MCP23008_IO_CONFIG) != ESP_OK ||
+                MCP23008_register_write_byte(MCP23008_OLAT_REG_ADDR, MCP23008_olat_shadow) != ESP_OK ||
+                MCP23008_register_write_byte(MCP23008_INTCON_REG_ADDR, MCP23008_INTCON_CONFIG) != ESP_OK ||
+                MCP23008_register_write_byte(MCP23008_GPINTEN_REG_ADDR, MCP23008_GPINTEN_CONFIG) != ESP_OK)
+            {
+                ESP_LOGE(TAG, "Failed to rewrite MCP23008 registers.");
+            }
+        }
+
+        xSemaphoreGiveRecursive(xMCP23008Mutex);
+    }
+}
+
+
+
+/**
+ * @brief   RUTINA DE SERVICIO DE INTERRUPCIÓN DEL GPIO CONECTADO A LA SALIDA INT DEL MCP23008. SE GUARDA EL INSTANTE
+ *          DEL FLANCO Y SE DESPIERTA A LA TAREA DE ATENCIÓN DE LA INTERRUPCIÓN, YA QUE NO SE PUEDE ACCEDER AL BUS I2C DESDE LA ISR.
+ *
+ * @param args  Parámetros pasados a la rutina de servicios de interrupción de GPIO.
+ */
+static void IRAM_ATTR MCP23008_int_isr_handler(void *args)
+{
+    /**
+     *  Esta variable sirve para que, en el caso de que un llamado a "xTaskNotifyFromISR()" desbloquee
+     *  una tarea de mayor prioridad que la que estaba corriendo justo antes de entrar en la rutina
+     *  de interrupción, al retornar se haga un context switch a dicha tarea de mayor prioridad en vez
+     *  de a la de menor prioridad (xHigherPriorityTaskWoken = pdTRUE)
+     */
+    BaseType_t xHigherPriorityTaskWoken;
+    xHigherPriorityTaskWoken = pdFALSE;
+
+    MCP23008_int_edge_time_us = esp_timer_get_time();
+
+    vTaskNotifyGiveFromISR(xMCP23008IntTaskHandle, &xHigherPriorityTaskWoken);
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+
+
+/**
+ * @brief   FUNCIÓN QUE ENTREGA UN EVENTO DE CAMBIO DEL TRIGGER PH, SI EL NIVEL DIFIERE DEL ÚLTIMO ENTREGADO.
+ *
+ * @param level         Nivel del Trigger pH.
+ * @param edge_time_us  Instante del flanco.
+ */
+static void MCP23008_pH_trigger_deliver(bool level, int64_t edge_time_us)
+{
+    if(level == MCP23008_pH_trigger_level)
+    {
+        return;
+    }
+
+    MCP23008_pH_trigger_level = level;
+
+    MCP23008_pH_trigger_event_t event = {
+        .level = level,
+        .edge_time_us = edge_time_us,
+        .latency_us = esp_timer_get_time() - edge_time_us,
+    };
+
+    xSemaphoreTakeRecursive(xMCP23008Mutex, portMAX_DELAY);
+
+    MCP23008_stats.trigger_events++;
+
+    if(event.latency_us > MCP23008_stats.trigger_max_latency_us)
+    {
+        MCP23008_stats.trigger_max_latency_us = event.latency_us;
+    }
+
+    xSemaphoreGiveRecursive(xMCP23008Mutex);
+
+    if(MCP23008PhTriggerCallback != NULL)
+    {
+        MCP23008PhTriggerCallback(&event);
+    }
+}
+
+
+
+/**
+ * @brief   TAREA DE ATENCIÓN DE LA INTERRUPCIÓN DEL MCP23008. LEE LOS REGISTROS INTF, INTCAP (LIBERANDO LA LÍNEA INT) Y
+ *          GPIO, Y ENTREGA LOS CAMBIOS DEL TRIGGER PH.
+ *
+ * @param pvParameters  Parámetro que se le pasa a la tarea en su creación.
+ */
+static void vTaskMCP23008Int(void *pvParameters)
+{
+    /**
+     *  Buffer para los registros INTF, INTCAP y GPIO, que se leen en una única transacción por ser consecutivos. Si el
+     *  GPIO se leyera en otra transacción, un pulso del pin entre ambas lecturas generaría una nueva interrupción que la
+     *  lectura del GPIO liberaría sin que se lea su captura, y el pulso se perdería.
+     */
+    uint8_t int_regs[3];
+
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        int64_t edge_time_us = MCP23008_int_edge_time_us;
+
+        xSemaphoreTakeRecursive(xMCP23008Mutex, portMAX_DELAY);
+
+        esp_err_t ret = MCP23008_register_read(MCP23008_INTF_REG_ADDR, int_regs, sizeof(int_regs));
+
+        xSemaphoreGiveRecursive(xMCP23008Mutex);
+
+        if(ret != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to read MCP23008 interrupt registers.");
+        }
+
+        else
+        {
+            /**
+             *  Primero se entrega el nivel capturado al momento de la interrupción, y luego el nivel actual, en caso de
+             *  que el pin haya vuelto a cambiar mientras la interrupción estaba pendiente.
+             */
+            if(int_regs[0] & MCP23008_GPINTEN_CONFIG)
+            {
+                MCP23008_pH_trigger_deliver(int_regs[1] >> 7, edge_time_us);
+            }
+
+            MCP23008_pH_trigger_deliver(int_regs[2] >> 7, edge_time_us);
+        }
+
+        /**
+         *  Si la línea INT sigue en bajo (lectura fallida o nuevo cambio antes de liberar la interrupción), no se va
+         *  a producir un nuevo flanco, por lo que se vuelve a atender la interrupción.
+         */
+        if(!gpio_get_level(MCP23008_INT_GPIO_PIN))
+        {
+            vTaskDelay(1);
+            xTaskNotifyGive(xMCP23008IntTaskHandle);
+        }
+    }
+}
+
+
+
 //==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
@@ -111,6 +359,18 @@ static esp_err_t MCP23008_register_write_byte(uint8_t reg_addr, uint8_t data)
  */
 esp_err_t MCP23008_init(void)
 {
+    /* Se crea el mutex (recursivo, para permitir transacciones anidadas) para el acceso al MCP23008. */
+    if(xMCP23008Mutex == NULL)
+    {
+        xMCP23008Mutex = xSemaphoreCreateRecursiveMutex();
+
+        if(xMCP23008Mutex == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create MCP23008 mutex.");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
     /* 
         Se pone en alto el pin de RESET del MCP23008 (logica negada, RESET en bajo) para habilitar el funcionamiento del mismo. 
     */
@@ -145,16 +405,91 @@ esp_err_t MCP23008_init(void)
         Se realiza una escritura en el MCP23008, en el registro de configuración de I/O, para configurar el GP7 (Trigger pH)
         como entrada y el resto de GP (Relés) como salidas (10000000 = 0x80).
     */
-    ESP_RETURN_ON_ERROR(MCP23008_register_write_byte(MCP23008_IO_CONFIG_REG_ADDR, 0x80), 
+    ESP_RETURN_ON_ERROR(MCP23008_register_write_byte(MCP23008_IO_CONFIG_REG_ADDR, MCP23008_IO_CONFIG),
                         TAG, "Failed to write in the I/O configuration register.");
 
     /*
-        Se realiza una escritura en el MCP23008, en el registro GPIO, para inicializar todos los pines en 0,
+        Se realiza una escritura en el MCP23008, en el registro OLAT, para inicializar todos los pines en 0,
         menos las valvulas de control de TDS, que por su logica negada, se inicializan en 1 para que esten 
-        apagadas.
+        apagadas. Se inicializa también la copia en RAM del registro.
+    */
+    ESP_RETURN_ON_ERROR(MCP23008_register_write_byte(MCP23008_OLAT_REG_ADDR, MCP23008_OLAT_INIT),
+                        TAG, "Failed to write in the OLAT register.");
+
+    MCP23008_olat_shadow = MCP23008_OLAT_INIT;
+
+    /*
+        Se configura la interrupción por cambio en el GP7 (Trigger pH), respecto de su valor anterior (ambos flancos),
+        y se lee el estado inicial del Trigger pH, lo que además libera cualquier interrupción pendiente.
+    */
+    uint8_t gpio = 0;
+
+    ESP_RETURN_ON_ERROR(MCP23008_register_write_byte(MCP23008_INTCON_REG_ADDR, MCP23008_INTCON_CONFIG),
+                        TAG, "Failed to write in the INTCON register.");
+    ESP_RETURN_ON_ERROR(MCP23008_register_write_byte(MCP23008_GPINTEN_REG_ADDR, MCP23008_GPINTEN_CONFIG),
+                        TAG, "Failed to write in the GPINTEN register.");
+    ESP_RETURN_ON_ERROR(MCP23008_register_read(MCP23008_GPIO_PORT_REG_ADDR, &gpio, 1),
+                        TAG, "Failed to read the GPIO register.");
+
+    MCP23008_pH_trigger_level = gpio >> 7;
+
+    /* Se crea la tarea que verifica periódicamente los registros del MCP23008 contra la copia en RAM. */
+    if(xMCP23008ResyncTaskHandle == NULL)
+    {
+        xTaskCreate(
+            vTaskMCP23008Resync,
+            "vTaskMCP23008Resync",
+            2048,
+            NULL,
+            MCP23008_RESYNC_TASK_PRIORITY,
+            &xMCP23008ResyncTaskHandle);
+
+        if(xMCP23008ResyncTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create vTaskMCP23008Resync task.");
+            return ESP_FAIL;
+        }
+    }
+
+    /* Se crea la tarea de atención de la interrupción del MCP23008. */
+    if(xMCP23008IntTaskHandle == NULL)
+    {
+        xTaskCreate(
+            vTaskMCP23008Int,
+            "vTaskMCP23008Int",
+            2048,
+            NULL,
+            MCP23008_INT_TASK_PRIORITY,
+            &xMCP23008IntTaskHandle);
+
+        if(xMCP23008IntTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create vTaskMCP23008Int task.");
+            return ESP_FAIL;
+        }
+    }
+
+    /*
+        Se configura el GPIO conectado a la salida INT del MCP23008 como entrada, con interrupción por flanco descendente
+        (INT activa en bajo). El GPIO 34 no posee resistencias internas de pull-up/pull-down, pero no son necesarias ya que
+        la salida INT del MCP23008 es push-pull.
     */
-    ESP_RETURN_ON_ERROR(MCP23008_register_write_byte(MCP23008_GPIO_PORT_REG_ADDR, 0x03), 
-                        TAG, "Failed to write in the GPIO register.");
+    gpio_config_t pGPIOConfig = {
+        .pin_bit_mask = (1ULL << MCP23008_INT_GPIO_PIN),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,
+    };
+
+    ESP_RETURN_ON_ERROR(gpio_config(&pGPIOConfig), TAG, "Failed to load gpio config.");
+
+    /* El servicio de ISR de GPIO puede haber sido instalado por otro módulo. */
+    esp_err_t ret = gpio_install_isr_service(0);
+    ESP_RETURN_ON_FALSE(ret == ESP_OK || ret == ESP_ERR_INVALID_STATE, ret, TAG, "Failed to install ISR.");
+
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(MCP23008_INT_GPIO_PIN, MCP23008_int_isr_handler, NULL),
+                        TAG, "Failed to add the ISR handler.");
 
     return ESP_OK;
 
@@ -172,17 +507,11 @@ esp_err_t MCP23008_init(void)
 bool read_pH_trigger(void)
 {
 
-    /* Se crea un buffer para guardar el dato leido mediante I2C desde el MCP23008 */
-    uint8_t buffer;
-
-    /* Se realiza la lectura del registro de GPIO del MCP23008 */
-    MCP23008_register_read(MCP23008_GPIO_PORT_REG_ADDR, &buffer, 1);
-
     /* 
-        Teniendo en cuenta que el Trigger pH está conectado en el GP7 del MCP23008, mediante operación de bit se devuelve
-        0 o 1 dependiendo del estado del trigger.
+        Se devuelve el último estado del Trigger pH (GP7), actualizado por la tarea de atención de la interrupción del
+        MCP23008, sin acceder al bus I2C.
     */
-   return (buffer >> 7);
+   return MCP23008_pH_trigger_level;
 
 }
 
@@ -197,23 +526,19 @@ bool read_pH_trigger(void)
  */
 esp_err_t set_relay_state(int8_t relay_num, bool relay_state)
 {
+    /*
+        Se realiza una transacción de un único relé. Si ya había una transacción abierta por la misma tarea, el cambio
+        se aplica recién al realizar el commit de la misma.
+    */
+    ESP_RETURN_ON_ERROR(begin_relay_transaction(), TAG, "Failed to set relay state.");
 
-    /* Se crea un buffer para guardar el dato leido mediante I2C desde el MCP23008 */
-    uint8_t buffer;
-
-    /* Se realiza la lectura del registro de GPIO del MCP23008 */
-    ESP_RETURN_ON_ERROR(MCP23008_register_read(MCP23008_GPIO_PORT_REG_ADDR, &buffer, 1), 
-                        TAG, "Failed to read GPIO state.");
-
-    /* 
-        Mediante operaciones de bit, se establece en el buffer el estado del rele segun el número de rele, ambos pasados como 
-        argumentos 
+    /*
+        Mediante operaciones de bit, se establece en la máscara el bit del rele segun el número de rele, y su estado,
+        ambos pasados como argumentos
     */
-    BIT_WRITE(buffer, relay_num, relay_state);
+    set_relay_mask(BIT(relay_num), relay_state ? BIT(relay_num) : 0);
 
-    /* Se escribe en el registro de GPIO del MCP23008 el buffer resultante, con el estado del relé correspondiente ya establecido  */
-    ESP_RETURN_ON_ERROR(MCP23008_register_write_byte(MCP23008_GPIO_PORT_REG_ADDR, buffer), 
-                        TAG, "Failed to set relay state.");
+    ESP_RETURN_ON_ERROR(commit_relay_transaction(), TAG, "Failed to set relay state.");
 
     return ESP_OK;
 
@@ -230,11 +555,11 @@ esp_err_t set_relay_state(int8_t relay_num, bool relay_state)
 bool get_relay_state(int8_t relay_num)
 {
 
-    /* Se crea un buffer para guardar el dato leido mediante I2C desde el MCP23008 */
-    uint8_t buffer;
-
-    /* Se realiza la lectura del registro de GPIO del MCP23008 */
-    MCP23008_register_read(MCP23008_GPIO_PORT_REG_ADDR, &buffer, 1);
+    /*
+        Se obtiene el estado de los relés de la copia en RAM del registro OLAT, sin acceder al bus I2C. Si la tarea tiene una
+        transacción abierta, se devuelve el estado de la transacción.
+    */
+    uint8_t buffer = MCP23008_transaction_owned() ? MCP23008_olat_pending : MCP23008_olat_shadow;
 
     /* 
         A partir del número de relé del cual se desea conocer el estado, mediante operación de bit se devuelve
@@ -242,4 +567,111 @@ bool get_relay_state(int8_t relay_num)
     */
    return ((buffer >> relay_num) & 1);
 
+}
+
+
+
+/**
+ * @brief   FUNCIÓN PARA ABRIR UNA TRANSACCIÓN DE RELÉS. HASTA EL COMMIT, LOS CAMBIOS DE ESTADO DE LOS RELÉS REALIZADOS POR
+ *          LA TAREA SE ACUMULAN SIN ESCRIBIR EN EL MCP23008, Y EL RESTO DE LAS TAREAS NO PUEDEN ACCEDER AL MISMO.
+ *
+ * @return esp_err_t
+ */
+esp_err_t begin_relay_transaction(void)
+{
+    ESP_RETURN_ON_FALSE(xMCP23008Mutex != NULL, ESP_ERR_INVALID_STATE, TAG, "MCP23008 not initialized.");
+
+    xSemaphoreTakeRecursive(xMCP23008Mutex, portMAX_DELAY);
+
+    /* Si es la transacción más externa, se parte del estado actual de los relés. */
+    if(MCP23008_transaction_depth++ == 0)
+    {
+        MCP23008_olat_pending = MCP23008_olat_shadow;
+    }
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   FUNCIÓN PARA ESTABLECER EL ESTADO DE VARIOS RELÉS DENTRO DE UNA TRANSACCIÓN.
+ *
+ * @param mask      Máscara con los bits de los relés a modificar (BIT(RELE_1) | BIT(RELE_2) ...).
+ * @param state     Estado de los relés indicados en la máscara (bit en 1 = relé en 1).
+ * @return esp_err_t
+ */
+esp_err_t set_relay_mask(uint8_t mask, uint8_t state)
+{
+    ESP_RETURN_ON_FALSE(MCP23008_transaction_owned(), ESP_ERR_INVALID_STATE, TAG, "No relay transaction open.");
+
+    /* Se mantiene el GP7 (Trigger pH) fuera de la máscara, dado que es una entrada. */
+    mask &= ~MCP23008_IO_CONFIG;
+
+    MCP23008_olat_pending = (MCP23008_olat_pending & ~mask) | (state & mask);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   FUNCIÓN PARA CERRAR UNA TRANSACCIÓN DE RELÉS. SI ES LA TRANSACCIÓN MÁS EXTERNA Y EL ESTADO DE LOS RELÉS CAMBIÓ,
+ *          SE ESCRIBE EL NUEVO ESTADO EN EL REGISTRO OLAT DEL MCP23008 EN UNA ÚNICA ESCRITURA I2C.
+ *
+ * @return esp_err_t
+ */
+esp_err_t commit_relay_transaction(void)
+{
+    ESP_RETURN_ON_FALSE(MCP23008_transaction_owned(), ESP_ERR_INVALID_STATE, TAG, "No relay transaction open.");
+
+    esp_err_t ret = ESP_OK;
+
+    if(--MCP23008_transaction_depth == 0 && MCP23008_olat_pending != MCP23008_olat_shadow)
+    {
+        ret = MCP23008_register_write_byte(MCP23008_OLAT_REG_ADDR, MCP23008_olat_pending);
+
+        if(ret == ESP_OK)
+        {
+            MCP23008_olat_shadow = MCP23008_olat_pending;
+        }
+    }
+
+    xSemaphoreGiveRecursive(xMCP23008Mutex);
+
+    ESP_RETURN_ON_ERROR(ret, TAG, "Failed to commit relay transaction.");
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   FUNCIÓN PARA OBTENER LAS ESTADÍSTICAS DE ACCESO AL MCP23008 (TRANSACCIONES I2C Y VERIFICACIONES DEL REGISTRO OLAT).
+ *
+ * @param stats     Puntero a la estructura donde se guardan las estadísticas.
+ */
+void MCP23008_get_stats(MCP23008_stats_t* stats)
+{
+    if(stats == NULL || xMCP23008Mutex == NULL)
+    {
+        return;
+    }
+
+    xSemaphoreTakeRecursive(xMCP23008Mutex, portMAX_DELAY);
+    *stats = MCP23008_stats;
+    xSemaphoreGiveRecursive(xMCP23008Mutex);
+}
+
+
+
+/**
+ * @brief   FUNCIÓN PARA ASIGNAR LA FUNCIÓN CALLBACK QUE SE EJECUTA CUANDO CAMBIA EL ESTADO DEL TRIGGER PH. SE EJECUTA DESDE
+ *          LA TAREA DE ATENCIÓN DE LA INTERRUPCIÓN DEL MCP23008, POR LO QUE NO DEBE BLOQUEARSE.
+ *
+ * @param callback_function     Función callback.
+ */
+void MCP23008_pH_trigger_callback_function_on_event(MCP23008PhTriggerCallbackFunction callback_function)
+{
+    MCP23008PhTriggerCallback = callback_function;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "esp_err.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 /*==================[DEFINES AND MACROS]=====================================*/
@@ -20,6 +21,32 @@
 #define MCP23008_ADDR                       0x20                  //Dirección I2C de esclavo del MCP23008
 #define MCP23008_GPIO_PORT_REG_ADDR         0x09                  //Dirección del registro de GPIO's del MCP23008
 #define MCP23008_IO_CONFIG_REG_ADDR         0x00                  //Dirección del registro de GPIO's del MCP23008
+#define MCP23008_GPINTEN_REG_ADDR           0x02                  //Dirección del registro de habilitación de interrupción por cambio (GPINTEN)
+#define MCP23008_INTCON_REG_ADDR            0x04                  //Dirección del registro de control de interrupción (INTCON)
+#define MCP23008_INTF_REG_ADDR              0x07                  //Dirección del registro de flags de interrupción (INTF)
+#define MCP23008_INTCAP_REG_ADDR            0x08                  //Dirección del registro de captura del puerto al momento de la interrupción (INTCAP)
+#define MCP23008_OLAT_REG_ADDR              0x0A                  //Dirección del registro de latches de salida (OLAT) del MCP23008
+
+#define MCP23008_IO_CONFIG                  0x80                  //Configuración de I/O: GP7 (Trigger pH) como entrada y el resto (relés) como salidas
+#define MCP23008_OLAT_INIT                  0x03                  //Estado inicial de los relés (válvulas de TDS en 1 por su lógica negada)
+#define MCP23008_GPINTEN_CONFIG             0x80                  //Interrupción por cambio habilitada solo en el GP7 (Trigger pH)
+#define MCP23008_INTCON_CONFIG              0x00                  //Interrupción por cambio respecto del valor anterior del pin (ambos flancos)
+
+#ifndef MCP23008_INT_GPIO_PIN
+#define MCP23008_INT_GPIO_PIN               34                    //Pin de GPIO del ESP32 conectado a la salida INT del MCP23008
+#endif
+
+#ifndef MCP23008_INT_TASK_PRIORITY
+#define MCP23008_INT_TASK_PRIORITY          5                     //Prioridad de la tarea de atención de la interrupción del MCP23008
+#endif
+
+#ifndef MCP23008_RESYNC_PERIOD_MS
+#define MCP23008_RESYNC_PERIOD_MS           10000                 //Período de verificación del registro OLAT contra la copia en RAM
+#endif
+
+#ifndef MCP23008_RESYNC_TASK_PRIORITY
+#define MCP23008_RESYNC_TASK_PRIORITY       1                     //Prioridad de la tarea de verificación del registro OLAT
+#endif
 
 /* Se definen algunos macros de operaciones de bits que serán de utilidad para la función "set_relay_state" */
 
@@ -33,6 +60,28 @@
 
 /*==================[EXTERNAL DATA DECLARATION]==============================*/
 
+/* Estadísticas del acceso al MCP23008 */
+typedef struct {
+    uint32_t bus_transactions;  /* Cantidad total de transacciones I2C realizadas con el MCP23008. */
+    uint32_t resyncs;           /* Cantidad de verificaciones del registro OLAT contra la copia en RAM. */
+    uint32_t drifts;            /* Cantidad de veces que el registro OLAT no coincidía con la copia en RAM. */
+    uint32_t trigger_events;    /* Cantidad de cambios del Trigger pH entregados. */
+    int64_t trigger_max_latency_us; /* Máxima latencia entre el flanco de la línea INT y la entrega del evento, en us. */
+} MCP23008_stats_t;
+
+/* Evento de cambio del Trigger pH (GP7) */
+typedef struct {
+    bool level;                 /* Nivel del Trigger pH luego del cambio. */
+    int64_t edge_time_us;       /* Instante del flanco de la línea INT (esp_timer), tomado en la ISR. */
+    int64_t latency_us;         /* Tiempo entre el flanco y la entrega del evento. */
+} MCP23008_pH_trigger_event_t;
+
+/**
+ *  @brief  Puntero a función que será utilizado para ejecutar la función que se pase
+ *          como callback cuando cambie el estado del Trigger pH.
+ */
+typedef void (*MCP23008PhTriggerCallbackFunction)(const MCP23008_pH_trigger_event_t *event);
+
 /* Enumeración correspondiente a los 7 reles que posee la placa */
 enum relays
 {
@@ -58,6 +107,11 @@ esp_err_t MCP23008_init(void);
 bool read_pH_trigger(void);
 esp_err_t set_relay_state(int8_t relay_num, bool relay_state);
 bool get_relay_state(int8_t relay_num);
+esp_err_t begin_relay_transaction(void);
+esp_err_t set_relay_mask(uint8_t mask, uint8_t state);
+esp_err_t commit_relay_transaction(void);
+void MCP23008_get_stats(MCP23008_stats_t* stats);
+void MCP23008_pH_trigger_callback_function_on_event(MCP23008PhTriggerCallbackFunction callback_function);
 
 /*==================[END OF FILE]============================================*/
 #endif // MCP23008_H_
\ No newline at end of file
@@ -24,6 +24,7 @@
 #include "MQTT_PUBL_SUSCR.h"
 #include "FLOW_SENSOR.h"
 #include "MCP23008.h"
+#include "ACTUATOR_SERVICE.h"
 #include "ALARMAS_USUARIO.h"
 #include "APP_LEVEL_SENSOR.h"
 #include "AUXILIARES_ALGORITMO_CONTROL_BOMBEO_SOLUCION.h"
@@ -41,6 +42,19 @@ static const char *mef_bombeo_tag = "MEF_CONTROL_BOMBEO_SOLUCION";
 /* Task Handle de la tarea del algoritmo de control de bombeo de solución. */
 static TaskHandle_t xMefBombeoAlgoritmoControlTaskHandle = NULL;
 
+/* Eventos pendientes de la tarea del algoritmo de control de bombeo de solución, como máscara de bits de "mef_bombeo_evento_tipo_t". */
+static uint32_t mef_bombeo_pendientes = 0;
+
+/* Último valor recibido de las banderas de los eventos MEF_BOMBEO_EVT_TIMER_BOMBA y MEF_BOMBEO_EVT_MODO. */
+static bool mef_bombeo_pendiente_timer_flag = 0;
+static bool mef_bombeo_pendiente_manual_mode_flag = 0;
+
+/* Estadísticas de la tarea del algoritmo de control de bombeo de solución. */
+static mef_bombeo_stats_t mef_bombeo_stats;
+
+/* Spinlock para los eventos pendientes y las estadísticas. */
+static portMUX_TYPE mef_bombeo_mux = portMUX_INITIALIZER_UNLOCKED;
+
 /* Handle del timer utilizado para temporizar el control de flujo de solución en los canales de cultivo. */
 static TimerHandle_t xTimerSensorFlujo = NULL;
 
@@ -86,11 +100,81 @@ static bool mef_bombeo_timer_flow_control_flag = 0;
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
+static void mef_bombeo_post(mef_bombeo_evento_tipo_t tipo, bool flag);
+static void mef_bombeo_level_change_callback(tanques_unidad_sec_t tanque);
+static void mef_bombeo_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static void mef_bombeo_aplicar_modo_manual(void);
 void MEFControlBombeoSoluc(void);
 void vTaskSolutionPumpControl(void *pvParameters);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
+/**
+ * @brief   Función para enviar un evento a la tarea de la MEF de control de bombeo de solución, sin bloquearse.
+ *          El evento se marca como pendiente y se guarda el último valor de su bandera, por lo que no se puede
+ *          perder, y si se repite antes de que la tarea lo procese solo se aplica el último valor.
+ * 
+ * @param tipo  Tipo de evento.
+ * @param flag  Estado de la bandera asociada al evento.
+ */
+static void mef_bombeo_post(mef_bombeo_evento_tipo_t tipo, bool flag)
+{
+    if(xMefBombeoAlgoritmoControlTaskHandle == NULL)
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&mef_bombeo_mux);
+    if(tipo == MEF_BOMBEO_EVT_TIMER_BOMBA)
+    {
+        mef_bombeo_pendiente_timer_flag = flag;
+    }
+
+    else if(tipo == MEF_BOMBEO_EVT_MODO)
+    {
+        mef_bombeo_pendiente_manual_mode_flag = flag;
+    }
+
+    mef_bombeo_pendientes |= BIT(tipo);
+    portEXIT_CRITICAL(&mef_bombeo_mux);
+
+    xTaskNotifyGive(xMefBombeoAlgoritmoControlTaskHandle);
+}
+
+
+
+/**
+ * @brief   Función de callback que se ejecuta cuando cambian las banderas de nivel de algún tanque. Si se trata
+ *          del tanque principal, se le avisa a la MEF, ya que condiciona el encendido de la bomba.
+ * 
+ * @param tanque    Tanque cuyas banderas cambiaron.
+ */
+static void mef_bombeo_level_change_callback(tanques_unidad_sec_t tanque)
+{
+    if(tanque == TANQUE_PRINCIPAL)
+    {
+        mef_bombeo_post(MEF_BOMBEO_EVT_NIVEL, 0);
+    }
+}
+
+
+
+/**
+ * @brief   Handler de eventos del cliente MQTT, asignado para el evento de desconexión del broker, ante el cual
+ *          se debe volver del modo MANUAL al modo AUTOMATICO.
+ * 
+ * @param handler_args  Datos pasados como argumento al asignar el handler.
+ * @param base          Base del evento.
+ * @param event_id      ID del evento.
+ * @param event_data    Datos del evento.
+ */
+static void mef_bombeo_mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    mef_bombeo_post(MEF_BOMBEO_EVT_CONEXION_MQTT, 0);
+}
+
+
+
 /**
  * @brief   Función de callback del timer de control de presencia de flujo en el canal de cultivo.
  * 
@@ -99,25 +183,27 @@ void vTaskSolutionPumpControl(void *pvParameters);
 static void vSensorFlujoTimerCallback( TimerHandle_t pxTimer )
 {
     /**
-     *  Esta variable sirve para que, en el caso de que un llamado a "xTaskNotifyFromISR()" desbloquee
-     *  una tarea de mayor prioridad que la que estaba corriendo justo antes de entrar en la rutina
-     *  de interrupción, al retornar se haga un context switch a dicha tarea de mayor prioridad en vez
-     *  de a la de menor prioridad (xHigherPriorityTaskWoken = pdTRUE)
-     */
-    BaseType_t xHigherPriorityTaskWoken;
-    xHigherPriorityTaskWoken = pdFALSE;
-
-    /**
-     *  Se setea la bandera del timer para señalizarle a la MEF "MEFControlBombeoSoluc"
+     *  Se le envía el evento a la tarea de la MEF de control de bombeo de solución, para señalizarle
      *  que se debe volver a controlar si hay flujo de solución en los canales.
      */
-    mef_bombeo_timer_flow_control_flag = 1;
+    mef_bombeo_post(MEF_BOMBEO_EVT_TIMER_FLUJO, 1);
+}
 
-    /**
-     *  Se le envía un Task Notify a la tarea de la MEF de control de bombeo de solución.
-     */
-    vTaskNotifyGiveFromISR(xMefBombeoAlgoritmoControlTaskHandle, &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+
+
+/**
+ * @brief   Función que acciona la bomba de solución según el último estado pedido en modo MANUAL.
+ */
+static void mef_bombeo_aplicar_modo_manual(void)
+{
+    bool manual_mode_bomba_state;
+
+    if(mqtt_get_topic_on_off(mqtt_get_topic_handle(MANUAL_MODE_PUMP_STATE_MQTT_TOPIC), &manual_mode_bomba_state) == ESP_OK)
+    {
+        actuator_service_set_relay(BOMBA, manual_mode_bomba_state);
+
+        ESP_LOGW(mef_bombeo_tag, "MANUAL MODE BOMBA: %d", manual_mode_bomba_state);
+    }
 }
 
 
@@ -154,28 +240,16 @@ void MEFControlBombeoSoluc(void)
          *  Se reestablece el estado en el que estaba la bomba antes de la transición
          *  con historia.
          */
-        set_relay_state(BOMBA, mef_bombeo_pump_state_history_transition);
+        actuator_service_set_relay(BOMBA, mef_bombeo_pump_state_history_transition);
 
-        /**
-         *  Se publica el nuevo estado de la bomba en el tópico MQTT correspondiente.
-         */
-        if(mqtt_check_connection())
+        if(mef_bombeo_pump_state_history_transition == ON)
         {
-            char buffer[10];
-
-            if(mef_bombeo_pump_state_history_transition == ON)
-            {
-                snprintf(buffer, sizeof(buffer), "%s", "ON");
-                ESP_LOGW(mef_bombeo_tag, "BOMBA ENCENDIDA");
-            }
-            
-            else if(mef_bombeo_pump_state_history_transition == OFF)
-            {
-                snprintf(buffer, sizeof(buffer), "%s", "OFF");
-                ESP_LOGW(mef_bombeo_tag, "BOMBA APAGADA");
-            }
-            
-            esp_mqtt_client_publish(MefBombeoClienteMQTT, PUMP_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
+            ESP_LOGW(mef_bombeo_tag, "BOMBA ENCENDIDA");
+        }
+        
+        else if(mef_bombeo_pump_state_history_transition == OFF)
+        {
+            ESP_LOGW(mef_bombeo_tag, "BOMBA APAGADA");
         }
     }
 
@@ -207,16 +281,7 @@ void MEFControlBombeoSoluc(void)
              */
             mef_bombeo_pump_state_history_transition = ON;
 
-            set_relay_state(BOMBA, ON);
-            /**
-             *  Se publica el nuevo estado de la bomba en el tópico MQTT correspondiente.
-             */
-            if(mqtt_check_connection())
-            {
-                char buffer[10];
-                snprintf(buffer, sizeof(buffer), "%s", "ON");
-                esp_mqtt_client_publish(MefBombeoClienteMQTT, PUMP_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-            }
+            actuator_service_set_relay(BOMBA, ON);
 
             ESP_LOGW(mef_bombeo_tag, "BOMBA ENCENDIDA");
 
@@ -238,12 +303,9 @@ void MEFControlBombeoSoluc(void)
 
             if(flow_sensor_flow_detected())
             {
-                if(mqtt_check_connection())
-                {
-                    char buffer[10];
-                    snprintf(buffer, sizeof(buffer), "%i", ALARMA_FALLA_BOMBA);
-                    esp_mqtt_client_publish(MefBombeoClienteMQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-                }
+                char buffer[10];
+                snprintf(buffer, sizeof(buffer), "%i", ALARMA_FALLA_BOMBA);
+                mqtt_publish_data(MefBombeoClienteMQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
                 ESP_LOGE(mef_bombeo_tag, "ALARMA, CIRCULA SOLUCIÓN POR LOS CANALES CUANDO NO DEBERÍA.");
             }
@@ -281,16 +343,7 @@ void MEFControlBombeoSoluc(void)
              */
             mef_bombeo_pump_state_history_transition = OFF;
 
-            set_relay_state(BOMBA, OFF);
-            /**
-             *  Se publica el nuevo estado de la bomba en el tópico MQTT correspondiente.
-             */
-            if(mqtt_check_connection())
-            {
-                char buffer[10];
-                snprintf(buffer, sizeof(buffer), "%s", "OFF");
-                esp_mqtt_client_publish(MefBombeoClienteMQTT, PUMP_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-            }
+            actuator_service_set_relay(BOMBA, OFF);
 
             ESP_LOGW(mef_bombeo_tag, "BOMBA APAGADA");
 
@@ -313,12 +366,9 @@ void MEFControlBombeoSoluc(void)
 
             if(!flow_sensor_flow_detected())
             {
-                if(mqtt_check_connection())
-                {
-                    char buffer[10];
-                    snprintf(buffer, sizeof(buffer), "%i", ALARMA_FALLA_BOMBA);
-                    esp_mqtt_client_publish(MefBombeoClienteMQTT, ALARMS_MQTT_TOPIC, buffer, 0, 0, 0);
-                }
+                char buffer[10];
+                snprintf(buffer, sizeof(buffer), "%i", ALARMA_FALLA_BOMBA);
+                mqtt_publish_data(MefBombeoClienteMQTT, ALARMS_MQTT_TOPIC, buffer, 0, MQTT_PUBLISH_KEEP_ALL);
 
                 ESP_LOGE(mef_bombeo_tag, "ALARMA, NO CIRCULA SOLUCIÓN POR LOS CANALES.");
             }
@@ -349,34 +399,67 @@ void vTaskSolutionPumpControl(void *pvParameters)
     /**
      *  Se establece el estado inicial de la bomba, que es apagada.
      */
-    set_relay_state(BOMBA, OFF);
-    /**
-     *  Se publica el nuevo estado de la bomba en el tópico MQTT correspondiente.
-     */
-    if(mqtt_check_connection())
-    {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%s", "OFF");
-        esp_mqtt_client_publish(MefBombeoClienteMQTT, PUMP_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-    }
+    actuator_service_set_relay(BOMBA, OFF);
 
     ESP_LOGW(mef_bombeo_tag, "BOMBA APAGADA");
 
 
+    uint32_t pendientes;
+
     while(1)
     {
         /**
-         *  Se realiza un Notify Take a la espera de señales que indiquen:
+         *  Se espera, sin timeout, un evento que indique:
          *  
          *  -Que se debe pasar a modo MANUAL o modo AUTO.
          *  -Que estando en modo MANUAL, se deba cambiar el estado de la bomba.
          *  -Que se cumplió el timeout del timer de control del tiempo de encendido o apagado de la bomba.
          *  -Que se cumplió el timeout del timer de control de flujo en los canales de cultivo.
+         *  -Que cambiaron las banderas de nivel del tanque principal.
+         *  -Que se produjo una desconexión del broker MQTT.
          * 
-         *  Además, se le coloca un timeout para evaluar las transiciones de las MEFs periódicamente, en caso
-         *  de que no llegue ninguna de las señales mencionadas.
+         *  Las MEFs solo se evalúan al recibir un evento, ya que sus transiciones dependen únicamente de ellos.
          */
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /**
+         *  Se toman los eventos pendientes, aplicando el último valor de las banderas asociadas. Los eventos
+         *  repetidos antes de despertarse la tarea se combinan en una única evaluación de las MEFs.
+         */
+        portENTER_CRITICAL(&mef_bombeo_mux);
+        pendientes = mef_bombeo_pendientes;
+        mef_bombeo_pendientes = 0;
+
+        if(pendientes & BIT(MEF_BOMBEO_EVT_TIMER_BOMBA))
+        {
+            mef_bombeo_timer_finished_flag = mef_bombeo_pendiente_timer_flag;
+        }
+
+        if(pendientes & BIT(MEF_BOMBEO_EVT_TIMER_FLUJO))
+        {
+            mef_bombeo_timer_flow_control_flag = 1;
+        }
+
+        if(pendientes & BIT(MEF_BOMBEO_EVT_MODO))
+        {
+            mef_bombeo_manual_mode_flag = mef_bombeo_pendiente_manual_mode_flag;
+        }
+
+        mef_bombeo_stats.despertares++;
+
+        for(int tipo = 0; tipo < MEF_BOMBEO_EVT_CANTIDAD; tipo++)
+        {
+            if(pendientes & BIT(tipo))
+            {
+                mef_bombeo_stats.eventos[tipo]++;
+            }
+        }
+        portEXIT_CRITICAL(&mef_bombeo_mux);
+
+        if(pendientes == 0)
+        {
+            continue;
+        }
 
 
         switch(est_MEF_principal)
@@ -397,6 +480,11 @@ void vTaskSolutionPumpControl(void *pvParameters)
                 xTimerStop(aux_control_bombeo_get_timer_handle(), 0);
                 xTimerStop(xTimerSensorFlujo, 0);
 
+                /**
+                 *  Se aplica en el momento el último estado pedido de la bomba en modo MANUAL.
+                 */
+                mef_bombeo_aplicar_modo_manual();
+
                 break;
             }
 
@@ -410,7 +498,8 @@ void vTaskSolutionPumpControl(void *pvParameters)
             /**
              *  En caso de que se baje la bandera de modo MANUAL, se debe transicionar nuevamente al estado
              *  de modo AUTOMATICO, en donde se controla el encendido y apagado de la bomba por tiempos,
-             *  mediante una transición con historia, por lo que se setea la bandera correspondiente.
+             *  mediante una transición con historia, por lo que se setea la bandera correspondiente y se
+             *  evalúa la MEF en el momento, para restaurar el estado de la bomba y de los timers.
              * 
              *  Además, en caso de que se produzca una desconexión del broker MQTT, se vuelve también
              *  al modo AUTOMATICO, y se limpia la bandera de modo MANUAL.
@@ -422,6 +511,8 @@ void vTaskSolutionPumpControl(void *pvParameters)
                 mef_bombeo_manual_mode_flag = 0;
                 mef_bombeo_history_transition_flag_control_bombeo_solucion = 1;
 
+                MEFControlBombeoSoluc();
+
                 break;
             }
 
@@ -429,35 +520,7 @@ void vTaskSolutionPumpControl(void *pvParameters)
              *  Se obtiene el nuevo estado en el que debe estar la bomba de solución y se acciona
              *  el relé correspondiente.
              */
-            float manual_mode_bomba_state = -1;
-            mqtt_get_float_data_from_topic(MANUAL_MODE_PUMP_STATE_MQTT_TOPIC, &manual_mode_bomba_state);
-
-            if(manual_mode_bomba_state == 0 || manual_mode_bomba_state == 1)
-            {
-                set_relay_state(BOMBA, manual_mode_bomba_state);
-
-                /**
-                 *  Se publica el nuevo estado de la bomba en el tópico MQTT correspondiente.
-                 */
-                if(mqtt_check_connection())
-                {
-                    char buffer[10];
-
-                    if(manual_mode_bomba_state == 0)
-                    {
-                        snprintf(buffer, sizeof(buffer), "%s", "OFF");    
-                    }
-
-                    else if(manual_mode_bomba_state == 1)
-                    {
-                        snprintf(buffer, sizeof(buffer), "%s", "ON");
-                    }
-
-                    esp_mqtt_client_publish(MefBombeoClienteMQTT, PUMP_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-                }
-
-                ESP_LOGW(mef_bombeo_tag, "MANUAL MODE BOMBA: %.0f", manual_mode_bomba_state);
-            }
+            mef_bombeo_aplicar_modo_manual();
 
             break;
         }
@@ -479,6 +542,15 @@ esp_err_t mef_bombeo_init(esp_mqtt_client_handle_t mqtt_client)
      */
     MefBombeoClienteMQTT = mqtt_client;
 
+    /**
+     *  Se asigna el tópico MQTT en el que el servicio de actuadores publica el estado de la bomba
+     *  cada vez que cambia.
+     */
+    if(actuator_service_set_state_topic(BOMBA, PUMP_STATE_MQTT_TOPIC) != ESP_OK)
+    {
+        ESP_LOGW(mef_bombeo_tag, "FAILED TO SET PUMP STATE TOPIC.");
+    }
+
     //=======================| INIT SENSOR FLUJO |=======================//
 
     /**
@@ -512,6 +584,19 @@ esp_err_t mef_bombeo_init(esp_mqtt_client_handle_t mqtt_client)
         }
     }
 
+    //=======================| INIT FUENTES DE EVENTOS |=======================//
+
+    /**
+     *  Una vez creada la tarea, se asignan las fuentes de eventos que no provienen de los timers ni de los
+     *  tópicos MQTT: los cambios de nivel del tanque principal y la desconexión del broker MQTT.
+     */
+    if(app_level_sensor_add_change_callback(mef_bombeo_level_change_callback) != ESP_OK
+        || esp_mqtt_client_register_event(mqtt_client, MQTT_EVENT_DISCONNECTED, mef_bombeo_mqtt_event_handler, NULL) != ESP_OK)
+    {
+        ESP_LOGE(mef_bombeo_tag, "FAILED TO REGISTER EVENT SOURCES.");
+        return ESP_FAIL;
+    }
+
     //=======================| INIT TIMERS |=======================//
 
     /**
@@ -597,7 +682,7 @@ void mef_bombeo_set_pump_off_time_min(pump_time_t nuevo_tiempo_bomba_off)
  */
 void mef_bombeo_set_manual_mode_flag_value(bool manual_mode_flag_state)
 {
-    mef_bombeo_manual_mode_flag = manual_mode_flag_state;
+    mef_bombeo_post(MEF_BOMBEO_EVT_MODO, manual_mode_flag_state);
 }
 
 
@@ -606,9 +691,34 @@ void mef_bombeo_set_manual_mode_flag_value(bool manual_mode_flag_state)
  * @brief   Función para cambiar el estado de la bandera de timeout del timer mediante
  *          el que se controla el tiempo de encendido y apagado de la bomba de solución.
  * 
- * @param manual_mode_flag_state    Estado de la bandera.
+ * @param timer_flag_state    Estado de la bandera.
  */
 void mef_bombeo_set_timer_flag_value(bool timer_flag_state)
 {
-    mef_bombeo_timer_finished_flag = timer_flag_state;
+    mef_bombeo_post(MEF_BOMBEO_EVT_TIMER_BOMBA, timer_flag_state);
+}
+
+
+
+/**
+ * @brief   Función para avisarle a la MEF que llegó un nuevo estado pedido para la bomba
+ *          de solución en modo MANUAL.
+ */
+void mef_bombeo_notify_manual_mode_actuator_state(void)
+{
+    mef_bombeo_post(MEF_BOMBEO_EVT_ESTADO_MANUAL, 0);
+}
+
+
+
+/**
+ * @brief   Función para obtener las estadísticas de la tarea de la MEF de control de bombeo de solución.
+ * 
+ * @param stats     Puntero a la estructura donde se copian las estadísticas.
+ */
+void mef_bombeo_get_stats(mef_bombeo_stats_t *stats)
+{
+    portENTER_CRITICAL(&mef_bombeo_mux);
+    *stats = mef_bombeo_stats;
+    portEXIT_CRITICAL(&mef_bombeo_mux);
 }
\ No newline at end of file
@@ -37,7 +37,7 @@ extern "C" {
  * 
  *  NOTA: CUANDO SE SEPA BIEN QUÉ RELÉ SE ASOCIA A QUÉ ACTUADOR, MODIFICAR LOS NÚMEROS.
  */
-typedef enum actuadores_control_bombeo_soluc{
+enum actuadores_control_bombeo_soluc{
     BOMBA = RELE_5,
 };
 
@@ -65,6 +65,29 @@ typedef enum {
  */
 typedef float pump_time_t;
 
+
+/**
+ *  Enumeración correspondiente a los tipos de evento que despiertan a la tarea de la MEF de control de bombeo de solución.
+ *  Los eventos no se encolan, sino que se marcan como pendientes en una máscara de bits, junto con el último valor de
+ *  su bandera, por lo que no se pueden perder.
+ */
+typedef enum {
+    MEF_BOMBEO_EVT_TIMER_BOMBA = 0,     /* Se cumplió el tiempo de encendido o apagado de la bomba. */
+    MEF_BOMBEO_EVT_TIMER_FLUJO,         /* Se cumplió el período de control de flujo en los canales. */
+    MEF_BOMBEO_EVT_MODO,                /* Cambio entre modo MANUAL y AUTOMATICO. */
+    MEF_BOMBEO_EVT_ESTADO_MANUAL,       /* Nuevo estado pedido de la bomba en modo MANUAL. */
+    MEF_BOMBEO_EVT_NIVEL,               /* Cambio de las banderas de nivel del tanque principal. */
+    MEF_BOMBEO_EVT_CONEXION_MQTT,       /* Desconexión del broker MQTT. */
+    MEF_BOMBEO_EVT_CANTIDAD,
+} mef_bombeo_evento_tipo_t;
+
+
+/* Estadísticas de la MEF de control de bombeo de solución, para verificar la cantidad de veces que se despierta su tarea. */
+typedef struct {
+    uint32_t despertares;                           /* Cantidad de veces que se despertó la tarea. */
+    uint32_t eventos[MEF_BOMBEO_EVT_CANTIDAD];      /* Cantidad de eventos procesados, por tipo. */
+} mef_bombeo_stats_t;
+
 /*======================[EXTERNAL DATA DECLARATION]==============================*/
 
 /*=====================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
@@ -75,6 +98,8 @@ void mef_bombeo_set_pump_on_time_min(pump_time_t tiempo_bomba_on);
 void mef_bombeo_set_pump_off_time_min(pump_time_t tiempo_bomba_off);
 void mef_bombeo_set_manual_mode_flag_value(bool manual_mode_flag_state);
 void mef_bombeo_set_timer_flag_value(bool timer_flag_state);
+void mef_bombeo_notify_manual_mode_actuator_state(void);
+void mef_bombeo_get_stats(mef_bombeo_stats_t *stats);
 
 /*==================[END OF FILE]============================================*/
 #ifdef __cplusplus
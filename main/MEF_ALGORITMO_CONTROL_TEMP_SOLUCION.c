@@ -1,7 +1,8 @@
 /**
  * @file MEF_ALGORITMO_CONTROL_TEMP_SOLUCION.c
  * @author Franco Bisciglia, David Kündinger
- * @brief   Implementación de las diferentes MEF's del algoritmo de control de la temperatura de la solución.
+ * @brief   Implementación de las diferentes MEF's del algoritmo de control de la temperatura de la solución, como
+ *          un lazo del motor de control por ventana de histéresis.
  * @version 0.1
  * @date 2023-01-16
  *
@@ -22,6 +23,8 @@
 #include "MQTT_PUBL_SUSCR.h"
 #include "DS18B20_SENSOR.h"
 #include "MCP23008.h"
+#include "ACTUATOR_SERVICE.h"
+#include "HYSTERESIS_CONTROLLER.h"
 #include "AUXILIARES_ALGORITMO_CONTROL_TEMP_SOLUCION.h"
 #include "MEF_ALGORITMO_CONTROL_TEMP_SOLUCION.h"
 
@@ -34,327 +37,49 @@
 /* Tag para imprimir información en el LOG. */
 static const char *mef_temp_soluc_tag = "MEF_CONTROL_TEMP_SOLUCION";
 
-/* Task Handle de la tarea del algoritmo de control de la temperatura de la solución. */
-static TaskHandle_t xMefTempSolucAlgoritmoControlTaskHandle = NULL;
-
 /* Handle del cliente MQTT. */
 static esp_mqtt_client_handle_t MefTempSolucClienteMQTT = NULL;
 
-/* Variable donde se guarda el valor de la temperatura de la solución sensada en °C. */
-static DS18B20_sensor_temp_t mef_temp_soluc_temp = 25;
-/* Límite inferior del rango considerado como correcto en el algoritmo de control de la temperatura de la solución en °C. */
-static DS18B20_sensor_temp_t mef_temp_soluc_limite_inferior_temp_soluc = 23;
-/* Límite superior del rango considerado como correcto en el algoritmo de control de la temperatura de la solución en °C. */
-static DS18B20_sensor_temp_t mef_temp_soluc_limite_superior_temp_soluc = 27;
-/* Ancho de la ventana de histeresis posicionada alrededor de los límites del rango considerado como correcto, en °C. */
-static DS18B20_sensor_temp_t mef_temp_soluc_ancho_ventana_hist = 1;
-/* Delta de temperatura considerado, en °C. */
-static DS18B20_sensor_temp_t mef_temp_soluc_delta_temp_soluc = 2;
-
-/* Bandera utilizada para controlar si se está o no en modo manual en el algoritmo de control de temperatura solución. */
-static bool mef_temp_soluc_manual_mode_flag = 0;
-/* Bandera utilizada para controlar las transiciones con reset de la MEF de control de temperatura solución. */
-static bool mef_temp_soluc_reset_transition_flag_control_temp = 0;
-/* Bandera utilizada para verificar si hubo error de sensado del sensor de temperatura de la solución. */
-static bool mef_temp_soluc_sensor_error_flag = 0;
-
-//==================================| EXTERNAL DATA DEFINITION |==================================//
-
-//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
-
-void MEFControlTempSoluc(void);
-void vTaskSolutionTempControl(void *pvParameters);
-
-//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
+/* Handle del lazo de control de temperatura de la solución en el motor de control por ventana de histéresis. */
+static hyst_ctrl_loop_handle_t mef_temp_soluc_loop = NULL;
 
 /**
- * @brief   Función de la MEF de control de la temperatura en la solución nutritiva. Mediante un control
- *          de ventana de histéresis, se accionan el calefactor o refrigerador según sea requerido para
- *          mantener la temperatura de la solución dentro de los límites inferior y superior establecidos.
+ *  Descriptor del lazo de control de temperatura de la solución: el calefactor o el refrigerador se mantienen
+ *  encendidos mientras la temperatura esté fuera de la ventana de histéresis correspondiente.
  */
-void MEFControlTempSoluc(void)
-{
-    /**
-     * Variable que representa el estado de la MEF de control de temperatura de la solución.
-     */
-    static estado_MEF_control_temp_soluc_t est_MEF_control_temp_soluc = TEMP_SOLUCION_CORRECTA;
+static const hyst_ctrl_loop_desc_t mef_temp_soluc_desc = {
+    .tag = "MEF_CONTROL_TEMP_SOLUCION",
 
-    /**
-     *  Se controla si se debe hacer una transición con reset, caso en el cual se vuelve al estado
-     *  de TEMP_SOLUCION_CORRECTA, con el refrigerador y calefactor de solución apagados.
-     */
-    if (mef_temp_soluc_reset_transition_flag_control_temp)
-    {
-        set_relay_state(CALEFACTOR_SOLUC, OFF);
-        set_relay_state(REFRIGERADOR_SOLUC, OFF);
-
-        ESP_LOGW(mef_temp_soluc_tag, "REFRIGERADOR APAGADO");
-        ESP_LOGW(mef_temp_soluc_tag, "CALEFACTOR APAGADO");
-
-        /**
-         *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
-         */
-        if(mqtt_check_connection())
-        {
-            char buffer[10];
-            snprintf(buffer, sizeof(buffer), "%s", "OFF");
-            esp_mqtt_client_publish(MefTempSolucClienteMQTT, REFRIGERADOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-            esp_mqtt_client_publish(MefTempSolucClienteMQTT, CALEFACTOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-        }
-        
-        est_MEF_control_temp_soluc = TEMP_SOLUCION_CORRECTA;
-        mef_temp_soluc_reset_transition_flag_control_temp = 0;
-    }
+    .valor_inicial = 25,
+    .limite_inferior = 23,
+    .limite_superior = 27,
+    .ancho_ventana_hist = 1,
+    .delta = 2,
 
-    switch (est_MEF_control_temp_soluc)
-    {
+    .actuador_aumento = CALEFACTOR_SOLUC,
+    .actuador_disminucion = REFRIGERADOR_SOLUC,
+    .nombre_aumento = "CALEFACTOR",
+    .nombre_disminucion = "REFRIGERADOR",
+    .nivel_encendido = ON,
 
-    case TEMP_SOLUCION_CORRECTA:
-
-        /**
-         *  En caso de que el nivel de temperatura de la solución caiga por debajo del límite inferior de la ventana de histeresis
-         *  centrada en el límite inferior de nivel de temperatura establecido, se cambia al estado en el cual se enciende
-         *  el calefactor de solución. Además, no debe estar levantada la bandera de error de sensor.
-         */
-        if (mef_temp_soluc_temp < (mef_temp_soluc_limite_inferior_temp_soluc - (mef_temp_soluc_ancho_ventana_hist / 2)) && !mef_temp_soluc_sensor_error_flag)
-        {
-            set_relay_state(CALEFACTOR_SOLUC, ON);
-            /**
-             *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
-             */
-            if(mqtt_check_connection())
-            {
-                char buffer[10];
-                snprintf(buffer, sizeof(buffer), "%s", "ON");
-                esp_mqtt_client_publish(MefTempSolucClienteMQTT, CALEFACTOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-            }
-
-            ESP_LOGW(mef_temp_soluc_tag, "CALEFACTOR ENCENDIDO");
-
-            est_MEF_control_temp_soluc = TEMP_SOLUCION_BAJA;
-        }
-
-        /**
-         *  En caso de que el nivel de temperatura de la solución suba por encima del límite superior de la ventana de histeresis
-         *  centrada en el límite superior de nivel de temperatura establecido, se cambia al estado en el cual se enciende
-         *  el refrigerador de solución. Además, no debe estar levantada la bandera de error de sensor.
-         */
-        if (mef_temp_soluc_temp > (mef_temp_soluc_limite_superior_temp_soluc + (mef_temp_soluc_ancho_ventana_hist / 2)) && !mef_temp_soluc_sensor_error_flag)
-        {
-            set_relay_state(REFRIGERADOR_SOLUC, ON);
-            /**
-             *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
-             */
-            if(mqtt_check_connection())
-            {
-                char buffer[10];
-                snprintf(buffer, sizeof(buffer), "%s", "ON");
-                esp_mqtt_client_publish(MefTempSolucClienteMQTT, REFRIGERADOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-            }
-
-            ESP_LOGW(mef_temp_soluc_tag, "REFRIGERADOR ENCENDIDO");
-
-            est_MEF_control_temp_soluc = TEMP_SOLUCION_ELEVADA;
-        }
-
-        break;
-
-    case TEMP_SOLUCION_BAJA:
-
-        /**
-         *  Cuando el nivel de temperatura sobrepase el límite superior de la ventana de histeresis centrada en el límite inferior
-         *  del rango de temperatura correcto, se transiciona al estado con el refrigerador y calefactor apagados. Además, si se 
-         *  levanta la bandera de error de sensor, se transiciona a dicho estado.
-         */
-        if (mef_temp_soluc_temp > (mef_temp_soluc_limite_inferior_temp_soluc + (mef_temp_soluc_ancho_ventana_hist / 2)) || mef_temp_soluc_sensor_error_flag)
-        {
-            set_relay_state(CALEFACTOR_SOLUC, OFF);
-            /**
-             *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
-             */
-            if(mqtt_check_connection())
-            {
-                char buffer[10];
-                snprintf(buffer, sizeof(buffer), "%s", "OFF");
-                esp_mqtt_client_publish(MefTempSolucClienteMQTT, CALEFACTOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-            }
-
-            ESP_LOGW(mef_temp_soluc_tag, "CALEFACTOR APAGADO");
-
-            est_MEF_control_temp_soluc = TEMP_SOLUCION_CORRECTA;
-        }
-
-        break;
-
-    case TEMP_SOLUCION_ELEVADA:
-
-        /**
-         *  Cuando el nivel de temperatura caiga por debajo del límite inferior de la ventana de histeresis centrada en el límite 
-         *  superior del rango de temperatura correcto, se transiciona al estado con el refrigerador y calefactor apagados. Además, 
-         *  si se levanta la bandera de error de sensor, se transiciona a dicho estado.
-         */
-        if (mef_temp_soluc_temp < (mef_temp_soluc_limite_superior_temp_soluc - (mef_temp_soluc_ancho_ventana_hist / 2)) || mef_temp_soluc_sensor_error_flag)
-        {
-            set_relay_state(REFRIGERADOR_SOLUC, OFF);
-            /**
-             *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
-             */
-            if(mqtt_check_connection())
-            {
-                char buffer[10];
-                snprintf(buffer, sizeof(buffer), "%s", "OFF");
-                esp_mqtt_client_publish(MefTempSolucClienteMQTT, REFRIGERADOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-            }
-
-            ESP_LOGW(mef_temp_soluc_tag, "REFRIGERADOR APAGADO");
-
-            est_MEF_control_temp_soluc = TEMP_SOLUCION_CORRECTA;
-        }
-
-        break;
-    }
-}
+    .bloqueo = NULL,
+    .bloqueo_aumento = NULL,
+    .bloqueo_disminucion = NULL,
 
+    .tiempo_apertura_ms = 0,
+    .tiempo_cierre_ms = 0,
 
+    .topic_manual_aumento = MANUAL_MODE_CALEFACTOR_STATE_MQTT_TOPIC,
+    .topic_manual_disminucion = MANUAL_MODE_REFRIGERADOR_STATE_MQTT_TOPIC,
 
-/**
- * @brief   Tarea que representa la MEF principal (de mayor jerarquía) del algoritmo de 
- *          control de la temperatura de la solución nutritiva, alternando entre el modo automatico
- *          o manual de control según se requiera.
- * 
- * @param pvParameters  Parámetro que se le pasa a la tarea en su creación.
- */
-void vTaskSolutionTempControl(void *pvParameters)
-{
-    /**
-     * Variable que representa el estado de la MEF de jerarquía superior del algoritmo de control del temperatura de la solución.
-     */
-    static estado_MEF_principal_control_temp_soluc_t est_MEF_principal = ALGORITMO_CONTROL_TEMP_SOLUC;
+    .on_eval = NULL,
+};
 
-    while (1)
-    {
-        /**
-         *  Se realiza un Notify Take a la espera de señales que indiquen:
-         *
-         *  -Que se debe pasar a modo MANUAL o modo AUTO.
-         *  -Que estando en modo MANUAL, se deba cambiar el estado del refrigerador o calefactor.
-         *
-         *  Además, se le coloca un timeout para evaluar las transiciones de las MEFs periódicamente, en caso
-         *  de que no llegue ninguna de las señales mencionadas, y para controlar el nivel de temperatura que llega
-         *  desde el sensor de temperatura sumergible.
-         */
-        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
-
-        switch (est_MEF_principal)
-        {
-
-        case ALGORITMO_CONTROL_TEMP_SOLUC:
-
-            /**
-             *  En caso de que se levante la bandera de modo MANUAL, se debe transicionar a dicho estado,
-             *  en donde el accionamiento del calefactor y refrigerador será manejado por el usuario
-             *  vía mensajes MQTT.
-             */
-            if (mef_temp_soluc_manual_mode_flag)
-            {
-                est_MEF_principal = TEMP_SOLUC_MODO_MANUAL;
-                mef_temp_soluc_reset_transition_flag_control_temp = 1;
-            }
-
-            MEFControlTempSoluc();
-
-            break;
-
-        case TEMP_SOLUC_MODO_MANUAL:
-
-            /**
-             *  En caso de que se baje la bandera de modo MANUAL, se debe transicionar nuevamente al estado
-             *  de modo AUTOMATICO, en donde se controla la temperatura de la solución a partir de los
-             *  valores del sensor de temperatura sumergible y el calefactor y refrigerador.
-             * 
-             *  Además, en caso de que se produzca una desconexión del broker MQTT, se vuelve también
-             *  al modo AUTOMATICO, y se limpia la bandera de modo MANUAL.
-             */
-            if (!mef_temp_soluc_manual_mode_flag || !mqtt_check_connection())
-            {
-                est_MEF_principal = ALGORITMO_CONTROL_TEMP_SOLUC;
-
-                mef_temp_soluc_manual_mode_flag = 0;
-
-                /**
-                 *  Se setea la bandera de reset de la MEF de control de temperatura de solución de modo
-                 *  que se resetee el estado de los actuadores correspondientes.
-                 */
-                mef_temp_soluc_reset_transition_flag_control_temp = 1;
-
-                break;
-            }
-
-            /**
-             *  Se obtiene el nuevo estado en el que deben estar el calefactor y refrigerador, y se accionan
-             *  los relés correspondientes.
-             */
-            float manual_mode_refrigerador_state = -1;
-            float manual_mode_calefactor_state = -1;
-            mqtt_get_float_data_from_topic(MANUAL_MODE_REFRIGERADOR_STATE_MQTT_TOPIC, &manual_mode_refrigerador_state);
-            mqtt_get_float_data_from_topic(MANUAL_MODE_CALEFACTOR_STATE_MQTT_TOPIC, &manual_mode_calefactor_state);
-
-            if (manual_mode_refrigerador_state == 0 || manual_mode_refrigerador_state == 1)
-            {
-                set_relay_state(REFRIGERADOR_SOLUC, manual_mode_refrigerador_state);
-                /**
-                 *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
-                 */
-                if(mqtt_check_connection())
-                {
-                    char buffer[10];
-
-                    if(manual_mode_refrigerador_state == 0)
-                    {
-                        snprintf(buffer, sizeof(buffer), "%s", "OFF");    
-                    }
-
-                    else if(manual_mode_refrigerador_state == 1)
-                    {
-                        snprintf(buffer, sizeof(buffer), "%s", "ON");
-                    }
-
-                    esp_mqtt_client_publish(MefTempSolucClienteMQTT, REFRIGERADOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-                }
-
-                ESP_LOGW(mef_temp_soluc_tag, "MANUAL MODE REFRIGERADOR: %.0f", manual_mode_refrigerador_state);
-            }
-
-            if (manual_mode_calefactor_state == 0 || manual_mode_calefactor_state == 1)
-            {
-                set_relay_state(CALEFACTOR_SOLUC, manual_mode_calefactor_state);
-                /**
-                 *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
-                 */
-                if(mqtt_check_connection())
-                {
-                    char buffer[10];
-
-                    if(manual_mode_calefactor_state == 0)
-                    {
-                        snprintf(buffer, sizeof(buffer), "%s", "OFF");    
-                    }
-
-                    else if(manual_mode_calefactor_state == 1)
-                    {
-                        snprintf(buffer, sizeof(buffer), "%s", "ON");
-                    }
-
-                    esp_mqtt_client_publish(MefTempSolucClienteMQTT, CALEFACTOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-                }
-
-                ESP_LOGW(mef_temp_soluc_tag, "MANUAL MODE CALEFACTOR: %.0f", manual_mode_calefactor_state);
-            }
-
-            break;
-        }
-    }
-}
+//==================================| EXTERNAL DATA DEFINITION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 //==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
 
@@ -371,50 +96,34 @@ esp_err_t mef_temp_soluc_init(esp_mqtt_client_handle_t mqtt_client)
      */
     MefTempSolucClienteMQTT = mqtt_client;
 
-    //=======================| CREACION TAREAS |=======================//
+    //=======================| REGISTRO DEL LAZO |=======================//
 
     /**
-     *  Se crea la tarea mediante la cual se controlará la transicion de las
-     *  MEFs del algoritmo de control de temperatura de solución.
+     *  Se registra el lazo de control de temperatura de solución en el motor de control por
+     *  ventana de histéresis, cuya tarea evalúa las MEFs de todos los lazos.
      */
-    if (xMefTempSolucAlgoritmoControlTaskHandle == NULL)
+    if (mef_temp_soluc_loop == NULL && hyst_ctrl_register_loop(&mef_temp_soluc_desc, mqtt_client, &mef_temp_soluc_loop) != ESP_OK)
     {
-        xTaskCreate(
-            vTaskSolutionTempControl,
-            "vTaskSolutionTempControl",
-            4096,
-            NULL,
-            2,
-            &xMefTempSolucAlgoritmoControlTaskHandle);
-
-        /**
-         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
-         */
-        if (xMefTempSolucAlgoritmoControlTaskHandle == NULL)
-        {
-            ESP_LOGE(mef_temp_soluc_tag, "Failed to create vTaskSolutionTempControl task.");
-            return ESP_FAIL;
-        }
+        ESP_LOGE(mef_temp_soluc_tag, "Failed to register solution temperature control loop.");
+        return ESP_FAIL;
     }
 
 
     //=======================| INIT ESTADO ACTUADORES |=======================//
     
     /**
-     *  Se inicializa el estado del calefactor y refrigerador en apagado.
+     *  Se inicializa el estado del calefactor y refrigerador en apagado, en un único pedido al servicio de actuadores.
      */
-    set_relay_state(CALEFACTOR_SOLUC, OFF);
-    set_relay_state(REFRIGERADOR_SOLUC, OFF);
+    actuator_service_set_relay_mask(BIT(CALEFACTOR_SOLUC) | BIT(REFRIGERADOR_SOLUC), 0);
 
     /**
-     *  Se publica el nuevo estado del refrigerador y calefactor en el tópico MQTT correspondiente.
+     *  Se asignan los tópicos MQTT en los que el servicio de actuadores publica el estado del refrigerador
+     *  y calefactor cada vez que cambia.
      */
-    if(mqtt_check_connection())
+    if(actuator_service_set_state_topic(REFRIGERADOR_SOLUC, REFRIGERADOR_STATE_MQTT_TOPIC) != ESP_OK
+        || actuator_service_set_state_topic(CALEFACTOR_SOLUC, CALEFACTOR_STATE_MQTT_TOPIC) != ESP_OK)
     {
-        char buffer[10];
-        snprintf(buffer, sizeof(buffer), "%s", "OFF");
-        esp_mqtt_client_publish(MefTempSolucClienteMQTT, REFRIGERADOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
-        esp_mqtt_client_publish(MefTempSolucClienteMQTT, CALEFACTOR_STATE_MQTT_TOPIC, buffer, 0, 0, 0);
+        ESP_LOGW(mef_temp_soluc_tag, "FAILED TO SET ACTUATORS STATE TOPIC.");
     }
 
     ESP_LOGW(mef_temp_soluc_tag, "REFRIGERADOR APAGADO");
@@ -427,13 +136,13 @@ esp_err_t mef_temp_soluc_init(esp_mqtt_client_handle_t mqtt_client)
 
 
 /**
- * @brief   Función que devuelve el Task Handle de la tarea principal del algoritmo de control de temperatura de solución.
+ * @brief   Función que devuelve el Task Handle de la tarea que evalúa el algoritmo de control de temperatura de solución.
  *
  * @return TaskHandle_t Task Handle de la tarea.
  */
 TaskHandle_t mef_temp_soluc_get_task_handle(void)
 {
-    return xMefTempSolucAlgoritmoControlTaskHandle;
+    return hyst_ctrl_get_task_handle();
 }
 
 
@@ -445,7 +154,7 @@ TaskHandle_t mef_temp_soluc_get_task_handle(void)
  */
 DS18B20_sensor_temp_t mef_temp_soluc_get_delta_temp(void)
 {
-    return mef_temp_soluc_delta_temp_soluc;
+    return mef_temp_soluc_desc.delta;
 }
 
 
@@ -459,8 +168,10 @@ DS18B20_sensor_temp_t mef_temp_soluc_get_delta_temp(void)
  */
 void mef_temp_soluc_set_temp_control_limits(DS18B20_sensor_temp_t nuevo_limite_inferior_temp_soluc, DS18B20_sensor_temp_t nuevo_limite_superior_temp_soluc)
 {
-    mef_temp_soluc_limite_inferior_temp_soluc = nuevo_limite_inferior_temp_soluc;
-    mef_temp_soluc_limite_superior_temp_soluc = nuevo_limite_superior_temp_soluc;
+    if (mef_temp_soluc_loop != NULL)
+    {
+        hyst_ctrl_set_limits(mef_temp_soluc_loop, nuevo_limite_inferior_temp_soluc, nuevo_limite_superior_temp_soluc);
+    }
 }
 
 
@@ -472,7 +183,10 @@ void mef_temp_soluc_set_temp_control_limits(DS18B20_sensor_temp_t nuevo_limite_i
  */
 void mef_temp_soluc_set_temp_soluc_value(DS18B20_sensor_temp_t nuevo_valor_temp_soluc)
 {
-    mef_temp_soluc_temp = nuevo_valor_temp_soluc;
+    if (mef_temp_soluc_loop != NULL)
+    {
+        hyst_ctrl_set_value(mef_temp_soluc_loop, nuevo_valor_temp_soluc);
+    }
 }
 
 
@@ -485,7 +199,10 @@ void mef_temp_soluc_set_temp_soluc_value(DS18B20_sensor_temp_t nuevo_valor_temp_
  */
 void mef_temp_soluc_set_manual_mode_flag_value(bool manual_mode_flag_state)
 {
-    mef_temp_soluc_manual_mode_flag = manual_mode_flag_state;
+    if (mef_temp_soluc_loop != NULL)
+    {
+        hyst_ctrl_set_manual_mode_flag_value(mef_temp_soluc_loop, manual_mode_flag_state);
+    }
 }
 
 
@@ -497,5 +214,22 @@ void mef_temp_soluc_set_manual_mode_flag_value(bool manual_mode_flag_state)
  */
 void mef_temp_soluc_set_sensor_error_flag_value(bool sensor_error_flag_state)
 {
-    mef_temp_soluc_sensor_error_flag = sensor_error_flag_state;
+    if (mef_temp_soluc_loop != NULL)
+    {
+        hyst_ctrl_set_sensor_error_flag_value(mef_temp_soluc_loop, sensor_error_flag_state);
+    }
+}
+
+
+
+/**
+ * @brief   Función para avisarle al algoritmo de control de temperatura de solución que llegó un nuevo estado pedido
+ *          para el calefactor o refrigerador en modo MANUAL.
+ */
+void mef_temp_soluc_notify_manual_mode_actuator_state(void)
+{
+    if(mef_temp_soluc_loop != NULL)
+    {
+        hyst_ctrl_notify(mef_temp_soluc_loop, HYST_CTRL_EVT_ESTADO_MANUAL);
+    }
 }
\ No newline at end of file
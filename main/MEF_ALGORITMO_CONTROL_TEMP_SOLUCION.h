@@ -29,31 +29,11 @@ extern "C" {
  * 
  *  NOTA: CUANDO SE SEPA BIEN QUÉ RELÉ SE ASOCIA A QUÉ ACTUADOR, MODIFICAR LOS NÚMEROS.
  */
-typedef enum actuadores_control_temp_soluc{
+enum actuadores_control_temp_soluc{
     CALEFACTOR_SOLUC = RELE_6,
     REFRIGERADOR_SOLUC = RELE_7,
 };
 
-
-/**
- *  Enumeración correspondiente a los estados de la MEF de control de temperatura de la solución.
- */
-typedef enum {
-    TEMP_SOLUCION_CORRECTA = 0,
-    TEMP_SOLUCION_BAJA,
-    TEMP_SOLUCION_ELEVADA,
-} estado_MEF_control_temp_soluc_t;
-
-
-/**
- *  Enumeración correspondiente a los estados de la MEF principal del algoritmo de control de
- *  la temperatura de la solución.
- */
-typedef enum {
-    ALGORITMO_CONTROL_TEMP_SOLUC = 0,
-    TEMP_SOLUC_MODO_MANUAL,
-} estado_MEF_principal_control_temp_soluc_t;
-
 /*======================[EXTERNAL DATA DECLARATION]==============================*/
 
 /*=====================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
@@ -65,6 +45,7 @@ void mef_temp_soluc_set_temp_control_limits(DS18B20_sensor_temp_t nuevo_limite_i
 void mef_temp_soluc_set_temp_soluc_value(DS18B20_sensor_temp_t nuevo_valor_temp_soluc);
 void mef_temp_soluc_set_manual_mode_flag_value(bool manual_mode_flag_state);
 void mef_temp_soluc_set_sensor_error_flag_value(bool sensor_error_flag_state);
+void mef_temp_soluc_notify_manual_mode_actuator_state(void);
 
 /*==================[END OF FILE]============================================*/
 #ifdef __cplusplus
@@ -29,8 +29,52 @@
  * 
  *      Con la función "mqtt_check_connection()", se puede conocer si se está o no conectado al broker MQTT.
  * 
- *      Si se desea publicar un dato en un tópico, se debe utilizar la función estándar "esp_mqtt_client_publish()" 
- *  de la librería de ESP-IDF.
+ *      Si se desea publicar un dato en un tópico, se debe utilizar la función "mqtt_publish_data()". Si hay conexión con
+ *  el broker, el dato se publica directamente; si no la hay, se guarda en un buffer circular en RAM según la política del
+ *  mensaje: MQTT_PUBLISH_KEEP_LATEST (solo se conserva el último dato del tópico, para telemetría) o MQTT_PUBLISH_KEEP_ALL
+ *  (se conservan todos, para alarmas). Cuando el buffer se llena, se descarta primero la telemetría más antigua y, si solo
+ *  quedan mensajes KEEP_ALL, el más antiguo se desborda a memoria FLASH (NVS), donde además sobrevive a un reinicio. Al
+ *  reconectarse (MQTT_EVENT_CONNECTED), una tarea vacía el buffer publicando un mensaje cada MQTT_PUBLISH_DRAIN_INTERVAL_MS,
+ *  para no saturar al broker.
+ * 
+ *      Los valores de los sensores se publican mediante "mqtt_publish_telemetry()". Por defecto, cada valor se publica en
+ *  su propio tópico, con el formato "%.<decimales>f". Si se define DEBUG_TELEMETRIA_AGREGADA, los valores se guardan en
+ *  una tabla y una tarea publica cada MQTT_TELEMETRY_FRAME_PERIOD_MS una única trama, en el tópico MQTT_TELEMETRY_FRAME_TOPIC,
+ *  con los valores actualizados en ese período. La trama es un JSON compacto:
+ * 
+ *          {"v":1,"t":<ms desde el inicio>,"d":{"<tópico>":<valor>,...}}
+ * 
+ *  o, si se define DEBUG_TELEMETRIA_FORMATO_BINARIO, una trama binaria (little endian):
+ * 
+ *          [versión: u8][cantidad N: u8][ms desde el inicio: u32] N x ([ID: u8][valor: float32])
+ * 
+ *  donde el ID es la posición del tópico en la tabla, publicada como JSON retenido en MQTT_TELEMETRY_MAP_TOPIC:
+ *  {"v":1,"ids":["<tópico ID 0>","<tópico ID 1>",...]}. Si la trama no se puede publicar, los valores se conservan
+ *  y se publican en la siguiente trama.
+ * 
+ *      En ambos modos, cada variable de telemetría puede tener una política de publicación por excepción, asignada
+ *  mediante "mqtt_set_telemetry_policy()": banda muerta absoluta y/o relativa respecto del último valor publicado,
+ *  tiempo mínimo entre publicaciones y tiempo máximo de silencio (heartbeat). Los valores que no cumplen la política
+ *  se descartan, y la cantidad de valores publicados y descartados se obtiene mediante "mqtt_get_telemetry_stats()".
+ * 
+ *      Los tópicos suscritos se guardan en una lista estática, indexada por una tabla de hash (FNV-1a) cuyo hash se
+ *  precalcula al registrar el tópico. De esta forma, la búsqueda del tópico al llegar un mensaje, o al pedir su dato
+ *  por nombre, no requiere recorrer toda la lista comparando strings. Además, cada función callback recibe como 
+ *  argumento "pvParameters" el handle del tópico que la disparó ("mqtt_topic_handle_t"), con el cual puede leer el
+ *  dato directamente mediante "mqtt_get_float_data_from_handle()" o "mqtt_get_char_data_from_handle()", sin búsqueda.
+ * 
+ *      Cada tópico puede declarar en el campo "value_type" de "mqtt_topic_t" el tipo de dato que espera recibir (float,
+ *  ON/OFF, MANUAL/AUTO o string sin interpretar). El dato se interpreta una única vez en el handler de eventos; si no
+ *  se corresponde con el tipo declarado, se descarta (sin ejecutar el callback) y se incrementa un contador de mensajes
+ *  rechazados. Los datos ya interpretados se leen sin bloqueos mediante "mqtt_get_topic_float()", "mqtt_get_topic_on_off()"
+ *  y "mqtt_get_topic_mode()", utilizando un número de secuencia (seqlock) para garantizar una lectura consistente.
+ * 
+ *      Las funciones callback NO se ejecutan dentro del handler de eventos, ya que varias de ellas terminan en escrituras
+ *  I2C o en notificaciones a las MEFs, y bloquearían el event loop del cliente MQTT (keepalive y recepción). El handler
+ *  solo guarda el dato y encola el índice del tópico en una cola acotada, sin bloquearse, y una tarea de ingreso
+ *  (de prioridad y núcleo configurables en "MQTT_PUBL_SUSCR.h") ejecuta los callbacks. Si la cola está llena el mensaje
+ *  se descarta (el último dato queda igualmente guardado). Las estadísticas de la cola se obtienen mediante 
+ *  "mqtt_get_ingress_stats()".
  */
 
 
@@ -38,6 +82,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
 
 #include "esp_system.h"
 #include "nvs_flash.h"
@@ -58,9 +105,53 @@
 
 #include "MQTT_PUBL_SUSCR.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+
+#include "DEBUG_DEFINITIONS.h"
 
 //==================================| MACROS AND TYPDEF |==================================//
 
+/* Namespace y claves de NVS utilizados para desbordar mensajes pendientes a memoria FLASH. */
+#define MQTT_PUBLISH_NVS_NAMESPACE "mqtt_pub"
+#define MQTT_PUBLISH_NVS_HEAD_KEY "head"
+#define MQTT_PUBLISH_NVS_TAIL_KEY "tail"
+
+/* Tamaño del buffer en el que se arma la trama de telemetría. */
+#define MQTT_TELEMETRY_FRAME_BUFFER_LEN 1024
+
+/**
+ *  Estructura de una variable de telemetría.
+ */
+typedef struct {
+    char topic[MQTT_TOPIC_NAME_MAX_LEN];    /* Tópico de la variable. Su posición en la tabla es su ID en la trama binaria. */
+    uint32_t topic_hash;    /* Hash del tópico, para buscarlo sin comparar strings. */
+    float value;        /* Último valor. */
+    uint8_t decimals;   /* Cantidad de decimales con los que se publica el valor. */
+    bool updated;       /* Indica si el valor se actualizó desde la última trama publicada. */
+    mqtt_telemetry_policy_t policy; /* Política de publicación por excepción. */
+    bool published;             /* Indica si ya se publicó algún valor. */
+    float last_published_value; /* Último valor publicado. */
+    uint32_t last_published_ms; /* Instante (en ms desde el inicio) de la última publicación. */
+    mqtt_telemetry_stats_t stats;   /* Cantidad de valores publicados y descartados. */
+} mqtt_telemetry_var_t;
+
+/**
+ *  Estructura de un mensaje pendiente de publicar.
+ */
+typedef struct {
+    char topic[MQTT_TOPIC_NAME_MAX_LEN];
+    char data[MQTT_PUBLISH_DATA_MAX_LEN];
+    uint16_t data_len;
+    uint8_t policy;
+} mqtt_pending_publish_t;
+
+/* Constantes del hash FNV-1a de 32 bits. */
+#define MQTT_FNV1A_OFFSET_BASIS 2166136261u
+#define MQTT_FNV1A_PRIME 16777619u
+
+/* Máscara para obtener el índice en la tabla de hash a partir del hash del tópico. */
+#define MQTT_TOPIC_HASH_TABLE_MASK (MQTT_TOPIC_HASH_TABLE_SIZE - 1)
+
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 //Tag para imprimir información en el LOG.
@@ -78,321 +169,1796 @@ static unsigned int mqtt_topic_num = 0;
  *  handle de la tarea a la cual se le quiere informar la llegada de un nuevo
  *  dato al topico correspondiente.
  */
-static mqtt_subscribed_topic_data* mqtt_topic_list = NULL;
-
-//==================================| EXTERNAL DATA DEFINITION |==================================//
-
-//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
+static mqtt_subscribed_topic_data mqtt_topic_list[MQTT_MAX_TOPIC_NUM];
 
-//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
+/**
+ *  Tabla de hash con direccionamiento abierto (sondeo lineal). Cada posición guarda el
+ *  índice del tópico en "mqtt_topic_list" más 1, de forma que 0 indica posición libre.
+ */
+static uint8_t mqtt_topic_hash_table[MQTT_TOPIC_HASH_TABLE_SIZE];
 
 /**
- * @brief Función correspondiente al handler de eventos MQTT.
- *
- *  Esta función es llamada por el client event loop cada vez que se produce un evento que se corresponda
- *  con los configurados mediante la función "esp_mqtt_client_register_event".
- *
- *
- * @param handler_args Datos pasados como argumento por el usuario al utilizar la función "esp_mqtt_client_register_event".
- * @param base Tipo base desde el cual se llamó al handler, MQTT en este caso.
- * @param event_id ID del evento recibido.
- * @param event_data Datos recibidos desde el evento, del tipo "esp_mqtt_event_handle_t".
+ *  Spinlock utilizado para que la escritura de un dato nuevo en un tópico no sea interrumpida por
+ *  una tarea lectora del mismo núcleo (que de otra forma esperaría indefinidamente a que el número
+ *  de secuencia vuelva a ser par). Las lecturas no lo utilizan.
  */
-static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
-{
-    ESP_LOGD(TAG, "Event dispatched from event loop base=%s, event_id=%d", base, event_id);
-    esp_mqtt_event_handle_t event = event_data;
-    esp_mqtt_client_handle_t client = event->client;
-    int msg_id;
+static portMUX_TYPE mqtt_topic_write_spinlock = portMUX_INITIALIZER_UNLOCKED;
 
+//Cantidad total de mensajes descartados por no corresponderse con el tipo de dato declarado del tópico.
+static uint32_t mqtt_rejected_payload_count = 0;
 
-    switch ((esp_mqtt_event_id_t)event_id) {
-    
-    case MQTT_EVENT_CONNECTED:
-        ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
-        
-        //Seteamos la variable global para informar que estamos conectados a un broker MQTT
-        MQTT_CONNECTED = 1;
+//Cola mediante la cual el handler de eventos le pasa a la tarea de ingreso los índices de los tópicos con datos nuevos.
+static QueueHandle_t mqtt_ingress_queue = NULL;
 
-        break;
+//Handle de la tarea de ingreso, que ejecuta las funciones callback de los tópicos.
+static TaskHandle_t xMqttIngressTaskHandle = NULL;
 
-    case MQTT_EVENT_DISCONNECTED:
-        ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
-        
-        //Reseteamos la variable global para indicar que nos deconectamos del broker MQTT
-        MQTT_CONNECTED = 0;
-        break;
+//Buffer circular en RAM de mensajes pendientes de publicar, junto con su posición inicial y cantidad de mensajes.
+static mqtt_pending_publish_t mqtt_publish_buffer[MQTT_PUBLISH_BUFFER_LEN];
+static unsigned int mqtt_publish_buffer_head = 0;
+static unsigned int mqtt_publish_buffer_count = 0;
 
-    case MQTT_EVENT_SUBSCRIBED:
-        ESP_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
-        break;
+//Mutex para el acceso al buffer de mensajes pendientes, ya que se publica desde varias tareas.
+static SemaphoreHandle_t mqtt_publish_mutex = NULL;
 
-    case MQTT_EVENT_UNSUBSCRIBED:
-        ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
-        break;
+//Handle de la tarea que vacía el buffer de mensajes pendientes al reconectarse al broker.
+static TaskHandle_t xMqttPublishDrainTaskHandle = NULL;
 
-    case MQTT_EVENT_PUBLISHED:
-        ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
-        break;
+//Bandera que indica que la tarea que vacía el buffer está publicando un mensaje que ya quitó del buffer de RAM.
+static bool mqtt_publish_drain_in_flight = 0;
 
-    case MQTT_EVENT_DATA:
-        ESP_LOGI(TAG, "MQTT SUBSCRIBED MESSAGE ARRIVED.");
-        //ESP_LOGI(TAG, "MQTT_EVENT_DATA: %.*s", event->data_len, event->data);
+//Handle del cliente MQTT, utilizado por la tarea que vacía el buffer.
+static esp_mqtt_client_handle_t mqtt_publish_client = NULL;
 
-        /**
-         *  Debido a que el nombre del topico que llega por "event->topic" generalmente contiene
-         *  caracteres basura por fuera del tamaño de "event->topic_len", entonces se copia hasta
-         *  esa cantidad de caracteres en un array auxiliar que será usado luego para comparación.
-         */
-        char topic_aux[100] = "";
-        strncpy(topic_aux, event->topic, event->topic_len);
+/**
+ *  Handle de NVS y contadores de los mensajes desbordados a FLASH. Los mensajes se guardan como
+ *  blobs con clave "<índice % MQTT_PUBLISH_NVS_MAX_ENTRIES>", entre "head" (más antiguo) y "tail".
+ */
+static nvs_handle_t mqtt_publish_nvs_handle;
+static bool mqtt_publish_nvs_available = 0;
+static uint32_t mqtt_publish_nvs_head = 0;
+static uint32_t mqtt_publish_nvs_tail = 0;
 
-        /**
-         *  Se compara el nombre del tópico al cual llegó el dato con la lista de tópicos anteriormente definida.
-         *  En caso de coincidir con algun nombre de la lista, se copia el dato correspondiente.
-         */
-        for(int i = 0; i < mqtt_topic_num; i++)
-        {
-            if(!strcmp(mqtt_topic_list[i].topic, topic_aux))
-            {
-                /**
-                 *  Se borra el contenido anterior del dato del tópico correspondiente y se
-                 *  le copia el nuevo, pero solo la cantidad de caracteres "data_len", porque
-                 *  si se copia todo "event->data", hay caracteres basura.
-                 */
-                memset(mqtt_topic_list[i].data, 0, sizeof(mqtt_topic_list[i].data));
-                strncpy(mqtt_topic_list[i].data, event->data, event->data_len);
+//Estadísticas del buffer de mensajes pendientes.
+static uint32_t mqtt_publish_spilled = 0;
+static uint32_t mqtt_publish_sent_from_buffer = 0;
+static uint32_t mqtt_publish_dropped = 0;
 
-                /**
-                 *  En caso de que para este tópico se haya cargado una función callback, se la ejecuta.
-                 */
-                if(mqtt_topic_list[i].topic_cb != NULL)
-                {
-                    mqtt_topic_list[i].topic_cb(NULL);
-                }
+//Tabla de variables de telemetría, y cantidad de variables registradas.
+static mqtt_telemetry_var_t mqtt_telemetry_vars[MQTT_TELEMETRY_MAX_VARS];
+static unsigned int mqtt_telemetry_var_num = 0;
 
-                ESP_LOGI(TAG, "TOPIC DATA ARRIVED: %s", mqtt_topic_list[i].data);
+//Mutex para el acceso a la tabla de variables de telemetría.
+static SemaphoreHandle_t mqtt_telemetry_mutex = NULL;
 
-                continue;
-            }
-        }
+#ifdef DEBUG_TELEMETRIA_AGREGADA
+//Handle de la tarea que publica la trama de telemetría.
+static TaskHandle_t xMqttTelemetryTaskHandle = NULL;
 
-        break;
+//Bandera que indica que hay que (re)publicar la tabla ID -> tópico de la trama binaria.
+static bool mqtt_telemetry_map_pending = 1;
 
-    case MQTT_EVENT_ERROR:
-        ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
-        if (event->error_handle->error_type == MQTT_ERROR_TYPE_TCP_TRANSPORT) {
-            // log_error_if_nonzero("reported from esp-tls", event->error_handle->esp_tls_last_esp_err);
-            // log_error_if_nonzero("reported from tls stack", event->error_handle->esp_tls_stack_err);
-            // log_error_if_nonzero("captured as transport's socket errno",  event->error_handle->esp_transport_sock_errno);
-            ESP_LOGI(TAG, "Last errno string (%s)", strerror(event->error_handle->esp_transport_sock_errno));
+//Buffer en el que se arma la trama de telemetría.
+static char mqtt_telemetry_frame[MQTT_TELEMETRY_FRAME_BUFFER_LEN];
+#endif
 
-        }
-        break;
+//Estadísticas de la cola de ingreso.
+static uint32_t mqtt_ingress_queued = 0;
+static uint32_t mqtt_ingress_dropped = 0;
+static uint32_t mqtt_ingress_high_water = 0;
 
-    default:
-        ESP_LOGI(TAG, "Other event id:%d", event->event_id);
-        break;
-    }
-}
+//==================================| EXTERNAL DATA DEFINITION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
+static uint32_t mqtt_topic_hash(const char* topic, size_t topic_len);
+static mqtt_topic_handle_t mqtt_find_topic(const char* topic, size_t topic_len);
+static bool mqtt_parse_topic_value(mqtt_topic_value_type_t value_type, const char* payload, mqtt_topic_value_t* value);
+static void mqtt_store_topic_value(mqtt_topic_handle_t topic_handle, const char* payload, size_t payload_len, const mqtt_topic_value_t* value);
+static esp_err_t mqtt_read_topic_value(mqtt_topic_handle_t topic_handle, mqtt_topic_value_t* value, char* payload);
+static void vTaskMqttIngress(void *pvParameters);
+static void mqtt_publish_nvs_key(uint32_t index, char* key);
+static void mqtt_publish_buffer_remove(unsigned int position);
+static void mqtt_publish_buffer_push(const mqtt_pending_publish_t* msg, bool front);
+static bool mqtt_publish_buffer_pending(void);
+static void vTaskMqttPublishDrain(void *pvParameters);
+static mqtt_telemetry_var_t* mqtt_telemetry_get_var(const char* topic);
+static bool mqtt_telemetry_check_policy(mqtt_telemetry_var_t* var, float value);
+#ifdef DEBUG_TELEMETRIA_AGREGADA
+static int mqtt_telemetry_build_frame(uint32_t* included_mask);
+static void vTaskMqttTelemetry(void *pvParameters);
+#endif
 
-//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
- * @brief   Función mediante la cual, a partir de la dirección del broker MQTT (URI) y del handle del cliente MQTT,
- *          se establece una conexión con dicho broker MQTT.
+ * @brief   Función que calcula el hash FNV-1a de 32 bits del nombre de un tópico.
  * 
- * @param MQTT_BROKER_URI Dirección (URI) del broker MQTT.
- * @param MQTT_CLIENT Handle del cliente MQTT.
+ *  NOTA:   Se recibe el largo del nombre en vez de depender del caracter nulo, ya que
+ *          el nombre del tópico que llega en "event->topic" no está terminado en nulo.
+ * 
+ * @param topic Nombre del tópico.
+ * @param topic_len Cantidad de caracteres del nombre del tópico.
+ * @return uint32_t Hash calculado.
  */
-esp_err_t mqtt_initialize_and_connect(char* MQTT_BROKER_URI, esp_mqtt_client_handle_t* MQTT_client)
+static uint32_t mqtt_topic_hash(const char* topic, size_t topic_len)
 {
-    /*====================/CONEXIÓN AL BROKER MQTT/====================*/
-
-    /**
-     *  Se crea la variable correspondiente a la dirección del broker MQTT, pasada como argumento.
-     */
-    esp_mqtt_client_config_t mqtt_cfg = {
-        .uri = MQTT_BROKER_URI,
-        .disable_auto_reconnect = 0,    //Al poner este campo en FALSE, al ocurrir una desconexión inesperada, se intentará una reconexión
-    };
-
-    /**
-     *  A partir de la configuración establecida, se obtiene la variable handle del cliente MQTT
-     */
-    *MQTT_client = esp_mqtt_client_init(&mqtt_cfg);
+    uint32_t hash = MQTT_FNV1A_OFFSET_BASIS;
 
-    if(MQTT_client == NULL)
+    for(size_t i = 0; i < topic_len; i++)
     {
-        ESP_LOGE(TAG, "MQTT ERROR: Failed to get MQTT client.");
-        
-        /**
-         * NOTA: REVISAR SI ACA ES NECESARIO HACER FREE
-         * 
-         */
-        free(MQTT_client);
-        return ESP_FAIL;
+        hash ^= (uint8_t) topic[i];
+        hash *= MQTT_FNV1A_PRIME;
     }
 
-    /**
-     *  Se establece qué tipo de eventos MQTT van a ser atendidos por el handler de eventos MQTT.
-     */
-    ESP_RETURN_ON_ERROR(esp_mqtt_client_register_event(*MQTT_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL), 
-                        TAG, "Failed to register MQTT event.");
-
-    /**
-     *  Se inicia la conexión con el broker MQTT.
-     */
-    ESP_RETURN_ON_ERROR(esp_mqtt_client_start(*MQTT_client), 
-                        TAG, "Failed to start MQTT connection.");
-
-    return ESP_OK;
-
+    return hash;
 }
 
 
-/**
- * @brief Función para verificar si ya se estableció la conexión con el broker MQTT.
- * 
- * @return -0 -> No hay conexion con el broker MQTT.
- *         -1 -> Hay conexion con el broker MQTT. 
- */
-bool mqtt_check_connection()
-{
-    return MQTT_CONNECTED;
-}
-
 
 /**
- * @brief   Función mediante la cual se registran y se suscribe a los tópicos MQTT que se pasen como argumento.
- * 
- * @param list_of_topics   Listado de nombres de los tópicos MQTT a suscribir.
- * @param number_of_new_topics  Cantidad de tópicos nuevos a suscribir.
- * @param mqtt_client   Handle del cliente MQTT.
- * @param qos   Quality of Service de la comunicación MQTT.
+ * @brief   Función que busca un tópico registrado a partir de su nombre, mediante la tabla de hash.
  * 
- * @return esp_err_t 
+ * @param topic Nombre del tópico (no necesariamente terminado en nulo).
+ * @param topic_len Cantidad de caracteres del nombre del tópico.
+ * @return mqtt_topic_handle_t  Handle del tópico, o NULL si no está registrado.
  */
-esp_err_t mqtt_suscribe_to_topics(  const mqtt_topic_t* list_of_topics, const unsigned int number_of_new_topics, 
-                                    esp_mqtt_client_handle_t mqtt_client, int qos)
+static mqtt_topic_handle_t mqtt_find_topic(const char* topic, size_t topic_len)
 {
+    uint32_t hash = mqtt_topic_hash(topic, topic_len);
 
     /**
-     *  Se verifica que los argumentos recibidos no estén vacíos.
+     *  Se recorre la tabla a partir de la posición indicada por el hash, hasta encontrar el
+     *  tópico o una posición libre (en cuyo caso el tópico no está registrado). Se compara
+     *  primero el hash y el largo, y solo si coinciden se comparan los caracteres.
      */
-    if(list_of_topics == NULL || number_of_new_topics == 0 || mqtt_client == NULL || qos < 0 || qos > 3)
+    for(uint32_t i = 0; i < MQTT_TOPIC_HASH_TABLE_SIZE; i++)
     {
-        ESP_LOGE(TAG, "MQTT ERROR: Failed to suscribe to topics. Enter valid arguments.");
-        return ESP_ERR_INVALID_ARG;
-    }
+        uint8_t slot = mqtt_topic_hash_table[(hash + i) & MQTT_TOPIC_HASH_TABLE_MASK];
 
-    /**
-     *  Se guarda la cantidad de topicos a suscribir.
-     */
-    mqtt_topic_num += number_of_new_topics;
+        if(slot == 0)
+        {
+            return NULL;
+        }
 
-    /**
-     *  Se inicializa el array de punteros a la estructura que contendrá los nombres de los tópicos MQTT a suscribir,
-     *  junto con el último dato recibido desde dicho tópico.
-     */
-    if(mqtt_topic_list == NULL)
-    {
-        mqtt_topic_list = calloc(number_of_new_topics, sizeof(mqtt_subscribed_topic_data));
-    }
+        mqtt_topic_handle_t topic_handle = &mqtt_topic_list[slot - 1];
 
-    /**
-     *  En caso de que ya se haya inicializado la primera vez, se procede a concatenar los nuevos topicos en el array,
-     *  aumentando a su vez el tamaño del mismo en una cantidad igual a "number_of_new_topics".
-     */
-    else
-    {
-        mqtt_topic_list = (mqtt_subscribed_topic_data*) realloc(mqtt_topic_list, mqtt_topic_num * sizeof(mqtt_subscribed_topic_data));
+        if( topic_handle->topic_hash == hash && topic_handle->topic_len == topic_len &&
+            !memcmp(topic_handle->topic, topic, topic_len))
+        {
+            return topic_handle;
+        }
     }
 
-    /**
-     *  Se verifica si se pudo reservar correctamente la memoria.
-     */
-    if(mqtt_topic_list == NULL)
-    {
-        ESP_LOGE(TAG, "MQTT ERROR: Failed to allocate memory.");
-        free(mqtt_topic_list);
-        return ESP_ERR_NO_MEM;
-    }
+    return NULL;
+}
 
-    /**
-     *  Se copian los nombres y punteros a función callback de los tópicos correspondientes y se suscribe a los mismos.
-     */
-    for(int i = (mqtt_topic_num - number_of_new_topics); i < mqtt_topic_num; i++)
+
+
+/**
+ * @brief   Función que interpreta el dato recibido en un tópico según el tipo de dato declarado para el mismo.
+ * 
+ * @param value_type Tipo de dato declarado para el tópico.
+ * @param payload Dato recibido, terminado en nulo.
+ * @param value Variable en la cual se guarda el dato interpretado.
+ * @return true Si el dato se corresponde con el tipo declarado.
+ * @return false Si el dato no se corresponde con el tipo declarado.
+ */
+static bool mqtt_parse_topic_value(mqtt_topic_value_type_t value_type, const char* payload, mqtt_topic_value_t* value)
+{
+    switch(value_type)
     {
-        mqtt_topic_list[i].topic_cb = list_of_topics[i-(mqtt_topic_num - number_of_new_topics)].topic_function_cb;
-        strcpy(mqtt_topic_list[i].topic, list_of_topics[i-(mqtt_topic_num - number_of_new_topics)].topic_name);
 
+    case MQTT_TOPIC_VALUE_RAW:
+        
+        return true;
+
+    case MQTT_TOPIC_VALUE_FLOAT:
+    {
         /**
-         *  En caso de que la función retorne -1, implica que no se pudo suscribir al
-         *  tópico correspondiente, y se retorna con error.
+         *  Se verifica que se haya interpretado al menos un caracter, que no queden caracteres
+         *  sin interpretar (salvo espacios) y que el valor sea finito, de forma que un dato
+         *  inválido no se convierta silenciosamente en 0.0 como con "atof()".
          */
-        if(esp_mqtt_client_subscribe(mqtt_client, mqtt_topic_list[i].topic, qos) == ESP_FAIL)
+        char* end = NULL;
+        float float_value = strtof(payload, &end);
+
+        if(end == payload)
         {
-            ESP_LOGE(TAG, "MQTT ERROR: Failed to suscribe to topic: %s", mqtt_topic_list[i].topic);
+            return false;
+        }
 
-            return ESP_FAIL;
+        while(*end == ' ' || *end == '\r' || *end == '\n' || *end == '\t')
+        {
+            end++;
         }
+
+        if(*end != '\0' || !isfinite(float_value))
+        {
+            return false;
+        }
+
+        value->float_value = float_value;
+        return true;
     }
 
-    return ESP_OK;
+    case MQTT_TOPIC_VALUE_ON_OFF:
+
+        if(!strcasecmp(payload, "ON") || !strcmp(payload, "1"))
+        {
+            value->on_off_value = true;
+            return true;
+        }
+
+        if(!strcasecmp(payload, "OFF") || !strcmp(payload, "0"))
+        {
+            value->on_off_value = false;
+            return true;
+        }
+
+        return false;
+
+    case MQTT_TOPIC_VALUE_MODE:
+
+        if(!strcasecmp(payload, "MANUAL"))
+        {
+            value->mode_value = MQTT_TOPIC_MODE_MANUAL;
+            return true;
+        }
 
+        if(!strcasecmp(payload, "AUTO"))
+        {
+            value->mode_value = MQTT_TOPIC_MODE_AUTO;
+            return true;
+        }
+
+        return false;
+
+    default:
+
+        return false;
+    }
 }
 
 
+
 /**
- * @brief   Función para obtener el último dato de un determinado tópico en formato float.
- * 
- * @param topic Nombre del tópico MQTT del cual se obtendrá el último dato.
- * @param buffer Variable en la cual se guardará el dato.
+ * @brief   Función que guarda un nuevo dato en un tópico. El número de secuencia es impar mientras
+ *          se escribe el dato, de forma que un lector concurrente pueda detectar una lectura inconsistente
+ *          y reintentarla.
  * 
- * @return esp_err_t 
+ * @param topic_handle Handle del tópico.
+ * @param payload Dato recibido (en formato char).
+ * @param payload_len Cantidad de caracteres del dato recibido.
+ * @param value Dato ya interpretado según el tipo de dato del tópico.
  */
-esp_err_t mqtt_get_float_data_from_topic(const char* topic, float* buffer)
+static void mqtt_store_topic_value(mqtt_topic_handle_t topic_handle, const char* payload, size_t payload_len, const mqtt_topic_value_t* value)
 {
-    /**
-     *  Se convierte el dato del tópico correspondiente, que es del formato char,
-     *  al formato float y se lo carga en el buffer pasado como argumento.
-     */
-    for(int i = 0; i < mqtt_topic_num; i++)
-    {
-        if(!strcmp(mqtt_topic_list[i].topic, topic))
-        {
-            *buffer = atof(mqtt_topic_list[i].data);
-        }
-    }
+    portENTER_CRITICAL(&mqtt_topic_write_spinlock);
 
-    return ESP_OK;
+    __atomic_store_n(&topic_handle->seq, topic_handle->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    memset(topic_handle->data, 0, sizeof(topic_handle->data));
+    memcpy(topic_handle->data, payload, payload_len);
+    topic_handle->value = *value;
+
+    __atomic_store_n(&topic_handle->seq, topic_handle->seq + 1, __ATOMIC_RELEASE);
+
+    portEXIT_CRITICAL(&mqtt_topic_write_spinlock);
 }
 
 
+
 /**
- * @brief   Función para obtener el último dato de un determinado tópico en formato de cadena de caracteres.
- * 
- * @param topic Nombre del tópico MQTT del cual se obtendrá el último dato.
- * @param buffer Variable en la cual se guardará el dato.
+ * @brief   Función que lee de forma consistente el último dato de un tópico, sin bloqueos. Si el dato
+ *          cambia durante la lectura (el número de secuencia es impar o cambió), se reintenta.
  * 
- * @return esp_err_t 
+ * @param topic_handle Handle del tópico.
+ * @param value Variable en la cual se guarda el dato interpretado (puede ser NULL).
+ * @param payload Buffer de tamaño MQTT_TOPIC_DATA_MAX_LEN en el cual se guarda el dato en formato char (puede ser NULL).
+ * @return esp_err_t ESP_ERR_INVALID_STATE si todavía no llegó ningún dato válido al tópico.
  */
-esp_err_t mqtt_get_char_data_from_topic(const char* topic, char* buffer)
+static esp_err_t mqtt_read_topic_value(mqtt_topic_handle_t topic_handle, mqtt_topic_value_t* value, char* payload)
 {
-    /**
+    uint32_t seq;
+
+    do
+    {
+        seq = __atomic_load_n(&topic_handle->seq, __ATOMIC_ACQUIRE);
+
+        if(seq & 1)
+        {
+            continue;
+        }
+
+        if(seq == 0)
+        {
+            return ESP_ERR_INVALID_STATE;
+        }
+
+        if(value != NULL)
+        {
+            *value = topic_handle->value;
+        }
+
+        if(payload != NULL)
+        {
+            memcpy(payload, topic_handle->data, MQTT_TOPIC_DATA_MAX_LEN);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    } while((seq & 1) || seq != __atomic_load_n(&topic_handle->seq, __ATOMIC_RELAXED));
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Tarea de ingreso, encargada de ejecutar las funciones callback de los tópicos en los que
+ *          llegó un dato nuevo, fuera del event loop del cliente MQTT.
+ * 
+ * @param pvParameters 
+ */
+static void vTaskMqttIngress(void *pvParameters)
+{
+    uint8_t topic_index;
+
+    while(1)
+    {
+        if(xQueueReceive(mqtt_ingress_queue, &topic_index, portMAX_DELAY) == pdTRUE)
+        {
+            mqtt_topic_handle_t topic_handle = &mqtt_topic_list[topic_index];
+
+            if(topic_handle->topic_cb != NULL)
+            {
+                topic_handle->topic_cb((void*) topic_handle);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Función que arma la clave de NVS de un mensaje desbordado a FLASH.
+ * 
+ * @param index Índice del mensaje.
+ * @param key Buffer en el cual se guarda la clave (de al menos 12 caracteres).
+ */
+static void mqtt_publish_nvs_key(uint32_t index, char* key)
+{
+    snprintf(key, 12, "%u", (unsigned int) (index % MQTT_PUBLISH_NVS_MAX_ENTRIES));
+}
+
+
+
+/**
+ * @brief   Función que quita un mensaje del buffer circular de mensajes pendientes, desplazando los
+ *          mensajes posteriores. Debe llamarse con el mutex tomado.
+ * 
+ * @param position Posición del mensaje, relativa al inicio del buffer (0 -> más antiguo).
+ */
+static void mqtt_publish_buffer_remove(unsigned int position)
+{
+    for(unsigned int i = position; i + 1 < mqtt_publish_buffer_count; i++)
+    {
+        mqtt_publish_buffer[(mqtt_publish_buffer_head + i) % MQTT_PUBLISH_BUFFER_LEN] = 
+            mqtt_publish_buffer[(mqtt_publish_buffer_head + i + 1) % MQTT_PUBLISH_BUFFER_LEN];
+    }
+
+    mqtt_publish_buffer_count--;
+}
+
+
+
+/**
+ * @brief   Función que agrega un mensaje al buffer de mensajes pendientes, respetando su política.
+ *          Debe llamarse con el mutex tomado.
+ * 
+ *          Si el mensaje es KEEP_LATEST y ya hay un mensaje pendiente KEEP_LATEST del mismo tópico, 
+ *          simplemente se lo reemplaza. Si el buffer está lleno, se descarta el mensaje KEEP_LATEST
+ *          más antiguo o, si no hay ninguno, se desborda a FLASH el mensaje más antiguo.
+ * 
+ * @param msg Mensaje a agregar.
+ * @param front true -> Se agrega al inicio del buffer (mensaje que no se pudo publicar al vaciarlo). 
+ *              false -> Se agrega al final del buffer.
+ */
+static void mqtt_publish_buffer_push(const mqtt_pending_publish_t* msg, bool front)
+{
+    if(msg->policy == MQTT_PUBLISH_KEEP_LATEST)
+    {
+        for(unsigned int i = 0; i < mqtt_publish_buffer_count; i++)
+        {
+            mqtt_pending_publish_t* pending = &mqtt_publish_buffer[(mqtt_publish_buffer_head + i) % MQTT_PUBLISH_BUFFER_LEN];
+
+            if(pending->policy == MQTT_PUBLISH_KEEP_LATEST && !strcmp(pending->topic, msg->topic))
+            {
+                /**
+                 *  Si el mensaje vuelve al inicio del buffer tras una publicación fallida, se conserva
+                 *  el dato pendiente, que es más reciente.
+                 */
+                if(!front)
+                {
+                    *pending = *msg;
+                }
+
+                return;
+            }
+        }
+    }
+
+    /**
+     *  Si el buffer está lleno, se hace lugar.
+     */
+    if(mqtt_publish_buffer_count == MQTT_PUBLISH_BUFFER_LEN)
+    {
+        unsigned int i;
+
+        for(i = 0; i < mqtt_publish_buffer_count; i++)
+        {
+            if(mqtt_publish_buffer[(mqtt_publish_buffer_head + i) % MQTT_PUBLISH_BUFFER_LEN].policy == MQTT_PUBLISH_KEEP_LATEST)
+            {
+                break;
+            }
+        }
+
+        if(i < mqtt_publish_buffer_count)
+        {
+            mqtt_publish_buffer_remove(i);
+            mqtt_publish_dropped++;
+        }
+
+        else if(mqtt_publish_nvs_available && (mqtt_publish_nvs_tail - mqtt_publish_nvs_head) < MQTT_PUBLISH_NVS_MAX_ENTRIES)
+        {
+            /**
+             *  Se desborda a FLASH el mensaje más antiguo. Como los mensajes en FLASH son siempre más antiguos
+             *  que los de RAM, al vaciar el buffer se publican primero los de FLASH.
+             */
+            char key[12];
+            mqtt_publish_nvs_key(mqtt_publish_nvs_tail, key);
+
+            if( nvs_set_blob(mqtt_publish_nvs_handle, key, &mqtt_publish_buffer[mqtt_publish_buffer_head], sizeof(mqtt_pending_publish_t)) == ESP_OK &&
+                nvs_set_u32(mqtt_publish_nvs_handle, MQTT_PUBLISH_NVS_TAIL_KEY, mqtt_publish_nvs_tail + 1) == ESP_OK &&
+                nvs_commit(mqtt_publish_nvs_handle) == ESP_OK)
+            {
+                mqtt_publish_nvs_tail++;
+                mqtt_publish_spilled++;
+            }
+
+            else
+            {
+                ESP_LOGE(TAG, "MQTT ERROR: Failed to spill pending publish to NVS.");
+                mqtt_publish_dropped++;
+            }
+
+            mqtt_publish_buffer_remove(0);
+        }
+
+        else
+        {
+            /**
+             *  No hay lugar en RAM ni en FLASH, por lo que se descarta el mensaje nuevo.
+             */
+            mqtt_publish_dropped++;
+            return;
+        }
+    }
+
+    if(front)
+    {
+        mqtt_publish_buffer_head = (mqtt_publish_buffer_head + MQTT_PUBLISH_BUFFER_LEN - 1) % MQTT_PUBLISH_BUFFER_LEN;
+        mqtt_publish_buffer[mqtt_publish_buffer_head] = *msg;
+    }
+
+    else
+    {
+        mqtt_publish_buffer[(mqtt_publish_buffer_head + mqtt_publish_buffer_count) % MQTT_PUBLISH_BUFFER_LEN] = *msg;
+    }
+
+    mqtt_publish_buffer_count++;
+}
+
+
+
+/**
+ * @brief   Función que indica si hay mensajes pendientes de publicar, en RAM o en FLASH, o si la tarea que vacía
+ *          el buffer está publicando uno. Debe llamarse con el mutex tomado.
+ * 
+ * @return true Hay mensajes pendientes.
+ * @return false No hay mensajes pendientes.
+ */
+static bool mqtt_publish_buffer_pending(void)
+{
+    return mqtt_publish_buffer_count > 0 || mqtt_publish_nvs_tail != mqtt_publish_nvs_head || mqtt_publish_drain_in_flight;
+}
+
+
+
+/**
+ * @brief   Tarea encargada de vaciar el buffer de mensajes pendientes al reconectarse al broker MQTT.
+ *          Se publica un mensaje cada MQTT_PUBLISH_DRAIN_INTERVAL_MS, para no saturar al broker con
+ *          todos los mensajes acumulados durante la desconexión.
+ * 
+ * @param pvParameters 
+ */
+static void vTaskMqttPublishDrain(void *pvParameters)
+{
+    mqtt_pending_publish_t msg;
+
+    while(1)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while(MQTT_CONNECTED)
+        {
+            bool from_nvs = 0;
+
+            /**
+             *  Se obtiene el mensaje pendiente más antiguo: primero los desbordados a FLASH y luego los de RAM.
+             *  Los de FLASH solo se quitan una vez publicados; los de RAM se quitan ahora y se vuelven a
+             *  agregar al inicio del buffer si la publicación falla.
+             */
+            xSemaphoreTake(mqtt_publish_mutex, portMAX_DELAY);
+
+            if(mqtt_publish_nvs_tail != mqtt_publish_nvs_head)
+            {
+                char key[12];
+                size_t msg_size = sizeof(msg);
+                mqtt_publish_nvs_key(mqtt_publish_nvs_head, key);
+
+                if(nvs_get_blob(mqtt_publish_nvs_handle, key, &msg, &msg_size) != ESP_OK || msg_size != sizeof(msg))
+                {
+                    /**
+                     *  Mensaje corrupto o inexistente, se lo saltea.
+                     */
+                    mqtt_publish_nvs_head++;
+                    nvs_set_u32(mqtt_publish_nvs_handle, MQTT_PUBLISH_NVS_HEAD_KEY, mqtt_publish_nvs_head);
+                    nvs_commit(mqtt_publish_nvs_handle);
+                    mqtt_publish_dropped++;
+                    xSemaphoreGive(mqtt_publish_mutex);
+                    continue;
+                }
+
+                from_nvs = 1;
+            }
+
+            else if(mqtt_publish_buffer_count > 0)
+            {
+                msg = mqtt_publish_buffer[mqtt_publish_buffer_head];
+                mqtt_publish_buffer_head = (mqtt_publish_buffer_head + 1) % MQTT_PUBLISH_BUFFER_LEN;
+                mqtt_publish_buffer_count--;
+            }
+
+            else
+            {
+                xSemaphoreGive(mqtt_publish_mutex);
+                break;
+            }
+
+            /**
+             *  Mientras se publica el mensaje se lo sigue considerando pendiente, para que las publicaciones
+             *  directas no se le adelanten.
+             */
+            mqtt_publish_drain_in_flight = 1;
+            xSemaphoreGive(mqtt_publish_mutex);
+
+            /**
+             *  Se publica el mensaje. Si falla, se lo conserva y se espera a la próxima reconexión.
+             */
+            bool published = esp_mqtt_client_publish(mqtt_publish_client, msg.topic, msg.data, msg.data_len, 0, 0) >= 0;
+
+            xSemaphoreTake(mqtt_publish_mutex, portMAX_DELAY);
+            mqtt_publish_drain_in_flight = 0;
+
+            if(published)
+            {
+                mqtt_publish_sent_from_buffer++;
+
+                if(from_nvs)
+                {
+                    mqtt_publish_nvs_head++;
+                    nvs_set_u32(mqtt_publish_nvs_handle, MQTT_PUBLISH_NVS_HEAD_KEY, mqtt_publish_nvs_head);
+                    nvs_commit(mqtt_publish_nvs_handle);
+                }
+            }
+
+            else if(!from_nvs)
+            {
+                mqtt_publish_buffer_push(&msg, 1);
+            }
+
+            xSemaphoreGive(mqtt_publish_mutex);
+
+            if(!published)
+            {
+                break;
+            }
+
+            vTaskDelay(pdMS_TO_TICKS(MQTT_PUBLISH_DRAIN_INTERVAL_MS));
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Función que busca una variable de telemetría en la tabla y, si no está, la registra.
+ *          Debe llamarse con el mutex de la tabla tomado.
+ * 
+ * @param topic Nombre del tópico MQTT de la variable.
+ * @return mqtt_telemetry_var_t* Puntero a la variable, o NULL si no hay lugar en la tabla.
+ */
+static mqtt_telemetry_var_t* mqtt_telemetry_get_var(const char* topic)
+{
+    size_t topic_len = strlen(topic);
+    uint32_t topic_hash = mqtt_topic_hash(topic, topic_len);
+
+    for(unsigned int i = 0; i < mqtt_telemetry_var_num; i++)
+    {
+        if(mqtt_telemetry_vars[i].topic_hash == topic_hash && !strcmp(mqtt_telemetry_vars[i].topic, topic))
+        {
+            return &mqtt_telemetry_vars[i];
+        }
+    }
+
+    if(mqtt_telemetry_var_num == MQTT_TELEMETRY_MAX_VARS || topic_len >= MQTT_TOPIC_NAME_MAX_LEN)
+    {
+        return NULL;
+    }
+
+    mqtt_telemetry_var_t* var = &mqtt_telemetry_vars[mqtt_telemetry_var_num];
+
+    memset(var, 0, sizeof(mqtt_telemetry_var_t));
+    strcpy(var->topic, topic);
+    var->topic_hash = topic_hash;
+    mqtt_telemetry_var_num++;
+
+    #ifdef DEBUG_TELEMETRIA_AGREGADA
+    mqtt_telemetry_map_pending = 1;
+    #endif
+
+    return var;
+}
+
+
+/**
+ * @brief   Función que verifica si un nuevo valor de una variable de telemetría cumple su política de publicación
+ *          y, en ese caso, lo registra como último valor publicado. Debe llamarse con el mutex de la tabla tomado.
+ * 
+ * @param var Puntero a la variable de telemetría.
+ * @param value Nuevo valor de la variable.
+ * @return true Si el valor debe publicarse.
+ * @return false Si el valor se descarta.
+ */
+static bool mqtt_telemetry_check_policy(mqtt_telemetry_var_t* var, float value)
+{
+    uint32_t now_ms = (uint32_t) (esp_timer_get_time() / 1000);
+    uint32_t elapsed_ms = now_ms - var->last_published_ms;
+    const mqtt_telemetry_policy_t* policy = &var->policy;
+
+    bool publish = 1;
+
+    /**
+     *  El primer valor siempre se publica. Luego, no se publica antes del tiempo mínimo entre publicaciones,
+     *  y se publica si se cumplió el tiempo máximo de silencio o si la variación respecto del último valor
+     *  publicado supera alguna de las bandas muertas configuradas (sin bandas muertas, se publica siempre).
+     */
+    if(var->published)
+    {
+        if(policy->min_interval_ms && elapsed_ms < policy->min_interval_ms)
+        {
+            publish = 0;
+        }
+
+        else if(!(policy->max_silence_ms && elapsed_ms >= policy->max_silence_ms) &&
+                (policy->abs_deadband > 0 || policy->rel_deadband > 0))
+        {
+            float delta = fabsf(value - var->last_published_value);
+
+            publish = (policy->abs_deadband > 0 && delta > policy->abs_deadband) ||
+                        (policy->rel_deadband > 0 && delta > policy->rel_deadband * fabsf(var->last_published_value));
+        }
+    }
+
+    if(!publish)
+    {
+        var->stats.suppressed++;
+        return 0;
+    }
+
+    var->published = 1;
+    var->last_published_value = value;
+    var->last_published_ms = now_ms;
+    var->stats.sent++;
+
+    return 1;
+}
+
+
+#ifdef DEBUG_TELEMETRIA_AGREGADA
+/**
+ * @brief   Función que arma la trama de telemetría con los valores actualizados desde la última trama
+ *          publicada. Debe llamarse con el mutex de telemetría tomado.
+ * 
+ * @param included_mask Máscara de bits (bit i -> variable con ID i) de las variables incluidas en la trama.
+ * @return int  Largo de la trama, o 0 si no hay valores actualizados.
+ */
+static int mqtt_telemetry_build_frame(uint32_t* included_mask)
+{
+    *included_mask = 0;
+
+    uint32_t timestamp_ms = (uint32_t) (esp_timer_get_time() / 1000);
+    int len = 0;
+    uint8_t count = 0;
+
+    #ifdef DEBUG_TELEMETRIA_FORMATO_BINARIO
+    uint8_t* frame = (uint8_t*) mqtt_telemetry_frame;
+
+    frame[0] = MQTT_TELEMETRY_FRAME_VERSION;
+    memcpy(&frame[2], &timestamp_ms, sizeof(timestamp_ms));
+    len = 2 + sizeof(timestamp_ms);
+
+    for(unsigned int i = 0; i < mqtt_telemetry_var_num; i++)
+    {
+        if(mqtt_telemetry_vars[i].updated)
+        {
+            frame[len] = i;
+            memcpy(&frame[len + 1], &mqtt_telemetry_vars[i].value, sizeof(float));
+            len += 1 + sizeof(float);
+            count++;
+            *included_mask |= (1u << i);
+        }
+    }
+
+    frame[1] = count;
+
+    #else
+    len = snprintf(mqtt_telemetry_frame, sizeof(mqtt_telemetry_frame), "{\"v\":%d,\"t\":%u,\"d\":{", 
+                    MQTT_TELEMETRY_FRAME_VERSION, (unsigned int) timestamp_ms);
+
+    for(unsigned int i = 0; i < mqtt_telemetry_var_num; i++)
+    {
+        if(mqtt_telemetry_vars[i].updated)
+        {
+            int n = snprintf(&mqtt_telemetry_frame[len], sizeof(mqtt_telemetry_frame) - len, "%s\"%s\":%.*f", 
+                            count ? "," : "", mqtt_telemetry_vars[i].topic, mqtt_telemetry_vars[i].decimals, mqtt_telemetry_vars[i].value);
+
+            /**
+             *  Si la variable no entra en la trama, se deja para la siguiente.
+             */
+            if(n < 0 || len + n + 3 > sizeof(mqtt_telemetry_frame))
+            {
+                mqtt_telemetry_frame[len] = '\0';
+                break;
+            }
+
+            len += n;
+            count++;
+            *included_mask |= (1u << i);
+        }
+    }
+
+    len += snprintf(&mqtt_telemetry_frame[len], sizeof(mqtt_telemetry_frame) - len, "}}");
+    #endif
+
+    return count ? len : 0;
+}
+
+
+
+/**
+ * @brief   Tarea encargada de publicar periódicamente la trama de telemetría agregada.
+ * 
+ * @param pvParameters 
+ */
+static void vTaskMqttTelemetry(void *pvParameters)
+{
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+
+    while(1)
+    {
+        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(MQTT_TELEMETRY_FRAME_PERIOD_MS));
+
+        if(!MQTT_CONNECTED)
+        {
+            continue;
+        }
+
+        xSemaphoreTake(mqtt_telemetry_mutex, portMAX_DELAY);
+
+        #ifdef DEBUG_TELEMETRIA_FORMATO_BINARIO
+        /**
+         *  Se publica (retenida) la tabla ID -> tópico, necesaria para interpretar la trama binaria,
+         *  al conectarse y cada vez que se registra una variable nueva.
+         */
+        if(mqtt_telemetry_map_pending)
+        {
+            int len = snprintf(mqtt_telemetry_frame, sizeof(mqtt_telemetry_frame), "{\"v\":%d,\"ids\":[", MQTT_TELEMETRY_FRAME_VERSION);
+
+            for(unsigned int i = 0; i < mqtt_telemetry_var_num && len < sizeof(mqtt_telemetry_frame); i++)
+            {
+                len += snprintf(&mqtt_telemetry_frame[len], sizeof(mqtt_telemetry_frame) - len, "%s\"%s\"", i ? "," : "", mqtt_telemetry_vars[i].topic);
+            }
+
+            if(len < sizeof(mqtt_telemetry_frame))
+            {
+                len += snprintf(&mqtt_telemetry_frame[len], sizeof(mqtt_telemetry_frame) - len, "]}");
+            }
+
+            if(len < sizeof(mqtt_telemetry_frame) && esp_mqtt_client_publish(mqtt_publish_client, MQTT_TELEMETRY_MAP_TOPIC, mqtt_telemetry_frame, len, 0, 1) >= 0)
+            {
+                mqtt_telemetry_map_pending = 0;
+            }
+        }
+        #endif
+
+        uint32_t included_mask;
+        int len = mqtt_telemetry_build_frame(&included_mask);
+
+        /**
+         *  Solo si la trama se publicó correctamente se marcan los valores como enviados; en caso
+         *  contrario, se vuelven a incluir en la próxima trama.
+         */
+        if(len > 0 && esp_mqtt_client_publish(mqtt_publish_client, MQTT_TELEMETRY_FRAME_TOPIC, mqtt_telemetry_frame, len, 0, 0) >= 0)
+        {
+            for(unsigned int i = 0; i < mqtt_telemetry_var_num; i++)
+            {
+                if(included_mask & (1u << i))
+                {
+                    mqtt_telemetry_vars[i].updated = 0;
+                }
+            }
+        }
+
+        xSemaphoreGive(mqtt_telemetry_mutex);
+    }
+}
+#endif
+
+
+
+/**
+ * @brief Función correspondiente al handler de eventos MQTT.
+ *
+ *  Esta función es llamada por el client event loop cada vez que se produce un evento que se corresponda
+ *  con los configurados mediante la función "esp_mqtt_client_register_event".
+ *
+ *
+ * @param handler_args Datos pasados como argumento por el usuario al utilizar la función "esp_mqtt_client_register_event".
+ * @param base Tipo base desde el cual se llamó al handler, MQTT en este caso.
+ * @param event_id ID del evento recibido.
+ * @param event_data Datos recibidos desde el evento, del tipo "esp_mqtt_event_handle_t".
+ */
+static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    ESP_LOGD(TAG, "Event dispatched from event loop base=%s, event_id=%d", base, event_id);
+    esp_mqtt_event_handle_t event = event_data;
+
+
+    switch ((esp_mqtt_event_id_t)event_id) {
+    
+    case MQTT_EVENT_CONNECTED:
+        ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+        
+        //Seteamos la variable global para informar que estamos conectados a un broker MQTT
+        MQTT_CONNECTED = 1;
+
+        #ifdef DEBUG_TELEMETRIA_AGREGADA
+        mqtt_telemetry_map_pending = 1;
+        #endif
+
+        /**
+         *  Se le avisa a la tarea correspondiente que vacíe el buffer de mensajes pendientes de publicar.
+         */
+        if(xMqttPublishDrainTaskHandle != NULL)
+        {
+            xTaskNotifyGive(xMqttPublishDrainTaskHandle);
+        }
+
+        break;
+
+    case MQTT_EVENT_DISCONNECTED:
+        ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+        
+        //Reseteamos la variable global para indicar que nos deconectamos del broker MQTT
+        MQTT_CONNECTED = 0;
+        break;
+
+    case MQTT_EVENT_SUBSCRIBED:
+        ESP_LOGI(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
+        break;
+
+    case MQTT_EVENT_UNSUBSCRIBED:
+        ESP_LOGI(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
+        break;
+
+    case MQTT_EVENT_PUBLISHED:
+        ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+        break;
+
+    case MQTT_EVENT_DATA:
+        ESP_LOGI(TAG, "MQTT SUBSCRIBED MESSAGE ARRIVED.");
+        //ESP_LOGI(TAG, "MQTT_EVENT_DATA: %.*s", event->data_len, event->data);
+
+        /**
+         *  Se busca el tópico al cual llegó el dato en la tabla de hash. El nombre del tópico que llega por
+         *  "event->topic" no está terminado en nulo, por lo que se lo busca utilizando "event->topic_len".
+         */
+        mqtt_topic_handle_t topic_handle = mqtt_find_topic(event->topic, event->topic_len);
+
+        if(topic_handle != NULL)
+        {
+            /**
+             *  Se copia el dato en un buffer auxiliar terminado en nulo, pero solo la cantidad de 
+             *  caracteres "data_len", porque si se copia todo "event->data", hay caracteres basura.
+             */
+            char payload[MQTT_TOPIC_DATA_MAX_LEN] = "";
+            size_t payload_len = event->data_len < (sizeof(payload) - 1) ? event->data_len : (sizeof(payload) - 1);
+            memcpy(payload, event->data, payload_len);
+
+            /**
+             *  Se interpreta el dato según el tipo declarado para el tópico. Si no se corresponde con dicho
+             *  tipo (o no entra en el buffer), se descarta el mensaje sin modificar el último dato válido
+             *  y sin ejecutar la función callback.
+             */
+            mqtt_topic_value_t value = {0};
+
+            if( (event->data_len >= sizeof(payload) && topic_handle->value_type != MQTT_TOPIC_VALUE_RAW) ||
+                !mqtt_parse_topic_value(topic_handle->value_type, payload, &value))
+            {
+                topic_handle->rejected_count++;
+                mqtt_rejected_payload_count++;
+                ESP_LOGW(TAG, "MQTT WARNING: Invalid payload rejected on topic %s: %s", topic_handle->topic, payload);
+                break;
+            }
+
+            mqtt_store_topic_value(topic_handle, payload, payload_len, &value);
+
+            /**
+             *  En caso de que para este tópico se haya cargado una función callback, se encola el índice
+             *  del tópico para que la tarea de ingreso ejecute el callback. No se bloquea si la cola está
+             *  llena, para no demorar el event loop del cliente MQTT; en ese caso se descarta el mensaje.
+             */
+            if(topic_handle->topic_cb != NULL)
+            {
+                uint8_t topic_index = topic_handle - mqtt_topic_list;
+
+                if(xQueueSend(mqtt_ingress_queue, &topic_index, 0) == pdTRUE)
+                {
+                    mqtt_ingress_queued++;
+
+                    uint32_t depth = uxQueueMessagesWaiting(mqtt_ingress_queue);
+
+                    if(depth > mqtt_ingress_high_water)
+                    {
+                        mqtt_ingress_high_water = depth;
+                    }
+                }
+
+                else
+                {
+                    mqtt_ingress_dropped++;
+                    ESP_LOGW(TAG, "MQTT WARNING: Ingress queue full, callback dropped for topic %s", topic_handle->topic);
+                }
+            }
+
+            ESP_LOGI(TAG, "TOPIC DATA ARRIVED: %s", payload);
+        }
+
+        break;
+
+    case MQTT_EVENT_ERROR:
+        ESP_LOGI(TAG, "MQTT_EVENT_ERROR");
+        if (event->error_handle->error_type == MQTT_ERROR_TYPE_TCP_TRANSPORT) {
+            // log_error_if_nonzero("reported from esp-tls", event->error_handle->esp_tls_last_esp_err);
+            // log_error_if_nonzero("reported from tls stack", event->error_handle->esp_tls_stack_err);
+            // log_error_if_nonzero("captured as transport's socket errno",  event->error_handle->esp_transport_sock_errno);
+            ESP_LOGI(TAG, "Last errno string (%s)", strerror(event->error_handle->esp_transport_sock_errno));
+
+        }
+        break;
+
+    default:
+        ESP_LOGI(TAG, "Other event id:%d", event->event_id);
+        break;
+    }
+}
+
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función mediante la cual, a partir de la dirección del broker MQTT (URI) y del handle del cliente MQTT,
+ *          se establece una conexión con dicho broker MQTT.
+ * 
+ * @param MQTT_BROKER_URI Dirección (URI) del broker MQTT.
+ * @param MQTT_CLIENT Handle del cliente MQTT.
+ */
+esp_err_t mqtt_initialize_and_connect(char* MQTT_BROKER_URI, esp_mqtt_client_handle_t* MQTT_client)
+{
+    /*====================/CONEXIÓN AL BROKER MQTT/====================*/
+
+    /**
+     *  Se crea la variable correspondiente a la dirección del broker MQTT, pasada como argumento.
+     */
+    esp_mqtt_client_config_t mqtt_cfg = {
+        .uri = MQTT_BROKER_URI,
+        .disable_auto_reconnect = 0,    //Al poner este campo en FALSE, al ocurrir una desconexión inesperada, se intentará una reconexión
+    };
+
+    /**
+     *  A partir de la configuración establecida, se obtiene la variable handle del cliente MQTT
+     */
+    *MQTT_client = esp_mqtt_client_init(&mqtt_cfg);
+
+    if(MQTT_client == NULL)
+    {
+        ESP_LOGE(TAG, "MQTT ERROR: Failed to get MQTT client.");
+        
+        /**
+         * NOTA: REVISAR SI ACA ES NECESARIO HACER FREE
+         * 
+         */
+        free(MQTT_client);
+        return ESP_FAIL;
+    }
+
+    /**
+     *  Se crea la cola y la tarea de ingreso, encargada de ejecutar las funciones callback
+     *  de los tópicos fuera del event loop del cliente MQTT.
+     */
+    if(mqtt_ingress_queue == NULL)
+    {
+        mqtt_ingress_queue = xQueueCreate(MQTT_INGRESS_QUEUE_LEN, sizeof(uint8_t));
+
+        if(mqtt_ingress_queue == NULL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Failed to create ingress queue.");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    if(xMqttIngressTaskHandle == NULL)
+    {
+        xTaskCreatePinnedToCore(
+            vTaskMqttIngress,
+            "vTaskMqttIngress",
+            MQTT_INGRESS_TASK_STACK_SIZE,
+            NULL,
+            MQTT_INGRESS_TASK_PRIORITY,
+            &xMqttIngressTaskHandle,
+            MQTT_INGRESS_TASK_CORE);
+
+        /**
+         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
+         */
+        if(xMqttIngressTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Failed to create vTaskMqttIngress task.");
+            return ESP_FAIL;
+        }
+    }
+
+    /**
+     *  Se inicializa el buffer de mensajes pendientes de publicar, recuperando de FLASH los índices de
+     *  los mensajes que hayan quedado desbordados antes de un reinicio. Si no se puede abrir NVS, el
+     *  buffer funciona solo en RAM.
+     */
+    mqtt_publish_client = *MQTT_client;
+
+    if(mqtt_publish_mutex == NULL)
+    {
+        mqtt_publish_mutex = xSemaphoreCreateMutex();
+
+        if(mqtt_publish_mutex == NULL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Failed to create publish buffer mutex.");
+            return ESP_ERR_NO_MEM;
+        }
+
+        if(nvs_open(MQTT_PUBLISH_NVS_NAMESPACE, NVS_READWRITE, &mqtt_publish_nvs_handle) == ESP_OK)
+        {
+            mqtt_publish_nvs_available = 1;
+            nvs_get_u32(mqtt_publish_nvs_handle, MQTT_PUBLISH_NVS_HEAD_KEY, &mqtt_publish_nvs_head);
+            nvs_get_u32(mqtt_publish_nvs_handle, MQTT_PUBLISH_NVS_TAIL_KEY, &mqtt_publish_nvs_tail);
+
+            if(mqtt_publish_nvs_tail - mqtt_publish_nvs_head > MQTT_PUBLISH_NVS_MAX_ENTRIES)
+            {
+                mqtt_publish_nvs_head = mqtt_publish_nvs_tail;
+            }
+        }
+
+        else
+        {
+            ESP_LOGW(TAG, "MQTT WARNING: NVS not available, publish buffer will be RAM only.");
+        }
+    }
+
+    if(xMqttPublishDrainTaskHandle == NULL)
+    {
+        xTaskCreate(
+            vTaskMqttPublishDrain,
+            "vTaskMqttPublishDrain",
+            4096,
+            NULL,
+            MQTT_PUBLISH_TASK_PRIORITY,
+            &xMqttPublishDrainTaskHandle);
+
+        /**
+         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
+         */
+        if(xMqttPublishDrainTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Failed to create vTaskMqttPublishDrain task.");
+            return ESP_FAIL;
+        }
+    }
+
+    /**
+     *  Se crea el mutex de la tabla de variables de telemetría.
+     */
+    if(mqtt_telemetry_mutex == NULL)
+    {
+        mqtt_telemetry_mutex = xSemaphoreCreateMutex();
+
+        if(mqtt_telemetry_mutex == NULL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Failed to create telemetry mutex.");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    #ifdef DEBUG_TELEMETRIA_AGREGADA
+    /**
+     *  Se crea la tarea que publica periódicamente la trama de telemetría agregada.
+     */
+
+    if(xMqttTelemetryTaskHandle == NULL)
+    {
+        xTaskCreate(
+            vTaskMqttTelemetry,
+            "vTaskMqttTelemetry",
+            4096,
+            NULL,
+            MQTT_PUBLISH_TASK_PRIORITY,
+            &xMqttTelemetryTaskHandle);
+
+        /**
+         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
+         */
+        if(xMqttTelemetryTaskHandle == NULL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Failed to create vTaskMqttTelemetry task.");
+            return ESP_FAIL;
+        }
+    }
+    #endif
+
+    /**
+     *  Se establece qué tipo de eventos MQTT van a ser atendidos por el handler de eventos MQTT.
+     */
+    ESP_RETURN_ON_ERROR(esp_mqtt_client_register_event(*MQTT_client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL), 
+                        TAG, "Failed to register MQTT event.");
+
+    /**
+     *  Se inicia la conexión con el broker MQTT.
+     */
+    ESP_RETURN_ON_ERROR(esp_mqtt_client_start(*MQTT_client), 
+                        TAG, "Failed to start MQTT connection.");
+
+    return ESP_OK;
+
+}
+
+
+/**
+ * @brief Función para verificar si ya se estableció la conexión con el broker MQTT.
+ * 
+ * @return -0 -> No hay conexion con el broker MQTT.
+ *         -1 -> Hay conexion con el broker MQTT. 
+ */
+bool mqtt_check_connection()
+{
+    return MQTT_CONNECTED;
+}
+
+
+/**
+ * @brief   Función mediante la cual se registran y se suscribe a los tópicos MQTT que se pasen como argumento.
+ * 
+ * @param list_of_topics   Listado de nombres de los tópicos MQTT a suscribir.
+ * @param number_of_new_topics  Cantidad de tópicos nuevos a suscribir.
+ * @param mqtt_client   Handle del cliente MQTT.
+ * @param qos   Quality of Service de la comunicación MQTT.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t mqtt_suscribe_to_topics(  const mqtt_topic_t* list_of_topics, const unsigned int number_of_new_topics, 
+                                    esp_mqtt_client_handle_t mqtt_client, int qos)
+{
+
+    /**
+     *  Se verifica que los argumentos recibidos no estén vacíos.
+     */
+    if(list_of_topics == NULL || number_of_new_topics == 0 || mqtt_client == NULL || qos < 0 || qos > 3)
+    {
+        ESP_LOGE(TAG, "MQTT ERROR: Failed to suscribe to topics. Enter valid arguments.");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /**
+     *  Se verifica que los nuevos tópicos entren en la lista estática de tópicos.
+     */
+    if(mqtt_topic_num + number_of_new_topics > MQTT_MAX_TOPIC_NUM)
+    {
+        ESP_LOGE(TAG, "MQTT ERROR: Topic list full. Increase MQTT_MAX_TOPIC_NUM.");
+        return ESP_ERR_NO_MEM;
+    }
+
+    /**
+     *  Se copian los nombres y punteros a función callback de los tópicos correspondientes, se los indexa
+     *  en la tabla de hash y se suscribe a los mismos.
+     */
+    for(int i = 0; i < number_of_new_topics; i++)
+    {
+        size_t topic_len = strnlen(list_of_topics[i].topic_name, MQTT_TOPIC_NAME_MAX_LEN);
+
+        if(topic_len == 0 || topic_len >= MQTT_TOPIC_NAME_MAX_LEN)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Invalid topic name length.");
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        if(mqtt_find_topic(list_of_topics[i].topic_name, topic_len) != NULL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Topic already registered: %s", list_of_topics[i].topic_name);
+            return ESP_ERR_INVALID_ARG;
+        }
+
+        mqtt_topic_handle_t topic_handle = &mqtt_topic_list[mqtt_topic_num];
+
+        topic_handle->topic_cb = list_of_topics[i].topic_function_cb;
+        topic_handle->value_type = list_of_topics[i].value_type;
+        memcpy(topic_handle->topic, list_of_topics[i].topic_name, topic_len);
+        topic_handle->topic[topic_len] = '\0';
+        topic_handle->topic_len = topic_len;
+        topic_handle->topic_hash = mqtt_topic_hash(topic_handle->topic, topic_len);
+
+        /**
+         *  Se inserta el tópico en la primer posición libre de la tabla de hash, a partir de
+         *  la posición indicada por su hash. Como la tabla es más grande que la cantidad máxima
+         *  de tópicos, siempre hay alguna posición libre.
+         */
+        uint32_t table_index = topic_handle->topic_hash & MQTT_TOPIC_HASH_TABLE_MASK;
+
+        while(mqtt_topic_hash_table[table_index] != 0)
+        {
+            table_index = (table_index + 1) & MQTT_TOPIC_HASH_TABLE_MASK;
+        }
+
+        mqtt_topic_hash_table[table_index] = mqtt_topic_num + 1;
+        mqtt_topic_num++;
+
+        /**
+         *  En caso de que la función retorne -1, implica que no se pudo suscribir al
+         *  tópico correspondiente, y se retorna con error.
+         */
+        if(esp_mqtt_client_subscribe(mqtt_client, topic_handle->topic, qos) == ESP_FAIL)
+        {
+            ESP_LOGE(TAG, "MQTT ERROR: Failed to suscribe to topic: %s", topic_handle->topic);
+
+            return ESP_FAIL;
+        }
+    }
+
+    return ESP_OK;
+
+}
+
+
+/**
+ * @brief   Función para obtener el último dato de un determinado tópico en formato float.
+ * 
+ * @param topic Nombre del tópico MQTT del cual se obtendrá el último dato.
+ * @param buffer Variable en la cual se guardará el dato.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t mqtt_get_float_data_from_topic(const char* topic, float* buffer)
+{
+    return mqtt_get_float_data_from_handle(mqtt_get_topic_handle(topic), buffer);
+}
+
+
+/**
+ * @brief   Función para obtener el último dato de un determinado tópico en formato de cadena de caracteres.
+ * 
+ * @param topic Nombre del tópico MQTT del cual se obtendrá el último dato.
+ * @param buffer Variable en la cual se guardará el dato.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t mqtt_get_char_data_from_topic(const char* topic, char* buffer)
+{
+    return mqtt_get_char_data_from_handle(mqtt_get_topic_handle(topic), buffer);
+}
+
+
+/**
+ * @brief   Función para obtener el handle de un tópico suscrito a partir de su nombre. El handle
+ *          puede guardarse y utilizarse luego para leer el dato del tópico sin volver a buscarlo.
+ * 
+ * @param topic Nombre del tópico MQTT.
+ * 
+ * @return mqtt_topic_handle_t  Handle del tópico, o NULL si no está suscrito.
+ */
+mqtt_topic_handle_t mqtt_get_topic_handle(const char* topic)
+{
+    if(topic == NULL)
+    {
+        return NULL;
+    }
+
+    return mqtt_find_topic(topic, strnlen(topic, MQTT_TOPIC_NAME_MAX_LEN));
+}
+
+
+/**
+ * @brief   Función para obtener el último dato de un tópico en formato float, a partir de su handle.
+ * 
+ * @param topic_handle Handle del tópico MQTT del cual se obtendrá el último dato.
+ * @param buffer Variable en la cual se guardará el dato.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t mqtt_get_float_data_from_handle(mqtt_topic_handle_t topic_handle, float* buffer)
+{
+    if(topic_handle == NULL || buffer == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /**
+     *  Si el tópico fue declarado como float, se retorna directamente el dato ya interpretado.
+     *  En caso contrario, se convierte el dato del tópico correspondiente, que es del formato
+     *  char, al formato float y se lo carga en el buffer pasado como argumento.
+     */
+    if(topic_handle->value_type == MQTT_TOPIC_VALUE_FLOAT)
+    {
+        return mqtt_get_topic_float(topic_handle, buffer);
+    }
+
+    char payload[MQTT_TOPIC_DATA_MAX_LEN];
+    ESP_RETURN_ON_ERROR(mqtt_read_topic_value(topic_handle, NULL, payload), TAG, "No data on topic yet.");
+
+    *buffer = atof(payload);
+
+    return ESP_OK;
+}
+
+
+/**
+ * @brief   Función para obtener el último dato de un tópico en formato de cadena de caracteres,
+ *          a partir de su handle.
+ * 
+ * @param topic_handle Handle del tópico MQTT del cual se obtendrá el último dato.
+ * @param buffer Variable en la cual se guardará el dato.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t mqtt_get_char_data_from_handle(mqtt_topic_handle_t topic_handle, char* buffer)
+{
+    if(topic_handle == NULL || buffer == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /**
      *  Se obtiene el dato del tópico correspondiente y se lo carga en el buffer 
      *  pasado como argumento.
      */
-    for(int i = 0; i < mqtt_topic_num; i++)
+    char payload[MQTT_TOPIC_DATA_MAX_LEN];
+    ESP_RETURN_ON_ERROR(mqtt_read_topic_value(topic_handle, NULL, payload), TAG, "No data on topic yet.");
+
+    strcpy(buffer, payload);
+    ESP_LOGI(TAG, "BUFFER: %s", buffer);
+
+    return ESP_OK;
+}
+
+
+/**
+ * @brief   Función para obtener el último dato válido de un tópico declarado como MQTT_TOPIC_VALUE_FLOAT.
+ * 
+ * @param topic_handle Handle del tópico MQTT.
+ * @param value Variable en la cual se guardará el dato.
+ * 
+ * @return esp_err_t    ESP_ERR_INVALID_ARG si el tópico no es del tipo float, ESP_ERR_INVALID_STATE
+ *                      si todavía no llegó ningún dato válido.
+ */
+esp_err_t mqtt_get_topic_float(mqtt_topic_handle_t topic_handle, float* value)
+{
+    if(topic_handle == NULL || value == NULL || topic_handle->value_type != MQTT_TOPIC_VALUE_FLOAT)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mqtt_topic_value_t topic_value;
+    ESP_RETURN_ON_ERROR(mqtt_read_topic_value(topic_handle, &topic_value, NULL), TAG, "No data on topic yet.");
+
+    *value = topic_value.float_value;
+
+    return ESP_OK;
+}
+
+
+/**
+ * @brief   Función para obtener el último dato válido de un tópico declarado como MQTT_TOPIC_VALUE_ON_OFF.
+ * 
+ * @param topic_handle Handle del tópico MQTT.
+ * @param value Variable en la cual se guardará el dato (true -> ON, false -> OFF).
+ * 
+ * @return esp_err_t    ESP_ERR_INVALID_ARG si el tópico no es del tipo ON/OFF, ESP_ERR_INVALID_STATE
+ *                      si todavía no llegó ningún dato válido.
+ */
+esp_err_t mqtt_get_topic_on_off(mqtt_topic_handle_t topic_handle, bool* value)
+{
+    if(topic_handle == NULL || value == NULL || topic_handle->value_type != MQTT_TOPIC_VALUE_ON_OFF)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mqtt_topic_value_t topic_value;
+    ESP_RETURN_ON_ERROR(mqtt_read_topic_value(topic_handle, &topic_value, NULL), TAG, "No data on topic yet.");
+
+    *value = topic_value.on_off_value;
+
+    return ESP_OK;
+}
+
+
+/**
+ * @brief   Función para obtener el último dato válido de un tópico declarado como MQTT_TOPIC_VALUE_MODE.
+ * 
+ * @param topic_handle Handle del tópico MQTT.
+ * @param value Variable en la cual se guardará el modo (MANUAL o AUTO).
+ * 
+ * @return esp_err_t    ESP_ERR_INVALID_ARG si el tópico no es del tipo MANUAL/AUTO, ESP_ERR_INVALID_STATE
+ *                      si todavía no llegó ningún dato válido.
+ */
+esp_err_t mqtt_get_topic_mode(mqtt_topic_handle_t topic_handle, mqtt_topic_mode_t* value)
+{
+    if(topic_handle == NULL || value == NULL || topic_handle->value_type != MQTT_TOPIC_VALUE_MODE)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    mqtt_topic_value_t topic_value;
+    ESP_RETURN_ON_ERROR(mqtt_read_topic_value(topic_handle, &topic_value, NULL), TAG, "No data on topic yet.");
+
+    *value = topic_value.mode_value;
+
+    return ESP_OK;
+}
+
+
+/**
+ * @brief   Función para obtener el número de secuencia del último dato válido de un tópico. Permite
+ *          saber si llegó un dato nuevo desde la última lectura sin tener que leerlo.
+ * 
+ * @param topic_handle Handle del tópico MQTT.
+ * 
+ * @return uint32_t Número de secuencia (0 si nunca llegó un dato válido).
+ */
+uint32_t mqtt_get_topic_seq(mqtt_topic_handle_t topic_handle)
+{
+    if(topic_handle == NULL)
+    {
+        return 0;
+    }
+
+    return __atomic_load_n(&topic_handle->seq, __ATOMIC_ACQUIRE) & ~1u;
+}
+
+
+/**
+ * @brief   Función para obtener la cantidad total de mensajes MQTT descartados por no corresponderse
+ *          con el tipo de dato declarado del tópico.
+ * 
+ * @return uint32_t Cantidad de mensajes descartados.
+ */
+uint32_t mqtt_get_rejected_payload_count(void)
+{
+    return mqtt_rejected_payload_count;
+}
+
+
+/**
+ * @brief   Función para obtener las estadísticas de la cola de ingreso de mensajes MQTT.
+ * 
+ * @param stats Variable en la cual se guardarán las estadísticas.
+ */
+void mqtt_get_ingress_stats(mqtt_ingress_stats_t* stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    stats->depth = (mqtt_ingress_queue != NULL) ? uxQueueMessagesWaiting(mqtt_ingress_queue) : 0;
+    stats->high_water = mqtt_ingress_high_water;
+    stats->queued = mqtt_ingress_queued;
+    stats->dropped = mqtt_ingress_dropped;
+}
+
+
+/**
+ * @brief   Función para publicar un dato en un tópico MQTT. Si hay conexión con el broker y no hay mensajes
+ *          pendientes, se publica directamente. En caso contrario, se guarda en el buffer de mensajes pendientes
+ *          según la política indicada, y se publicará al reconectarse.
+ * 
+ * @param mqtt_client Handle del cliente MQTT.
+ * @param topic Nombre del tópico MQTT.
+ * @param data Dato a publicar.
+ * @param len Largo del dato. Si es 0, se calcula con "strlen()".
+ * @param policy Política de almacenamiento en caso de no poder publicarse (KEEP_LATEST o KEEP_ALL).
+ * 
+ * @return esp_err_t    ESP_OK si se publicó o se guardó para publicarse luego.
+ */
+esp_err_t mqtt_publish_data(esp_mqtt_client_handle_t mqtt_client, const char* topic, const char* data, int len, mqtt_publish_policy_t policy)
+{
+    if(mqtt_client == NULL || topic == NULL || data == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(len <= 0)
+    {
+        len = strlen(data);
+    }
+
+    /**
+     *  Si el buffer todavía no fue inicializado, solo se puede publicar directamente.
+     */
+    if(mqtt_publish_mutex == NULL)
+    {
+        if(MQTT_CONNECTED && esp_mqtt_client_publish(mqtt_client, topic, data, len, 0, 0) >= 0)
+        {
+            return ESP_OK;
+        }
+
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /**
+     *  Si hay conexión y no hay mensajes pendientes, se publica directamente. Si hay mensajes pendientes,
+     *  el nuevo se agrega al final del buffer para respetar el orden de publicación. El mutex se mantiene
+     *  tomado desde la verificación hasta publicar o guardar el mensaje, para que ninguna otra publicación
+     *  se intercale entre ambas.
+     */
+    xSemaphoreTake(mqtt_publish_mutex, portMAX_DELAY);
+
+    if(MQTT_CONNECTED && !mqtt_publish_buffer_pending() && esp_mqtt_client_publish(mqtt_client, topic, data, len, 0, 0) >= 0)
+    {
+        xSemaphoreGive(mqtt_publish_mutex);
+        return ESP_OK;
+    }
+
+    if(len >= MQTT_PUBLISH_DATA_MAX_LEN || strlen(topic) >= MQTT_TOPIC_NAME_MAX_LEN)
+    {
+        mqtt_publish_dropped++;
+        xSemaphoreGive(mqtt_publish_mutex);
+
+        ESP_LOGW(TAG, "MQTT WARNING: Message too long to be buffered, dropped: %s", topic);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    mqtt_pending_publish_t msg = {
+        .data_len = len,
+        .policy = policy,
+    };
+    strcpy(msg.topic, topic);
+    memcpy(msg.data, data, len);
+
+    mqtt_publish_buffer_push(&msg, 0);
+    xSemaphoreGive(mqtt_publish_mutex);
+
+    /**
+     *  Si hay conexión (había mensajes pendientes o falló la publicación), se le avisa a la tarea
+     *  correspondiente que vacíe el buffer.
+     */
+    if(MQTT_CONNECTED)
+    {
+        xTaskNotifyGive(xMqttPublishDrainTaskHandle);
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ * @brief   Función para obtener las estadísticas del buffer de mensajes pendientes de publicar.
+ * 
+ * @param stats Variable en la cual se guardarán las estadísticas.
+ */
+void mqtt_get_publish_stats(mqtt_publish_stats_t* stats)
+{
+    if(stats == NULL)
+    {
+        return;
+    }
+
+    if(mqtt_publish_mutex != NULL)
+    {
+        xSemaphoreTake(mqtt_publish_mutex, portMAX_DELAY);
+    }
+
+    stats->ram_pending = mqtt_publish_buffer_count;
+    stats->nvs_pending = mqtt_publish_nvs_tail - mqtt_publish_nvs_head;
+    stats->spilled = mqtt_publish_spilled;
+    stats->sent_from_buffer = mqtt_publish_sent_from_buffer;
+    stats->dropped = mqtt_publish_dropped;
+
+    if(mqtt_publish_mutex != NULL)
+    {
+        xSemaphoreGive(mqtt_publish_mutex);
+    }
+}
+
+
+/**
+ * @brief   Función para publicar el valor de una variable de telemetría (sensores). Según la configuración
+ *          (DEBUG_TELEMETRIA_AGREGADA), el valor se publica en su propio tópico o se agrega a la trama de
+ *          telemetría del período actual.
+ * 
+ * @param mqtt_client Handle del cliente MQTT.
+ * @param topic Nombre del tópico MQTT de la variable.
+ * @param value Valor a publicar.
+ * @param decimals Cantidad de decimales con los que se publica el valor.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t mqtt_publish_telemetry(esp_mqtt_client_handle_t mqtt_client, const char* topic, float value, uint8_t decimals)
+{
+    if(mqtt_client == NULL || topic == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(mqtt_telemetry_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(mqtt_telemetry_mutex, portMAX_DELAY);
+
+    mqtt_telemetry_var_t* var = mqtt_telemetry_get_var(topic);
+
+    if(var == NULL)
+    {
+        xSemaphoreGive(mqtt_telemetry_mutex);
+        ESP_LOGE(TAG, "MQTT ERROR: Failed to register telemetry variable: %s", topic);
+        return ESP_ERR_NO_MEM;
+    }
+
+    /**
+     *  Si el valor no cumple la política de publicación de la variable, se descarta.
+     */
+    if(!mqtt_telemetry_check_policy(var, value))
+    {
+        xSemaphoreGive(mqtt_telemetry_mutex);
+        return ESP_OK;
+    }
+
+    #ifdef DEBUG_TELEMETRIA_AGREGADA
+    var->value = value;
+    var->decimals = decimals;
+    var->updated = 1;
+
+    xSemaphoreGive(mqtt_telemetry_mutex);
+
+    return ESP_OK;
+
+    #else
+    xSemaphoreGive(mqtt_telemetry_mutex);
+
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+
+    return mqtt_publish_data(mqtt_client, topic, buffer, 0, MQTT_PUBLISH_KEEP_LATEST);
+    #endif
+}
+
+
+/**
+ * @brief   Función para asignar la política de publicación por excepción de una variable de telemetría
+ *          (banda muerta, tiempo mínimo entre publicaciones y tiempo máximo de silencio). Si la variable
+ *          todavía no fue publicada, se la registra.
+ * 
+ * @param topic Nombre del tópico MQTT de la variable.
+ * @param policy Política de publicación.
+ * 
+ * @return esp_err_t
+ */
+esp_err_t mqtt_set_telemetry_policy(const char* topic, const mqtt_telemetry_policy_t* policy)
+{
+    if(topic == NULL || policy == NULL || policy->abs_deadband < 0 || policy->rel_deadband < 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(mqtt_telemetry_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(mqtt_telemetry_mutex, portMAX_DELAY);
+
+    mqtt_telemetry_var_t* var = mqtt_telemetry_get_var(topic);
+
+    if(var == NULL)
+    {
+        xSemaphoreGive(mqtt_telemetry_mutex);
+        ESP_LOGE(TAG, "MQTT ERROR: Failed to register telemetry variable: %s", topic);
+        return ESP_ERR_NO_MEM;
+    }
+
+    var->policy = *policy;
+
+    xSemaphoreGive(mqtt_telemetry_mutex);
+
+    return ESP_OK;
+}
+
+
+/**
+ * @brief   Función para obtener la cantidad de valores de telemetría publicados y descartados por la
+ *          política de publicación, de una variable o del total de las variables.
+ * 
+ * @param topic Nombre del tópico MQTT de la variable, o NULL para obtener el total.
+ * @param stats Puntero a la estructura donde se guardan las estadísticas.
+ * 
+ * @return esp_err_t
+ */
+esp_err_t mqtt_get_telemetry_stats(const char* topic, mqtt_telemetry_stats_t* stats)
+{
+    if(stats == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if(mqtt_telemetry_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t topic_hash = (topic != NULL) ? mqtt_topic_hash(topic, strlen(topic)) : 0;
+    bool found = 0;
+
+    stats->sent = 0;
+    stats->suppressed = 0;
+
+    xSemaphoreTake(mqtt_telemetry_mutex, portMAX_DELAY);
+
+    for(unsigned int i = 0; i < mqtt_telemetry_var_num; i++)
     {
-        if(!strcmp(mqtt_topic_list[i].topic, topic))
+        if(topic == NULL || (mqtt_telemetry_vars[i].topic_hash == topic_hash && !strcmp(mqtt_telemetry_vars[i].topic, topic)))
         {
-            strcpy(buffer, mqtt_topic_list[i].data);
-            ESP_LOGI(TAG, "BUFFER: %s", buffer);
+            stats->sent += mqtt_telemetry_vars[i].stats.sent;
+            stats->suppressed += mqtt_telemetry_vars[i].stats.suppressed;
+            found = 1;
         }
     }
 
+    xSemaphoreGive(mqtt_telemetry_mutex);
+
+    if(topic != NULL && !found)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
     return ESP_OK;
 }
\ No newline at end of file
@@ -14,6 +14,9 @@ extern "C" {
 /*==================[INCLUDES]=============================================*/
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
 #include "mqtt_client.h"
 
 /*==================[DEFINES AND MACROS]=====================================*/
@@ -24,25 +27,210 @@ extern "C" {
  */
 typedef void (*CallbackFunction)(void *pvParameters);
 
+/**
+ *  @brief  Cantidad máxima de tópicos MQTT que pueden registrarse en la librería.
+ * 
+ *  NOTA:   La lista de tópicos es un array estático de este tamaño, por lo que la dirección
+ *          de cada tópico registrado no cambia nunca y puede guardarse como handle.
+ */
+#define MQTT_MAX_TOPIC_NUM 32
+
+/**
+ *  @brief  Tamaño de la tabla de hash utilizada para indexar los tópicos registrados.
+ *          Debe ser potencia de 2 y al menos el doble de MQTT_MAX_TOPIC_NUM, para
+ *          mantener cortas las secuencias de colisiones.
+ */
+#define MQTT_TOPIC_HASH_TABLE_SIZE 64
+
+/* Largo máximo del nombre de un tópico MQTT (incluyendo el caracter nulo). */
+#define MQTT_TOPIC_NAME_MAX_LEN 100
+
+/**
+ *  @brief  Configuración de la tarea de ingreso, encargada de ejecutar las funciones callback de los
+ *          tópicos fuera del event loop del cliente MQTT. Pueden redefinirse antes de incluir este archivo.
+ */
+#ifndef MQTT_INGRESS_QUEUE_LEN
+#define MQTT_INGRESS_QUEUE_LEN 16   /* Cantidad de mensajes que pueden quedar pendientes de procesar. */
+#endif
+
+#ifndef MQTT_INGRESS_TASK_PRIORITY
+#define MQTT_INGRESS_TASK_PRIORITY 3
+#endif
+
+#ifndef MQTT_INGRESS_TASK_CORE
+#define MQTT_INGRESS_TASK_CORE tskNO_AFFINITY
+#endif
+
+#ifndef MQTT_INGRESS_TASK_STACK_SIZE
+#define MQTT_INGRESS_TASK_STACK_SIZE 4096
+#endif
+
+/**
+ *  @brief  Configuración del buffer de publicaciones pendientes, utilizado para no perder mensajes mientras
+ *          no hay conexión con el broker MQTT. Pueden redefinirse antes de incluir este archivo.
+ */
+#ifndef MQTT_PUBLISH_BUFFER_LEN
+#define MQTT_PUBLISH_BUFFER_LEN 24      /* Cantidad de mensajes pendientes que se guardan en RAM. */
+#endif
+
+#ifndef MQTT_PUBLISH_DATA_MAX_LEN
+#define MQTT_PUBLISH_DATA_MAX_LEN 128   /* Largo máximo del dato de un mensaje pendiente. */
+#endif
+
+#ifndef MQTT_PUBLISH_NVS_MAX_ENTRIES
+#define MQTT_PUBLISH_NVS_MAX_ENTRIES 64 /* Cantidad de mensajes que pueden desbordarse de RAM a memoria FLASH (NVS). */
+#endif
+
+#ifndef MQTT_PUBLISH_DRAIN_INTERVAL_MS
+#define MQTT_PUBLISH_DRAIN_INTERVAL_MS 50   /* Tiempo entre publicaciones al vaciar el buffer tras una reconexión. */
+#endif
+
+#ifndef MQTT_PUBLISH_TASK_PRIORITY
+#define MQTT_PUBLISH_TASK_PRIORITY 2
+#endif
+
+/**
+ *  @brief  Configuración de la telemetría y de la telemetría agregada (ver DEBUG_TELEMETRIA_AGREGADA en
+ *          "DEBUG_DEFINITIONS.h"). Pueden redefinirse antes de incluir este archivo.
+ */
+#ifndef MQTT_TELEMETRY_MAX_VARS
+#define MQTT_TELEMETRY_MAX_VARS 24          /* Cantidad máxima de variables de telemetría distintas (como máximo 32). */
+#endif
+
+#ifndef MQTT_TELEMETRY_FRAME_PERIOD_MS
+#define MQTT_TELEMETRY_FRAME_PERIOD_MS 5000 /* Período de publicación de la trama de telemetría. */
+#endif
+
+#define MQTT_TELEMETRY_FRAME_TOPIC "Telemetria"             /* Tópico en el que se publica la trama de telemetría. */
+#define MQTT_TELEMETRY_MAP_TOPIC "Telemetria/Mapa"          /* Tópico (retenido) con la tabla ID -> tópico de la trama binaria. */
+#define MQTT_TELEMETRY_FRAME_VERSION 1                      /* Versión del formato de la trama de telemetría. */
+
+/* Largo máximo del dato de un tópico MQTT (incluyendo el caracter nulo). */
+#define MQTT_TOPIC_DATA_MAX_LEN 50
+
+/**
+ * @brief   Tipo de dato que se espera recibir en un tópico MQTT. El dato se interpreta una única vez,
+ *          al llegar el mensaje, y los mensajes que no se correspondan con el tipo declarado se descartan.
+ * 
+ */
+typedef enum {
+    MQTT_TOPIC_VALUE_RAW = 0,   /* String sin interpretar (valor por defecto). */
+    MQTT_TOPIC_VALUE_FLOAT,     /* Número en punto flotante. */
+    MQTT_TOPIC_VALUE_ON_OFF,    /* Estado binario: "ON"/"OFF" o "1"/"0". */
+    MQTT_TOPIC_VALUE_MODE,      /* Modo de funcionamiento: "MANUAL"/"AUTO". */
+} mqtt_topic_value_type_t;
+
+/**
+ * @brief   Modos de funcionamiento que pueden recibirse en un tópico del tipo MQTT_TOPIC_VALUE_MODE.
+ * 
+ */
+typedef enum {
+    MQTT_TOPIC_MODE_AUTO = 0,
+    MQTT_TOPIC_MODE_MANUAL,
+} mqtt_topic_mode_t;
+
+/**
+ * @brief   Valor ya interpretado del último dato recibido en un tópico.
+ * 
+ */
+typedef union {
+    float float_value;
+    bool on_off_value;
+    mqtt_topic_mode_t mode_value;
+} mqtt_topic_value_t;
+
 /**
  * @brief   Estructura utilizada para almacenar los datos provenientes de los tópicos 
  *          MQTT correspondientes.
  * 
  */
 typedef struct {
-    char data[50];  /* Dato almacenado (en formato char dado que así se lo recibe desde el tópico). */
-    char topic[100];    /* Nombre/dirección del tópico MQTT correspondiente. */
+    char data[MQTT_TOPIC_DATA_MAX_LEN];  /* Dato almacenado (en formato char dado que así se lo recibe desde el tópico). */
+    mqtt_topic_value_type_t value_type;     /* Tipo de dato declarado para el tópico. */
+    mqtt_topic_value_t value;   /* Último dato válido, ya interpretado según "value_type". */
+    uint32_t seq;   /* Número de secuencia del dato. Impar mientras se escribe, 0 si nunca llegó un dato válido. */
+    uint32_t rejected_count;    /* Cantidad de mensajes descartados por no corresponderse con "value_type". */
+    char topic[MQTT_TOPIC_NAME_MAX_LEN];    /* Nombre/dirección del tópico MQTT correspondiente. */
+    uint16_t topic_len;     /* Largo del nombre del tópico, precalculado al registrarlo. */
+    uint32_t topic_hash;    /* Hash FNV-1a del nombre del tópico, precalculado al registrarlo. */
     CallbackFunction topic_cb;   /* Puntero a función callback que se llamará cuando llegue un dato al tópico. */
 } mqtt_subscribed_topic_data;
 
+/**
+ * @brief   Handle de un tópico suscrito. Apunta directamente a la posición del tópico en la lista
+ *          interna de la librería, y es el argumento "pvParameters" que reciben las funciones callback.
+ * 
+ */
+typedef mqtt_subscribed_topic_data* mqtt_topic_handle_t;
+
+
+/**
+ * @brief   Política de almacenamiento de un mensaje a publicar mientras no hay conexión con el broker MQTT.
+ * 
+ */
+typedef enum {
+    MQTT_PUBLISH_KEEP_LATEST = 0,   /* Solo se guarda el último mensaje pendiente del tópico (telemetría, estados de actuadores). */
+    MQTT_PUBLISH_KEEP_ALL,          /* Se guardan todos los mensajes pendientes del tópico, en orden (alarmas). */
+} mqtt_publish_policy_t;
+
+/**
+ * @brief   Estadísticas del buffer de publicaciones pendientes.
+ * 
+ */
+typedef struct {
+    uint32_t ram_pending;       /* Cantidad de mensajes pendientes en RAM. */
+    uint32_t nvs_pending;       /* Cantidad de mensajes pendientes en memoria FLASH (NVS). */
+    uint32_t spilled;           /* Cantidad total de mensajes desbordados de RAM a FLASH. */
+    uint32_t sent_from_buffer;  /* Cantidad total de mensajes pendientes publicados tras una reconexión. */
+    uint32_t dropped;           /* Cantidad total de mensajes descartados por falta de espacio. */
+} mqtt_publish_stats_t;
+
+
+/**
+ * @brief   Política de publicación por excepción de una variable de telemetría. Un valor nuevo solo se publica
+ *          si su variación respecto del último valor publicado supera alguna de las bandas muertas configuradas,
+ *          respetando el tiempo mínimo entre publicaciones. Pasado el tiempo máximo de silencio, el valor se
+ *          publica aunque no haya variado (heartbeat). Con todos los campos en 0 se publican todos los valores.
+ * 
+ */
+typedef struct {
+    float abs_deadband;         /* Variación absoluta mínima para publicar (0 = no se utiliza). */
+    float rel_deadband;         /* Variación relativa mínima para publicar, como fracción del último valor publicado (0 = no se utiliza). */
+    uint32_t min_interval_ms;   /* Tiempo mínimo entre publicaciones (0 = sin límite). */
+    uint32_t max_silence_ms;    /* Tiempo máximo sin publicar; pasado este tiempo se publica el valor igualmente (0 = sin heartbeat). */
+} mqtt_telemetry_policy_t;
+
+
+/**
+ * @brief   Estadísticas de publicación de la telemetría.
+ * 
+ */
+typedef struct {
+    uint32_t sent;          /* Cantidad de valores publicados (o agregados a la trama de telemetría). */
+    uint32_t suppressed;    /* Cantidad de valores descartados por la política de publicación. */
+} mqtt_telemetry_stats_t;
+
+
+/**
+ * @brief   Estadísticas de la cola de ingreso de mensajes MQTT.
+ * 
+ */
+typedef struct {
+    uint32_t depth;         /* Cantidad de mensajes actualmente pendientes en la cola. */
+    uint32_t high_water;    /* Máxima cantidad de mensajes pendientes alcanzada. */
+    uint32_t queued;        /* Cantidad total de mensajes encolados. */
+    uint32_t dropped;       /* Cantidad total de mensajes descartados por cola llena. */
+} mqtt_ingress_stats_t;
+
 
 /**
  * @brief   Estructura utilizada para guardar los nombres de los topicos a los cuales se desea suscribir.
  * 
  */
 typedef struct {
-    char topic_name[100];   /* Nombre del topico MQTT a suscribir. */
+    char topic_name[MQTT_TOPIC_NAME_MAX_LEN];   /* Nombre del topico MQTT a suscribir. */
     CallbackFunction topic_function_cb;     /* Puntero a función callback que se llamará cuando llegue un dato al tópico. */
+    mqtt_topic_value_type_t value_type;     /* Tipo de dato esperado en el tópico (por defecto, MQTT_TOPIC_VALUE_RAW). */
 } mqtt_topic_t;
 
 /*==================[EXTERNAL DATA DECLARATION]==============================*/
@@ -54,6 +242,20 @@ bool mqtt_check_connection();
 esp_err_t mqtt_suscribe_to_topics(const mqtt_topic_t* list_of_topics, const unsigned int number_of_new_topics, esp_mqtt_client_handle_t mqtt_client, int qos);
 esp_err_t mqtt_get_float_data_from_topic(const char* topic, float* buffer);
 esp_err_t mqtt_get_char_data_from_topic(const char* topic, char* buffer);
+mqtt_topic_handle_t mqtt_get_topic_handle(const char* topic);
+esp_err_t mqtt_get_float_data_from_handle(mqtt_topic_handle_t topic_handle, float* buffer);
+esp_err_t mqtt_get_char_data_from_handle(mqtt_topic_handle_t topic_handle, char* buffer);
+esp_err_t mqtt_get_topic_float(mqtt_topic_handle_t topic_handle, float* value);
+esp_err_t mqtt_get_topic_on_off(mqtt_topic_handle_t topic_handle, bool* value);
+esp_err_t mqtt_get_topic_mode(mqtt_topic_handle_t topic_handle, mqtt_topic_mode_t* value);
+uint32_t mqtt_get_topic_seq(mqtt_topic_handle_t topic_handle);
+uint32_t mqtt_get_rejected_payload_count(void);
+void mqtt_get_ingress_stats(mqtt_ingress_stats_t* stats);
+esp_err_t mqtt_publish_data(esp_mqtt_client_handle_t mqtt_client, const char* topic, const char* data, int len, mqtt_publish_policy_t policy);
+void mqtt_get_publish_stats(mqtt_publish_stats_t* stats);
+esp_err_t mqtt_publish_telemetry(esp_mqtt_client_handle_t mqtt_client, const char* topic, float value, uint8_t decimals);
+esp_err_t mqtt_set_telemetry_policy(const char* topic, const mqtt_telemetry_policy_t* policy);
+esp_err_t mqtt_get_telemetry_stats(const char* topic, mqtt_telemetry_stats_t* stats);
 
 /*==================[END OF FILE]============================================*/
 
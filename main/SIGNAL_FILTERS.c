@@ -0,0 +1,489 @@
+/**
+ * @file SIGNAL_FILTERS.c
+ * @author Franco Bisciglia, David Kündinger
+ * @brief   Librería de filtros (mediana móvil, media recortada y media móvil exponencial) para flujos de muestras de sensores.
+ * @version 0.1
+ * @date 2023-01-01
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+
+
+/**
+ * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
+ *
+ *          Los filtros operan muestra a muestra, sin guardar ni ordenar bloques completos de muestras:
+ *
+ *      -MEDIANA MÓVIL: mediana de las últimas N muestras. Las muestras de la ventana se reparten en un montículo de máximos
+ *      (mitad inferior), la mediana, y un montículo de mínimos (mitad superior), guardados en un único arreglo centrado en la
+ *      mediana (índices negativos para el de máximos, positivos para el de mínimos). Cada muestra guarda su posición en el
+ *      montículo, por lo que la muestra nueva reemplaza en su lugar a la más antigua y solo se reacomoda hacia arriba o hacia
+ *      abajo, con un costo O(log N) por muestra.
+ *
+ *      -MEDIA RECORTADA: promedio de cada bloque de muestras descartando las "trim" menores y mayores, que se mantienen
+ *      ordenadas a medida que llegan las muestras, con un costo O(trim) por muestra.
+ *
+ *      -MEDIA MÓVIL EXPONENCIAL: y = y + alpha * (x - y), con un costo O(1) por muestra.
+ */
+
+
+
+//==================================| INCLUDES |==================================//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+
+#include "SIGNAL_FILTERS.h"
+
+//==================================| MACROS AND TYPDEF |==================================//
+
+/* Cantidad de muestras en el montículo de mínimos y en el de máximos. */
+#define FILTER_MEDIAN_MIN_COUNT(f) (((f)->count - 1) / 2)
+#define FILTER_MEDIAN_MAX_COUNT(f) ((f)->count / 2)
+
+//==================================| INTERNAL DATA DEFINITION |==================================//
+
+/* Tag para imprimir información en el LOG. */
+static const char *TAG = "SIGNAL_FILTERS_LIBRARY";
+
+//==================================| EXTERNAL DATA DEFINITION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
+
+static bool filter_median_less(const filter_median_t *f, int i, int j);
+static bool filter_median_cmp_exchange(filter_median_t *f, int i, int j);
+static void filter_median_min_sort_down(filter_median_t *f, int i);
+static void filter_median_max_sort_down(filter_median_t *f, int i);
+static bool filter_median_min_sort_up(filter_median_t *f, int i);
+static bool filter_median_max_sort_up(filter_median_t *f, int i);
+
+//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función que indica si la muestra en la posición i del montículo es menor que la de la posición j.
+ */
+static bool filter_median_less(const filter_median_t *f, int i, int j)
+{
+    return f->data[f->heap[i]] < f->data[f->heap[j]];
+}
+
+
+
+/**
+ * @brief   Función que intercambia las posiciones i y j del montículo si la muestra en i es menor que la de j,
+ *          actualizando las posiciones de ambas muestras. Devuelve 1 si se realizó el intercambio.
+ */
+static bool filter_median_cmp_exchange(filter_median_t *f, int i, int j)
+{
+    if(!filter_median_less(f, i, j))
+    {
+        return 0;
+    }
+
+    int aux = f->heap[i];
+    f->heap[i] = f->heap[j];
+    f->heap[j] = aux;
+
+    f->pos[f->heap[i]] = i;
+    f->pos[f->heap[j]] = j;
+
+    return 1;
+}
+
+
+
+/**
+ * @brief   Función que mantiene la propiedad del montículo de mínimos a partir de la posición i, comparándola
+ *          con su padre y descendiendo hacia sus hijos.
+ */
+static void filter_median_min_sort_down(filter_median_t *f, int i)
+{
+    for(; i <= FILTER_MEDIAN_MIN_COUNT(f); i *= 2)
+    {
+        if(i > 1 && i < FILTER_MEDIAN_MIN_COUNT(f) && filter_median_less(f, i + 1, i))
+        {
+            i++;
+        }
+
+        if(!filter_median_cmp_exchange(f, i, i / 2))
+        {
+            break;
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Función que mantiene la propiedad del montículo de máximos (índices negativos) a partir de la posición i,
+ *          comparándola con su padre y descendiendo hacia sus hijos.
+ */
+static void filter_median_max_sort_down(filter_median_t *f, int i)
+{
+    for(; i >= -FILTER_MEDIAN_MAX_COUNT(f); i *= 2)
+    {
+        if(i < -1 && i > -FILTER_MEDIAN_MAX_COUNT(f) && filter_median_less(f, i, i - 1))
+        {
+            i--;
+        }
+
+        if(!filter_median_cmp_exchange(f, i / 2, i))
+        {
+            break;
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Función que mantiene la propiedad del montículo de mínimos por encima de la posición i, incluyendo
+ *          la mediana. Devuelve 1 si cambió la mediana.
+ */
+static bool filter_median_min_sort_up(filter_median_t *f, int i)
+{
+    while(i > 0 && filter_median_cmp_exchange(f, i, i / 2))
+    {
+        i /= 2;
+    }
+
+    return i == 0;
+}
+
+
+
+/**
+ * @brief   Función que mantiene la propiedad del montículo de máximos por encima de la posición i, incluyendo
+ *          la mediana. Devuelve 1 si cambió la mediana.
+ */
+static bool filter_median_max_sort_up(filter_median_t *f, int i)
+{
+    while(i < 0 && filter_median_cmp_exchange(f, i / 2, i))
+    {
+        i /= 2;
+    }
+
+    return i == 0;
+}
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para inicializar un filtro de mediana móvil.
+ *
+ * @param filter    Filtro a inicializar.
+ * @param window    Cantidad de muestras de la ventana.
+ * @return esp_err_t
+ */
+esp_err_t filter_median_init(filter_median_t *filter, int window)
+{
+    ESP_RETURN_ON_FALSE(filter != NULL && window > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    filter->data = calloc(window, sizeof(float));
+    filter->pos = calloc(window, sizeof(int));
+    int *heap = calloc(window, sizeof(int));
+
+    if(filter->data == NULL || filter->pos == NULL || heap == NULL)
+    {
+        free(filter->data);
+        free(filter->pos);
+        free(heap);
+        filter->data = NULL;
+        filter->pos = NULL;
+        filter->heap = NULL;
+
+        ESP_LOGE(TAG, "Failed to allocate median filter.");
+        return ESP_ERR_NO_MEM;
+    }
+
+    /**
+     *  El montículo se centra en la mitad del arreglo, de forma que la mediana quede en el índice 0.
+     */
+    filter->heap = heap + window / 2;
+    filter->window = window;
+    filter->idx = 0;
+    filter->count = 0;
+
+    /**
+     *  Se asigna a cada posición del buffer circular su lugar inicial en el montículo, alternando
+     *  entre el de máximos y el de mínimos: mediana, máx, mín, máx, mín...
+     */
+    for(int i = window - 1; i >= 0; i--)
+    {
+        filter->pos[i] = ((i + 1) / 2) * ((i & 1) ? -1 : 1);
+        filter->heap[filter->pos[i]] = i;
+    }
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para liberar la memoria de un filtro de mediana móvil.
+ *
+ * @param filter    Filtro a liberar.
+ */
+void filter_median_deinit(filter_median_t *filter)
+{
+    if(filter == NULL || filter->data == NULL)
+    {
+        return;
+    }
+
+    free(filter->heap - filter->window / 2);
+    free(filter->pos);
+    free(filter->data);
+
+    filter->data = NULL;
+    filter->pos = NULL;
+    filter->heap = NULL;
+}
+
+
+
+/**
+ * @brief   Función para agregar una muestra al filtro de mediana móvil, reemplazando a la más antigua si la
+ *          ventana está completa.
+ *
+ * @param filter    Filtro.
+ * @param sample    Nueva muestra.
+ */
+void filter_median_add(filter_median_t *filter, float sample)
+{
+    bool is_new = filter->count < filter->window;
+    int p = filter->pos[filter->idx];
+    float old = filter->data[filter->idx];
+
+    filter->data[filter->idx] = sample;
+    filter->idx = (filter->idx + 1) % filter->window;
+    filter->count += is_new;
+
+    /**
+     *  La nueva muestra ocupa el lugar de la más antigua, y se reacomoda según en qué montículo se encuentre.
+     */
+    if(p > 0)
+    {
+        if(!is_new && old < sample)
+        {
+            filter_median_min_sort_down(filter, p * 2);
+        }
+
+        else if(filter_median_min_sort_up(filter, p))
+        {
+            filter_median_max_sort_down(filter, -1);
+        }
+    }
+
+    else if(p < 0)
+    {
+        if(!is_new && sample < old)
+        {
+            filter_median_max_sort_down(filter, p * 2);
+        }
+
+        else if(filter_median_max_sort_up(filter, p))
+        {
+            filter_median_min_sort_down(filter, 1);
+        }
+    }
+
+    else
+    {
+        if(FILTER_MEDIAN_MAX_COUNT(filter))
+        {
+            filter_median_max_sort_down(filter, -1);
+        }
+
+        if(FILTER_MEDIAN_MIN_COUNT(filter))
+        {
+            filter_median_min_sort_down(filter, 1);
+        }
+    }
+}
+
+
+
+/**
+ * @brief   Función para obtener la mediana de las muestras de la ventana. Si la cantidad de muestras es par,
+ *          se devuelve el promedio de las dos centrales.
+ *
+ * @param filter    Filtro.
+ * @return float    Mediana (0 si no hay muestras).
+ */
+float filter_median_get(const filter_median_t *filter)
+{
+    if(filter->count == 0)
+    {
+        return 0;
+    }
+
+    float value = filter->data[filter->heap[0]];
+
+    if((filter->count & 1) == 0)
+    {
+        value = (value + filter->data[filter->heap[-1]]) / 2;
+    }
+
+    return value;
+}
+
+
+
+/**
+ * @brief   Función para inicializar un filtro de media recortada por bloques.
+ *
+ * @param filter        Filtro a inicializar.
+ * @param block_len     Cantidad de muestras de cada bloque.
+ * @param trim          Cantidad de muestras descartadas en cada extremo (hasta FILTER_TRIM_MAX, y menos de la mitad del bloque).
+ * @return esp_err_t
+ */
+esp_err_t filter_trimmed_mean_init(filter_trimmed_mean_t *filter, uint16_t block_len, uint8_t trim)
+{
+    ESP_RETURN_ON_FALSE(filter != NULL && trim <= FILTER_TRIM_MAX && block_len > 2 * trim,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    filter->sum = 0;
+    filter->block_len = block_len;
+    filter->count = 0;
+    filter->trim = trim;
+    filter->value = 0;
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para agregar una muestra al filtro de media recortada.
+ *
+ * @param filter    Filtro.
+ * @param sample    Nueva muestra.
+ * @return true     Se completó un bloque, y hay un nuevo valor disponible.
+ * @return false    El bloque todavía no se completó.
+ */
+bool filter_trimmed_mean_add(filter_trimmed_mean_t *filter, float sample)
+{
+    int n = filter->count < filter->trim ? filter->count : filter->trim;
+    int i;
+
+    filter->sum += sample;
+
+    /**
+     *  Si la muestra está entre las "trim" menores del bloque, se inserta ordenada, descartando la mayor de ellas.
+     */
+    i = (n == filter->trim) ? n - 1 : n;
+
+    if(i >= 0 && (n < filter->trim || sample < filter->low[i]))
+    {
+        while(i > 0 && filter->low[i - 1] > sample)
+        {
+            filter->low[i] = filter->low[i - 1];
+            i--;
+        }
+
+        filter->low[i] = sample;
+    }
+
+    /**
+     *  Si la muestra está entre las "trim" mayores del bloque, se inserta ordenada, descartando la menor de ellas.
+     */
+    i = (n == filter->trim) ? n - 1 : n;
+
+    if(i >= 0 && (n < filter->trim || sample > filter->high[i]))
+    {
+        while(i > 0 && filter->high[i - 1] < sample)
+        {
+            filter->high[i] = filter->high[i - 1];
+            i--;
+        }
+
+        filter->high[i] = sample;
+    }
+
+    if(++filter->count < filter->block_len)
+    {
+        return 0;
+    }
+
+    /**
+     *  Al completarse el bloque, se calcula el promedio sin las muestras de los extremos y se reinicia el bloque.
+     */
+    float sum = filter->sum;
+
+    for(i = 0; i < filter->trim; i++)
+    {
+        sum -= filter->low[i] + filter->high[i];
+    }
+
+    filter->value = sum / (filter->count - 2 * filter->trim);
+    filter->sum = 0;
+    filter->count = 0;
+
+    return 1;
+}
+
+
+
+/**
+ * @brief   Función para obtener el resultado del último bloque completo del filtro de media recortada.
+ *
+ * @param filter    Filtro.
+ * @return float    Media recortada.
+ */
+float filter_trimmed_mean_get(const filter_trimmed_mean_t *filter)
+{
+    return filter->value;
+}
+
+
+
+/**
+ * @brief   Función para inicializar un filtro de media móvil exponencial.
+ *
+ * @param filter    Filtro a inicializar.
+ * @param alpha     Factor de suavizado (0 < alpha <= 1). Con alpha = 1 no se filtra.
+ * @return esp_err_t
+ */
+esp_err_t filter_ema_init(filter_ema_t *filter, float alpha)
+{
+    ESP_RETURN_ON_FALSE(filter != NULL && alpha > 0 && alpha <= 1, ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    filter->alpha = alpha;
+    filter->value = 0;
+    filter->initialized = 0;
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para agregar una muestra al filtro de media móvil exponencial. La primera muestra
+ *          inicializa el valor filtrado.
+ *
+ * @param filter    Filtro.
+ * @param sample    Nueva muestra.
+ * @return float    Valor filtrado.
+ */
+float filter_ema_add(filter_ema_t *filter, float sample)
+{
+    if(!filter->initialized)
+    {
+        filter->value = sample;
+        filter->initialized = 1;
+    }
+
+    else
+    {
+        filter->value += filter->alpha * (sample - filter->value);
+    }
+
+    return filter->value;
+}
\ No newline at end of file
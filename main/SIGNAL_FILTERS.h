@@ -0,0 +1,85 @@
+/*
+
+    Filtros para flujos de muestras de sensores
+
+*/
+
+#ifndef SIGNAL_FILTERS_H_   /* Include guard */
+#define SIGNAL_FILTERS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/* Cantidad máxima de muestras que se descartan en cada extremo en la media recortada. */
+#define FILTER_TRIM_MAX 8
+
+/**
+ * @brief   Mediana móvil sobre una ventana de las últimas "window" muestras. Las muestras se mantienen en un
+ *          montículo de máximos (mitad inferior) y uno de mínimos (mitad superior) alrededor de la mediana, con
+ *          un índice de posición por muestra, de forma que reemplazar la muestra más antigua cuesta O(log n).
+ */
+typedef struct {
+    float *data;        /* Buffer circular de muestras. */
+    int *pos;           /* Posición en el montículo de cada muestra. */
+    int *heap;          /* Montículos de máximos (índices negativos), mediana (0) y mínimos (índices positivos). */
+    int window;         /* Tamaño de la ventana. */
+    int idx;            /* Posición de la próxima muestra en el buffer circular. */
+    int count;          /* Cantidad de muestras en la ventana. */
+} filter_median_t;
+
+/**
+ * @brief   Media recortada por bloques: se promedian las muestras de cada bloque de "block_len" muestras,
+ *          descartando las "trim" menores y las "trim" mayores. Costo O(trim) por muestra.
+ */
+typedef struct {
+    float sum;                      /* Suma de las muestras del bloque. */
+    float low[FILTER_TRIM_MAX];     /* Menores muestras del bloque, ordenadas de menor a mayor. */
+    float high[FILTER_TRIM_MAX];    /* Mayores muestras del bloque, ordenadas de mayor a menor. */
+    uint16_t block_len;             /* Cantidad de muestras por bloque. */
+    uint16_t count;                 /* Cantidad de muestras del bloque actual. */
+    uint8_t trim;                   /* Cantidad de muestras descartadas en cada extremo. */
+    float value;                    /* Resultado del último bloque completo. */
+} filter_trimmed_mean_t;
+
+/**
+ * @brief   Media móvil exponencial: y = y + alpha * (x - y). Costo O(1) por muestra.
+ */
+typedef struct {
+    float alpha;        /* Factor de suavizado (0 < alpha <= 1). */
+    float value;        /* Valor filtrado. */
+    bool initialized;   /* Indica si ya se cargó la primera muestra. */
+} filter_ema_t;
+
+/*==================[EXTERNAL DATA DECLARATION]==============================*/
+
+/*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
+
+esp_err_t filter_median_init(filter_median_t *filter, int window);
+void filter_median_deinit(filter_median_t *filter);
+void filter_median_add(filter_median_t *filter, float sample);
+float filter_median_get(const filter_median_t *filter);
+
+esp_err_t filter_trimmed_mean_init(filter_trimmed_mean_t *filter, uint16_t block_len, uint8_t trim);
+bool filter_trimmed_mean_add(filter_trimmed_mean_t *filter, float sample);
+float filter_trimmed_mean_get(const filter_trimmed_mean_t *filter);
+
+esp_err_t filter_ema_init(filter_ema_t *filter, float alpha);
+float filter_ema_add(filter_ema_t *filter, float sample);
+
+/*==================[END OF FILE]============================================*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SIGNAL_FILTERS_H_
@@ -0,0 +1,237 @@
+/**
+ * @file TANK_MODEL.c
+ * @author Franco Bisciglia, David Kündinger
+ * @brief   Librería para convertir la distancia medida por el sensor de nivel ubicado en la parte superior de un tanque en nivel,
+ *          volumen de líquido y caudal de llenado, a partir de un modelo de la geometría del tanque.
+ * @version 0.1
+ * @date 2023-01-01
+ * 
+ * @copyright Copyright (c) 2023
+ * 
+ */
+
+
+
+/**
+ * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
+ *
+ *          Al inicializar el modelo se integra el área de la sección transversal del tanque y se guarda una tabla del volumen
+ *      acumulado a alturas equiespaciadas. Cada medición solo requiere convertir la distancia a altura de líquido e interpolar
+ *      linealmente en la tabla, con un costo constante e independiente de la forma del tanque.
+ *
+ *          El caudal de llenado se calcula como la variación de volumen sobre un intervalo mínimo de TANK_MODEL_FILL_RATE_WINDOW_MS,
+ *      para que el ruido del sensor no se amplifique al derivar mediciones muy cercanas, y luego se suaviza con una media
+ *      móvil exponencial.
+ */
+
+
+
+//==================================| INCLUDES |==================================//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+
+#include "TANK_MODEL.h"
+
+//==================================| MACROS AND TYPDEF |==================================//
+
+#define TANK_MODEL_PI 3.14159265f
+
+//==================================| INTERNAL DATA DEFINITION |==================================//
+
+/* Tag para imprimir información en el LOG. */
+static const char *TAG = "TANK_MODEL_LIBRARY";
+
+//==================================| EXTERNAL DATA DEFINITION |==================================//
+
+//==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
+
+static float tank_model_area_cm2(const tank_model_config_t *config, float liquid_height_cm);
+
+//==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para obtener el área de la sección transversal del tanque a una altura determinada.
+ * 
+ * @param config            Geometría del tanque.
+ * @param liquid_height_cm  Altura desde el fondo del tanque, entre 0 y "height_cm".
+ * @return float    Área de la sección, en cm².
+ */
+static float tank_model_area_cm2(const tank_model_config_t *config, float liquid_height_cm)
+{
+    switch(config->shape)
+    {
+
+    case TANK_SHAPE_CYLINDER:
+        return TANK_MODEL_PI * config->diameter_cm * config->diameter_cm / 4;
+
+    case TANK_SHAPE_RECTANGLE:
+        return config->width_cm * config->length_cm;
+
+    case TANK_SHAPE_TABLE:
+    default:
+        break;
+
+    }
+
+    /**
+     *  Se interpola linealmente el área entre los puntos de la tabla más cercanos.
+     */
+    float pos = liquid_height_cm * (config->profile_len - 1) / config->height_cm;
+    int idx = (int) pos;
+
+    if(idx >= config->profile_len - 1)
+    {
+        return config->profile_area_cm2[config->profile_len - 1];
+    }
+
+    float frac = pos - idx;
+
+    return config->profile_area_cm2[idx] + frac * (config->profile_area_cm2[idx + 1] - config->profile_area_cm2[idx]);
+}
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para inicializar el modelo de un tanque, precalculando la tabla de volumen en función de la altura.
+ * 
+ * @param model     Modelo a inicializar.
+ * @param config    Geometría del tanque (se copia en el modelo; la tabla de perfil, si la hay, debe seguir existiendo).
+ * @return esp_err_t 
+ */
+esp_err_t tank_model_init(tank_model_t *model, const tank_model_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(model != NULL && config != NULL && config->height_cm > 0 && config->sensor_offset_cm >= 0, 
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument.");
+
+    ESP_RETURN_ON_FALSE(config->shape != TANK_SHAPE_CYLINDER || config->diameter_cm > 0, 
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid cylinder diameter.");
+    ESP_RETURN_ON_FALSE(config->shape != TANK_SHAPE_RECTANGLE || (config->width_cm > 0 && config->length_cm > 0), 
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid rectangle dimensions.");
+    ESP_RETURN_ON_FALSE(config->shape != TANK_SHAPE_TABLE || (config->profile_area_cm2 != NULL && config->profile_len >= 2), 
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid area profile.");
+
+    memset(model, 0, sizeof(*model));
+    model->config = *config;
+    model->table_scale = (TANK_MODEL_TABLE_LEN - 1) / config->height_cm;
+
+
+    //=======================| TABLA DE VOLUMEN |=======================//
+
+    /**
+     *  Se integra el área de la sección por el método de los trapecios, sobre el paso de la tabla.
+     */
+    float step_cm = config->height_cm / (TANK_MODEL_TABLE_LEN - 1);
+    float prev_area_cm2 = tank_model_area_cm2(config, 0);
+    float volume_cm3 = 0;
+
+    model->volume_table_l[0] = 0;
+
+    for(int i = 1; i < TANK_MODEL_TABLE_LEN; i++)
+    {
+        float area_cm2 = tank_model_area_cm2(config, i * step_cm);
+        volume_cm3 += (prev_area_cm2 + area_cm2) * step_cm / 2;
+        prev_area_cm2 = area_cm2;
+
+        model->volume_table_l[i] = volume_cm3 / 1000;
+    }
+
+    return filter_ema_init(&model->fill_rate, TANK_MODEL_FILL_RATE_EMA_ALPHA);
+}
+
+
+
+/**
+ * @brief   Función para obtener el volumen de líquido del tanque para una altura de líquido determinada.
+ * 
+ * @param model             Modelo del tanque.
+ * @param liquid_height_cm  Altura de líquido desde el fondo. Se satura entre 0 y la altura útil del tanque.
+ * @return float    Volumen de líquido, en litros.
+ */
+float tank_model_volume_l(const tank_model_t *model, float liquid_height_cm)
+{
+    float pos = liquid_height_cm * model->table_scale;
+
+    if(pos <= 0)
+    {
+        return 0;
+    }
+
+    if(pos >= TANK_MODEL_TABLE_LEN - 1)
+    {
+        return model->volume_table_l[TANK_MODEL_TABLE_LEN - 1];
+    }
+
+    int idx = (int) pos;
+    float frac = pos - idx;
+
+    return model->volume_table_l[idx] + frac * (model->volume_table_l[idx + 1] - model->volume_table_l[idx]);
+}
+
+
+
+/**
+ * @brief   Función para obtener la capacidad del tanque (volumen con el tanque lleno).
+ * 
+ * @param model     Modelo del tanque.
+ * @return float    Capacidad, en litros.
+ */
+float tank_model_capacity_l(const tank_model_t *model)
+{
+    return model->volume_table_l[TANK_MODEL_TABLE_LEN - 1];
+}
+
+
+
+/**
+ * @brief   Función para convertir una medición de distancia del sensor de nivel en nivel, volumen y caudal de llenado,
+ *          actualizando el cálculo del caudal. Solo deben pasarse mediciones válidas.
+ * 
+ * @param model         Modelo del tanque.
+ * @param distance_cm   Distancia medida desde el sensor hasta la superficie del líquido, en cm.
+ * @param time_us       Instante de la medición, en us (por ejemplo, de "esp_timer_get_time()").
+ * @param reading       Variable donde se guarda el resultado.
+ */
+void tank_model_update(tank_model_t *model, float distance_cm, int64_t time_us, tank_model_reading_t *reading)
+{
+    float liquid_height_cm = model->config.height_cm + model->config.sensor_offset_cm - distance_cm;
+
+    reading->level = liquid_height_cm / model->config.height_cm;
+    reading->volume_l = tank_model_volume_l(model, liquid_height_cm);
+
+
+    //=======================| CAUDAL DE LLENADO |=======================//
+
+    /**
+     *  Al cumplirse el intervalo mínimo desde el volumen de referencia, se calcula el caudal sobre
+     *  dicho intervalo y la medición actual pasa a ser la nueva referencia. Las mediciones con un
+     *  nivel fuera del tanque no son físicamente posibles, por lo que no se tienen en cuenta.
+     */
+    if(reading->level < 0 || reading->level > 1)
+    {
+        /* No se actualiza el caudal. */
+    }
+
+    else if(!model->has_ref)
+    {
+        model->ref_volume_l = reading->volume_l;
+        model->ref_time_us = time_us;
+        model->has_ref = 1;
+    }
+
+    else if(time_us - model->ref_time_us >= TANK_MODEL_FILL_RATE_WINDOW_MS * 1000LL)
+    {
+        float elapsed_min = (time_us - model->ref_time_us) / 60e6f;
+
+        filter_ema_add(&model->fill_rate, (reading->volume_l - model->ref_volume_l) / elapsed_min);
+
+        model->ref_volume_l = reading->volume_l;
+        model->ref_time_us = time_us;
+    }
+
+    reading->fill_rate_l_min = model->fill_rate.value;
+}
\ No newline at end of file
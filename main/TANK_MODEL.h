@@ -0,0 +1,89 @@
+/*
+
+    Modelo geométrico de tanques de almacenamiento de líquido
+
+*/
+
+#ifndef TANK_MODEL_H_   /* Include guard */
+#define TANK_MODEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*==================[INCLUDES]=============================================*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "SIGNAL_FILTERS.h"
+
+/*==================[DEFINES AND MACROS]=====================================*/
+
+/* Cantidad de entradas de la tabla de volumen en función de la altura de líquido. */
+#define TANK_MODEL_TABLE_LEN 65
+
+/* Intervalo mínimo sobre el cual se calcula la variación de volumen para obtener el caudal de llenado. */
+#define TANK_MODEL_FILL_RATE_WINDOW_MS 10000
+
+/* Factor de suavizado (media móvil exponencial) del caudal de llenado. */
+#define TANK_MODEL_FILL_RATE_EMA_ALPHA 0.5
+
+/* Forma de la sección transversal del tanque. */
+typedef enum {
+    TANK_SHAPE_CYLINDER = 0,        /* Cilindro vertical de diámetro "diameter_cm". */
+    TANK_SHAPE_RECTANGLE,           /* Prisma rectangular de "width_cm" x "length_cm". */
+    TANK_SHAPE_TABLE,               /* Área de sección transversal dada por tabla, en función de la altura. */
+} tank_shape_t;
+
+/**
+ * @brief   Configuración de la geometría de un tanque, con el sensor de nivel ubicado en la parte superior.
+ */
+typedef struct {
+    float height_cm;                    /* Altura útil del tanque, desde el fondo hasta el nivel de llenado máximo. */
+    float sensor_offset_cm;             /* Distancia desde el sensor hasta el nivel de llenado máximo (zona muerta del sensor). */
+    tank_shape_t shape;                 /* Forma de la sección transversal. */
+    float diameter_cm;                  /* Diámetro (TANK_SHAPE_CYLINDER). */
+    float width_cm;                     /* Ancho (TANK_SHAPE_RECTANGLE). */
+    float length_cm;                    /* Largo (TANK_SHAPE_RECTANGLE). */
+    const float *profile_area_cm2;      /* Área de la sección a alturas equiespaciadas desde el fondo hasta "height_cm" (TANK_SHAPE_TABLE). */
+    uint8_t profile_len;                /* Cantidad de puntos de "profile_area_cm2" (al menos 2). */
+} tank_model_config_t;
+
+/**
+ * @brief   Modelo de un tanque: la configuración, la tabla de volumen precalculada y el estado del cálculo de caudal.
+ */
+typedef struct {
+    tank_model_config_t config;                     /* Geometría del tanque. */
+    float volume_table_l[TANK_MODEL_TABLE_LEN];     /* Volumen acumulado a alturas equiespaciadas desde el fondo hasta "height_cm". */
+    float table_scale;                              /* Conversión de altura en cm a posición en la tabla. */
+    float ref_volume_l;                             /* Volumen al inicio del intervalo de cálculo del caudal. */
+    int64_t ref_time_us;                            /* Instante del inicio del intervalo de cálculo del caudal. */
+    bool has_ref;                                   /* Indica si ya hay un volumen de referencia. */
+    filter_ema_t fill_rate;                         /* Caudal de llenado filtrado, en L/min. */
+} tank_model_t;
+
+/* Resultado de convertir una medición de distancia con el modelo del tanque. */
+typedef struct {
+    float level;                /* Nivel de líquido, entre 0 (tanque vacío) y 1 (tanque lleno), sin saturar. */
+    float volume_l;             /* Volumen de líquido, en litros. */
+    float fill_rate_l_min;      /* Caudal de llenado (negativo si se vacía), en L/min. */
+} tank_model_reading_t;
+
+/*==================[EXTERNAL DATA DECLARATION]==============================*/
+
+/*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
+
+esp_err_t tank_model_init(tank_model_t *model, const tank_model_config_t *config);
+float tank_model_volume_l(const tank_model_t *model, float liquid_height_cm);
+float tank_model_capacity_l(const tank_model_t *model);
+void tank_model_update(tank_model_t *model, float distance_cm, int64_t time_us, tank_model_reading_t *reading);
+
+/*==================[END OF FILE]============================================*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TANK_MODEL_H_
@@ -14,7 +14,16 @@
 /**
  * =================================================| EXPLICACIÓN DE LIBRERÍA |=================================================
  *  
- *          
+ *          El valor de TDS se obtiene con la fórmula del fabricante del sensor, a partir de la tensión de salida compensada
+ *      por la temperatura de la solución (sensor DS18B20):
+ * 
+ *      V_comp = V / (1 + 0.02 * (T - 25))
+ *      ppm = (133.42 * V_comp^3 - 255.86 * V_comp^2 + 857.39 * V_comp) * 0.5
+ * 
+ *          La conversión se realiza en punto fijo (Q16): el coeficiente de compensación se obtiene interpolando una tabla
+ *      precalculada para cada grado entre 0 y 50 °C, y el polinomio se evalúa en forma de Horner con enteros de 64 bits.
+ *      Si la medición de temperatura es errónea o tiene más de TDS_SENSOR_TEMP_MAX_AGE_MS, no se compensa el valor, lo
+ *      que se indica mediante "TDS_sensor_is_temp_compensated()".
  */
 
 
@@ -33,16 +42,40 @@
 
 #include "driver/adc.h"
 
+#include "ADC_ENGINE.h"
+#include "SIGNAL_FILTERS.h"
+
 //==================================| MACROS AND TYPDEF |==================================//
 
+/* Período de obtención de un nuevo valor de TDS, en ms. */
+#define TDS_SENSOR_PERIOD_MS 3000
+
+/* Factor de suavizado de la media móvil exponencial aplicada a los valores de TDS. */
+#define TDS_SENSOR_EMA_ALPHA 0.5
+
+/* Edad máxima de la medición de temperatura utilizada para la compensación, en ms. */
+#define TDS_SENSOR_TEMP_MAX_AGE_MS 5000
+
+/* Rango de la tabla de coeficientes de compensación de temperatura (un valor por grado), en °C. */
+#define TDS_SENSOR_TEMP_COMP_MIN_TEMP 0
+#define TDS_SENSOR_TEMP_COMP_TABLE_LEN 51
+
+/* Valor 1 en formato Q16. */
+#define TDS_SENSOR_Q16_ONE 65536
+
+/* Tensión de referencia del ADC (3.3 V) en formato Q16. */
+#define TDS_SENSOR_VREF_Q16 216269
+
+/* Coeficientes del polinomio de conversión (ya multiplicados por 0.5) en formato Q16. */
+#define TDS_SENSOR_POLY_A3_Q16 4371907          // 66.71
+#define TDS_SENSOR_POLY_A2_Q16 (-8384020)       // -127.93
+#define TDS_SENSOR_POLY_A1_Q16 28094956         // 428.695
+
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 /* Tag para imprimir información en el LOG. */
 static const char *TAG = "TDS_SENSOR_LIBRARY";
 
-/* Handle de la tarea de obtención de datos del sensor de TDS */
-static TaskHandle_t xTdsTaskHandle = NULL;
-
 /* Puntero a función que apuntará a la función callback pasada como argumento en la función de configuración de callback. */
 TdsSensorCallbackFunction TdsSensorCallback = NULL;
 
@@ -52,168 +85,180 @@ static TDS_sensor_ppm_t TDS_ppm_value = 0;
 /* Variable que representa canal de ADC2 del sensor de TDS */
 static TDS_sensor_adc1_ch_t TDS_SENSOR_ANALOG_PIN;
 
+/* Filtro de media móvil exponencial de los valores de TDS. */
+static filter_ema_t TDS_ema_filter;
+
+/* Tabla de coeficientes de compensación de temperatura, en formato Q16. */
+static uint32_t TDS_temp_comp_table[TDS_SENSOR_TEMP_COMP_TABLE_LEN];
+
+/* Bandera que indica si el último valor de TDS fue compensado por temperatura. */
+static bool TDS_temp_compensated = 0;
+
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
-static void vTaskGetTdsInPpm(void *pvParameters);
+static void TDS_sensor_build_temp_comp_table(void);
+static uint32_t TDS_sensor_temp_comp_coef(int32_t temp_deci);
+static int32_t TDS_sensor_raw_to_ppm_q16(uint16_t raw, uint32_t comp_q16);
+static void TDS_sensor_adc_callback(uint16_t raw);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
- * @brief   Tarea encargada de tomar muestras del ADC al que está conectado el sensor de TDS y, 
- *          calcular el valor de TDS en ppm.
- * 
- * @param pvParameters  Parámetros pasados a la tarea en su creación.
+ * @brief   Función que arma la tabla de coeficientes de compensación de temperatura, 1 / (1 + 0.02 * (T - 25)),
+ *          en formato Q16, para cada grado del rango de la tabla.
  */
-static void vTaskGetTdsInPpm(void *pvParameters)
+static void TDS_sensor_build_temp_comp_table(void)
 {
-    while (1) {
-
-        /**
-         *  Variable en donde se almacenarán conversiones parciales del ADC.
-         */
-        int TDS_buffer[10];
-
-        /**
-         *  Se toma 1 conversión del ADC cada un tiempo (10 ms), para un total de 10 muestras.
-         */
-        for(int i = 0; i < 10; i++)
-        {
-            TDS_buffer[i] = adc1_get_raw(TDS_SENSOR_ANALOG_PIN);
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-
-        /**
-         *  Variable auxiliar para realizar ordenamiento del arreglo de conversiones de ADC.
-         */
-        int TDS_aux=0;
-
-        /**
-         *  Se ordenan los valores del menor al mayor con el método de la burbuja.
-         */
-        for(int i=1; i < 10; i++)
-        {
-            for(int j=0; j < 10-i; j++)
-            {
-                if(TDS_buffer[j] > TDS_buffer[j+1])
-                {
-                    TDS_aux = TDS_buffer[j];
-                    TDS_buffer[j]=TDS_buffer[j+1];
-                    TDS_buffer[j+1]=TDS_aux;
-                }
-            }  
-        }
-
-        /**
-         *  Se obtiene la tensión entregada por el sensor a partir de la mediana del arreglo de muestras del
-         *  ADC obtenido, con la fórmula:
-         * 
-         *  V = valor_digital * (V_max / resolución_adc)
-         * 
-         *  Donde:
-         *      -valor_digital: el valor obtenido del ADC.
-         *      -V_max: el máximo valor de tensión aceptado por el ADC.
-         *      -resolución_adc: la resolución del ADC.
-         * 
-         */
-        float TDS_voltage;
-        
-        TDS_voltage = TDS_buffer[5] * (3.3 / 4096.0);
-
-        /**
-         *  Se calcula el coeficiente de compensación de temperatura, tomando el valor de temperatura provisto
-         *  por el sensor de temperatura sumergible DS18B20 colocado en la misma solucion que el sensor de TDS.
-         */
-        DS18B20_sensor_temp_t DS18B20_temp;
-
-        DS18B20_getTemp(&DS18B20_temp);
-        float TDS_temp_comp_coef = 1.0 + 0.02 * (DS18B20_temp - 25.0);
-
-        /**
-         *  Se calcula la tensión compensada por el coeficiente de temperatura.
-         */
-        float TDS_compensation_voltage = TDS_voltage / TDS_temp_comp_coef;
-
-        /**
-         *  Se calcula el valor de TDS en ppm, utilizando una fórmula provista por el fabricante del sensor.
-         * 
-         *  REF: https://wiki.dfrobot.com/Gravity__Analog_TDS_Sensor___Meter_For_Arduino_SKU__SEN0244
-         */
-        TDS_ppm_value = (133.42 * TDS_compensation_voltage * TDS_compensation_voltage * TDS_compensation_voltage - 255.86 * TDS_compensation_voltage * TDS_compensation_voltage + 857.39 * TDS_compensation_voltage) * 0.5; // Fórmula para convertir el voltaje en valor TDS ppm
-
-
-        /**
-         *  Se ejecuta la función callback configurada.
-         */
-        if(TdsSensorCallback != NULL)
-        {
-            TdsSensorCallback(NULL);
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(3000));
+    for(int i = 0; i < TDS_SENSOR_TEMP_COMP_TABLE_LEN; i++)
+    {
+        float temp = TDS_SENSOR_TEMP_COMP_MIN_TEMP + i;
+        TDS_temp_comp_table[i] = (uint32_t) (TDS_SENSOR_Q16_ONE / (1.0 + 0.02 * (temp - 25.0)) + 0.5);
     }
 }
 
-//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
 
 /**
- * @brief   Función para inicializar el sensor de TDS.
+ * @brief   Función que obtiene el coeficiente de compensación de temperatura (Q16) interpolando la tabla,
+ *          a partir de la temperatura en décimas de grado.
  * 
- * @param TDS_sens_analog_pin    Canal de ADC en el cual se encuentra conectado el sensor (debe ser del ADC2)
- * @return esp_err_t 
+ * @param temp_deci     Temperatura de la solución, en décimas de °C.
+ * @return uint32_t     Coeficiente de compensación, en formato Q16.
  */
-esp_err_t TDS_sensor_init(TDS_sensor_adc1_ch_t TDS_sens_analog_pin)
+static uint32_t TDS_sensor_temp_comp_coef(int32_t temp_deci)
 {
-    //========================| CONFIGURACIÓN ADC |===========================//
+    int32_t offset = temp_deci - TDS_SENSOR_TEMP_COMP_MIN_TEMP * 10;
 
     /**
-     *  Se guarda el canal del ADC2 utilizado.
+     *  Fuera del rango de la tabla, se utiliza el coeficiente del extremo correspondiente.
      */
-    TDS_SENSOR_ANALOG_PIN = TDS_sens_analog_pin;
+    if(offset <= 0)
+    {
+        return TDS_temp_comp_table[0];
+    }
+
+    if(offset >= (TDS_SENSOR_TEMP_COMP_TABLE_LEN - 1) * 10)
+    {
+        return TDS_temp_comp_table[TDS_SENSOR_TEMP_COMP_TABLE_LEN - 1];
+    }
+
+    int32_t idx = offset / 10;
+    int32_t frac = offset % 10;
+    int32_t c0 = TDS_temp_comp_table[idx];
+    int32_t c1 = TDS_temp_comp_table[idx + 1];
+
+    return c0 + ((c1 - c0) * frac) / 10;
+}
+
+
 
+/**
+ * @brief   Función que convierte el valor del ADC en ppm, en punto fijo, compensando la tensión con el
+ *          coeficiente de compensación de temperatura.
+ * 
+ * @param raw           Valor filtrado del ADC.
+ * @param comp_q16      Coeficiente de compensación de temperatura, en formato Q16 (TDS_SENSOR_Q16_ONE sin compensar).
+ * @return int32_t      Valor de TDS en ppm, en formato Q16.
+ */
+static int32_t TDS_sensor_raw_to_ppm_q16(uint16_t raw, uint32_t comp_q16)
+{
     /**
-     *  Se configura la resolución del ADC, en este caso, de 12 bits.
+     *  Tensión de entrada en formato Q16: V = raw * (3.3 / 4096).
      */
-    ESP_RETURN_ON_ERROR(adc1_config_width(ADC_WIDTH_BIT_12), TAG, "Failed to config ADC width.");
+    int64_t voltage_q16 = ((int64_t) raw * TDS_SENSOR_VREF_Q16) >> 12;
 
     /**
-     *  Se configura el nivel de atenuación del ADC, en este caso, de 11 dB, lo que implica un
-     *  rango de tensión de hasta aproximadamente 3,1 V.
+     *  Tensión compensada por temperatura.
      */
-    ESP_RETURN_ON_ERROR(adc1_config_channel_atten(TDS_sens_analog_pin, ADC_ATTEN_DB_11), TAG, "Failed to config ADC attenuation.");
+    int64_t x = (voltage_q16 * comp_q16) >> 16;
+
+    /**
+     *  Polinomio del fabricante en forma de Horner, con los coeficientes ya multiplicados por 0.5:
+     * 
+     *  ppm = ((66.71 * V - 127.93) * V + 428.695) * V
+     */
+    int64_t acc = TDS_SENSOR_POLY_A3_Q16;
+    acc = ((acc * x) >> 16) + TDS_SENSOR_POLY_A2_Q16;
+    acc = ((acc * x) >> 16) + TDS_SENSOR_POLY_A1_Q16;
+
+    return (int32_t) ((acc * x) >> 16);
+}
+
 
 
+/**
+ * @brief   Función callback del motor de adquisición del ADC, que recibe el valor filtrado del canal del
+ *          sensor de TDS y calcula el valor de TDS en ppm.
+ * 
+ * @param raw   Valor filtrado del ADC (mediana de los promedios de muestras del canal).
+ */
+static void TDS_sensor_adc_callback(uint16_t raw)
+{
+    /**
+     *  Se obtiene la temperatura de la solución, provista por el sensor de temperatura sumergible DS18B20
+     *  colocado en la misma solucion que el sensor de TDS. Si la medición de temperatura es errónea o
+     *  antigua, no se compensa el valor de TDS, y se señaliza mediante la bandera de compensación.
+     */
+    DS18B20_sensor_temp_t DS18B20_temp;
+    uint32_t comp_q16 = TDS_SENSOR_Q16_ONE;
 
-    //========================| CREACIÓN DE TAREA |===========================//
+    TDS_temp_compensated = (DS18B20_getFreshTemp(&DS18B20_temp, TDS_SENSOR_TEMP_MAX_AGE_MS) == ESP_OK);
+
+    if(TDS_temp_compensated)
+    {
+        comp_q16 = TDS_sensor_temp_comp_coef((int32_t) (DS18B20_temp * 10));
+    }
 
     /**
-     *  Se crea la tarea encargada de obtener el valor de pH a partir del valor de tensión
-     *  entregado por el sensor.
+     *  Se calcula el valor de TDS en ppm, utilizando una fórmula provista por el fabricante del sensor.
      * 
-     *  Se le da un nivel de prioridad bajo considerando que la dinámica de la evolución
-     *  del pH en la solución es muy lenta, y en la tarea solamente se obtiene una conversión
-     *  del ADC y se realizan cálculos en base a la misma.
+     *  REF: https://wiki.dfrobot.com/Gravity__Analog_TDS_Sensor___Meter_For_Arduino_SKU__SEN0244
+     */
+    float TDS_ppm = TDS_sensor_raw_to_ppm_q16(raw, comp_q16) / (float) TDS_SENSOR_Q16_ONE;
+
+    /**
+     *  Se suaviza el valor obtenido con la media móvil exponencial.
      */
-    if(xTdsTaskHandle == NULL)
+    TDS_ppm_value = filter_ema_add(&TDS_ema_filter, TDS_ppm);
+
+    /**
+     *  Se ejecuta la función callback configurada.
+     */
+    if(TdsSensorCallback != NULL)
     {
-        xTaskCreate(
-            vTaskGetTdsInPpm,
-            "vTaskGetTdsInPpm",
-            2048,
-            NULL,
-            6,
-            &xTdsTaskHandle);
-        
-        /**
-         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
-         */
-        if(xTdsTaskHandle == NULL)
-        {
-            ESP_LOGE(TAG, "Failed to create vTaskGetTdsInPpm task.");
-            return ESP_FAIL;
-        }
+        TdsSensorCallback(NULL);
     }
+}
+
+//==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
+
+/**
+ * @brief   Función para inicializar el sensor de TDS.
+ * 
+ * @param TDS_sens_analog_pin    Canal de ADC en el cual se encuentra conectado el sensor (debe ser del ADC2)
+ * @return esp_err_t 
+ */
+esp_err_t TDS_sensor_init(TDS_sensor_adc1_ch_t TDS_sens_analog_pin)
+{
+    //========================| CONFIGURACIÓN ADC |===========================//
+
+    /**
+     *  Se guarda el canal del ADC2 utilizado.
+     */
+    TDS_SENSOR_ANALOG_PIN = TDS_sens_analog_pin;
+
+    ESP_RETURN_ON_ERROR(filter_ema_init(&TDS_ema_filter, TDS_SENSOR_EMA_ALPHA), TAG, "Failed to initialize TDS filter.");
+
+    TDS_sensor_build_temp_comp_table();
+
+    /**
+     *  Se agrega el canal al motor de adquisición continua del ADC1, que muestrea el canal, filtra
+     *  las muestras y ejecuta la función callback de cálculo del TDS cada TDS_SENSOR_PERIOD_MS.
+     */
+    ESP_RETURN_ON_ERROR(adc_engine_add_channel(TDS_sens_analog_pin, TDS_SENSOR_PERIOD_MS, TDS_sensor_adc_callback), 
+                        TAG, "Failed to add ADC channel.");
 
     return ESP_OK;
 }
@@ -245,4 +290,17 @@ esp_err_t TDS_getValue(TDS_sensor_ppm_t *TDS_value_buffer)
 void TDS_sensor_callback_function_on_new_measurment(TdsSensorCallbackFunction callback_function)
 {
     TdsSensorCallback = callback_function;
+}
+
+
+
+/**
+ * @brief   Función que indica si el último valor de TDS obtenido fue compensado por temperatura.
+ * 
+ * @return true     El valor fue compensado con una medición de temperatura válida y reciente.
+ * @return false    La medición de temperatura era errónea o antigua, y el valor no fue compensado.
+ */
+bool TDS_sensor_is_temp_compensated(void)
+{
+    return TDS_temp_compensated;
 }
\ No newline at end of file
@@ -14,6 +14,7 @@ extern "C" {
 /*==================[INCLUDES]=============================================*/
 
 #include <stdio.h>
+#include <stdbool.h>
 #include "esp_err.h"
 #include "driver/adc.h"
 #include "freertos/FreeRTOS.h"
@@ -37,6 +38,7 @@ typedef void (*TdsSensorCallbackFunction)(void *pvParameters);
 esp_err_t TDS_sensor_init(TDS_sensor_adc1_ch_t TDS_sens_analog_pin);
 esp_err_t TDS_getValue(TDS_sensor_ppm_t *TDS_value_buffer);
 void TDS_sensor_callback_function_on_new_measurment(TdsSensorCallbackFunction callback_function);
+bool TDS_sensor_is_temp_compensated(void);
 
 /*==================[END OF FILE]============================================*/
 
@@ -11,6 +11,7 @@
 #include "MQTT_PUBL_SUSCR.h"
 #include "WiFi_STA.h"
 #include "MCP23008.h"
+#include "ACTUATOR_SERVICE.h"
 
 #include "APP_LIGHT_SENSOR.h"
 #include "APP_CO2.h"
@@ -61,6 +62,10 @@ void app_main(void)
     mqtt_initialize_and_connect("mqtt://192.168.201.173:1883", &Cliente_MQTT);
     while(!mqtt_check_connection()){vTaskDelay(pdMS_TO_TICKS(100));}
 
+    //=======================| INIT SERVICIO ACTUADORES |=======================//
+
+    ESP_ERROR_CHECK_WITHOUT_ABORT(actuator_service_init(Cliente_MQTT));
+
     //=======================| INIT ALGORITMO SENSOR LUZ |=======================//
     
     #ifdef DEBUG_ALGORITMO_SENSOR_LUZ
@@ -95,22 +100,22 @@ void app_main(void)
     //=======================| INIT ALGORITMO CONTROL pH |=======================//
 
     #ifdef DEBUG_ALGORITMO_CONTROL_PH
-    aux_control_ph_init(Cliente_MQTT);
     mef_ph_init(Cliente_MQTT);
+    aux_control_ph_init(Cliente_MQTT);
     #endif
 
     //=======================| INIT ALGORITMO CONTROL TDS |=======================//
 
     #ifdef DEBUG_ALGORITMO_CONTROL_TDS
-    aux_control_tds_init(Cliente_MQTT);
     mef_tds_init(Cliente_MQTT);
+    aux_control_tds_init(Cliente_MQTT);
     #endif
 
     //=======================| INIT ALGORITMO CONTROL TEMPERATURA SOLUCIÓN |=======================//
 
     #ifdef DEBUG_ALGORITMO_CONTROL_TEMPERATURA_SOLUCION
-    aux_control_temp_soluc_init(Cliente_MQTT);
     mef_temp_soluc_init(Cliente_MQTT);
+    aux_control_temp_soluc_init(Cliente_MQTT);
     #endif
 
 }
\ No newline at end of file
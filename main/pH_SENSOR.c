@@ -22,13 +22,32 @@
  *      Mediante esas mediciones, se confecciona una curva para convertir el valor de tensión en pH, en nuestro caso:
  * 
  *      PH= -5.21 * V_pH + 21.11;
+ * 
+ *      Dicha recta se utiliza como calibración por defecto. La calibración puede rehacerse en funcionamiento, sin reprogramar
+ *  el equipo: con el transductor en cada solución buffer (2 o 3 puntos, por ejemplo pH 4, 7 y 10) se llama a
+ *  "pH_sensor_calibration_add_point()" con el pH de la solución, lo que guarda el valor filtrado actual del ADC junto con la
+ *  temperatura de la solución (sensor DS18B20). Luego, "pH_sensor_calibration_commit()" ajusta una recta por tramos entre
+ *  los puntos, y guarda los puntos en memoria NVS, de donde se cargan en cada inicio.
+ * 
+ *      Compensación de temperatura: la pendiente del electrodo es proporcional a la temperatura absoluta (ecuación de Nernst),
+ *  con el punto isopotencial en pH 7. Cada punto de calibración se lleva a su equivalente a 25 °C, y en cada medición se
+ *  aplica la corrección inversa con la temperatura actual:
+ * 
+ *      pH = 7 + (pH_25 - 7) * (298,15 / (T + 273,15))
+ * 
+ *      Al aplicar una calibración, se precalcula una tabla en punto fijo (pH en milésimas) con el pH a 25 °C para cada
+ *  paso de 16 cuentas del ADC, de forma que la conversión de cada medición sea una interpolación entera entre dos valores.
  */
 
 
 
 //==================================| INCLUDES |==================================//
 
+#include <string.h>
+#include <math.h>
+
 #include "pH_SENSOR.h"
+#include "DS18B20_SENSOR.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
@@ -36,19 +55,47 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "driver/adc.h"
+#include "nvs_flash.h"
+
+#include "ADC_ENGINE.h"
+#include "SIGNAL_FILTERS.h"
 
 //==================================| MACROS AND TYPDEF |==================================//
 
+/* Período de obtención de un nuevo valor de pH, en ms. */
+#define PH_SENSOR_PERIOD_MS 3000
+
+/* Factor de suavizado de la media móvil exponencial aplicada a los valores de pH. */
+#define PH_SENSOR_EMA_ALPHA 0.5
+
+/* Recta de calibración por defecto (pH = m * V + h), a 25 °C. */
+#define PH_SENSOR_DEFAULT_SLOPE -5.21
+#define PH_SENSOR_DEFAULT_OFFSET 21.11
+
+/* Escala de los valores de pH de la tabla de conversión (milésimas de pH). */
+#define PH_SENSOR_CAL_SCALE 1000
+
+/* Temperatura de referencia de la tabla de conversión, y temperatura utilizada si no hay dato del DS18B20, en °C. */
+#define PH_SENSOR_CAL_REF_TEMP 25.0
+
+/* Diferencia mínima del valor del ADC entre dos puntos de calibración. */
+#define PH_SENSOR_CAL_MIN_RAW_DELTA 50
+
+/* Diferencia de pH por debajo de la cual un nuevo punto reemplaza a uno ya cargado. */
+#define PH_SENSOR_CAL_SAME_BUFFER_DELTA 0.5
+
+/* Espacio de nombres y clave de la calibración en memoria NVS. */
+#define PH_SENSOR_NVS_NAMESPACE "ph_cal"
+#define PH_SENSOR_NVS_KEY "cal"
+
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 /* Tag para imprimir información en el LOG. */
 static const char *TAG = "pH_SENSOR_LIBRARY";
 
-/* Handle de la tarea de obtención de datos del sensor de pH */
-static TaskHandle_t xpHTaskHandle = NULL;
-
 /* Puntero a función que apuntará a la función callback pasada como argumento en la función de configuración de callback. */
 PhSensorCallbackFunction PhSensorCallback = NULL;
 
@@ -58,98 +105,209 @@ pH_sensor_ph_t pH_value = 0;
 /* Variable que representa canal de ADC1 del sensor de pH */
 pH_sensor_adc1_ch_t PH_SENSOR_ANALOG_PIN;
 
+/* Filtro de media móvil exponencial de los valores de pH. */
+static filter_ema_t pH_ema_filter;
+
+/* Mutex para el acceso a la calibración y a los puntos de calibración pendientes. */
+static SemaphoreHandle_t xPhCalibrationMutex = NULL;
+
+/* Calibración aplicada. */
+static pH_sensor_calibration_t pH_calibration;
+
+/* Puntos de calibración cargados, pendientes de aplicar. */
+static pH_sensor_calibration_t pH_calibration_pending = {0};
+
+/**
+ *  Tablas de conversión (pH a 25 °C en milésimas, por cada paso de 16 cuentas del ADC). La nueva tabla se arma en
+ *  la tabla inactiva y luego se intercambia, de forma que la conversión nunca lea una tabla a medio armar.
+ */
+static int16_t pH_cal_tables[2][PH_SENSOR_CAL_TABLE_LEN];
+static uint8_t pH_cal_table_active = 0;
+static portMUX_TYPE pH_cal_table_mux = portMUX_INITIALIZER_UNLOCKED;
+
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
-static void vTaskGetpH(void *pvParameters);
+static void pH_sensor_adc_callback(uint16_t raw);
+static float pH_sensor_get_temp(void);
+static void pH_sensor_default_calibration(pH_sensor_calibration_t *calibration);
+static bool pH_sensor_calibration_is_valid(const pH_sensor_calibration_t *calibration);
+static void pH_sensor_apply_calibration(const pH_sensor_calibration_t *calibration);
 
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
- * @brief   Tarea encargada de tomar muestras del ADC al que está conectado el sensor de pH y, a partir
- *          de la recta obtenida por calibración, calcular el valor de pH.
+ * @brief   Función callback del motor de adquisición del ADC, que recibe el valor filtrado del canal del
+ *          sensor de pH y, a partir de la tabla de conversión de la calibración, calcula el valor de pH.
  * 
- * @param pvParameters  Parámetros pasados a la tarea en su creación.
+ * @param raw   Valor filtrado del ADC (mediana de los promedios de muestras del canal).
  */
-static void vTaskGetpH(void *pvParameters)
+static void pH_sensor_adc_callback(uint16_t raw)
 {
-    while (1) {
+    /**
+     *  Se obtiene el pH a 25 °C interpolando entre los dos valores de la tabla de conversión más cercanos
+     *  al valor del ADC, en punto fijo (milésimas de pH).
+     */
+    uint32_t idx = raw >> PH_SENSOR_CAL_TABLE_SHIFT;
+    int32_t frac = raw & ((1 << PH_SENSOR_CAL_TABLE_SHIFT) - 1);
+    int32_t pH_25_milli;
 
-        /**
-         *  Variable en donde se almacenarán conversiones parciales del ADC.
-         */
-        int pH_buffer[10];
+    if(idx >= PH_SENSOR_CAL_TABLE_LEN - 1)
+    {
+        idx = PH_SENSOR_CAL_TABLE_LEN - 2;
+        frac = 1 << PH_SENSOR_CAL_TABLE_SHIFT;
+    }
 
-        /**
-         *  Se toma 1 conversión del ADC cada un tiempo (10 ms), para un total de 10 muestras.
-         */
-        for(int i = 0; i < 10; i++)
-        {
-            pH_buffer[i] = adc1_get_raw(PH_SENSOR_ANALOG_PIN);
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
+    portENTER_CRITICAL(&pH_cal_table_mux);
+    const int16_t *table = pH_cal_tables[pH_cal_table_active];
+    pH_25_milli = table[idx] + (((table[idx + 1] - table[idx]) * frac) >> PH_SENSOR_CAL_TABLE_SHIFT);
+    portEXIT_CRITICAL(&pH_cal_table_mux);
+
+    /**
+     *  Se compensa la pendiente del electrodo con la temperatura actual de la solución, alrededor del
+     *  punto isopotencial (pH 7).
+     */
+    float temp_comp = (PH_SENSOR_CAL_REF_TEMP + 273.15) / (pH_sensor_get_temp() + 273.15);
+    float pH_measured = 7.0 + ((pH_25_milli - 7 * PH_SENSOR_CAL_SCALE) / (float) PH_SENSOR_CAL_SCALE) * temp_comp;
+
+    pH_value = filter_ema_add(&pH_ema_filter, pH_measured);
+
+    /**
+     *  Se ejecuta la función callback configurada.
+     */
+    if(PhSensorCallback != NULL)
+    {
+        PhSensorCallback(NULL);
+    }
+}
+
+
+
+/**
+ * @brief   Función que obtiene la temperatura de la solución del sensor DS18B20. Si no hay un dato válido,
+ *          se utiliza la temperatura de referencia.
+ * 
+ * @return float    Temperatura de la solución, en °C.
+ */
+static float pH_sensor_get_temp(void)
+{
+    DS18B20_sensor_temp_t temp;
+
+    if(DS18B20_getTemp(&temp) != ESP_OK)
+    {
+        return PH_SENSOR_CAL_REF_TEMP;
+    }
+
+    return temp;
+}
+
+
+
+/**
+ * @brief   Función que carga la calibración por defecto, a partir de la recta obtenida en la calibración
+ *          inicial del sensor (puntos de pH 4 y 10 a 25 °C).
+ * 
+ * @param calibration   Calibración donde se carga la calibración por defecto.
+ */
+static void pH_sensor_default_calibration(pH_sensor_calibration_t *calibration)
+{
+    const float buffers_pH[2] = {10, 4};
+
+    memset(calibration, 0, sizeof(pH_sensor_calibration_t));
+    calibration->num_points = 2;
+
+    for(int i = 0; i < 2; i++)
+    {
+        float voltage = (buffers_pH[i] - PH_SENSOR_DEFAULT_OFFSET) / PH_SENSOR_DEFAULT_SLOPE;
+
+        calibration->points[i].buffer_pH = buffers_pH[i];
+        calibration->points[i].raw = (uint16_t) lroundf(voltage * (4096.0 / 3.3));
+        calibration->points[i].temp = PH_SENSOR_CAL_REF_TEMP;
+    }
+}
+
+
+
+/**
+ * @brief   Función que verifica que una calibración sea válida: 2 o 3 puntos ordenados por valor del ADC, con una
+ *          separación mínima entre ellos, y con la misma pendiente (signo) en todos los tramos.
+ * 
+ * @param calibration   Calibración a verificar.
+ * @return true     La calibración es válida.
+ * @return false    La calibración no es válida.
+ */
+static bool pH_sensor_calibration_is_valid(const pH_sensor_calibration_t *calibration)
+{
+    if(calibration->num_points < 2 || calibration->num_points > PH_SENSOR_CAL_MAX_POINTS)
+    {
+        return 0;
+    }
 
-        /**
-         *  Variable auxiliar para realizar ordenamiento del arreglo de conversiones de ADC.
-         */
-        int pH_aux=0;
+    float first_delta = calibration->points[1].buffer_pH - calibration->points[0].buffer_pH;
 
-        /**
-         *  Se ordenan los valores del menor al mayor con el método de la burbuja.
-         */
-        for(int i=1; i < 10; i++)
+    for(int i = 1; i < calibration->num_points; i++)
+    {
+        const pH_sensor_cal_point_t *p0 = &calibration->points[i - 1];
+        const pH_sensor_cal_point_t *p1 = &calibration->points[i];
+
+        if(p1->raw < p0->raw + PH_SENSOR_CAL_MIN_RAW_DELTA || (p1->buffer_pH - p0->buffer_pH) * first_delta <= 0)
         {
-            for(int j=0; j < 10-i; j++)
-            {
-                if(pH_buffer[j] > pH_buffer[j+1])
-                {
-                    pH_aux = pH_buffer[j];
-                    pH_buffer[j]=pH_buffer[j+1];
-                    pH_buffer[j+1]=pH_aux;
-                }
-            }  
+            return 0;
         }
+    }
+
+    return 1;
+}
+
 
-        /**
-         *  A partir del valor medio del arreglo de conversiones calculamos el valor de tensión correspondiente
-         *  al valor digital de dicha muestra, con la fórmula:
-         * 
-         *  V = valor_digital * (V_max / resolución_adc)
-         * 
-         *  Donde:
-         *      -valor_digital: el valor obtenido del ADC.
-         *      -V_max: el máximo valor de tensión aceptado por el ADC.
-         *      -resolución_adc: la resolución del ADC.
-         */
-        float pH_voltage;
-        
-        pH_voltage = pH_buffer[5] * (3.3 / 4096.0);
-        
-        /**
-         *  A partir de la calibración mencionada anteriormente, se obtiene la recta:
-         *  
-         *  pH = m * pH_voltage + h
-         * 
-         *  Obteniendo de la calibración los valores de pendiente y ordenada al origen de la recta, en nuestro caso:
-         * 
-         *  m = -5.21
-         *  h = 21.11
-         * 
-         *  Donde se puede notar que la pendiente es negativa, por lo que a mayor pH, menor valor de tensión en la entrada.
-         */
-        pH_value = -5.21 * pH_voltage + 21.11;
-
-        /**
-         *  Se ejecuta la función callback configurada.
-         */
-        if(PhSensorCallback != NULL)
+
+/**
+ * @brief   Función que arma la tabla de conversión a partir de una calibración válida, y la aplica.
+ * 
+ *          Cada punto se lleva a su pH equivalente a 25 °C, y entre los puntos se interpola linealmente
+ *          (recta por tramos), extrapolando los tramos extremos fuera del rango calibrado.
+ * 
+ * @param calibration   Calibración a aplicar.
+ */
+static void pH_sensor_apply_calibration(const pH_sensor_calibration_t *calibration)
+{
+    float pH_25[PH_SENSOR_CAL_MAX_POINTS];
+    int16_t *table = pH_cal_tables[!pH_cal_table_active];
+
+    for(int i = 0; i < calibration->num_points; i++)
+    {
+        const pH_sensor_cal_point_t *p = &calibration->points[i];
+        pH_25[i] = 7.0 + (p->buffer_pH - 7.0) * ((p->temp + 273.15) / (PH_SENSOR_CAL_REF_TEMP + 273.15));
+    }
+
+    for(int i = 0; i < PH_SENSOR_CAL_TABLE_LEN; i++)
+    {
+        int raw = i << PH_SENSOR_CAL_TABLE_SHIFT;
+        int seg = 0;
+
+        while(seg < calibration->num_points - 2 && raw >= calibration->points[seg + 1].raw)
         {
-            PhSensorCallback(NULL);
+            seg++;
         }
-        
-        vTaskDelay(pdMS_TO_TICKS(3000));
+
+        const pH_sensor_cal_point_t *p0 = &calibration->points[seg];
+        const pH_sensor_cal_point_t *p1 = &calibration->points[seg + 1];
+
+        float value = pH_25[seg] + (raw - p0->raw) * (pH_25[seg + 1] - pH_25[seg]) / (p1->raw - p0->raw);
+        long milli = lroundf(value * PH_SENSOR_CAL_SCALE);
+
+        table[i] = milli > INT16_MAX ? INT16_MAX : (milli < INT16_MIN ? INT16_MIN : milli);
     }
+
+    /**
+     *  Se intercambia la tabla activa, y se guarda la calibración aplicada.
+     */
+    portENTER_CRITICAL(&pH_cal_table_mux);
+    pH_cal_table_active = !pH_cal_table_active;
+    portEXIT_CRITICAL(&pH_cal_table_mux);
+
+    pH_calibration = *calibration;
 }
 
 //==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
@@ -169,48 +327,56 @@ esp_err_t ph_sensor_init(pH_sensor_adc1_ch_t pH_sens_analog_pin)
      */
     PH_SENSOR_ANALOG_PIN = pH_sens_analog_pin;
 
+    ESP_RETURN_ON_ERROR(filter_ema_init(&pH_ema_filter, PH_SENSOR_EMA_ALPHA), TAG, "Failed to initialize pH filter.");
+
+    //========================| CALIBRACIÓN |===========================//
+
     /**
-     *  Se configura la resolución del ADC, en este caso, de 12 bits.
+     *  Se crea el mutex de acceso a la calibración.
      */
-    ESP_RETURN_ON_ERROR(adc1_config_width(ADC_WIDTH_BIT_12), TAG, "Failed to config ADC width.");
+    if(xPhCalibrationMutex == NULL)
+    {
+        xPhCalibrationMutex = xSemaphoreCreateMutex();
+
+        if(xPhCalibrationMutex == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create pH calibration mutex.");
+            return ESP_ERR_NO_MEM;
+        }
+    }
 
     /**
-     *  Se configura el nivel de atenuación del ADC, en este caso, de 11 dB, lo que implica un
-     *  rango de tensión de hasta aproximadamente 3,1 V.
+     *  Se carga la calibración guardada en memoria NVS. Si no hay una calibración guardada, o no es válida,
+     *  se utiliza la calibración por defecto.
      */
-    ESP_RETURN_ON_ERROR(adc1_config_channel_atten(pH_sens_analog_pin, ADC_ATTEN_DB_11), TAG, "Failed to config ADC attenuation.");
+    pH_sensor_calibration_t calibration;
+    size_t calibration_size = sizeof(calibration);
+    nvs_handle_t nvs_handle;
+    bool calibration_loaded = 0;
 
+    if(nvs_open(PH_SENSOR_NVS_NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK)
+    {
+        calibration_loaded = nvs_get_blob(nvs_handle, PH_SENSOR_NVS_KEY, &calibration, &calibration_size) == ESP_OK &&
+                            calibration_size == sizeof(calibration) && pH_sensor_calibration_is_valid(&calibration);
+        nvs_close(nvs_handle);
+    }
 
+    if(!calibration_loaded)
+    {
+        ESP_LOGW(TAG, "No pH calibration stored, using default calibration.");
+        pH_sensor_default_calibration(&calibration);
+    }
 
-    //========================| CREACIÓN DE TAREA |===========================//
+    xSemaphoreTake(xPhCalibrationMutex, portMAX_DELAY);
+    pH_sensor_apply_calibration(&calibration);
+    xSemaphoreGive(xPhCalibrationMutex);
 
     /**
-     *  Se crea la tarea encargada de obtener el valor de pH a partir del valor de tensión
-     *  entregado por el sensor.
-     * 
-     *  Se le da un nivel de prioridad bajo considerando que la dinámica de la evolución
-     *  del pH en la solución es muy lenta, y en la tarea solamente se obtiene una conversión
-     *  del ADC y se realizan cálculos en base a la misma.
+     *  Se agrega el canal al motor de adquisición continua del ADC1, que muestrea el canal, filtra
+     *  las muestras y ejecuta la función callback de cálculo del pH cada PH_SENSOR_PERIOD_MS.
      */
-    if(xpHTaskHandle == NULL)
-    {
-        xTaskCreate(
-            vTaskGetpH,
-            "vTaskGetpH",
-            2048,
-            NULL,
-            6,
-            &xpHTaskHandle);
-        
-        /**
-         *  En caso de que el handle sea NULL, implica que no se pudo crear la tarea, y se retorna con error.
-         */
-        if(xpHTaskHandle == NULL)
-        {
-            ESP_LOGE(TAG, "Failed to create vTaskGetpH task.");
-            return ESP_FAIL;
-        }
-    }
+    ESP_RETURN_ON_ERROR(adc_engine_add_channel(pH_sens_analog_pin, PH_SENSOR_PERIOD_MS, pH_sensor_adc_callback), 
+                        TAG, "Failed to add ADC channel.");
 
     return ESP_OK;
 }
@@ -242,4 +408,201 @@ esp_err_t pH_getValue(pH_sensor_ph_t *pH_value_buffer)
 void pH_sensor_callback_function_on_new_measurment(PhSensorCallbackFunction callback_function)
 {
     PhSensorCallback = callback_function;
+}
+
+
+
+/**
+ * @brief   Función para cargar un punto de calibración, con el transductor colocado en una solución buffer. Se
+ *          guarda el valor filtrado actual del ADC y la temperatura de la solución. Si ya había un punto cargado
+ *          con una solución de pH similar, se reemplaza.
+ * 
+ * @param buffer_pH     pH de la solución buffer (por ejemplo, 4, 7 o 10).
+ * @return esp_err_t    ESP_ERR_INVALID_SIZE si ya se cargaron PH_SENSOR_CAL_MAX_POINTS puntos distintos.
+ */
+esp_err_t pH_sensor_calibration_add_point(float buffer_pH)
+{
+    ESP_RETURN_ON_FALSE(xPhCalibrationMutex != NULL, ESP_ERR_INVALID_STATE, TAG, "pH sensor not initialized.");
+    ESP_RETURN_ON_FALSE(buffer_pH > 0 && buffer_pH < 14, ESP_ERR_INVALID_ARG, TAG, "Invalid buffer pH.");
+
+    pH_sensor_cal_point_t point = {
+        .buffer_pH = buffer_pH,
+        .temp = pH_sensor_get_temp(),
+    };
+
+    ESP_RETURN_ON_ERROR(adc_engine_get_raw(PH_SENSOR_ANALOG_PIN, &point.raw), TAG, "No pH sensor data.");
+
+    esp_err_t ret = ESP_OK;
+
+    xSemaphoreTake(xPhCalibrationMutex, portMAX_DELAY);
+
+    int i;
+
+    for(i = 0; i < pH_calibration_pending.num_points; i++)
+    {
+        if(fabsf(pH_calibration_pending.points[i].buffer_pH - buffer_pH) < PH_SENSOR_CAL_SAME_BUFFER_DELTA)
+        {
+            break;
+        }
+    }
+
+    if(i < PH_SENSOR_CAL_MAX_POINTS)
+    {
+        pH_calibration_pending.points[i] = point;
+
+        if(i == pH_calibration_pending.num_points)
+        {
+            pH_calibration_pending.num_points++;
+        }
+
+        ESP_LOGI(TAG, "pH calibration point %d: pH %.2f, raw %u, %.1f C", i, buffer_pH, point.raw, point.temp);
+    }
+
+    else
+    {
+        ret = ESP_ERR_INVALID_SIZE;
+    }
+
+    xSemaphoreGive(xPhCalibrationMutex);
+
+    return ret;
+}
+
+
+
+/**
+ * @brief   Función para aplicar los puntos de calibración cargados (al menos 2) y guardarlos en memoria NVS. Si
+ *          los puntos no forman una calibración válida, se mantiene la calibración anterior.
+ * 
+ * @return esp_err_t    ESP_ERR_INVALID_STATE si los puntos no forman una calibración válida.
+ */
+esp_err_t pH_sensor_calibration_commit(void)
+{
+    ESP_RETURN_ON_FALSE(xPhCalibrationMutex != NULL, ESP_ERR_INVALID_STATE, TAG, "pH sensor not initialized.");
+
+    xSemaphoreTake(xPhCalibrationMutex, portMAX_DELAY);
+
+    /**
+     *  Se ordenan los puntos por valor del ADC.
+     */
+    pH_sensor_calibration_t calibration = pH_calibration_pending;
+
+    for(int i = 1; i < calibration.num_points; i++)
+    {
+        pH_sensor_cal_point_t point = calibration.points[i];
+        int j = i - 1;
+
+        while(j >= 0 && calibration.points[j].raw > point.raw)
+        {
+            calibration.points[j + 1] = calibration.points[j];
+            j--;
+        }
+
+        calibration.points[j + 1] = point;
+    }
+
+    if(!pH_sensor_calibration_is_valid(&calibration))
+    {
+        xSemaphoreGive(xPhCalibrationMutex);
+        ESP_LOGE(TAG, "Invalid pH calibration points.");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pH_sensor_apply_calibration(&calibration);
+    memset(&pH_calibration_pending, 0, sizeof(pH_calibration_pending));
+
+    /**
+     *  Se guarda la calibración en memoria NVS. Si no se puede guardar, la calibración queda aplicada
+     *  igualmente hasta el próximo reinicio.
+     */
+    nvs_handle_t nvs_handle;
+    esp_err_t ret = nvs_open(PH_SENSOR_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+
+    if(ret == ESP_OK)
+    {
+        ret = nvs_set_blob(nvs_handle, PH_SENSOR_NVS_KEY, &calibration, sizeof(calibration));
+
+        if(ret == ESP_OK)
+        {
+            ret = nvs_commit(nvs_handle);
+        }
+
+        nvs_close(nvs_handle);
+    }
+
+    xSemaphoreGive(xPhCalibrationMutex);
+
+    ESP_RETURN_ON_ERROR(ret, TAG, "Failed to store pH calibration.");
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para descartar los puntos de calibración cargados y no aplicados.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t pH_sensor_calibration_clear(void)
+{
+    ESP_RETURN_ON_FALSE(xPhCalibrationMutex != NULL, ESP_ERR_INVALID_STATE, TAG, "pH sensor not initialized.");
+
+    xSemaphoreTake(xPhCalibrationMutex, portMAX_DELAY);
+    memset(&pH_calibration_pending, 0, sizeof(pH_calibration_pending));
+    xSemaphoreGive(xPhCalibrationMutex);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para volver a la calibración por defecto, borrando la calibración guardada en memoria NVS.
+ * 
+ * @return esp_err_t 
+ */
+esp_err_t pH_sensor_calibration_reset(void)
+{
+    ESP_RETURN_ON_FALSE(xPhCalibrationMutex != NULL, ESP_ERR_INVALID_STATE, TAG, "pH sensor not initialized.");
+
+    pH_sensor_calibration_t calibration;
+    pH_sensor_default_calibration(&calibration);
+
+    xSemaphoreTake(xPhCalibrationMutex, portMAX_DELAY);
+
+    pH_sensor_apply_calibration(&calibration);
+    memset(&pH_calibration_pending, 0, sizeof(pH_calibration_pending));
+
+    nvs_handle_t nvs_handle;
+
+    if(nvs_open(PH_SENSOR_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK)
+    {
+        nvs_erase_key(nvs_handle, PH_SENSOR_NVS_KEY);
+        nvs_commit(nvs_handle);
+        nvs_close(nvs_handle);
+    }
+
+    xSemaphoreGive(xPhCalibrationMutex);
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para obtener la calibración aplicada.
+ * 
+ * @param calibration   Variable donde se guardará la calibración.
+ */
+void pH_sensor_get_calibration(pH_sensor_calibration_t *calibration)
+{
+    if(calibration == NULL || xPhCalibrationMutex == NULL)
+    {
+        return;
+    }
+
+    xSemaphoreTake(xPhCalibrationMutex, portMAX_DELAY);
+    *calibration = pH_calibration;
+    xSemaphoreGive(xPhCalibrationMutex);
 }
\ No newline at end of file
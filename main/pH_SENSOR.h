@@ -14,6 +14,7 @@ extern "C" {
 /*==================[INCLUDES]=============================================*/
 
 #include <stdio.h>
+#include <stdint.h>
 #include "esp_err.h"
 #include "driver/adc.h"
 #include "freertos/FreeRTOS.h"
@@ -24,6 +25,26 @@ extern "C" {
 typedef adc1_channel_t pH_sensor_adc1_ch_t;
 typedef float pH_sensor_ph_t;
 
+/* Cantidad máxima de puntos de calibración (soluciones buffer de pH 4, 7 y 10). */
+#define PH_SENSOR_CAL_MAX_POINTS 3
+
+/* Cantidad de bits del valor del ADC que se descartan para indexar la tabla de conversión (pasos de 16 cuentas). */
+#define PH_SENSOR_CAL_TABLE_SHIFT 4
+#define PH_SENSOR_CAL_TABLE_LEN ((4096 >> PH_SENSOR_CAL_TABLE_SHIFT) + 1)
+
+/* Punto de calibración: valor del ADC medido en una solución buffer, a una temperatura dada. */
+typedef struct {
+    float buffer_pH;        /* pH de la solución buffer. */
+    uint16_t raw;           /* Valor filtrado del ADC medido. */
+    float temp;             /* Temperatura de la solución al medir, en °C. */
+} pH_sensor_cal_point_t;
+
+/* Calibración del sensor de pH, tal como se guarda en memoria NVS. */
+typedef struct {
+    uint8_t num_points;                                         /* Cantidad de puntos de calibración (2 o 3). */
+    pH_sensor_cal_point_t points[PH_SENSOR_CAL_MAX_POINTS];     /* Puntos ordenados por valor del ADC. */
+} pH_sensor_calibration_t;
+
 /**
  *  @brief  Puntero a función que será utilizado para ejecutar la función que se pase
  *          como callback cuando finalice una nueva conversión del sensor.
@@ -38,6 +59,12 @@ esp_err_t ph_sensor_init(pH_sensor_adc1_ch_t pH_sens_analog_pin);
 esp_err_t pH_getValue(pH_sensor_ph_t *pH_value_buffer);
 void pH_sensor_callback_function_on_new_measurment(PhSensorCallbackFunction callback_function);
 
+esp_err_t pH_sensor_calibration_add_point(float buffer_pH);
+esp_err_t pH_sensor_calibration_commit(void);
+esp_err_t pH_sensor_calibration_clear(void);
+esp_err_t pH_sensor_calibration_reset(void);
+void pH_sensor_get_calibration(pH_sensor_calibration_t *calibration);
+
 /*==================[END OF FILE]============================================*/
 
 #ifdef __cplusplus
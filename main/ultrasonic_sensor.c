@@ -38,32 +38,86 @@
 
 #define TRIGGER_LOW_DELAY 4         //Tiempo de estado en bajo al inicio de una transmisión
 #define TRIGGER_HIGH_DELAY 10       //Tiempo de estado en alto en el pulso de inicio de una transmisión
-#define TIMEOUT_TIME_ms 50          //Tiempo que se está dispuesto a esperar luego de mandar el pulso de inicio de transmisión para ser considerado como error de timeout
-#define TIME_TO_CM_CONST 58         //Constante para convertir el valor de tiempo de pulso recibido desde el sensor a distancia en cm
 
-/* Macros para definir areas críticas en el código, que deshabilitan las interrupciones. */
-static portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-#define PORT_ENTER_CRITICAL portENTER_CRITICAL(&mux)
-#define PORT_EXIT_CRITICAL portEXIT_CRITICAL(&mux)
-
-/* Macro para controlar si expiró el tiempo de espera de respuesta del sensor. */
-#define timeout_expired(start, len) ((esp_timer_get_time() - (start)) >= (len))
+/**
+ *  Tabla de conversión de la duración del pulso de respuesta a distancia en cm (cm/us, ida y vuelta), en función de la
+ *  temperatura del aire, desde ULTRASONIC_TEMP_TABLE_MIN hasta ULTRASONIC_TEMP_TABLE_MAX °C cada ULTRASONIC_TEMP_TABLE_STEP °C.
+ *  Se calcula como c(T) / 2, con c(T) = 331,3 * sqrt(1 + T / 273,15) m/s.
+ */
+#define ULTRASONIC_TEMP_TABLE_MIN (-20)
+#define ULTRASONIC_TEMP_TABLE_MAX 60
+#define ULTRASONIC_TEMP_TABLE_STEP 4
 
 /* Macros para control de variables y de excepciones. */
 #define CHECK_ARG(VAL) do { if (!(VAL)) return ESP_ERR_INVALID_ARG; } while (0)
 #define CHECK(x) do { esp_err_t __; if ((__ = x) != ESP_OK) return __; } while (0)
-#define RETURN_CRITICAL(RES) do { PORT_EXIT_CRITICAL; return RES; } while(0)
 
 //==================================| INTERNAL DATA DEFINITION |==================================//
 
 static const char* TAG = "ULTRASONIC_SENSOR_LIBRARY";
 
+/* Estructura con el estado de captura del pulso de respuesta de cada sensor. */
+typedef struct {
+    gpio_num_t pin;                     /* Pin de datos (TRIGG-ECHO) del sensor. */
+    bool busy;                          /* Hay una medición en curso. */
+    int64_t trigger_us;                 /* Instante del pulso de inicio de la medición en curso. */
+    volatile int64_t echo_rise_us;      /* Instante del flanco de subida del pulso de respuesta (0 si no ocurrió). */
+    volatile int64_t echo_fall_us;      /* Instante del flanco de bajada del pulso de respuesta (0 si no ocurrió). */
+    TaskHandle_t waiting_task;          /* Tarea a notificar al finalizar el pulso de respuesta. */
+} ultrasonic_capture_t;
+
+/* Estado de captura de cada sensor inicializado. */
+static ultrasonic_capture_t ultrasonic_captures[ULTRASONIC_MAX_SENSORS];
+static int ultrasonic_captures_num = 0;
+
+static const float ultrasonic_cm_per_us_table[] = {
+    0.0159470f, 0.0160725f, 0.0161970f, 0.0163206f, 0.0164433f, 0.0165650f, 0.0166858f,
+    0.0168058f, 0.0169250f, 0.0170433f, 0.0171607f, 0.0172774f, 0.0173933f, 0.0175084f,
+    0.0176228f, 0.0177365f, 0.0178494f, 0.0179616f, 0.0180731f, 0.0181839f, 0.0182941f,
+};
+
+/* Constante de conversión de tiempo de pulso a distancia para la temperatura del aire actual (20 °C por defecto). */
+static float ultrasonic_cm_per_us = 0.0171607f;
+
 //==================================| EXTERNAL DATA DEFINITION |==================================//
 
 //==================================| INTERNAL FUNCTIONS DECLARATION |==================================//
 
+static void IRAM_ATTR ultrasonic_echo_isr_handler(void *arg);
+
 //==================================| INTERNAL FUNCTIONS DEFINITION |==================================//
 
+/**
+ * @brief   Rutina de interrupción de los flancos del pin de datos (TRIGG-ECHO) durante una medición. Guarda el
+ *          instante de los flancos de subida y bajada del pulso de respuesta y, al finalizar el pulso, deshabilita
+ *          la interrupción y notifica a la tarea que inició la medición, con el bit correspondiente al sensor.
+ * 
+ * @param arg   Estado de captura del sensor.
+ */
+static void IRAM_ATTR ultrasonic_echo_isr_handler(void *arg)
+{
+    ultrasonic_capture_t *capture = (ultrasonic_capture_t *) arg;
+    int64_t now_us = esp_timer_get_time();
+
+    if(gpio_get_level(capture->pin))
+    {
+        if(capture->echo_rise_us == 0)
+        {
+            capture->echo_rise_us = now_us;
+        }
+    }
+
+    else if(capture->echo_rise_us != 0 && capture->echo_fall_us == 0)
+    {
+        capture->echo_fall_us = now_us;
+        gpio_intr_disable(capture->pin);
+
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xTaskNotifyFromISR(capture->waiting_task, BIT(capture - ultrasonic_captures), eSetBits, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
 //==================================| EXTERNAL FUNCTIONS DEFINITION |==================================//
 
 /**
@@ -74,100 +128,272 @@ static const char* TAG = "ULTRASONIC_SENSOR_LIBRARY";
  */
 esp_err_t ultrasonic_sensor_init(ultrasonic_sens_t *ultrasonic_sens_descr)
 {
+    ESP_RETURN_ON_FALSE(ultrasonic_captures_num < ULTRASONIC_MAX_SENSORS, ESP_ERR_NO_MEM, TAG, "Too many ultrasonic sensors.");
+
+    /**
+     *  Se asigna al sensor un estado de captura propio, de forma que puedan realizarse mediciones
+     *  de distintos sensores en simultáneo.
+     */
+    ultrasonic_capture_t *capture = &ultrasonic_captures[ultrasonic_captures_num];
+    capture->pin = ultrasonic_sens_descr->trigg_echo_pin;
+    capture->busy = 0;
+
     /* Se establece el pin común a TRIGGER y ECHO como OUTPUT inicialmente */
     gpio_set_direction(ultrasonic_sens_descr->trigg_echo_pin, GPIO_MODE_OUTPUT);
 
     /* Se inicializa el pin en 0 */
-    return gpio_set_level(ultrasonic_sens_descr->trigg_echo_pin, 0);
+    ESP_RETURN_ON_ERROR(gpio_set_level(ultrasonic_sens_descr->trigg_echo_pin, 0), TAG, "Failed to set pin level.");
+
+    /**
+     *  Se configura la interrupción por ambos flancos del pin, que se mantiene deshabilitada fuera de las mediciones.
+     *  Si el servicio de interrupciones ya fue instalado por otro módulo, no se considera un error.
+     */
+    ESP_RETURN_ON_ERROR(gpio_set_intr_type(ultrasonic_sens_descr->trigg_echo_pin, GPIO_INTR_ANYEDGE), 
+                        TAG, "Failed to set interrupt type.");
+    gpio_intr_disable(ultrasonic_sens_descr->trigg_echo_pin);
+
+    esp_err_t isr_service_ret = gpio_install_isr_service(0);
+    ESP_RETURN_ON_FALSE(isr_service_ret == ESP_OK || isr_service_ret == ESP_ERR_INVALID_STATE, isr_service_ret, 
+                        TAG, "Failed to install ISR.");
+
+    ESP_RETURN_ON_ERROR(gpio_isr_handler_add(ultrasonic_sens_descr->trigg_echo_pin, ultrasonic_echo_isr_handler, capture), 
+                        TAG, "Failed to add the ISR handler.");
+
+    ultrasonic_sens_descr->capture_idx = ultrasonic_captures_num++;
+
+    return ESP_OK;
 }
 
 
 
 /**
- * @brief   Función utilizada para obtener la distancia en "cm" respecto de el objeto más cercano al que esté apuntando
- *          el sensor ultrasónico (también un cuerpo de agua).
+ * @brief   Función para iniciar una medición de distancia sin esperar su resultado. Al finalizar el pulso de respuesta,
+ *          la tarea que llama a esta función recibe una notificación (eSetBits) con el bit del sensor, devuelto en
+ *          "notify_bit". El resultado se obtiene luego con "ultrasonic_get_distance_cm()".
  * 
  * @param ultrasonic_sens_descr     Estructura que contiene el pin de datos (TRIGG-ECHO) del sensor ultrasónico.
- * @param distance_cm       Variable donde se guarda la distancia en cm respecto al objeto más cercano.
- * @return esp_err_t 
+ * @param notify_bit    Variable donde se guarda el bit de notificación del sensor (puede ser NULL).
+ * @return esp_err_t    ESP_ERR_INVALID_STATE si ya hay una medición en curso en el sensor.
  */
-esp_err_t ultrasonic_measure_distance_cm(ultrasonic_sens_t *ultrasonic_sens_descr, float *distance_cm)
+esp_err_t ultrasonic_start_measurement(ultrasonic_sens_t *ultrasonic_sens_descr, uint32_t *notify_bit)
 {
+    ESP_RETURN_ON_FALSE(ultrasonic_sens_descr->capture_idx < ultrasonic_captures_num &&
+                        ultrasonic_captures[ultrasonic_sens_descr->capture_idx].pin == ultrasonic_sens_descr->trigg_echo_pin, 
+                        ESP_ERR_INVALID_STATE, TAG, "Ultrasonic sensor not initialized.");
+
+    ultrasonic_capture_t *capture = &ultrasonic_captures[ultrasonic_sens_descr->capture_idx];
+    gpio_num_t pin = capture->pin;
+
+    ESP_RETURN_ON_FALSE(!capture->busy, ESP_ERR_INVALID_STATE, TAG, "Measurement already in progress.");
+
 
     /*====================| PULSO DE INICIO DE CONVERSIÓN |====================*/
 
     /* 
-        Se ingresa a sección critica, donde no se debe interrumpir el proceso de comunicación con el sensor,
-        por lo que se desactivan las interrupciones.
+        Se envía un pulso de al menos 10us al sensor ultrasonico para iniciar la conversión de distancia. No se
+        deshabilitan las interrupciones: si el pulso se extiende por una interrupción, el sensor igualmente inicia
+        la conversión.
     */
-    PORT_ENTER_CRITICAL;
+    gpio_set_direction(pin, GPIO_MODE_OUTPUT);
 
-    /* Se envía un pulso de 10us al sensor ultrasonico para iniciar la conversión de distancia */
-    gpio_set_direction(ultrasonic_sens_descr->trigg_echo_pin, GPIO_MODE_OUTPUT);
-
-    gpio_set_level(ultrasonic_sens_descr->trigg_echo_pin, 0);
+    gpio_set_level(pin, 0);
     ets_delay_us(TRIGGER_LOW_DELAY);
-    gpio_set_level(ultrasonic_sens_descr->trigg_echo_pin, 1);
+    gpio_set_level(pin, 1);
     ets_delay_us(TRIGGER_HIGH_DELAY);
-    gpio_set_level(ultrasonic_sens_descr->trigg_echo_pin, 0);
+    gpio_set_level(pin, 0);
 
 
     /*====================| ESPERA DE RESPUESTA |====================*/
 
     /* 
-        Se espera el pulso de respuesta del sensor. Si transcurre cierto tiempo (timeout) y no
-        llega el puslo de respuesta, se retorna con un mensaje de error.
+        Se pasa el pin a entrada y se habilita su interrupción, que toma el instante de los flancos del
+        pulso de respuesta.
     */
-    gpio_set_direction(ultrasonic_sens_descr->trigg_echo_pin, GPIO_MODE_INPUT);
+    capture->echo_rise_us = 0;
+    capture->echo_fall_us = 0;
+    capture->waiting_task = xTaskGetCurrentTaskHandle();
+    capture->trigger_us = esp_timer_get_time();
+    capture->busy = 1;
 
-    int64_t start = esp_timer_get_time();
-    while (!gpio_get_level(ultrasonic_sens_descr->trigg_echo_pin))
+    gpio_set_direction(pin, GPIO_MODE_INPUT);
+    gpio_intr_enable(pin);
+
+    if(notify_bit != NULL)
     {
-        if (timeout_expired(start, 20000))
-        {
-            RETURN_CRITICAL(ESP_ERR_ULTRASONIC_PING_TIMEOUT);
-        }
+        *notify_bit = BIT(ultrasonic_sens_descr->capture_idx);
     }
 
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función para obtener el resultado de una medición iniciada con "ultrasonic_start_measurement()".
+ * 
+ * @param ultrasonic_sens_descr     Estructura que contiene el pin de datos (TRIGG-ECHO) del sensor ultrasónico.
+ * @param distance_cm       Variable donde se guarda la distancia en cm respecto al objeto más cercano.
+ * @return esp_err_t    ESP_ERR_ULTRASONIC_IN_PROGRESS si la medición sigue en curso, ESP_ERR_ULTRASONIC_PING_TIMEOUT o
+ *                      ESP_ERR_ULTRASONIC_ECHO_TIMEOUT si se cumplió el tiempo de espera sin recibir el pulso de respuesta
+ *                      completo, o ESP_ERR_INVALID_STATE si no hay una medición iniciada.
+ */
+esp_err_t ultrasonic_get_distance_cm(ultrasonic_sens_t *ultrasonic_sens_descr, float *distance_cm)
+{
+    ESP_RETURN_ON_FALSE(ultrasonic_sens_descr->capture_idx < ultrasonic_captures_num &&
+                        ultrasonic_captures[ultrasonic_sens_descr->capture_idx].pin == ultrasonic_sens_descr->trigg_echo_pin, 
+                        ESP_ERR_INVALID_STATE, TAG, "Ultrasonic sensor not initialized.");
+
+    ultrasonic_capture_t *capture = &ultrasonic_captures[ultrasonic_sens_descr->capture_idx];
 
-    /*====================| RECEPCIÓN DE PULSO DE RESPUESTA |====================*/
+    if(!capture->busy)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t echo_start = capture->echo_rise_us;
+    int64_t echo_end = capture->echo_fall_us;
 
     /* 
-        Una vez recibido el pulso, se sabe que la duración del mismo es directamente proporcional a 
-        la distancia respecto del objeto que reflejó la señal ultrasonica. Por lo tanto, debe medirse
-        dicho tiempo para conocer la distancia en cm.
+        Si el pulso de respuesta no finalizó, y no se cumplió el tiempo de espera (timeout), la medición
+        sigue en curso. Si se cumplió, se retorna con un mensaje de error según si llegó o no el pulso.
     */
-    int64_t echo_start = esp_timer_get_time();
-    int64_t time = echo_start;
-    while (gpio_get_level(ultrasonic_sens_descr->trigg_echo_pin))
+    if(echo_end == 0)
     {
-        time = esp_timer_get_time();
-        if (timeout_expired(echo_start, 400 * 5800.0f))
+        if(esp_timer_get_time() - capture->trigger_us < ULTRASONIC_TIMEOUT_MS * 1000)
         {
-            RETURN_CRITICAL(ESP_ERR_ULTRASONIC_ECHO_TIMEOUT);
+            return ESP_ERR_ULTRASONIC_IN_PROGRESS;
         }
-    }
 
+        gpio_intr_disable(capture->pin);
+        capture->busy = 0;
 
-    /* 
-        Fin de sección crítica, se reactivan las interrupciones.
-    */
-    PORT_EXIT_CRITICAL;
+        return (echo_start == 0) ? ESP_ERR_ULTRASONIC_PING_TIMEOUT : ESP_ERR_ULTRASONIC_ECHO_TIMEOUT;
+    }
+
+    capture->busy = 0;
 
 
     /*====================| CÁLCULO DE DISTANCIA EN CM |====================*/
 
     /* 
         En base a la duración del pulso de respuesta, se calcula la distancia en cm a partir
-        de una constante de conversión de tiempo a cm.
+        de la constante de conversión de tiempo a cm correspondiente a la temperatura del aire.
     */
 
-    uint32_t ultrasonic_pulse_time = time - echo_start;
+    uint32_t ultrasonic_pulse_time = echo_end - echo_start;
 
-    *distance_cm = ((float)ultrasonic_pulse_time) / ((float)TIME_TO_CM_CONST);
+    *distance_cm = ((float)ultrasonic_pulse_time) * ultrasonic_cm_per_us;
 
     return ESP_OK;
-    
+}
+
+
+
+/**
+ * @brief   Función para obtener la duración del pulso de respuesta de la última medición finalizada, a partir de
+ *          los instantes de sus flancos tomados en la interrupción.
+ * 
+ * @param ultrasonic_sens_descr     Estructura que contiene el pin de datos (TRIGG-ECHO) del sensor ultrasónico.
+ * @param echo_us       Variable donde se guarda la duración del pulso de respuesta en us.
+ * @return esp_err_t    ESP_ERR_INVALID_STATE si la medición sigue en curso o si no se recibió el pulso de respuesta completo.
+ */
+esp_err_t ultrasonic_get_echo_time_us(ultrasonic_sens_t *ultrasonic_sens_descr, uint32_t *echo_us)
+{
+    ESP_RETURN_ON_FALSE(ultrasonic_sens_descr->capture_idx < ultrasonic_captures_num &&
+                        ultrasonic_captures[ultrasonic_sens_descr->capture_idx].pin == ultrasonic_sens_descr->trigg_echo_pin, 
+                        ESP_ERR_INVALID_STATE, TAG, "Ultrasonic sensor not initialized.");
+
+    ultrasonic_capture_t *capture = &ultrasonic_captures[ultrasonic_sens_descr->capture_idx];
+
+    int64_t echo_start = capture->echo_rise_us;
+    int64_t echo_end = capture->echo_fall_us;
+
+    if(capture->busy || echo_start == 0 || echo_end == 0)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    *echo_us = echo_end - echo_start;
+
+    return ESP_OK;
+}
+
+
+
+/**
+ * @brief   Función utilizada para obtener la distancia en "cm" respecto de el objeto más cercano al que esté apuntando
+ *          el sensor ultrasónico (también un cuerpo de agua). La tarea queda bloqueada hasta que finalice el pulso
+ *          de respuesta, o hasta que transcurra el tiempo de espera (timeout).
+ * 
+ * @param ultrasonic_sens_descr     Estructura que contiene el pin de datos (TRIGG-ECHO) del sensor ultrasónico.
+ * @param distance_cm       Variable donde se guarda la distancia en cm respecto al objeto más cercano.
+ * @return esp_err_t 
+ */
+esp_err_t ultrasonic_measure_distance_cm(ultrasonic_sens_t *ultrasonic_sens_descr, float *distance_cm)
+{
+    uint32_t notify_bit;
+    esp_err_t ret;
+
+    ESP_RETURN_ON_ERROR(ultrasonic_start_measurement(ultrasonic_sens_descr, &notify_bit), TAG, "Failed to start measurement.");
+
+    /**
+     *  Se espera la notificación del sensor, limpiando solo su bit para no perder las de otros sensores.
+     */
+    while((ret = ultrasonic_get_distance_cm(ultrasonic_sens_descr, distance_cm)) == ESP_ERR_ULTRASONIC_IN_PROGRESS)
+    {
+        xTaskNotifyWait(0, notify_bit, NULL, pdMS_TO_TICKS(ULTRASONIC_TIMEOUT_MS));
+    }
+
+    return ret;
+}
+
+
+
+/**
+ * @brief   Función para compensar la velocidad del sonido con la temperatura del aire en la que se propaga el pulso. La
+ *          constante de conversión se interpola de una tabla precalculada, y se aplica a todas las mediciones siguientes
+ *          de todos los sensores.
+ * 
+ * @param temp_c    Temperatura del aire en °C. Fuera del rango de la tabla se toma el valor del extremo más cercano.
+ */
+void ultrasonic_set_air_temperature(float temp_c)
+{
+    const int table_len = sizeof(ultrasonic_cm_per_us_table) / sizeof(ultrasonic_cm_per_us_table[0]);
+
+    float pos = (temp_c - ULTRASONIC_TEMP_TABLE_MIN) / ULTRASONIC_TEMP_TABLE_STEP;
+
+    if(pos <= 0)
+    {
+        ultrasonic_cm_per_us = ultrasonic_cm_per_us_table[0];
+        return;
+    }
+
+    if(pos >= table_len - 1)
+    {
+        ultrasonic_cm_per_us = ultrasonic_cm_per_us_table[table_len - 1];
+        return;
+    }
+
+    int idx = (int) pos;
+    float frac = pos - idx;
+
+    ultrasonic_cm_per_us = ultrasonic_cm_per_us_table[idx] + 
+                            frac * (ultrasonic_cm_per_us_table[idx + 1] - ultrasonic_cm_per_us_table[idx]);
+}
+
+
+
+/**
+ * @brief   Función para calcular el nivel de líquido de un tanque a partir de la distancia medida por el sensor
+ *          ultrasónico, ubicado en la parte superior del tanque.
+ * 
+ * @param tank  Estructura que contiene las dimensiones del tanque (altura).
+ * @param distance_cm   Distancia medida respecto de la capa superior del líquido, en cm.
+ * @return float    Nivel de líquido en el tanque, entre 0 (tanque vacío) y 1 (tanque lleno).
+ */
+float ultrasonic_distance_to_level(const storage_tank_t *tank, float distance_cm)
+{
+    return (tank->height - distance_cm) / tank->height;
 }
 
 
@@ -199,7 +425,7 @@ esp_err_t ultrasonic_measure_level(ultrasonic_sens_t *ultrasonic_sens_descr, sto
         Se calcula el nivel de líquido presente en el tanque en por unidad, a partir de la altura del mismo y de la distancia
         medida anteriormente.
     */
-    *level = (tank->height - level_distance_cm) / tank->height;
+    *level = ultrasonic_distance_to_level(tank, level_distance_cm);
 
     return ESP_OK;
 
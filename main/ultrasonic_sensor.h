@@ -16,6 +16,7 @@ extern "C" {
 #include "driver/gpio.h"
 #include "esp_err.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 /*==================[DEFINES AND MACROS]=====================================*/
@@ -26,6 +27,13 @@ extern "C" {
 #define ESP_ERR_ULTRASONIC_PING         0x200
 #define ESP_ERR_ULTRASONIC_PING_TIMEOUT 0x201
 #define ESP_ERR_ULTRASONIC_ECHO_TIMEOUT 0x202
+#define ESP_ERR_ULTRASONIC_IN_PROGRESS  0x203
+
+/* Tiempo que se está dispuesto a esperar luego de mandar el pulso de inicio de transmisión para ser considerado como error de timeout. */
+#define ULTRASONIC_TIMEOUT_MS 50
+
+/* Cantidad máxima de sensores ultrasónicos que pueden inicializarse. */
+#define ULTRASONIC_MAX_SENSORS 8
 
 /**
  * Estructura que contiene el pin común de datos de TRIGGER y ECHO del sensor ultrasonico.
@@ -38,6 +46,7 @@ extern "C" {
 typedef struct
 {
     gpio_num_t trigg_echo_pin;      //Pin correspondiente al TRIGGER y ECHO
+    uint8_t capture_idx;            //Índice del estado de captura del sensor (asignado en la inicialización)
 } ultrasonic_sens_t;
 
 
@@ -54,7 +63,12 @@ typedef struct
 /*==================[EXTERNAL FUNCTIONS DECLARATION]=========================*/
 
 esp_err_t ultrasonic_sensor_init(ultrasonic_sens_t *ultrasonic_sens_descr);
+esp_err_t ultrasonic_start_measurement(ultrasonic_sens_t *ultrasonic_sens_descr, uint32_t *notify_bit);
+esp_err_t ultrasonic_get_distance_cm(ultrasonic_sens_t *ultrasonic_sens_descr, float *distance_cm);
+esp_err_t ultrasonic_get_echo_time_us(ultrasonic_sens_t *ultrasonic_sens_descr, uint32_t *echo_us);
 esp_err_t ultrasonic_measure_distance_cm(ultrasonic_sens_t *ultrasonic_sens_descr, float *distance_cm);
+void ultrasonic_set_air_temperature(float temp_c);
+float ultrasonic_distance_to_level(const storage_tank_t *tank, float distance_cm);
 esp_err_t ultrasonic_measure_level(ultrasonic_sens_t *ultrasonic_sens_descr, storage_tank_t *tank, float *level);
 
 /*==================[END OF FILE]============================================*/